@@ -18,18 +18,41 @@
 
 #include "miscadmin.h"
 
+#include "utils/builtins.h"
 #include "utils/guc.h"
 #include "utils/rel.h"
 
 #include "citus_version.h"
 
 #include "columnar/columnar.h"
+#include "columnar/columnar_cache.h"
+#include "columnar/columnar_compression_pool.h"
+#include "columnar/columnar_metadata_cache.h"
 #include "columnar/columnar_tableam.h"
 
 /* Default values for option parameters */
 #define DEFAULT_STRIPE_ROW_COUNT 150000
 #define DEFAULT_CHUNK_ROW_COUNT 10000
 
+/* number of blocks that scans prefetch ahead of the data they read */
+#define DEFAULT_PREFETCH_DEPTH 64
+#define PREFETCH_DEPTH_MAXIMUM 8192
+
+/* kilobytes of decoded chunks that each backend caches, 0 disables the cache */
+#define DEFAULT_CHUNK_CACHE_SIZE 0
+
+/* size of the per-backend stripe and skip list cache in kB, 0 disables it */
+#define DEFAULT_METADATA_CACHE_SIZE 4096
+
+/* number of background workers that compress chunks, 0 compresses them inline */
+#define DEFAULT_COMPRESSION_WORKERS 0
+
+/* stripes with fewer rows are written uncompressed, 0 disables staging */
+#define DEFAULT_STAGING_ROW_LIMIT 0
+
+/* chunks of auto compressed columns that compress less are stored uncompressed */
+#define DEFAULT_AUTO_COMPRESSION_MIN_RATIO 1.2
+
 #if HAVE_LIBZSTD
 #define DEFAULT_COMPRESSION_TYPE COMPRESSION_ZSTD
 #elif HAVE_CITUS_LIBLZ4
@@ -42,6 +65,16 @@ int columnar_compression = DEFAULT_COMPRESSION_TYPE;
 int columnar_stripe_row_limit = DEFAULT_STRIPE_ROW_COUNT;
 int columnar_chunk_group_row_limit = DEFAULT_CHUNK_ROW_COUNT;
 int columnar_compression_level = 3;
+bool columnar_enable_encoding = false;
+int columnar_prefetch_depth = DEFAULT_PREFETCH_DEPTH;
+int columnar_chunk_cache_size = DEFAULT_CHUNK_CACHE_SIZE;
+int columnar_metadata_cache_size = DEFAULT_METADATA_CACHE_SIZE;
+int columnar_compression_workers = DEFAULT_COMPRESSION_WORKERS;
+int columnar_staging_row_limit = DEFAULT_STAGING_ROW_LIMIT;
+double columnar_auto_compression_min_ratio = DEFAULT_AUTO_COMPRESSION_MIN_RATIO;
+
+static bool WarnIfStagingWithoutCompaction(int *newval, void **extra,
+										   GucSource source);
 
 static const struct config_enum_entry columnar_compression_options[] =
 {
@@ -61,6 +94,7 @@ columnar_init(void)
 {
 	columnar_init_gucs();
 	columnar_tableam_init();
+	ColumnarMetadataCacheInit();
 }
 
 
@@ -92,6 +126,139 @@ columnar_init_gucs()
 							NULL,
 							NULL);
 
+	DefineCustomRealVariable("columnar.auto_compression_min_ratio",
+							 gettext_noop("Minimum compression ratio for the chunks of "
+										  "columns with auto compression."),
+							 gettext_noop("Columns listed as auto in the column_compression "
+										  "option of a columnar table store the chunks that "
+										  "don't compress by at least this ratio "
+										  "uncompressed, and don't try to compress the rest "
+										  "of the column in the same stripe."),
+							 &columnar_auto_compression_min_ratio,
+							 DEFAULT_AUTO_COMPRESSION_MIN_RATIO,
+							 1.0,
+							 100.0,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomBoolVariable("columnar.enable_encoding",
+							 gettext_noop("Enables lightweight encodings of chunk values."),
+							 gettext_noop("When enabled, columnar encodes the values of each "
+										  "chunk with run-length, delta, frame-of-reference "
+										  "or dictionary encoding before compressing them, "
+										  "if that reduces the size of the chunk."),
+							 &columnar_enable_encoding,
+							 false,
+							 PGC_USERSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("columnar.prefetch_depth",
+							gettext_noop("Number of blocks to prefetch ahead of the "
+										 "columnar data being read."),
+							gettext_noop("Scans issue prefetch requests for the blocks of "
+										 "the upcoming chunks of the stripe being read and "
+										 "of the next stripe, so that they are fetched "
+										 "concurrently. A value of 0 disables prefetching."),
+							&columnar_prefetch_depth,
+							DEFAULT_PREFETCH_DEPTH,
+							0,
+							PREFETCH_DEPTH_MAXIMUM,
+							PGC_USERSET,
+							GUC_UNIT_BLOCKS,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("columnar.chunk_cache_size",
+							gettext_noop("Amount of memory each backend uses to cache "
+										 "decompressed columnar chunks."),
+							gettext_noop("Scans keep the decompressed and decoded values "
+										 "of the chunks they read in a per-backend LRU "
+										 "cache, so that repeated scans of the same "
+										 "stripes do not decompress them again. A value "
+										 "of 0 disables the cache."),
+							&columnar_chunk_cache_size,
+							DEFAULT_CHUNK_CACHE_SIZE,
+							0,
+							MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_UNIT_KB,
+							NULL,
+							ColumnarChunkCacheSizeAssignHook,
+							NULL);
+
+	DefineCustomIntVariable("columnar.metadata_cache_size",
+							gettext_noop("Amount of memory each backend uses to cache "
+										 "columnar stripe and chunk metadata."),
+							gettext_noop("Scans keep the stripe lists and the chunk "
+										 "metadata of the stripes they read in a "
+										 "per-backend LRU cache, so that repeated scans "
+										 "of the same table do not read them from the "
+										 "columnar catalog tables again. A value of 0 "
+										 "disables the cache."),
+							&columnar_metadata_cache_size,
+							DEFAULT_METADATA_CACHE_SIZE,
+							0,
+							MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_UNIT_KB,
+							NULL,
+							ColumnarMetadataCacheSizeAssignHook,
+							NULL);
+
+	DefineCustomIntVariable("columnar.compression_workers",
+							gettext_noop("Number of background workers each columnar "
+										 "writer uses to compress chunks."),
+							gettext_noop("When set, writers hand the chunks of the stripe "
+										 "they are buffering to background workers to "
+										 "compress, so that compression runs on other "
+										 "cores while rows are being buffered. Writers "
+										 "compress the chunks themselves if no worker can "
+										 "be started. A value of 0 disables the workers."),
+							&columnar_compression_workers,
+							DEFAULT_COMPRESSION_WORKERS,
+							0,
+							COMPRESSION_WORKERS_MAXIMUM,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("columnar.staging_row_limit",
+							gettext_noop("Number of rows below which stripes written by "
+										 "inserts are written as staging stripes."),
+							gettext_noop("Small transactions each write a stripe of their "
+										 "own. When set, stripes that have fewer rows than "
+										 "this and fit into a single chunk group are "
+										 "written without encoding, compression and bloom "
+										 "filters, which makes small inserts cheaper. This "
+										 "does not reduce the number of stripes that are "
+										 "written. Staging stripes are only compressed "
+										 "when columnar.compact_stripes merges them into "
+										 "full-sized stripes, which the maintenance daemon "
+										 "does when citus.columnar_stripe_compaction_interval "
+										 "is set. Staging stripes that cannot be merged with "
+										 "adjacent stripes that are not full stay "
+										 "uncompressed. Tables with indexes or row triggers "
+										 "don't get staging stripes, since their stripes "
+										 "cannot be merged. A value of 0 disables staging."),
+							&columnar_staging_row_limit,
+							DEFAULT_STAGING_ROW_LIMIT,
+							0,
+							CHUNK_ROW_COUNT_MAXIMUM,
+							PGC_USERSET,
+							0,
+							WarnIfStagingWithoutCompaction,
+							NULL,
+							NULL);
+
 	DefineCustomIntVariable("columnar.stripe_row_limit",
 							"Maximum number of tuples per stripe.",
 							NULL,
@@ -145,6 +312,38 @@ ParseCompressionType(const char *compressionTypeString)
 }
 
 
+/*
+ * WarnIfStagingWithoutCompaction prints a warning when a user enables staging
+ * stripes while the maintenance daemon does not merge stripes, in which case
+ * staging stripes stay uncompressed until columnar.compact_stripes is run.
+ */
+static bool
+WarnIfStagingWithoutCompaction(int *newval, void **extra, GucSource source)
+{
+	/* print a warning only when user sets the guc */
+	if (source != PGC_S_SESSION || *newval == 0)
+	{
+		return true;
+	}
+
+	/* the setting is not defined if citus is not loaded */
+	const char *compactionInterval =
+		GetConfigOption("citus.columnar_stripe_compaction_interval", true, false);
+	if (compactionInterval == NULL || pg_strtoint32(compactionInterval) <= 0)
+	{
+		ereport(WARNING, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						  errmsg("staging stripes are not compressed unless they "
+								 "are merged"),
+						  errdetail("citus.columnar_stripe_compaction_interval is "
+									"not set, so staging stripes stay uncompressed "
+									"until columnar.compact_stripes is run on their "
+									"tables.")));
+	}
+
+	return true;
+}
+
+
 /*
  * CompressionTypeStr returns string representation of a compression type.
  * For compression algorithms that are invalid or not compiled, it
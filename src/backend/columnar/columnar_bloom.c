@@ -0,0 +1,400 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_bloom.c
+ *
+ * This file contains the functions to build the per-chunk bloom filters of
+ * the columns listed in columnar.bloom_filter_columns, and to check equality
+ * quals against them.
+ *
+ * Min/max values in chunk skip nodes are of little help for equality filters
+ * on unsorted, high-cardinality columns such as uuids or user ids, since the
+ * range of nearly every chunk covers the searched value. A bloom filter
+ * instead tells us whether the chunk might contain the given value, so point
+ * lookups can skip nearly all chunk groups.
+ *
+ * The values are hashed by the standard hash function of the default hash
+ * operator class of the column type, and we set BLOOM_FILTER_HASH_COUNT bits
+ * for each value using double hashing. Since the hash functions of a hash
+ * operator family are compatible across types, we can also use the filters
+ * for cross-type equality operators of that family, such as int8 = int4.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "fmgr.h"
+
+#include "access/hash.h"
+#include "access/stratnum.h"
+#include "catalog/pg_am.h"
+#include "commands/defrem.h"
+#include "common/hashfn.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/primnodes.h"
+#include "utils/array.h"
+#include "utils/lsyscache.h"
+
+#include "columnar/columnar.h"
+#include "columnar/columnar_bloom.h"
+
+#include "distributed/listutils.h"
+
+static void BuildColumnarBloomFilterQualsRec(Node *node, TupleDesc tupleDescriptor,
+											 List **bloomQualList);
+static ColumnarBloomFilterQual * BuildOpExprBloomFilterQual(OpExpr *opExpr,
+															TupleDesc tupleDescriptor);
+static ColumnarBloomFilterQual * BuildScalarArrayOpExprBloomFilterQual(
+	ScalarArrayOpExpr *arrayOpExpr, TupleDesc tupleDescriptor);
+static FmgrInfo * BloomFilterConstHashFunction(Var *var, Oid operatorId,
+											   Oid inputCollation, Oid constTypeId,
+											   TupleDesc tupleDescriptor);
+static void BloomFilterAddHash(bytea *bloomFilter, uint32 hashValue);
+static bool BloomFilterMightContainHash(bytea *bloomFilter, uint32 hashValue);
+
+
+/*
+ * BuildChunkBloomFilter builds a bloom filter that contains the values with
+ * given hashes. The size of the filter is proportional to the number of
+ * values, so that it has the same false positive rate (about 1%) regardless
+ * of the chunk size.
+ */
+bytea *
+BuildChunkBloomFilter(uint32 *hashValues, uint32 hashValueCount)
+{
+	uint64 bitCount = Max((uint64) hashValueCount * BLOOM_FILTER_BITS_PER_VALUE,
+						  BLOOM_FILTER_MIN_BITS);
+	uint64 byteCount = (bitCount + 7) / 8;
+
+	bytea *bloomFilter = palloc0(VARHDRSZ + byteCount);
+	SET_VARSIZE(bloomFilter, VARHDRSZ + byteCount);
+
+	for (uint32 hashIndex = 0; hashIndex < hashValueCount; hashIndex++)
+	{
+		BloomFilterAddHash(bloomFilter, hashValues[hashIndex]);
+	}
+
+	return bloomFilter;
+}
+
+
+/*
+ * BuildColumnarBloomFilterQuals returns a list of ColumnarBloomFilterQual's
+ * for the equality quals in given (implicitly AND'ed) qual list that can be
+ * checked against bloom filters. Other quals are skipped.
+ */
+List *
+BuildColumnarBloomFilterQuals(List *qualList, TupleDesc tupleDescriptor)
+{
+	List *bloomQualList = NIL;
+
+	Node *qual = NULL;
+	foreach_declared_ptr(qual, qualList)
+	{
+		BuildColumnarBloomFilterQualsRec(qual, tupleDescriptor, &bloomQualList);
+	}
+
+	return bloomQualList;
+}
+
+
+/*
+ * ColumnarBloomFilterQualRefutesChunk returns true if none of the values the
+ * qual compares against can be in a chunk with given bloom filter. A chunk
+ * without a bloom filter is never refuted.
+ */
+bool
+ColumnarBloomFilterQualRefutesChunk(ColumnarBloomFilterQual *bloomQual,
+									bytea *bloomFilter)
+{
+	if (bloomFilter == NULL)
+	{
+		return false;
+	}
+
+	for (uint32 hashIndex = 0; hashIndex < bloomQual->hashValueCount; hashIndex++)
+	{
+		if (BloomFilterMightContainHash(bloomFilter, bloomQual->hashValues[hashIndex]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * BuildColumnarBloomFilterQualsRec descends into AND expressions and appends
+ * the quals that can be checked against bloom filters to bloomQualList.
+ */
+static void
+BuildColumnarBloomFilterQualsRec(Node *node, TupleDesc tupleDescriptor,
+								 List **bloomQualList)
+{
+	if (node == NULL)
+	{
+		return;
+	}
+
+	if (is_andclause(node))
+	{
+		Node *arg = NULL;
+		foreach_declared_ptr(arg, ((BoolExpr *) node)->args)
+		{
+			BuildColumnarBloomFilterQualsRec(arg, tupleDescriptor, bloomQualList);
+		}
+
+		return;
+	}
+
+	ColumnarBloomFilterQual *bloomQual = NULL;
+	if (IsA(node, OpExpr))
+	{
+		bloomQual = BuildOpExprBloomFilterQual((OpExpr *) node, tupleDescriptor);
+	}
+	else if (IsA(node, ScalarArrayOpExpr))
+	{
+		bloomQual = BuildScalarArrayOpExprBloomFilterQual((ScalarArrayOpExpr *) node,
+														  tupleDescriptor);
+	}
+
+	if (bloomQual != NULL)
+	{
+		*bloomQualList = lappend(*bloomQualList, bloomQual);
+	}
+}
+
+
+/*
+ * BuildOpExprBloomFilterQual returns a ColumnarBloomFilterQual for given
+ * operator expression if it is in the form of "Var = Const" or "Const = Var",
+ * or NULL otherwise.
+ */
+static ColumnarBloomFilterQual *
+BuildOpExprBloomFilterQual(OpExpr *opExpr, TupleDesc tupleDescriptor)
+{
+	if (list_length(opExpr->args) != 2)
+	{
+		return NULL;
+	}
+
+	Node *leftArg = (Node *) linitial(opExpr->args);
+	Node *rightArg = (Node *) lsecond(opExpr->args);
+
+	Var *var = NULL;
+	Const *constValue = NULL;
+
+	if (IsA(leftArg, Var) && IsA(rightArg, Const))
+	{
+		var = (Var *) leftArg;
+		constValue = (Const *) rightArg;
+	}
+	else if (IsA(leftArg, Const) && IsA(rightArg, Var))
+	{
+		var = (Var *) rightArg;
+		constValue = (Const *) leftArg;
+	}
+	else
+	{
+		return NULL;
+	}
+
+	if (constValue->constisnull)
+	{
+		return NULL;
+	}
+
+	FmgrInfo *hashFunction = BloomFilterConstHashFunction(var, opExpr->opno,
+														  opExpr->inputcollid,
+														  constValue->consttype,
+														  tupleDescriptor);
+	if (hashFunction == NULL)
+	{
+		return NULL;
+	}
+
+	ColumnarBloomFilterQual *bloomQual = palloc0(sizeof(ColumnarBloomFilterQual));
+	bloomQual->columnIndex = var->varattno - 1;
+	bloomQual->hashValues = palloc(sizeof(uint32));
+	bloomQual->hashValues[0] =
+		DatumGetUInt32(FunctionCall1Coll(hashFunction, opExpr->inputcollid,
+										 constValue->constvalue));
+	bloomQual->hashValueCount = 1;
+
+	return bloomQual;
+}
+
+
+/*
+ * BuildScalarArrayOpExprBloomFilterQual returns a ColumnarBloomFilterQual for
+ * given expression if it is in the form of "Var = ANY(Const array)", which is
+ * also what "Var IN (...)" is transformed into, or NULL otherwise.
+ */
+static ColumnarBloomFilterQual *
+BuildScalarArrayOpExprBloomFilterQual(ScalarArrayOpExpr *arrayOpExpr,
+									  TupleDesc tupleDescriptor)
+{
+	if (!arrayOpExpr->useOr || list_length(arrayOpExpr->args) != 2)
+	{
+		return NULL;
+	}
+
+	Node *leftArg = (Node *) linitial(arrayOpExpr->args);
+	Node *rightArg = (Node *) lsecond(arrayOpExpr->args);
+
+	if (!IsA(leftArg, Var) || !IsA(rightArg, Const) ||
+		((Const *) rightArg)->constisnull)
+	{
+		return NULL;
+	}
+
+	Var *var = (Var *) leftArg;
+	ArrayType *constArray = DatumGetArrayTypeP(((Const *) rightArg)->constvalue);
+	Oid elementTypeId = ARR_ELEMTYPE(constArray);
+
+	FmgrInfo *hashFunction = BloomFilterConstHashFunction(var, arrayOpExpr->opno,
+														  arrayOpExpr->inputcollid,
+														  elementTypeId,
+														  tupleDescriptor);
+	if (hashFunction == NULL)
+	{
+		return NULL;
+	}
+
+	int16 elementTypeLength = 0;
+	bool elementTypeByValue = false;
+	char elementTypeAlign = 0;
+	get_typlenbyvalalign(elementTypeId, &elementTypeLength, &elementTypeByValue,
+						 &elementTypeAlign);
+
+	Datum *elementValues = NULL;
+	bool *elementNulls = NULL;
+	int elementCount = 0;
+	deconstruct_array(constArray, elementTypeId, elementTypeLength,
+					  elementTypeByValue, elementTypeAlign, &elementValues,
+					  &elementNulls, &elementCount);
+
+	ColumnarBloomFilterQual *bloomQual = palloc0(sizeof(ColumnarBloomFilterQual));
+	bloomQual->columnIndex = var->varattno - 1;
+	bloomQual->hashValues = palloc0(Max(elementCount, 1) * sizeof(uint32));
+
+	for (int elementIndex = 0; elementIndex < elementCount; elementIndex++)
+	{
+		/* NULL elements never compare equal to the column value */
+		if (elementNulls[elementIndex])
+		{
+			continue;
+		}
+
+		Datum hashDatum = FunctionCall1Coll(hashFunction, arrayOpExpr->inputcollid,
+											elementValues[elementIndex]);
+		bloomQual->hashValues[bloomQual->hashValueCount++] = DatumGetUInt32(hashDatum);
+	}
+
+	return bloomQual;
+}
+
+
+/*
+ * BloomFilterConstHashFunction returns the hash function for the constants
+ * that the given Var is compared against using given operator, or NULL if the
+ * bloom filters of the column cannot be used for the comparison.
+ *
+ * That is the case if the operator is not the equality operator of the hash
+ * operator family that the filters are built with, or if the comparison uses
+ * a different collation than the column, which might consider a different
+ * set of values equal.
+ */
+static FmgrInfo *
+BloomFilterConstHashFunction(Var *var, Oid operatorId, Oid inputCollation,
+							 Oid constTypeId, TupleDesc tupleDescriptor)
+{
+	if (var->varattno <= 0 || var->varattno > tupleDescriptor->natts ||
+		var->varlevelsup != 0)
+	{
+		return NULL;
+	}
+
+	Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor,
+													var->varattno - 1);
+	if (attributeForm->attisdropped || attributeForm->atttypid != var->vartype ||
+		attributeForm->attcollation != inputCollation)
+	{
+		return NULL;
+	}
+
+	Oid operatorClassId = GetDefaultOpClass(attributeForm->atttypid, HASH_AM_OID);
+	if (!OidIsValid(operatorClassId))
+	{
+		return NULL;
+	}
+
+	Oid operatorFamilyId = get_opclass_family(operatorClassId);
+	if (get_op_opfamily_strategy(operatorId, operatorFamilyId) != HTEqualStrategyNumber)
+	{
+		return NULL;
+	}
+
+	Oid hashFunctionId = get_opfamily_proc(operatorFamilyId, constTypeId, constTypeId,
+										   HASHSTANDARD_PROC);
+	if (!OidIsValid(hashFunctionId))
+	{
+		return NULL;
+	}
+
+	FmgrInfo *hashFunction = palloc0(sizeof(FmgrInfo));
+	fmgr_info(hashFunctionId, hashFunction);
+
+	return hashFunction;
+}
+
+
+/*
+ * BloomFilterAddHash sets the bits of given bloom filter for the value with
+ * given hash.
+ */
+static void
+BloomFilterAddHash(bytea *bloomFilter, uint32 hashValue)
+{
+	uint8 *filterBits = (uint8 *) VARDATA_ANY(bloomFilter);
+	uint64 bitCount = (uint64) VARSIZE_ANY_EXHDR(bloomFilter) * 8;
+
+	/* derive the bit positions from two hashes, see Kirsch & Mitzenmacher */
+	uint32 firstHash = hashValue;
+	uint32 secondHash = murmurhash32(hashValue) | 1;
+
+	for (uint32 hashIndex = 0; hashIndex < BLOOM_FILTER_HASH_COUNT; hashIndex++)
+	{
+		uint64 bitIndex = (firstHash + hashIndex * secondHash) % bitCount;
+		filterBits[bitIndex / 8] |= (1 << (bitIndex % 8));
+	}
+}
+
+
+/*
+ * BloomFilterMightContainHash returns false if the value with given hash
+ * certainly is not in given bloom filter.
+ */
+static bool
+BloomFilterMightContainHash(bytea *bloomFilter, uint32 hashValue)
+{
+	uint8 *filterBits = (uint8 *) VARDATA_ANY(bloomFilter);
+	uint64 bitCount = (uint64) VARSIZE_ANY_EXHDR(bloomFilter) * 8;
+
+	uint32 firstHash = hashValue;
+	uint32 secondHash = murmurhash32(hashValue) | 1;
+
+	for (uint32 hashIndex = 0; hashIndex < BLOOM_FILTER_HASH_COUNT; hashIndex++)
+	{
+		uint64 bitIndex = (firstHash + hashIndex * secondHash) % bitCount;
+		if ((filterBits[bitIndex / 8] & (1 << (bitIndex % 8))) == 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,323 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_cache.c
+ *
+ * Backend-local LRU cache of decoded column chunk value buffers.
+ *
+ * Reading a column chunk requires reading its value stream from the storage,
+ * decompressing it and decoding it. Scans that repeatedly hit the same
+ * stripes redo this work each time, so we keep the decoded value buffers of
+ * the most recently read chunks around, up to columnar.chunk_cache_size
+ * kilobytes per backend.
+ *
+ * Flushed stripes are immutable and neither storage ids nor stripe ids are
+ * reused, so a cached buffer never becomes stale. Still, we drop the entries
+ * of a storage when its metadata is deleted on truncate or drop, and when it
+ * is vacuumed, so that they don't occupy the cache until they are evicted.
+ * Entries of other backends for a truncated or dropped storage are never hit
+ * again and are evicted as their caches fill up.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "funcapi.h"
+
+#include "access/htup_details.h"
+#include "lib/ilist.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+#include "columnar/columnar.h"
+#include "columnar/columnar_cache.h"
+
+/*
+ * ChunkCacheEntry is an entry of the chunk cache, it keeps a copy of a decoded
+ * value buffer. Entries are kept in ChunkCacheLRUList from the most recently
+ * used to the least recently used.
+ */
+typedef struct ChunkCacheEntry
+{
+	/* key must be the first field, see hash_search */
+	ColumnarChunkCacheKey key;
+
+	dlist_node lruNode;
+	char *data;
+	int length;
+} ChunkCacheEntry;
+
+/* approximate memory used by an entry, used to enforce the cache size */
+#define ChunkCacheEntrySize(length) ((Size) (length) + sizeof(ChunkCacheEntry))
+
+static MemoryContext ChunkCacheContext = NULL;
+static HTAB *ChunkCacheHash = NULL;
+static dlist_head ChunkCacheLRUList = DLIST_STATIC_INIT(ChunkCacheLRUList);
+static Size ChunkCacheUsedSize = 0;
+
+/* counters reported by columnar.chunk_cache_stats() */
+static int64 ChunkCacheHits = 0;
+static int64 ChunkCacheMisses = 0;
+static int64 ChunkCacheEvictions = 0;
+
+static Size ChunkCacheSizeLimit(int cacheSizeKB);
+static void CreateChunkCache(void);
+static void ReleaseChunkCache(void);
+static void EnforceChunkCacheLimit(Size sizeLimit);
+static void RemoveChunkCacheEntry(ChunkCacheEntry *entry);
+
+PG_FUNCTION_INFO_V1(columnar_chunk_cache_stats);
+
+
+/*
+ * ColumnarChunkCacheEnabled returns whether the chunk cache is enabled.
+ */
+bool
+ColumnarChunkCacheEnabled(void)
+{
+	return columnar_chunk_cache_size > 0;
+}
+
+
+/*
+ * ColumnarChunkCacheLookup returns a copy of the cached value buffer for the
+ * given key, allocated in the current memory context, or NULL if it is not
+ * cached.
+ */
+StringInfo
+ColumnarChunkCacheLookup(ColumnarChunkCacheKey *key)
+{
+	ChunkCacheEntry *entry = NULL;
+
+	if (ChunkCacheHash != NULL)
+	{
+		entry = hash_search(ChunkCacheHash, key, HASH_FIND, NULL);
+	}
+
+	if (entry == NULL)
+	{
+		ChunkCacheMisses++;
+		return NULL;
+	}
+
+	ChunkCacheHits++;
+	dlist_move_head(&ChunkCacheLRUList, &entry->lruNode);
+
+	StringInfo valueBuffer = makeStringInfo();
+	appendBinaryStringInfo(valueBuffer, entry->data, entry->length);
+
+	return valueBuffer;
+}
+
+
+/*
+ * ColumnarChunkCacheInsert stores a copy of the given decoded value buffer in
+ * the cache, evicting the least recently used entries to make room for it.
+ */
+void
+ColumnarChunkCacheInsert(ColumnarChunkCacheKey *key, StringInfo valueBuffer)
+{
+	Size sizeLimit = ChunkCacheSizeLimit(columnar_chunk_cache_size);
+	Size entrySize = ChunkCacheEntrySize(valueBuffer->len);
+
+	if (entrySize > sizeLimit)
+	{
+		return;
+	}
+
+	if (ChunkCacheHash == NULL)
+	{
+		CreateChunkCache();
+	}
+
+	EnforceChunkCacheLimit(sizeLimit - entrySize);
+
+	/* copy the data first, so we never end up with a half-initialized entry */
+	char *data = MemoryContextAlloc(ChunkCacheContext, Max(valueBuffer->len, 1));
+	memcpy(data, valueBuffer->data, valueBuffer->len); /* IGNORE-BANNED */
+
+	bool found = false;
+	ChunkCacheEntry *entry = hash_search(ChunkCacheHash, key, HASH_ENTER, &found);
+	if (found)
+	{
+		/* another scan in this backend cached the same chunk meanwhile */
+		pfree(data);
+		dlist_move_head(&ChunkCacheLRUList, &entry->lruNode);
+		return;
+	}
+
+	entry->data = data;
+	entry->length = valueBuffer->len;
+	dlist_push_head(&ChunkCacheLRUList, &entry->lruNode);
+	ChunkCacheUsedSize += entrySize;
+}
+
+
+/*
+ * ColumnarChunkCacheInvalidateStorage removes the cached value buffers of the
+ * chunks of the given storage.
+ */
+void
+ColumnarChunkCacheInvalidateStorage(uint64 storageId)
+{
+	if (ChunkCacheHash == NULL)
+	{
+		return;
+	}
+
+	HASH_SEQ_STATUS status;
+	ChunkCacheEntry *entry = NULL;
+
+	hash_seq_init(&status, ChunkCacheHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		/* removing the entry just returned by hash_seq_search is safe */
+		if (entry->key.storageId == storageId)
+		{
+			RemoveChunkCacheEntry(entry);
+		}
+	}
+}
+
+
+/*
+ * ColumnarChunkCacheSizeAssignHook evicts entries when columnar.chunk_cache_size
+ * is lowered, and releases the cache altogether when it is disabled.
+ */
+void
+ColumnarChunkCacheSizeAssignHook(int newval, void *extra)
+{
+	if (ChunkCacheHash == NULL)
+	{
+		return;
+	}
+
+	if (newval == 0)
+	{
+		ReleaseChunkCache();
+	}
+	else
+	{
+		EnforceChunkCacheLimit(ChunkCacheSizeLimit(newval));
+	}
+}
+
+
+/*
+ * ChunkCacheSizeLimit converts the given cache size in kilobytes to bytes.
+ */
+static Size
+ChunkCacheSizeLimit(int cacheSizeKB)
+{
+	return (Size) cacheSizeKB * 1024;
+}
+
+
+/*
+ * CreateChunkCache creates the memory context and the hash table of the
+ * cache. The cache lives until the end of the backend.
+ */
+static void
+CreateChunkCache(void)
+{
+	ChunkCacheContext = AllocSetContextCreate(TopMemoryContext,
+											  "Columnar Chunk Cache Context",
+											  ALLOCSET_DEFAULT_SIZES);
+
+	HASHCTL info;
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(ColumnarChunkCacheKey);
+	info.entrysize = sizeof(ChunkCacheEntry);
+	info.hcxt = ChunkCacheContext;
+
+	ChunkCacheHash = hash_create("columnar chunk cache", 256, &info,
+								 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	dlist_init(&ChunkCacheLRUList);
+	ChunkCacheUsedSize = 0;
+}
+
+
+/*
+ * ReleaseChunkCache frees all memory used by the cache. Evictions are counted
+ * so that the counters stay consistent with the number of cached entries.
+ */
+static void
+ReleaseChunkCache(void)
+{
+	ChunkCacheEvictions += hash_get_num_entries(ChunkCacheHash);
+
+	MemoryContextDelete(ChunkCacheContext);
+	ChunkCacheContext = NULL;
+	ChunkCacheHash = NULL;
+	dlist_init(&ChunkCacheLRUList);
+	ChunkCacheUsedSize = 0;
+}
+
+
+/*
+ * EnforceChunkCacheLimit evicts the least recently used entries until the
+ * cache uses at most sizeLimit bytes.
+ */
+static void
+EnforceChunkCacheLimit(Size sizeLimit)
+{
+	while (ChunkCacheUsedSize > sizeLimit && !dlist_is_empty(&ChunkCacheLRUList))
+	{
+		ChunkCacheEntry *entry = dlist_tail_element(ChunkCacheEntry, lruNode,
+													&ChunkCacheLRUList);
+		RemoveChunkCacheEntry(entry);
+		ChunkCacheEvictions++;
+	}
+}
+
+
+/*
+ * RemoveChunkCacheEntry removes the given entry from the cache and frees its
+ * data.
+ */
+static void
+RemoveChunkCacheEntry(ChunkCacheEntry *entry)
+{
+	ChunkCacheUsedSize -= ChunkCacheEntrySize(entry->length);
+	dlist_delete(&entry->lruNode);
+	pfree(entry->data);
+
+	hash_search(ChunkCacheHash, &entry->key, HASH_REMOVE, NULL);
+}
+
+
+/*
+ * columnar_chunk_cache_stats returns the hit, miss and eviction counters of the
+ * chunk cache of the current backend, together with the number of entries and
+ * the memory they use.
+ */
+Datum
+columnar_chunk_cache_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupleDescriptor = NULL;
+	if (get_call_result_type(fcinfo, NULL, &tupleDescriptor) != TYPEFUNC_COMPOSITE)
+	{
+		elog(ERROR, "return type must be a row type");
+	}
+
+	int64 entryCount = 0;
+	if (ChunkCacheHash != NULL)
+	{
+		entryCount = hash_get_num_entries(ChunkCacheHash);
+	}
+
+	bool nulls[5] = { false };
+	Datum values[5] = {
+		Int64GetDatum(ChunkCacheHits),
+		Int64GetDatum(ChunkCacheMisses),
+		Int64GetDatum(ChunkCacheEvictions),
+		Int64GetDatum(entryCount),
+		Int64GetDatum((int64) ChunkCacheUsedSize)
+	};
+
+	HeapTuple tuple = heap_form_tuple(tupleDescriptor, values, nulls);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
@@ -15,10 +15,13 @@
 
 #include "common/pg_lzcompress.h"
 #include "lib/stringinfo.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
 
 #include "citus_version.h"
 #include "pg_version_constants.h"
 
+#include "columnar/columnar.h"
 #include "columnar/columnar_compression.h"
 
 #if HAVE_CITUS_LIBLZ4
@@ -30,6 +33,7 @@
 #endif
 
 #if HAVE_LIBZSTD
+#include <zdict.h>
 #include <zstd.h>
 #endif
 
@@ -54,6 +58,49 @@ typedef struct ColumnarCompressHeader
 									  len) (((ColumnarCompressHeader *) (ptr))->rawsize = \
 												(len))
 
+#if HAVE_LIBZSTD
+
+/* maximum number of digested zstd dictionaries cached per backend */
+#define ZSTD_DICTIONARY_CACHE_SIZE 64
+
+/* a zstd dictionary starts with its magic number, followed by its id */
+#define ZSTD_DICTIONARY_ID_OFFSET 4
+
+/*
+ * ZstdDictionaryCacheKey identifies a digested zstd dictionary. Compression
+ * dictionaries are digested for a compression level, whereas decompression
+ * dictionaries are cached with compressionLevel 0.
+ */
+typedef struct ZstdDictionaryCacheKey
+{
+	uint32 dictionaryId;
+	int compressionLevel;
+} ZstdDictionaryCacheKey;
+
+typedef struct ZstdDictionaryCacheEntry
+{
+	ZstdDictionaryCacheKey key;
+	ZSTD_CDict *compressionDictionary;
+	ZSTD_DDict *decompressionDictionary;
+} ZstdDictionaryCacheEntry;
+
+/*
+ * zstd contexts are reused for all chunks compressed and decompressed by the
+ * backend, instead of setting up a new context for each chunk.
+ */
+static ZSTD_CCtx *ZstdCompressionContext = NULL;
+static ZSTD_DCtx *ZstdDecompressionContext = NULL;
+
+/* digested zstd dictionaries by dictionary id and compression level */
+static HTAB *ZstdDictionaryCache = NULL;
+
+static ZSTD_CCtx * GetZstdCompressionContext(void);
+static ZSTD_DCtx * GetZstdDecompressionContext(void);
+static ZstdDictionaryCacheEntry * GetZstdDictionaryCacheEntry(uint32 dictionaryId,
+															  int compressionLevel);
+static void ResetZstdDictionaryCache(void);
+#endif
+
 
 /*
  * CompressBuffer compresses the given buffer with the given compression type
@@ -66,6 +113,24 @@ CompressBuffer(StringInfo inputBuffer,
 			   StringInfo outputBuffer,
 			   CompressionType compressionType,
 			   int compressionLevel)
+{
+	return CompressBufferWithDictionary(inputBuffer, outputBuffer, compressionType,
+										compressionLevel, InvalidZstdDictionaryId);
+}
+
+
+/*
+ * CompressBufferWithDictionary is like CompressBuffer, but compresses with the
+ * given zstd dictionary if the compression type is zstd. The id of the
+ * dictionary is recorded in the zstd frame, which is how DecompressBuffer
+ * finds the dictionary again.
+ */
+bool
+CompressBufferWithDictionary(StringInfo inputBuffer,
+							 StringInfo outputBuffer,
+							 CompressionType compressionType,
+							 int compressionLevel,
+							 uint32 zstdDictionaryId)
 {
 	switch (compressionType)
 	{
@@ -104,11 +169,31 @@ CompressBuffer(StringInfo inputBuffer,
 			resetStringInfo(outputBuffer);
 			enlargeStringInfo(outputBuffer, maximumLength);
 
-			size_t compressedSize = ZSTD_compress(outputBuffer->data,
-												  outputBuffer->maxlen,
-												  inputBuffer->data,
-												  inputBuffer->len,
-												  compressionLevel);
+			ZSTD_CCtx *compressionContext = GetZstdCompressionContext();
+			size_t compressedSize = 0;
+
+			if (zstdDictionaryId != InvalidZstdDictionaryId)
+			{
+				ZstdDictionaryCacheEntry *cacheEntry =
+					GetZstdDictionaryCacheEntry(zstdDictionaryId, compressionLevel);
+				ZSTD_CDict *dictionary = cacheEntry->compressionDictionary;
+
+				compressedSize = ZSTD_compress_usingCDict(compressionContext,
+														  outputBuffer->data,
+														  outputBuffer->maxlen,
+														  inputBuffer->data,
+														  inputBuffer->len,
+														  dictionary);
+			}
+			else
+			{
+				compressedSize = ZSTD_compressCCtx(compressionContext,
+												   outputBuffer->data,
+												   outputBuffer->maxlen,
+												   inputBuffer->data,
+												   inputBuffer->len,
+												   compressionLevel);
+			}
 
 			if (ZSTD_isError(compressedSize))
 			{
@@ -206,10 +291,32 @@ DecompressBuffer(StringInfo buffer,
 			StringInfo decompressedBuffer = makeStringInfo();
 			enlargeStringInfo(decompressedBuffer, decompressedSize);
 
-			size_t zstdDecompressSize = ZSTD_decompress(decompressedBuffer->data,
-														decompressedSize,
-														buffer->data,
-														buffer->len);
+			ZSTD_DCtx *decompressionContext = GetZstdDecompressionContext();
+			size_t zstdDecompressSize = 0;
+
+			/* chunks compressed with a dictionary have its id in the frame */
+			uint32 dictionaryId = ZSTD_getDictID_fromFrame(buffer->data, buffer->len);
+			if (dictionaryId != InvalidZstdDictionaryId)
+			{
+				ZstdDictionaryCacheEntry *cacheEntry =
+					GetZstdDictionaryCacheEntry(dictionaryId, 0);
+
+				zstdDecompressSize =
+					ZSTD_decompress_usingDDict(decompressionContext,
+											   decompressedBuffer->data,
+											   decompressedSize,
+											   buffer->data,
+											   buffer->len,
+											   cacheEntry->decompressionDictionary);
+			}
+			else
+			{
+				zstdDecompressSize = ZSTD_decompressDCtx(decompressionContext,
+														 decompressedBuffer->data,
+														 decompressedSize,
+														 buffer->data,
+														 buffer->len);
+			}
 			if (ZSTD_isError(zstdDecompressSize))
 			{
 				ereport(ERROR, (errmsg("zstd decompression failed"),
@@ -270,3 +377,207 @@ DecompressBuffer(StringInfo buffer,
 		}
 	}
 }
+
+
+/*
+ * TrainZstdDictionary trains a zstd dictionary of at most dictionarySize bytes
+ * from the given samples, which are stored back to back in sampleBuffer, and
+ * returns the dictionary with the given id.
+ */
+StringInfo
+TrainZstdDictionary(StringInfo sampleBuffer, size_t *sampleSizes, uint32 sampleCount,
+					int dictionarySize, uint32 dictionaryId)
+{
+#if HAVE_LIBZSTD
+	StringInfo dictionary = makeStringInfo();
+	enlargeStringInfo(dictionary, dictionarySize);
+
+	size_t trainedSize = ZDICT_trainFromBuffer(dictionary->data, dictionarySize,
+											   sampleBuffer->data, sampleSizes,
+											   sampleCount);
+	if (ZDICT_isError(trainedSize))
+	{
+		ereport(ERROR, (errmsg("could not train zstd dictionary"),
+						errdetail("%s", ZDICT_getErrorName(trainedSize)),
+						errhint("Load more data into the table or use a smaller "
+								"dictionary size.")));
+	}
+
+	dictionary->len = trainedSize;
+
+	/*
+	 * The trainer derives the id of the dictionary from its content. Replace
+	 * it with the given id, which is unique, since decompression finds the
+	 * dictionary of a chunk by the id recorded in its zstd frame. The id is
+	 * stored in little-endian byte order.
+	 */
+	for (int byteIndex = 0; byteIndex < 4; byteIndex++)
+	{
+		dictionary->data[ZSTD_DICTIONARY_ID_OFFSET + byteIndex] =
+			(char) ((dictionaryId >> (8 * byteIndex)) & 0xFF);
+	}
+
+	if (ZDICT_getDictID(dictionary->data, dictionary->len) != dictionaryId)
+	{
+		ereport(ERROR, (errmsg("could not set the id of zstd dictionary %u",
+							   dictionaryId)));
+	}
+
+	return dictionary;
+#else
+	ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					errmsg("zstd dictionaries are not supported since citus_columnar "
+						   "was built without zstd")));
+#endif
+}
+
+
+#if HAVE_LIBZSTD
+
+/*
+ * GetZstdCompressionContext returns the zstd compression context of the
+ * backend, creating it on first use.
+ */
+static ZSTD_CCtx *
+GetZstdCompressionContext(void)
+{
+	if (ZstdCompressionContext == NULL)
+	{
+		ZstdCompressionContext = ZSTD_createCCtx();
+		if (ZstdCompressionContext == NULL)
+		{
+			ereport(ERROR, (errcode(ERRCODE_OUT_OF_MEMORY),
+							errmsg("out of memory"),
+							errdetail("Failed to create zstd compression context.")));
+		}
+	}
+
+	return ZstdCompressionContext;
+}
+
+
+/*
+ * GetZstdDecompressionContext returns the zstd decompression context of the
+ * backend, creating it on first use.
+ */
+static ZSTD_DCtx *
+GetZstdDecompressionContext(void)
+{
+	if (ZstdDecompressionContext == NULL)
+	{
+		ZstdDecompressionContext = ZSTD_createDCtx();
+		if (ZstdDecompressionContext == NULL)
+		{
+			ereport(ERROR, (errcode(ERRCODE_OUT_OF_MEMORY),
+							errmsg("out of memory"),
+							errdetail("Failed to create zstd decompression context.")));
+		}
+	}
+
+	return ZstdDecompressionContext;
+}
+
+
+/*
+ * GetZstdDictionaryCacheEntry returns the cache entry of the given zstd
+ * dictionary, which has the dictionary digested for compression at the given
+ * level, or for decompression if compressionLevel is 0. The dictionary is
+ * read from columnar metadata on a cache miss.
+ *
+ * Dictionaries are never modified and their ids are never reused, so cache
+ * entries never have to be invalidated. The cache is simply emptied once it
+ * has ZSTD_DICTIONARY_CACHE_SIZE entries.
+ */
+static ZstdDictionaryCacheEntry *
+GetZstdDictionaryCacheEntry(uint32 dictionaryId, int compressionLevel)
+{
+	if (ZstdDictionaryCache == NULL)
+	{
+		HASHCTL info;
+		memset(&info, 0, sizeof(info));
+		info.keysize = sizeof(ZstdDictionaryCacheKey);
+		info.entrysize = sizeof(ZstdDictionaryCacheEntry);
+		info.hcxt = TopMemoryContext;
+
+		ZstdDictionaryCache = hash_create("columnar zstd dictionary cache",
+										  ZSTD_DICTIONARY_CACHE_SIZE, &info,
+										  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	ZstdDictionaryCacheKey key;
+	memset(&key, 0, sizeof(key));
+	key.dictionaryId = dictionaryId;
+	key.compressionLevel = compressionLevel;
+
+	ZstdDictionaryCacheEntry *cacheEntry =
+		hash_search(ZstdDictionaryCache, &key, HASH_FIND, NULL);
+	if (cacheEntry != NULL)
+	{
+		return cacheEntry;
+	}
+
+	bytea *dictionary = ReadColumnarZstdDictionary(dictionaryId);
+	if (dictionary == NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DATA_CORRUPTED),
+						errmsg("zstd dictionary %u of columnar chunk does not exist",
+							   dictionaryId)));
+	}
+
+	ZSTD_CDict *compressionDictionary = NULL;
+	ZSTD_DDict *decompressionDictionary = NULL;
+
+	if (compressionLevel != 0)
+	{
+		compressionDictionary = ZSTD_createCDict(VARDATA_ANY(dictionary),
+												 VARSIZE_ANY_EXHDR(dictionary),
+												 compressionLevel);
+	}
+	else
+	{
+		decompressionDictionary = ZSTD_createDDict(VARDATA_ANY(dictionary),
+												   VARSIZE_ANY_EXHDR(dictionary));
+	}
+
+	pfree(dictionary);
+
+	if (compressionDictionary == NULL && decompressionDictionary == NULL)
+	{
+		ereport(ERROR, (errmsg("could not load zstd dictionary %u", dictionaryId)));
+	}
+
+	if (hash_get_num_entries(ZstdDictionaryCache) >= ZSTD_DICTIONARY_CACHE_SIZE)
+	{
+		ResetZstdDictionaryCache();
+	}
+
+	cacheEntry = hash_search(ZstdDictionaryCache, &key, HASH_ENTER, NULL);
+	cacheEntry->compressionDictionary = compressionDictionary;
+	cacheEntry->decompressionDictionary = decompressionDictionary;
+
+	return cacheEntry;
+}
+
+
+/*
+ * ResetZstdDictionaryCache frees all digested zstd dictionaries of the
+ * backend.
+ */
+static void
+ResetZstdDictionaryCache(void)
+{
+	HASH_SEQ_STATUS status;
+	hash_seq_init(&status, ZstdDictionaryCache);
+
+	ZstdDictionaryCacheEntry *cacheEntry = NULL;
+	while ((cacheEntry = hash_seq_search(&status)) != NULL)
+	{
+		ZSTD_freeCDict(cacheEntry->compressionDictionary);
+		ZSTD_freeDDict(cacheEntry->decompressionDictionary);
+
+		hash_search(ZstdDictionaryCache, &cacheEntry->key, HASH_REMOVE, NULL);
+	}
+}
+
+
+#endif
@@ -0,0 +1,632 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_compression_pool.c
+ *
+ * Pool of dynamic background workers that compress the value buffers of
+ * column chunks while the writer keeps buffering rows.
+ *
+ * Compressing a stripe is the most CPU intensive part of loading a columnar
+ * table. With columnar.compression_workers set, the writer submits the value
+ * buffer of each column chunk to a pool of workers as soon as the chunk is
+ * serialized, instead of compressing it inline, and it only waits for the
+ * outstanding chunks when the stripe is flushed. This way the chunks of a
+ * stripe are compressed on other cores while the rest of the stripe is being
+ * buffered.
+ *
+ * Each worker has a pair of shared memory queues in a single dynamic shared
+ * memory segment: one to receive the chunks to compress and one to return
+ * the compressed chunks, in the order the chunks were received. Chunks are
+ * distributed over the workers round-robin.
+ *
+ * Workers only need access to shared memory, they never connect to a
+ * database. If a worker can't be started or exits unexpectedly, the chunks
+ * assigned to it are compressed by the writer itself, so the pool never
+ * changes what gets written, only where the compression happens.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "safe_lib.h"
+
+#include "postmaster/bgworker.h"
+#include "storage/dsm.h"
+#include "storage/latch.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "tcop/tcopprot.h"
+#include "utils/memutils.h"
+
+#include "columnar/columnar.h"
+#include "columnar/columnar_compression_pool.h"
+
+#include "distributed/listutils.h"
+
+/* size of each of the queues, chunks larger than that are streamed through */
+#define COMPRESSION_QUEUE_SIZE (256 * 1024)
+
+/* offsets of the queues of a worker in the shared memory segment */
+#define JobQueueOffset(workerIndex) \
+	((Size) (workerIndex) * 2 * COMPRESSION_QUEUE_SIZE)
+#define ResultQueueOffset(workerIndex) \
+	(JobQueueOffset(workerIndex) + COMPRESSION_QUEUE_SIZE)
+
+/* forward declaration of background worker entrypoint */
+extern PGDLLEXPORT void ColumnarCompressionWorkerMain(Datum main_arg);
+
+/* CompressionJobHeader precedes the uncompressed data in a job message */
+typedef struct CompressionJobHeader
+{
+	int32 compressionType;
+	int32 compressionLevel;
+} CompressionJobHeader;
+
+/*
+ * CompressionResultHeader precedes the compressed data in a result message,
+ * which has no data if the chunk could not be compressed.
+ */
+typedef struct CompressionResultHeader
+{
+	bool compressed;
+} CompressionResultHeader;
+
+/*
+ * CompressionJob is a chunk that was sent to a worker and whose compressed
+ * value buffer is not received yet.
+ */
+typedef struct CompressionJob
+{
+	ColumnChunkBuffers *chunkBuffers;
+	CompressionType compressionType;
+	int compressionLevel;
+
+	/* memory context to allocate the compressed value buffer in */
+	MemoryContext resultContext;
+} CompressionJob;
+
+typedef struct CompressionWorker
+{
+	BackgroundWorkerHandle *handle;
+	shm_mq_handle *jobQueue;
+	shm_mq_handle *resultQueue;
+
+	/* jobs sent to the worker, in the order the results are returned */
+	List *pendingJobs;
+
+	/* whether the worker is gone, either it failed to start or it exited */
+	bool detached;
+} CompressionWorker;
+
+struct ColumnarCompressionPool
+{
+	MemoryContext context;
+	dsm_segment *segment;
+
+	CompressionWorker *workers;
+	int workerCount;
+	int liveWorkerCount;
+	int nextWorkerIndex;
+
+	/* detaches from the segment if the pool is not destroyed explicitly */
+	MemoryContextCallback detachCallback;
+};
+
+static void DetachCompressionPool(void *arg);
+static CompressionWorker * NextCompressionWorker(ColumnarCompressionPool *pool);
+static bool ReceiveCompressionResults(ColumnarCompressionPool *pool, bool nowait);
+static bool ReceiveCompressionResult(ColumnarCompressionPool *pool,
+									 CompressionWorker *worker, bool nowait);
+static void CompressionWorkerDetached(ColumnarCompressionPool *pool,
+									  CompressionWorker *worker);
+static void CompressChunkLocally(CompressionJob *job);
+static void SetChunkValueBuffer(ColumnChunkBuffers *chunkBuffers, char *data,
+								int length, CompressionType compressionType,
+								MemoryContext resultContext);
+
+
+/*
+ * ColumnarCompressionPoolCreate starts up to workerCount compression workers
+ * and returns the pool, allocated in the current memory context. Returns NULL
+ * if no worker could be registered.
+ *
+ * The pool lives until it is destroyed or the memory context it is allocated
+ * in goes away, whichever comes first, so that workers don't outlive the
+ * writer when it is discarded without being finished.
+ */
+ColumnarCompressionPool *
+ColumnarCompressionPoolCreate(int workerCount)
+{
+	Assert(workerCount > 0);
+
+	ColumnarCompressionPool *pool = palloc0(sizeof(ColumnarCompressionPool));
+	pool->context = CurrentMemoryContext;
+	pool->workers = palloc0(workerCount * sizeof(CompressionWorker));
+
+	dsm_segment *segment = dsm_create(JobQueueOffset(workerCount),
+									  DSM_CREATE_NULL_IF_MAXSEGMENTS);
+	if (segment == NULL)
+	{
+		pfree(pool->workers);
+		pfree(pool);
+		return NULL;
+	}
+
+	/*
+	 * The writer outlives the resource owner of the statement that created
+	 * it, so we manage the mapping ourselves and detach when the memory
+	 * context of the pool is deleted, at the latest at the end of the
+	 * transaction.
+	 */
+	dsm_pin_mapping(segment);
+	pool->segment = segment;
+	pool->detachCallback.func = DetachCompressionPool;
+	pool->detachCallback.arg = pool;
+	MemoryContextRegisterResetCallback(pool->context, &pool->detachCallback);
+
+	for (int workerIndex = 0; workerIndex < workerCount; workerIndex++)
+	{
+		char *segmentAddress = dsm_segment_address(segment);
+		shm_mq *jobQueue = shm_mq_create(segmentAddress + JobQueueOffset(workerIndex),
+										 COMPRESSION_QUEUE_SIZE);
+		shm_mq *resultQueue =
+			shm_mq_create(segmentAddress + ResultQueueOffset(workerIndex),
+						  COMPRESSION_QUEUE_SIZE);
+
+		shm_mq_set_sender(jobQueue, MyProc);
+		shm_mq_set_receiver(resultQueue, MyProc);
+
+		BackgroundWorker worker;
+		memset(&worker, 0, sizeof(worker));
+
+		strcpy_s(worker.bgw_name, sizeof(worker.bgw_name),
+				 "citus_columnar compression worker");
+		strcpy_s(worker.bgw_type, sizeof(worker.bgw_type),
+				 "citus_columnar compression worker");
+
+		worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+		worker.bgw_start_time = BgWorkerStart_ConsistentState;
+		worker.bgw_restart_time = BGW_NEVER_RESTART;
+
+		strcpy_s(worker.bgw_library_name, sizeof(worker.bgw_library_name),
+				 "citus_columnar");
+		strcpy_s(worker.bgw_function_name, sizeof(worker.bgw_function_name),
+				 "ColumnarCompressionWorkerMain");
+		worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(segment));
+		worker.bgw_notify_pid = MyProcPid;
+
+		memcpy_s(worker.bgw_extra, sizeof(worker.bgw_extra), &workerIndex,
+				 sizeof(workerIndex));
+
+		BackgroundWorkerHandle *handle = NULL;
+		if (!RegisterDynamicBackgroundWorker(&worker, &handle))
+		{
+			/* out of background worker slots, make do with what we have */
+			break;
+		}
+
+		CompressionWorker *compressionWorker = &pool->workers[workerIndex];
+		compressionWorker->handle = handle;
+		compressionWorker->jobQueue = shm_mq_attach(jobQueue, segment, handle);
+		compressionWorker->resultQueue = shm_mq_attach(resultQueue, segment, handle);
+		compressionWorker->pendingJobs = NIL;
+		compressionWorker->detached = false;
+
+		pool->workerCount++;
+	}
+
+	elog(DEBUG1, "started %d of %d columnar compression workers",
+		 pool->workerCount, workerCount);
+
+	if (pool->workerCount == 0)
+	{
+		ColumnarCompressionPoolDestroy(pool);
+		return NULL;
+	}
+
+	pool->liveWorkerCount = pool->workerCount;
+
+	return pool;
+}
+
+
+/*
+ * ColumnarCompressionPoolSubmit sends the (uncompressed) value buffer of the
+ * given chunk to one of the workers. Once the compressed buffer is received,
+ * it replaces the value buffer of the chunk, and the value compression type
+ * of the chunk is set accordingly. The compressed buffer is allocated in the
+ * current memory context, so the chunk must stay around until the pool is
+ * waited for.
+ */
+void
+ColumnarCompressionPoolSubmit(ColumnarCompressionPool *pool,
+							  ColumnChunkBuffers *chunkBuffers,
+							  CompressionType compressionType,
+							  int compressionLevel)
+{
+	CompressionJob *job = MemoryContextAlloc(pool->context, sizeof(CompressionJob));
+	job->chunkBuffers = chunkBuffers;
+	job->compressionType = compressionType;
+	job->compressionLevel = compressionLevel;
+	job->resultContext = CurrentMemoryContext;
+
+	CompressionJobHeader header;
+	header.compressionType = compressionType;
+	header.compressionLevel = compressionLevel;
+
+	shm_mq_iovec messageParts[2];
+	messageParts[0].data = (char *) &header;
+	messageParts[0].len = sizeof(header);
+	messageParts[1].data = chunkBuffers->valueBuffer->data;
+	messageParts[1].len = chunkBuffers->valueBuffer->len;
+
+	CompressionWorker *worker = NextCompressionWorker(pool);
+	while (worker != NULL)
+	{
+		if (worker->detached)
+		{
+			/* we found out the worker is gone while receiving results */
+			worker = NextCompressionWorker(pool);
+			continue;
+		}
+
+		shm_mq_result result = shm_mq_sendv(worker->jobQueue, messageParts, 2,
+											true, true);
+		if (result == SHM_MQ_SUCCESS)
+		{
+			MemoryContext oldContext = MemoryContextSwitchTo(pool->context);
+			worker->pendingJobs = lappend(worker->pendingJobs, job);
+			MemoryContextSwitchTo(oldContext);
+			return;
+		}
+		else if (result == SHM_MQ_DETACHED)
+		{
+			CompressionWorkerDetached(pool, worker);
+
+			worker = NextCompressionWorker(pool);
+			continue;
+		}
+
+		/*
+		 * The job queue is full. Make room for the worker to send its results
+		 * and wait for either the worker or the other workers to make progress.
+		 * The send has to be retried with the same worker and message, since
+		 * it might have been sent partially.
+		 */
+		if (!ReceiveCompressionResults(pool, true))
+		{
+			(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, -1L,
+							 PG_WAIT_EXTENSION);
+			ResetLatch(MyLatch);
+		}
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	/* all workers are gone */
+	CompressChunkLocally(job);
+	pfree(job);
+}
+
+
+/*
+ * ColumnarCompressionPoolWait waits until the compressed value buffers of all
+ * submitted chunks are received.
+ */
+void
+ColumnarCompressionPoolWait(ColumnarCompressionPool *pool)
+{
+	for (int workerIndex = 0; workerIndex < pool->workerCount; workerIndex++)
+	{
+		CompressionWorker *worker = &pool->workers[workerIndex];
+
+		/* results of a worker come in order, so a blocking receive can't deadlock */
+		while (worker->pendingJobs != NIL)
+		{
+			ReceiveCompressionResult(pool, worker, false);
+		}
+	}
+}
+
+
+/*
+ * ColumnarCompressionPoolDestroy detaches from the shared memory segment of
+ * the pool, which makes the workers exit. Chunks submitted since the pool was
+ * last waited for are left uncompressed.
+ */
+void
+ColumnarCompressionPoolDestroy(ColumnarCompressionPool *pool)
+{
+	DetachCompressionPool(pool);
+
+	/* the pool itself is freed with its memory context, see detachCallback */
+	for (int workerIndex = 0; workerIndex < pool->workerCount; workerIndex++)
+	{
+		CompressionWorker *worker = &pool->workers[workerIndex];
+
+		list_free_deep(worker->pendingJobs);
+		worker->pendingJobs = NIL;
+	}
+	pool->liveWorkerCount = 0;
+}
+
+
+/*
+ * DetachCompressionPool detaches from the shared memory segment of the pool
+ * if that is not done yet. It is also called as a memory context callback.
+ */
+static void
+DetachCompressionPool(void *arg)
+{
+	ColumnarCompressionPool *pool = (ColumnarCompressionPool *) arg;
+
+	if (pool->segment != NULL)
+	{
+		dsm_detach(pool->segment);
+		pool->segment = NULL;
+	}
+}
+
+
+/*
+ * NextCompressionWorker returns the worker to send the next job to, or NULL
+ * if all workers are gone.
+ */
+static CompressionWorker *
+NextCompressionWorker(ColumnarCompressionPool *pool)
+{
+	if (pool->liveWorkerCount == 0)
+	{
+		return NULL;
+	}
+
+	CompressionWorker *worker = NULL;
+	do {
+		worker = &pool->workers[pool->nextWorkerIndex];
+		pool->nextWorkerIndex = (pool->nextWorkerIndex + 1) % pool->workerCount;
+	} while (worker->detached);
+
+	return worker;
+}
+
+
+/*
+ * ReceiveCompressionResults receives the available results from all workers,
+ * and returns whether any were received. It does not wait for results if
+ * nowait is true.
+ */
+static bool
+ReceiveCompressionResults(ColumnarCompressionPool *pool, bool nowait)
+{
+	bool received = false;
+
+	for (int workerIndex = 0; workerIndex < pool->workerCount; workerIndex++)
+	{
+		CompressionWorker *worker = &pool->workers[workerIndex];
+
+		while (worker->pendingJobs != NIL &&
+			   ReceiveCompressionResult(pool, worker, nowait))
+		{
+			received = true;
+		}
+	}
+
+	return received;
+}
+
+
+/*
+ * ReceiveCompressionResult receives the result of the oldest pending job of
+ * the given worker, and stores it in the chunk of the job. Returns false if
+ * there is no result available and nowait is true. If the worker is gone,
+ * its pending jobs are compressed locally instead.
+ */
+static bool
+ReceiveCompressionResult(ColumnarCompressionPool *pool, CompressionWorker *worker,
+						 bool nowait)
+{
+	Size messageLength = 0;
+	void *message = NULL;
+
+	Assert(worker->pendingJobs != NIL);
+
+	shm_mq_result result = shm_mq_receive(worker->resultQueue, &messageLength,
+										  &message, nowait);
+	if (result == SHM_MQ_WOULD_BLOCK)
+	{
+		return false;
+	}
+	else if (result == SHM_MQ_DETACHED)
+	{
+		CompressionWorkerDetached(pool, worker);
+		return true;
+	}
+
+	if (messageLength < sizeof(CompressionResultHeader))
+	{
+		elog(ERROR, "invalid message received from columnar compression worker");
+	}
+
+	CompressionJob *job = (CompressionJob *) linitial(worker->pendingJobs);
+	CompressionResultHeader *header = (CompressionResultHeader *) message;
+
+	if (header->compressed)
+	{
+		SetChunkValueBuffer(job->chunkBuffers,
+							(char *) message + sizeof(CompressionResultHeader),
+							messageLength - sizeof(CompressionResultHeader),
+							job->compressionType, job->resultContext);
+	}
+
+	worker->pendingJobs = list_delete_first(worker->pendingJobs);
+	pfree(job);
+
+	return true;
+}
+
+
+/*
+ * CompressionWorkerDetached marks the given worker as gone and compresses its
+ * pending jobs locally.
+ */
+static void
+CompressionWorkerDetached(ColumnarCompressionPool *pool, CompressionWorker *worker)
+{
+	Assert(!worker->detached);
+
+	elog(DEBUG1, "columnar compression worker exited, compressing %d chunks locally",
+		 list_length(worker->pendingJobs));
+
+	worker->detached = true;
+	pool->liveWorkerCount--;
+
+	CompressionJob *job = NULL;
+	foreach_declared_ptr(job, worker->pendingJobs)
+	{
+		CompressChunkLocally(job);
+	}
+
+	list_free_deep(worker->pendingJobs);
+	worker->pendingJobs = NIL;
+}
+
+
+/*
+ * CompressChunkLocally compresses the value buffer of the chunk of the given
+ * job in this backend, in case no worker is available to do it.
+ */
+static void
+CompressChunkLocally(CompressionJob *job)
+{
+	MemoryContext oldContext = MemoryContextSwitchTo(job->resultContext);
+
+	StringInfo compressionBuffer = makeStringInfo();
+	bool compressed = CompressBuffer(job->chunkBuffers->valueBuffer, compressionBuffer,
+									 job->compressionType, job->compressionLevel);
+	if (compressed)
+	{
+		SetChunkValueBuffer(job->chunkBuffers, compressionBuffer->data,
+							compressionBuffer->len, job->compressionType,
+							job->resultContext);
+	}
+
+	pfree(compressionBuffer->data);
+	pfree(compressionBuffer);
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * SetChunkValueBuffer replaces the value buffer of the given chunk with a copy
+ * of the given compressed data.
+ */
+static void
+SetChunkValueBuffer(ColumnChunkBuffers *chunkBuffers, char *data, int length,
+					CompressionType compressionType, MemoryContext resultContext)
+{
+	StringInfo uncompressedBuffer = chunkBuffers->valueBuffer;
+
+	MemoryContext oldContext = MemoryContextSwitchTo(resultContext);
+
+	StringInfo valueBuffer = makeStringInfo();
+	appendBinaryStringInfo(valueBuffer, data, length);
+
+	MemoryContextSwitchTo(oldContext);
+
+	chunkBuffers->valueBuffer = valueBuffer;
+	chunkBuffers->valueCompressionType = compressionType;
+
+	pfree(uncompressedBuffer->data);
+	pfree(uncompressedBuffer);
+}
+
+
+/*
+ * ColumnarCompressionWorkerMain is the entrypoint of the compression workers.
+ * It compresses the chunks it receives from the writer and sends them back,
+ * until the writer detaches from the shared memory segment.
+ */
+void
+ColumnarCompressionWorkerMain(Datum main_arg)
+{
+	dsm_handle segmentHandle = DatumGetUInt32(main_arg);
+	int workerIndex = 0;
+
+	memcpy_s(&workerIndex, sizeof(workerIndex), MyBgworkerEntry->bgw_extra,
+			 sizeof(workerIndex));
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	dsm_segment *segment = dsm_attach(segmentHandle);
+	if (segment == NULL)
+	{
+		/* the writer is done already */
+		proc_exit(0);
+	}
+
+	char *segmentAddress = dsm_segment_address(segment);
+	shm_mq *jobQueue = (shm_mq *) (segmentAddress + JobQueueOffset(workerIndex));
+	shm_mq *resultQueue = (shm_mq *) (segmentAddress + ResultQueueOffset(workerIndex));
+
+	shm_mq_set_receiver(jobQueue, MyProc);
+	shm_mq_set_sender(resultQueue, MyProc);
+
+	shm_mq_handle *jobQueueHandle = shm_mq_attach(jobQueue, segment, NULL);
+	shm_mq_handle *resultQueueHandle = shm_mq_attach(resultQueue, segment, NULL);
+
+	StringInfo compressionBuffer = makeStringInfo();
+
+	while (true)
+	{
+		Size messageLength = 0;
+		void *message = NULL;
+
+		shm_mq_result result = shm_mq_receive(jobQueueHandle, &messageLength,
+											  &message, false);
+		if (result != SHM_MQ_SUCCESS)
+		{
+			break;
+		}
+
+		if (messageLength < sizeof(CompressionJobHeader))
+		{
+			elog(ERROR, "invalid message received by columnar compression worker");
+		}
+
+		CompressionJobHeader *jobHeader = (CompressionJobHeader *) message;
+
+		/* the message stays valid until the next receive, so don't copy it */
+		StringInfoData inputBuffer;
+		inputBuffer.data = (char *) message + sizeof(CompressionJobHeader);
+		inputBuffer.len = messageLength - sizeof(CompressionJobHeader);
+		inputBuffer.maxlen = inputBuffer.len;
+		inputBuffer.cursor = 0;
+
+		CompressionResultHeader resultHeader;
+		resultHeader.compressed = CompressBuffer(&inputBuffer, compressionBuffer,
+												 jobHeader->compressionType,
+												 jobHeader->compressionLevel);
+
+		shm_mq_iovec messageParts[2];
+		messageParts[0].data = (char *) &resultHeader;
+		messageParts[0].len = sizeof(resultHeader);
+		messageParts[1].data = compressionBuffer->data;
+		messageParts[1].len = compressionBuffer->len;
+
+		result = shm_mq_sendv(resultQueueHandle, messageParts,
+							  resultHeader.compressed ? 2 : 1, false, true);
+		if (result != SHM_MQ_SUCCESS)
+		{
+			break;
+		}
+	}
+
+	dsm_detach(segment);
+	proc_exit(0);
+}
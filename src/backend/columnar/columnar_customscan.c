@@ -17,6 +17,7 @@
 #include "miscadmin.h"
 
 #include "access/amapi.h"
+#include "access/parallel.h"
 #include "access/skey.h"
 #include "catalog/pg_am.h"
 #include "catalog/pg_statistic.h"
@@ -26,16 +27,20 @@
 #include "nodes/nodeFuncs.h"
 #include "nodes/pg_list.h"
 #include "nodes/plannodes.h"
+#include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/plancat.h"
+#include "optimizer/planner.h"
 #include "optimizer/restrictinfo.h"
+#include "optimizer/tlist.h"
 #if PG_VERSION_NUM >= PG_VERSION_16
 #include "parser/parse_relation.h"
 #include "parser/parsetree.h"
 #endif
+#include "rewrite/rewriteManip.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
 #include "utils/relcache.h"
@@ -49,6 +54,7 @@
 #include "columnar/columnar_customscan.h"
 #include "columnar/columnar_metadata.h"
 #include "columnar/columnar_tableam.h"
+#include "columnar/columnar_vector.h"
 
 #include "distributed/listutils.h"
 
@@ -62,9 +68,66 @@ typedef struct ColumnarScanState
 
 	ExprContext *css_RuntimeContext;
 	List *qual;
+
+	/*
+	 * State for vectorized execution, see ColumnarScanNextVectorized. Rows of
+	 * the current batch that pass vectorQualList are tracked in
+	 * selectionVector, and nextSelectedIndex points to the next one to be
+	 * returned.
+	 */
+	bool vectorized;
+	List *vectorQualList;
+	ColumnarBatch batch;
+	uint32 *selectionVector;
+	uint32 selectionVectorSize;
+	uint32 selectedRowCount;
+	uint32 nextSelectedIndex;
 } ColumnarScanState;
 
 
+/*
+ * ColumnarAggregateScanState represents the state for a columnar aggregate
+ * scan, which computes the aggregates of a query without GROUP BY over a
+ * columnar table and returns them as a single row.
+ */
+typedef struct ColumnarAggregateScanState
+{
+	CustomScanState custom_scanstate; /* must be first field */
+
+	ExprContext *css_RuntimeContext;
+	List *qual;
+
+	/*
+	 * Rows of a chunk group are first filtered by vectorQualList, and then by
+	 * qualState unless allQualsVectorized is true.
+	 */
+	List *vectorQualList;
+	bool allQualsVectorized;
+	ExprState *qualState;
+	TupleTableSlot *rowSlot;
+	uint32 *selectionVector;
+	uint32 selectionVectorSize;
+
+	/* ColumnarVectorAggregate's for the entries of custom_scan_tlist */
+	List *aggregateList;
+
+	/* 0-indexed attribute numbers of the columns read by the scan */
+	Bitmapset *attrNeeded;
+
+	/*
+	 * If useSkipNodes is true, then chunk groups whose rows all pass the
+	 * quals are aggregated using their skip nodes instead of their values,
+	 * see ColumnarAggregateChunkGroupCallback. rangeQualList holds the quals
+	 * in fast path form for checking that.
+	 */
+	bool useSkipNodes;
+	List *rangeQualList;
+	int64 chunkGroupsFromSkipNodes;
+
+	bool finished;
+} ColumnarAggregateScanState;
+
+
 typedef bool (*PathPredicate)(Path *path);
 
 
@@ -81,17 +144,31 @@ static void CostColumnarScan(PlannerInfo *root, RelOptInfo *rel, Oid relationId,
 static void AddColumnarScanPaths(PlannerInfo *root, RelOptInfo *rel,
 								 RangeTblEntry *rte);
 static void AddColumnarScanPath(PlannerInfo *root, RelOptInfo *rel,
-								RangeTblEntry *rte, Relids required_relids);
+								RangeTblEntry *rte, Relids required_relids,
+								int parallelWorkers);
 
 /* helper functions to be used when costing paths or altering them */
 static void RemovePathsByPredicate(RelOptInfo *rel, PathPredicate removePathPredicate);
-static bool IsNotIndexPath(Path *path);
+static void RemovePartialPathsByPredicate(RelOptInfo *rel,
+										  PathPredicate removePathPredicate);
+static bool IsNotIndexOrBitmapHeapPath(Path *path);
+static bool IsNotSeqScanPath(Path *path);
+static bool ColumnarParallelScanAllowed(Oid relationId);
+static double ColumnarParallelDivisor(Path *path);
 static Cost ColumnarIndexScanAdditionalCost(PlannerInfo *root, RelOptInfo *rel,
 											Oid relationId, IndexPath *indexPath);
+static void EstimateIndexSelectivityAndCorrelation(PlannerInfo *root,
+												   IndexPath *indexPath,
+												   Selectivity *indexSelectivity,
+												   double *indexCorrelation);
+static void CostColumnarBitmapHeapPath(PlannerInfo *root, RelOptInfo *rel,
+									   Oid relationId,
+									   BitmapHeapPath *bitmapHeapPath);
 static int RelationIdGetNumberOfAttributes(Oid relationId);
 static Cost ColumnarPerStripeScanCost(RelOptInfo *rel, Oid relationId,
 									  int numberOfColumnsRead);
 static uint64 ColumnarTableStripeCount(Oid relationId);
+static uint64 ColumnarTableChunkGroupCount(Oid relationId);
 static Path * CreateColumnarSeqScanPath(PlannerInfo *root, RelOptInfo *rel,
 										Oid relationId);
 static void AddColumnarScanPathsRec(PlannerInfo *root, RelOptInfo *rel,
@@ -120,6 +197,19 @@ static void ColumnarScan_BeginCustomScan(CustomScanState *node, EState *estate,
 static TupleTableSlot * ColumnarScan_ExecCustomScan(CustomScanState *node);
 static void ColumnarScan_EndCustomScan(CustomScanState *node);
 static void ColumnarScan_ReScanCustomScan(CustomScanState *node);
+static Size ColumnarScan_EstimateDSMCustomScan(CustomScanState *node,
+												ParallelContext *pcxt);
+static void ColumnarScan_InitializeDSMCustomScan(CustomScanState *node,
+												 ParallelContext *pcxt,
+												 void *coordinate);
+static void ColumnarScan_ReInitializeDSMCustomScan(CustomScanState *node,
+												   ParallelContext *pcxt,
+												   void *coordinate);
+static void ColumnarScan_InitializeWorkerCustomScan(CustomScanState *node,
+													shm_toc *toc,
+													void *coordinate);
+static void ColumnarScanBeginParallel(ColumnarScanState *columnarScanState,
+									  ParallelTableScanDesc parallelScan);
 static void ColumnarScan_ExplainCustomScan(CustomScanState *node, List *ancestors,
 										   ExplainState *es);
 
@@ -132,17 +222,60 @@ static List * set_deparse_context_planstate(List *dpcontext, Node *node,
 
 /* other helpers */
 static List * ColumnarVarNeeded(ColumnarScanState *columnarScanState);
+static TupleTableSlot * ColumnarScanNextVectorized(ColumnarScanState *columnarScanState);
+static void ColumnarScanResetVectorState(ColumnarScanState *columnarScanState);
 static Bitmapset * ColumnarAttrNeeded(ScanState *ss);
 #if PG_VERSION_NUM >= PG_VERSION_16
 static Bitmapset * fixup_inherited_columns(Oid parentId, Oid childId, Bitmapset *columns);
 #endif
 
+/* aggregate pushdown */
+static void ColumnarCreateUpperPathsHook(PlannerInfo *root, UpperRelationKind stage,
+										 RelOptInfo *inputRel, RelOptInfo *outputRel,
+										 void *extra);
+static void AddColumnarAggregateScanPath(PlannerInfo *root, RelOptInfo *inputRel,
+										 RelOptInfo *outputRel);
+static Plan * ColumnarAggregateScanPath_PlanCustomPath(PlannerInfo *root,
+													   RelOptInfo *rel,
+													   struct CustomPath *best_path,
+													   List *tlist,
+													   List *clauses,
+													   List *custom_plans);
+static Node * ColumnarAggregateScan_CreateCustomScanState(CustomScan *cscan);
+static void ColumnarAggregateScan_BeginCustomScan(CustomScanState *node, EState *estate,
+												  int eflags);
+static TupleTableSlot * ColumnarAggregateScan_ExecCustomScan(CustomScanState *node);
+static void ColumnarAggregateScan_EndCustomScan(CustomScanState *node);
+static void ColumnarAggregateScan_ReScanCustomScan(CustomScanState *node);
+static void ColumnarAggregateScan_ExplainCustomScan(CustomScanState *node,
+													List *ancestors,
+													ExplainState *es);
+static TupleTableSlot * ColumnarAggregateScanNext(
+	ColumnarAggregateScanState *aggregateScanState);
+static bool ColumnarAggregateScanRecheck(ColumnarAggregateScanState *aggregateScanState,
+										 TupleTableSlot *slot);
+static void ColumnarAggregateScanRun(ColumnarAggregateScanState *aggregateScanState);
+static uint32 ColumnarAggregateScanFilterRows(
+	ColumnarAggregateScanState *aggregateScanState, ColumnarBatch *batch);
+static bool ColumnarAggregateChunkGroupCallback(StripeMetadata *stripeMetadata,
+												StripeSkipList *stripeSkipList,
+												uint32 chunkGroupIndex,
+												void *callbackArg);
+static bool ColumnarAggregateSkipNodesUsable(
+	ColumnarAggregateScanState *aggregateScanState,
+	TupleDesc tupleDescriptor, bool allQualsFastPath);
+
 /* saved hook value in case of unload */
 static set_rel_pathlist_hook_type PreviousSetRelPathlistHook = NULL;
 static get_relation_info_hook_type PreviousGetRelationInfoHook = NULL;
+static create_upper_paths_hook_type PreviousCreateUpperPathsHook = NULL;
 
 static bool EnableColumnarCustomScan = true;
 static bool EnableColumnarQualPushdown = true;
+static bool EnableColumnarVectorization = true;
+static bool EnableColumnarParallelScan = false;
+static bool EnableColumnarAggregatePushdown = false;
+static bool EnableColumnarBitmapScan = false;
 static double ColumnarQualPushdownCorrelationThreshold = 0.9;
 static int ColumnarMaxCustomScanPaths = 64;
 static int ColumnarPlannerDebugLevel = DEBUG3;
@@ -167,9 +300,35 @@ const struct CustomExecMethods ColumnarScanExecuteMethods = {
 	.EndCustomScan = ColumnarScan_EndCustomScan,
 	.ReScanCustomScan = ColumnarScan_ReScanCustomScan,
 
+	.EstimateDSMCustomScan = ColumnarScan_EstimateDSMCustomScan,
+	.InitializeDSMCustomScan = ColumnarScan_InitializeDSMCustomScan,
+	.ReInitializeDSMCustomScan = ColumnarScan_ReInitializeDSMCustomScan,
+	.InitializeWorkerCustomScan = ColumnarScan_InitializeWorkerCustomScan,
+
 	.ExplainCustomScan = ColumnarScan_ExplainCustomScan,
 };
 
+const struct CustomPathMethods ColumnarAggregateScanPathMethods = {
+	.CustomName = "ColumnarAggregateScan",
+	.PlanCustomPath = ColumnarAggregateScanPath_PlanCustomPath,
+};
+
+const struct CustomScanMethods ColumnarAggregateScanScanMethods = {
+	.CustomName = "ColumnarAggregateScan",
+	.CreateCustomScanState = ColumnarAggregateScan_CreateCustomScanState,
+};
+
+const struct CustomExecMethods ColumnarAggregateScanExecuteMethods = {
+	.CustomName = "ColumnarAggregateScan",
+
+	.BeginCustomScan = ColumnarAggregateScan_BeginCustomScan,
+	.ExecCustomScan = ColumnarAggregateScan_ExecCustomScan,
+	.EndCustomScan = ColumnarAggregateScan_EndCustomScan,
+	.ReScanCustomScan = ColumnarAggregateScan_ReScanCustomScan,
+
+	.ExplainCustomScan = ColumnarAggregateScan_ExplainCustomScan,
+};
+
 static const struct config_enum_entry debug_level_options[] = {
 	{ "debug5", DEBUG5, false },
 	{ "debug4", DEBUG4, false },
@@ -198,6 +357,9 @@ columnar_customscan_init()
 	PreviousGetRelationInfoHook = get_relation_info_hook;
 	get_relation_info_hook = ColumnarGetRelationInfoHook;
 
+	PreviousCreateUpperPathsHook = create_upper_paths_hook;
+	create_upper_paths_hook = ColumnarCreateUpperPathsHook;
+
 	/* register customscan specific GUC's */
 	DefineCustomBoolVariable(
 		"columnar.enable_custom_scan",
@@ -219,6 +381,49 @@ columnar_customscan_init()
 		PGC_USERSET,
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
+	DefineCustomBoolVariable(
+		"columnar.enable_vectorization",
+		gettext_noop("Enables evaluating pushed-down quals over whole chunk groups "
+					 "in columnar custom scan. This has no effect unless "
+					 "columnar.enable_custom_scan is true."),
+		NULL,
+		&EnableColumnarVectorization,
+		true,
+		PGC_USERSET,
+		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+		NULL, NULL, NULL);
+	DefineCustomBoolVariable(
+		"columnar.enable_parallel_scan",
+		gettext_noop("Enables parallel scans on columnar tables, where the stripes "
+					 "of the table are distributed among the parallel workers."),
+		NULL,
+		&EnableColumnarParallelScan,
+		false,
+		PGC_USERSET,
+		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+		NULL, NULL, NULL);
+	DefineCustomBoolVariable(
+		"columnar.enable_aggregate_pushdown",
+		gettext_noop("Enables computing count(), min(), max() and sum() aggregates "
+					 "of queries without GROUP BY in columnar custom scan, using "
+					 "the chunk group skip lists where possible. This has no "
+					 "effect unless columnar.enable_custom_scan is true."),
+		NULL,
+		&EnableColumnarAggregatePushdown,
+		false,
+		PGC_USERSET,
+		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+		NULL, NULL, NULL);
+	DefineCustomBoolVariable(
+		"columnar.enable_bitmap_scan",
+		gettext_noop("Enables bitmap heap scans on columnar tables, which read "
+					 "each chunk group that contains matching rows only once."),
+		NULL,
+		&EnableColumnarBitmapScan,
+		false,
+		PGC_USERSET,
+		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
+		NULL, NULL, NULL);
 	DefineCustomRealVariable(
 		"columnar.qual_pushdown_correlation_threshold",
 		gettext_noop("Correlation threshold to attempt to push a qual "
@@ -259,6 +464,7 @@ columnar_customscan_init()
 		NULL);
 
 	RegisterCustomScanMethods(&ColumnarScanScanMethods);
+	RegisterCustomScanMethods(&ColumnarAggregateScanScanMethods);
 }
 
 
@@ -297,15 +503,6 @@ ColumnarSetRelPathlistHook(PlannerInfo *root, RelOptInfo *rel, Index rti,
 							errmsg("sample scans not supported on columnar tables")));
 		}
 
-		if (list_length(rel->partial_pathlist) != 0)
-		{
-			/*
-			 * Parallel scans on columnar tables are already discardad by
-			 * ColumnarGetRelationInfoHook but be on the safe side.
-			 */
-			elog(ERROR, "parallel scans on columnar are not supported");
-		}
-
 		/*
 		 * There are cases where IndexPath is normally more preferrable over
 		 * SeqPath for heapAM but not for columnarAM. In such cases, an
@@ -328,8 +525,9 @@ ColumnarSetRelPathlistHook(PlannerInfo *root, RelOptInfo *rel, Index rti,
 
 			/*
 			 * When columnar custom scan is enabled (columnar.enable_custom_scan),
-			 * we only consider ColumnarScanPath's & IndexPath's. For this reason,
-			 * we remove other paths and re-estimate IndexPath costs to make accurate
+			 * we only consider ColumnarScanPath's, IndexPath's and
+			 * BitmapHeapPath's. For this reason, we remove other paths and
+			 * re-estimate IndexPath & BitmapHeapPath costs to make accurate
 			 * comparisons between them.
 			 *
 			 * Even more, we might calculate an equal cost for a
@@ -339,9 +537,23 @@ ColumnarSetRelPathlistHook(PlannerInfo *root, RelOptInfo *rel, Index rti,
 			 * In that case, if we don't remove SeqPath's, we might wrongly choose
 			 * SeqPath thinking that its cost would be equal to ColumnarCustomScan.
 			 */
-			RemovePathsByPredicate(rel, IsNotIndexPath);
+			RemovePathsByPredicate(rel, IsNotIndexOrBitmapHeapPath);
+
+			/*
+			 * For the same reason, we replace the partial paths generated by
+			 * postgres with a parallel-aware ColumnarScanPath, if any.
+			 */
+			rel->partial_pathlist = NIL;
 			AddColumnarScanPaths(root, rel, rte);
 		}
+		else
+		{
+			/*
+			 * We only know how to scan columnar tables in parallel with a
+			 * SeqScan, which CostColumnarPaths already re-costed.
+			 */
+			RemovePartialPathsByPredicate(rel, IsNotSeqScanPath);
+		}
 	}
 	RelationClose(relation);
 }
@@ -358,14 +570,23 @@ ColumnarGetRelationInfoHook(PlannerInfo *root, Oid relationObjectId,
 
 	if (IsColumnarTableAmTable(relationObjectId))
 	{
-		/* disable parallel query */
-		rel->rel_parallel_workers = 0;
+		if (!ColumnarParallelScanAllowed(relationObjectId))
+		{
+			/* disable parallel query */
+			rel->rel_parallel_workers = 0;
+		}
 
 		/* disable index-only scan */
 		IndexOptInfo *indexOptInfo = NULL;
 		foreach_declared_ptr(indexOptInfo, rel->indexlist)
 		{
 			memset(indexOptInfo->canreturn, false, indexOptInfo->ncolumns * sizeof(bool));
+
+			/* disable bitmap heap scan unless columnar.enable_bitmap_scan is set */
+			if (!EnableColumnarBitmapScan)
+			{
+				indexOptInfo->amhasgetbitmap = false;
+			}
 		}
 	}
 }
@@ -394,12 +615,113 @@ RemovePathsByPredicate(RelOptInfo *rel, PathPredicate removePathPredicate)
 
 
 /*
- * IsNotIndexPath returns true if given path is not an IndexPath.
+ * RemovePartialPathsByPredicate removes the paths that removePathPredicate
+ * evaluates to true from partial_pathlist of given rel.
+ */
+static void
+RemovePartialPathsByPredicate(RelOptInfo *rel, PathPredicate removePathPredicate)
+{
+	List *filteredPathList = NIL;
+
+	Path *path = NULL;
+	foreach_declared_ptr(path, rel->partial_pathlist)
+	{
+		if (!removePathPredicate(path))
+		{
+			filteredPathList = lappend(filteredPathList, path);
+		}
+	}
+
+	rel->partial_pathlist = filteredPathList;
+}
+
+
+/*
+ * IsNotIndexOrBitmapHeapPath returns true if given path is neither an
+ * IndexPath nor a BitmapHeapPath.
+ */
+static bool
+IsNotIndexOrBitmapHeapPath(Path *path)
+{
+	return !IsA(path, IndexPath) && !IsA(path, BitmapHeapPath);
+}
+
+
+/*
+ * IsNotSeqScanPath returns true if given path is not a plain SeqScan path.
  */
 static bool
-IsNotIndexPath(Path *path)
+IsNotSeqScanPath(Path *path)
 {
-	return !IsA(path, IndexPath);
+	return path->pathtype != T_SeqScan;
+}
+
+
+/*
+ * ColumnarParallelScanAllowed returns true if parallel scans can be considered
+ * for the columnar table with relationId.
+ *
+ * Scans flush the pending writes of the current transaction first, which is
+ * not possible in parallel mode, so we don't scan a table with pending writes
+ * in parallel.
+ */
+static bool
+ColumnarParallelScanAllowed(Oid relationId)
+{
+	if (!EnableColumnarParallelScan)
+	{
+		return false;
+	}
+
+	Relation relation = RelationIdGetRelation(relationId);
+	if (!RelationIsValid(relation))
+	{
+		ereport(ERROR, (errmsg("could not open relation with OID %u", relationId)));
+	}
+
+	RelFileNumber relfilenumber = RelationPhysicalIdentifierNumber_compat(
+		RelationPhysicalIdentifier_compat(relation));
+	RelationClose(relation);
+
+	return !PendingWritesInUpperTransactions(relfilenumber, InvalidSubTransactionId);
+}
+
+
+/*
+ * ColumnarParallelDivisor returns the estimated fraction of the rows of a
+ * parallel scan that a single participant would process.
+ *
+ * Exact function copied from get_parallel_divisor() in PG's costsize.c as it's
+ * static.
+ */
+static double
+ColumnarParallelDivisor(Path *path)
+{
+	double parallel_divisor = path->parallel_workers;
+
+	/*
+	 * Early experience with parallel query suggests that when there is only
+	 * one worker, the leader often makes a very substantial contribution to
+	 * executing the parallel portion of the plan, but as more workers are
+	 * added, it does less and less, because it's busy reading tuples from the
+	 * workers and doing whatever non-parallel post-processing is needed.  By
+	 * the time we reach 4 workers, the leader no longer makes a meaningful
+	 * contribution.  Thus, for now, estimate that the leader spends 30% of
+	 * its time servicing each worker, and the remainder executing the
+	 * parallel plan.
+	 */
+	if (parallel_leader_participation)
+	{
+		double leader_contribution;
+
+		leader_contribution = 1.0 - (0.3 * path->parallel_workers);
+		if (leader_contribution > 0)
+		{
+			parallel_divisor += leader_contribution;
+		}
+	}
+
+	return parallel_divisor;
 }
 
 
@@ -410,7 +732,7 @@ IsNotIndexPath(Path *path)
 static Path *
 CreateColumnarSeqScanPath(PlannerInfo *root, RelOptInfo *rel, Oid relationId)
 {
-	/* columnar doesn't support parallel scan */
+	/* partial paths are added by postgres, see CostColumnarPaths */
 	int parallelWorkers = 0;
 
 	Relids requiredOuter = rel->lateral_relids;
@@ -428,19 +750,24 @@ static void
 CostColumnarPaths(PlannerInfo *root, RelOptInfo *rel, Oid relationId)
 {
 	Path *path = NULL;
+	foreach_declared_ptr(path, rel->partial_pathlist)
+	{
+		if (path->pathtype == T_SeqScan)
+		{
+			CostColumnarSeqPath(rel, relationId, path);
+		}
+	}
+
 	foreach_declared_ptr(path, rel->pathlist)
 	{
 		if (IsA(path, IndexPath))
 		{
-			/*
-			 * Since we don't provide implementations for scan_bitmap_next_block
-			 * & scan_bitmap_next_tuple, postgres doesn't generate bitmap index
-			 * scan paths for columnar tables already (see related comments in
-			 * TableAmRoutine). For this reason, we only consider IndexPath's
-			 * here.
-			 */
 			CostColumnarIndexPath(root, rel, relationId, (IndexPath *) path);
 		}
+		else if (IsA(path, BitmapHeapPath))
+		{
+			CostColumnarBitmapHeapPath(root, rel, relationId, (BitmapHeapPath *) path);
+		}
 		else if (path->pathtype == T_SeqScan)
 		{
 			CostColumnarSeqPath(rel, relationId, path);
@@ -496,21 +823,10 @@ ColumnarIndexScanAdditionalCost(PlannerInfo *root, RelOptInfo *rel,
 	int numberOfColumnsRead = RelationIdGetNumberOfAttributes(relationId);
 	Cost perStripeCost = ColumnarPerStripeScanCost(rel, relationId, numberOfColumnsRead);
 
-	/*
-	 * We don't need to pass correct loop count to amcostestimate since we
-	 * will only use index correlation & index selectivity, and loop count
-	 * doesn't have any effect on those two.
-	 */
-	double fakeLoopCount = 1;
-	Cost fakeIndexStartupCost;
-	Cost fakeIndexTotalCost;
-	double fakeIndexPages;
 	Selectivity indexSelectivity;
 	double indexCorrelation;
-	amcostestimate_function amcostestimate = indexPath->indexinfo->amcostestimate;
-	amcostestimate(root, indexPath, fakeLoopCount, &fakeIndexStartupCost,
-				   &fakeIndexTotalCost, &indexSelectivity,
-				   &indexCorrelation, &fakeIndexPages);
+	EstimateIndexSelectivityAndCorrelation(root, indexPath, &indexSelectivity,
+										   &indexCorrelation);
 
 	Relation relation = RelationIdGetRelation(relationId);
 	if (!RelationIsValid(relation))
@@ -579,6 +895,122 @@ ColumnarIndexScanAdditionalCost(PlannerInfo *root, RelOptInfo *rel,
 }
 
 
+/*
+ * EstimateIndexSelectivityAndCorrelation estimates the selectivity and the
+ * correlation of the index scan described by given IndexPath using indexAM.
+ */
+static void
+EstimateIndexSelectivityAndCorrelation(PlannerInfo *root, IndexPath *indexPath,
+									   Selectivity *indexSelectivity,
+									   double *indexCorrelation)
+{
+	/*
+	 * We don't need to pass correct loop count to amcostestimate since we
+	 * will only use index correlation & index selectivity, and loop count
+	 * doesn't have any effect on those two.
+	 */
+	double fakeLoopCount = 1;
+	Cost fakeIndexStartupCost;
+	Cost fakeIndexTotalCost;
+	double fakeIndexPages;
+	amcostestimate_function amcostestimate = indexPath->indexinfo->amcostestimate;
+	amcostestimate(root, indexPath, fakeLoopCount, &fakeIndexStartupCost,
+				   &fakeIndexTotalCost, indexSelectivity,
+				   indexCorrelation, &fakeIndexPages);
+}
+
+
+/*
+ * CostColumnarBitmapHeapPath re-costs given bitmap heap path for columnar
+ * table with relationId.
+ */
+static void
+CostColumnarBitmapHeapPath(PlannerInfo *root, RelOptInfo *rel, Oid relationId,
+						   BitmapHeapPath *bitmapHeapPath)
+{
+	if (!enable_bitmapscan)
+	{
+		/* costs are already set to disable_cost, don't adjust them */
+		return;
+	}
+
+	Path *path = &bitmapHeapPath->path;
+
+	ereport(DEBUG4, (errmsg("columnar table bitmap heap scan costs estimated by "
+							"postgres: startup cost = %.10f, total cost = %.10f",
+							path->startup_cost, path->total_cost)));
+
+	Cost fakeBitmapCost;
+	Selectivity indexSelectivity;
+	cost_bitmap_tree_node(bitmapHeapPath->bitmapqual, &fakeBitmapCost,
+						  &indexSelectivity);
+
+	Relation relation = RelationIdGetRelation(relationId);
+	if (!RelationIsValid(relation))
+	{
+		ereport(ERROR, (errmsg("could not open relation with OID %u", relationId)));
+	}
+
+	uint64 rowCount = ColumnarTableRowCount(relation);
+	RelationClose(relation);
+	double tuplesFetched = clamp_row_est(rowCount * indexSelectivity);
+
+	/*
+	 * Bitmap heap scans visit the rows in row number order, so we read each
+	 * chunk group at most once, together with all the columns.
+	 *
+	 * In the worst case (i.e no correlation between the column & the index),
+	 * the fetched rows are uniformly distributed over the chunk groups, so we
+	 * estimate the number of chunk groups that contain at least one of them.
+	 * In the best case, the fetched rows are stored next to each other. As in
+	 * ColumnarIndexScanAdditionalCost, we interpolate between the two using
+	 * the index correlation, if the bitmap is built from a single index.
+	 */
+	double chunkGroupCount = Max(ColumnarTableChunkGroupCount(relationId), 1);
+	double maxChunkGroupReadCount =
+		chunkGroupCount * (1.0 - pow(1.0 - 1.0 / chunkGroupCount, tuplesFetched));
+	double minChunkGroupReadCount =
+		Max(tuplesFetched / Max(rowCount / chunkGroupCount, 1.0), 1.0);
+	minChunkGroupReadCount = Min(minChunkGroupReadCount, maxChunkGroupReadCount);
+
+	double absIndexCorrelation = 0;
+	if (IsA(bitmapHeapPath->bitmapqual, IndexPath))
+	{
+		Selectivity fakeIndexSelectivity;
+		double indexCorrelation;
+		EstimateIndexSelectivityAndCorrelation(root,
+											   (IndexPath *) bitmapHeapPath->bitmapqual,
+											   &fakeIndexSelectivity,
+											   &indexCorrelation);
+		absIndexCorrelation = float_abs(indexCorrelation);
+	}
+
+	double chunkGroupReadCount =
+		minChunkGroupReadCount + (1 - absIndexCorrelation) *
+		(maxChunkGroupReadCount - minChunkGroupReadCount);
+
+	int numberOfColumnsRead = RelationIdGetNumberOfAttributes(relationId);
+	Cost perChunkGroupCost =
+		ColumnarPerStripeScanCost(rel, relationId, numberOfColumnsRead) *
+		ColumnarTableStripeCount(relationId) / chunkGroupCount;
+
+	Cost cpuPerTuple = cpu_tuple_cost + rel->baserestrictcost.per_tuple +
+					   path->pathtarget->cost.per_tuple;
+
+	/* postgres already set startup cost to the cost of building the bitmap */
+	path->total_cost = path->startup_cost +
+					   perChunkGroupCost * chunkGroupReadCount +
+					   cpuPerTuple * tuplesFetched;
+
+	ereport(DEBUG4, (errmsg("re-costing bitmap heap scan for columnar table: "
+							"selectivity = %.10f, per chunk group cost = %.10f, "
+							"estimated chunk group read count = %.10f, "
+							"total cost = %.10f", indexSelectivity,
+							perChunkGroupCost, chunkGroupReadCount,
+							path->total_cost)));
+}
+
+
 /*
  * CostColumnarSeqPath sets costs given seq path for columnar table with
  * relationId.
@@ -602,6 +1034,12 @@ CostColumnarSeqPath(RelOptInfo *rel, Oid relationId, Path *path)
 	path->startup_cost = 0;
 	path->total_cost = stripesToRead *
 					   ColumnarPerStripeScanCost(rel, relationId, numberOfColumnsRead);
+
+	if (path->parallel_workers > 0)
+	{
+		/* stripes are distributed among the participants */
+		path->total_cost /= ColumnarParallelDivisor(path);
+	}
 }
 
 
@@ -1162,6 +1600,20 @@ AddColumnarScanPaths(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 
 	AddColumnarScanPathsRec(root, rel, rte, paramRelids, candidateRelids,
 							depthLimit);
+
+	/*
+	 * Also add a parallel-aware path, if possible. Partial paths can't be
+	 * parameterized, so we only consider the minimal parameterization.
+	 */
+	if (rel->consider_parallel && bms_is_empty(paramRelids))
+	{
+		int parallelWorkers = compute_parallel_worker(rel, rel->pages, -1,
+													  max_parallel_workers_per_gather);
+		if (parallelWorkers > 0)
+		{
+			AddColumnarScanPath(root, rel, rte, paramRelids, parallelWorkers);
+		}
+	}
 }
 
 
@@ -1204,7 +1656,9 @@ AddColumnarScanPathsRec(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte,
 	check_stack_depth();
 
 	Assert(!bms_overlap(paramRelids, candidateRelids));
-	AddColumnarScanPath(root, rel, rte, paramRelids);
+
+	int parallelWorkers = 0;
+	AddColumnarScanPath(root, rel, rte, paramRelids, parallelWorkers);
 
 	/* recurse for all candidateRelids, unless we hit the depth limit */
 	Assert(depthLimit >= 0);
@@ -1303,14 +1757,16 @@ ContainsExecParams(Node *node, void *notUsed)
 
 
 /*
- * Create and add a path with the given parameterization paramRelids.
+ * Create and add a path with the given parameterization paramRelids. If
+ * parallelWorkers is greater than 0, then a parallel-aware partial path is
+ * added instead.
  *
  * XXX: Consider refactoring to be more like postgresGetForeignPaths(). The
  * only differences are param_info and custom_private.
  */
 static void
 AddColumnarScanPath(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte,
-					Relids paramRelids)
+					Relids paramRelids, int parallelWorkers)
 {
 	/*
 	 * Must return a CustomPath, not a larger structure containing a
@@ -1332,8 +1788,10 @@ AddColumnarScanPath(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte,
 	path->parent = rel;
 	path->pathtarget = rel->reltarget;
 
-	/* columnar scans are not parallel-aware, but they are parallel-safe */
+	/* columnar scans are parallel-safe, see below for parallel-aware ones */
 	path->parallel_safe = rel->consider_parallel;
+	path->parallel_aware = parallelWorkers > 0;
+	path->parallel_workers = parallelWorkers;
 
 	path->param_info = get_baserel_parampathinfo(root, rel, paramRelids);
 
@@ -1428,17 +1886,32 @@ AddColumnarScanPath(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte,
 	CostColumnarScan(root, rel, rte->relid, cpath, numberOfColumnsRead,
 					 numberOfClausesPushed);
 
+	if (path->parallel_aware)
+	{
+		/* each participant scans and returns a share of the stripes */
+		double parallelDivisor = ColumnarParallelDivisor(path);
+		path->rows = clamp_row_est(path->rows / parallelDivisor);
+		path->total_cost /= parallelDivisor;
+	}
 
 	StringInfoData buf;
 	initStringInfo(&buf);
 	ereport(ColumnarPlannerDebugLevel,
-			(errmsg("columnar planner: adding CustomScan path for %s",
+			(errmsg("columnar planner: adding %sCustomScan path for %s",
+					path->parallel_aware ? "parallel " : "",
 					rte->eref->aliasname),
 			 errdetail("%s; %d clauses pushed down",
 					   ParameterizationAsString(root, paramRelids, &buf),
 					   numberOfClausesPushed)));
 
-	add_path(rel, path);
+	if (path->parallel_aware)
+	{
+		add_partial_path(rel, path);
+	}
+	else
+	{
+		add_path(rel, path);
+	}
 }
 
 
@@ -1616,6 +2089,34 @@ ColumnarTableStripeCount(Oid relationId)
 }
 
 
+/*
+ * ColumnarTableChunkGroupCount returns the number of chunk groups that
+ * columnar table with relationId has by using stripe metadata.
+ */
+static uint64
+ColumnarTableChunkGroupCount(Oid relationId)
+{
+	Relation relation = RelationIdGetRelation(relationId);
+	if (!RelationIsValid(relation))
+	{
+		ereport(ERROR, (errmsg("could not open relation with OID %u", relationId)));
+	}
+
+	List *stripeList = StripesForRelfilelocator(RelationPhysicalIdentifier_compat(
+													relation));
+	RelationClose(relation);
+
+	uint64 chunkGroupCount = 0;
+	StripeMetadata *stripeMetadata = NULL;
+	foreach_declared_ptr(stripeMetadata, stripeList)
+	{
+		chunkGroupCount += stripeMetadata->chunkCount;
+	}
+
+	return chunkGroupCount;
+}
+
+
 static Plan *
 ColumnarScanPath_PlanCustomPath(PlannerInfo *root,
 								RelOptInfo *rel,
@@ -1809,6 +2310,16 @@ ColumnarScan_BeginCustomScan(CustomScanState *cscanstate, EState *estate, int ef
 	columnarScanState->qual = (List *) EvalParamsMutator(
 		(Node *) plainClauses, columnarScanState->css_RuntimeContext);
 
+	/*
+	 * Columnar doesn't support backward scans anyway, but we don't want to
+	 * hand out rows from a batch in the wrong order if it ever does.
+	 */
+	columnarScanState->vectorized = EnableColumnarVectorization &&
+									!(eflags & EXEC_FLAG_BACKWARD);
+	columnarScanState->vectorQualList =
+		BuildColumnarVectorQuals(columnarScanState->qual, NULL);
+	ColumnarScanResetVectorState(columnarScanState);
+
 	/* scan slot is already initialized */
 }
 
@@ -1892,6 +2403,11 @@ ColumnarScanNext(ColumnarScanState *columnarScanState)
 		node->ss.ss_currentScanDesc = scandesc;
 	}
 
+	if (columnarScanState->vectorized)
+	{
+		return ColumnarScanNextVectorized(columnarScanState);
+	}
+
 	/*
 	 * get the next tuple from the table
 	 */
@@ -1904,7 +2420,101 @@ ColumnarScanNext(ColumnarScanState *columnarScanState)
 
 
 /*
- * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
+ * ColumnarScanNextVectorized returns the next row that passes the vectorized
+ * quals. Rather than reading rows one by one, it fetches a whole chunk group
+ * at a time, evaluates the vectorized quals over its column vectors and only
+ * materializes the rows that pass them. The columns that are not referenced
+ * by the quals are not even deserialized for chunk groups with no such rows.
+ *
+ * Vectorized quals are implied by the scan quals, so the rows filtered here
+ * would be filtered by ExecScan anyway, and ExecScan still evaluates the full
+ * qual for the rows we return.
+ */
+static TupleTableSlot *
+ColumnarScanNextVectorized(ColumnarScanState *columnarScanState)
+{
+	CustomScanState *node = (CustomScanState *) columnarScanState;
+	TableScanDesc scandesc = node->ss.ss_currentScanDesc;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	ColumnarBatch *batch = &columnarScanState->batch;
+
+	while (columnarScanState->nextSelectedIndex >= columnarScanState->selectedRowCount)
+	{
+		if (!ColumnarScanNextBatch(scandesc, slot, batch))
+		{
+			ExecClearTuple(slot);
+			return NULL;
+		}
+
+		if (batch->rowCount > columnarScanState->selectionVectorSize)
+		{
+			MemoryContext queryContext = node->ss.ps.state->es_query_cxt;
+
+			if (columnarScanState->selectionVector != NULL)
+			{
+				pfree(columnarScanState->selectionVector);
+			}
+
+			columnarScanState->selectionVector =
+				MemoryContextAlloc(queryContext, batch->rowCount * sizeof(uint32));
+			columnarScanState->selectionVectorSize = batch->rowCount;
+		}
+
+		/*
+		 * Operators might allocate memory, e.g. when detoasting, so evaluate
+		 * them in the per-tuple memory context, which ExecScan resets for
+		 * each tuple anyway.
+		 */
+		ExprContext *econtext = node->ss.ps.ps_ExprContext;
+		MemoryContext oldContext =
+			MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+		uint32 selectedRowCount =
+			ColumnarVectorFilter(columnarScanState->vectorQualList, batch,
+								 columnarScanState->selectionVector);
+
+		MemoryContextSwitchTo(oldContext);
+
+		/*
+		 * So far only the columns referenced by the quals are deserialized,
+		 * so deserialize the rest only if we will return any rows.
+		 */
+		if (selectedRowCount > 0)
+		{
+			ColumnarScanMaterializeBatch(scandesc, batch);
+		}
+
+		/* keep EXPLAIN ANALYZE's "Rows Removed by Filter" accurate */
+		InstrCountFiltered1(node, (batch->rowCount - batch->startRow) -
+							selectedRowCount);
+
+		columnarScanState->selectedRowCount = selectedRowCount;
+		columnarScanState->nextSelectedIndex = 0;
+	}
+
+	uint32 rowIndex =
+		columnarScanState->selectionVector[columnarScanState->nextSelectedIndex++];
+	ColumnarScanStoreBatchRow(batch, rowIndex, slot);
+
+	return slot;
+}
+
+
+/*
+ * ColumnarScanResetVectorState forgets the rows of the current batch that
+ * are not yet returned.
+ */
+static void
+ColumnarScanResetVectorState(ColumnarScanState *columnarScanState)
+{
+	memset(&columnarScanState->batch, 0, sizeof(ColumnarBatch));
+	columnarScanState->selectedRowCount = 0;
+	columnarScanState->nextSelectedIndex = 0;
+}
+
+
+/*
+ * SeqRecheck -- access method routine to recheck a tuple in EvalPlanQual
  */
 static bool
 ColumnarScanRecheck(ColumnarScanState *node, TupleTableSlot *slot)
@@ -1960,6 +2570,10 @@ ColumnarScan_ReScanCustomScan(CustomScanState *node)
 	columnarScanState->qual = (List *) EvalParamsMutator(
 		(Node *) allClauses, columnarScanState->css_RuntimeContext);
 
+	columnarScanState->vectorQualList =
+		BuildColumnarVectorQuals(columnarScanState->qual, NULL);
+	ColumnarScanResetVectorState(columnarScanState);
+
 	TableScanDesc scanDesc = node->ss.ss_currentScanDesc;
 
 	if (scanDesc != NULL)
@@ -1972,6 +2586,103 @@ ColumnarScan_ReScanCustomScan(CustomScanState *node)
 }
 
 
+/*
+ * ColumnarScan_EstimateDSMCustomScan returns the size of the shared memory
+ * needed for a parallel columnar custom scan.
+ */
+static Size
+ColumnarScan_EstimateDSMCustomScan(CustomScanState *node, ParallelContext *pcxt)
+{
+	EState *estate = node->ss.ps.state;
+
+	return table_parallelscan_estimate(node->ss.ss_currentRelation,
+									   estate->es_snapshot);
+}
+
+
+/*
+ * ColumnarScan_InitializeDSMCustomScan initializes the shared state of a
+ * parallel columnar custom scan in the leader and begins the leader's scan.
+ */
+static void
+ColumnarScan_InitializeDSMCustomScan(CustomScanState *node, ParallelContext *pcxt,
+									 void *coordinate)
+{
+	ColumnarScanState *columnarScanState = (ColumnarScanState *) node;
+	EState *estate = node->ss.ps.state;
+	ParallelTableScanDesc parallelScan = (ParallelTableScanDesc) coordinate;
+
+	table_parallelscan_initialize(node->ss.ss_currentRelation, parallelScan,
+								  estate->es_snapshot);
+
+	ColumnarScanBeginParallel(columnarScanState, parallelScan);
+}
+
+
+/*
+ * ColumnarScan_ReInitializeDSMCustomScan resets the shared state of a parallel
+ * columnar custom scan before it is rescanned.
+ */
+static void
+ColumnarScan_ReInitializeDSMCustomScan(CustomScanState *node, ParallelContext *pcxt,
+									   void *coordinate)
+{
+	ParallelTableScanDesc parallelScan = (ParallelTableScanDesc) coordinate;
+
+	table_parallelscan_reinitialize(node->ss.ss_currentRelation, parallelScan);
+}
+
+
+/*
+ * ColumnarScan_InitializeWorkerCustomScan begins the scan of a parallel worker
+ * using the shared state initialized by the leader.
+ */
+static void
+ColumnarScan_InitializeWorkerCustomScan(CustomScanState *node, shm_toc *toc,
+										void *coordinate)
+{
+	ColumnarScanState *columnarScanState = (ColumnarScanState *) node;
+
+	ColumnarScanBeginParallel(columnarScanState, (ParallelTableScanDesc) coordinate);
+}
+
+
+/*
+ * ColumnarScanBeginParallel begins a columnar scan that reads the stripes it
+ * claims from given shared state, and sets it as the current scan of given
+ * scan state so that ColumnarScanNext doesn't begin a serial one.
+ *
+ * This is the counterpart of table_beginscan_parallel for columnar custom
+ * scans, which also need to pass the needed attributes and the quals.
+ */
+static void
+ColumnarScanBeginParallel(ColumnarScanState *columnarScanState,
+						  ParallelTableScanDesc parallelScan)
+{
+	CustomScanState *node = (CustomScanState *) columnarScanState;
+	Relation relation = node->ss.ss_currentRelation;
+
+	/* the columnar access method does not use the flags, they are specific to heap */
+	uint32 flags = 0;
+
+	Snapshot snapshot = SnapshotAny;
+	if (!parallelScan->phs_snapshot_any)
+	{
+		/* snapshot was serialized into shared memory by the leader */
+		snapshot = RestoreSnapshot((char *) parallelScan +
+								   parallelScan->phs_snapshot_off);
+		RegisterSnapshot(snapshot);
+		flags |= SO_TEMP_SNAPSHOT;
+	}
+
+	Bitmapset *attr_needed = ColumnarAttrNeeded(&node->ss);
+	node->ss.ss_currentScanDesc =
+		columnar_beginscan_extended(relation, snapshot, 0, NULL, parallelScan, flags,
+									attr_needed, columnarScanState->qual);
+	bms_free(attr_needed);
+}
+
+
 static void
 ColumnarScan_ExplainCustomScan(CustomScanState *node, List *ancestors,
 							   ExplainState *es)
@@ -2128,3 +2839,679 @@ set_deparse_context_planstate(List *dpcontext, Node *node, List *ancestors)
 	PlanState *ps = (PlanState *) node;
 	return set_deparse_context_plan(dpcontext, ps->plan, ancestors);
 }
+
+
+/*
+ * ColumnarCreateUpperPathsHook adds a ColumnarAggregateScan path for the
+ * aggregation step of queries that compute aggregates without GROUP BY over
+ * a single columnar table, see AddColumnarAggregateScanPath.
+ */
+static void
+ColumnarCreateUpperPathsHook(PlannerInfo *root, UpperRelationKind stage,
+							 RelOptInfo *inputRel, RelOptInfo *outputRel,
+							 void *extra)
+{
+	if (PreviousCreateUpperPathsHook)
+	{
+		PreviousCreateUpperPathsHook(root, stage, inputRel, outputRel, extra);
+	}
+
+	if (stage != UPPERREL_GROUP_AGG || !EnableColumnarCustomScan ||
+		!EnableColumnarAggregatePushdown)
+	{
+		return;
+	}
+
+	AddColumnarAggregateScanPath(root, inputRel, outputRel);
+}
+
+
+/*
+ * AddColumnarAggregateScanPath adds a path that computes the aggregates of
+ * the query in a single scan of the columnar table, if the query only has
+ * aggregates that ColumnarVectorAggregate supports and no GROUP BY.
+ *
+ * Such a scan filters and aggregates the rows of each chunk group over its
+ * column vectors, without producing a tuple for every row. Moreover, chunk
+ * groups whose rows all pass the quals can often be aggregated using their
+ * skip list entries alone, without reading their data at all.
+ */
+static void
+AddColumnarAggregateScanPath(PlannerInfo *root, RelOptInfo *inputRel,
+							 RelOptInfo *outputRel)
+{
+	Query *parse = root->parse;
+
+	if (!parse->hasAggs || parse->groupClause != NIL || parse->groupingSets != NIL ||
+		root->hasHavingQual || parse->hasTargetSRFs || parse->hasWindowFuncs)
+	{
+		return;
+	}
+
+	if (inputRel->reloptkind != RELOPT_BASEREL || inputRel->rtekind != RTE_RELATION)
+	{
+		return;
+	}
+
+	RangeTblEntry *rte = root->simple_rte_array[inputRel->relid];
+	if (rte->inh || rte->tablesample != NULL || !IsColumnarTableAmTable(rte->relid))
+	{
+		return;
+	}
+
+	Bitmapset *attrsUsed = NULL;
+
+	List *qualList = NIL;
+	RestrictInfo *rinfo = NULL;
+	foreach_declared_ptr(rinfo, inputRel->baserestrictinfo)
+	{
+		/* leave pseudoconstant and security barrier quals to the executor */
+		if (rinfo->pseudoconstant || rinfo->security_level != 0)
+		{
+			return;
+		}
+
+		qualList = lappend(qualList, rinfo->clause);
+	}
+
+	/*
+	 * We evaluate the quals over the rows of a chunk group ourselves, so they
+	 * must not need any other plan nodes or run-time state.
+	 */
+	if (contain_volatile_functions((Node *) qualList) ||
+		contain_subplans((Node *) qualList) ||
+		ContainsExecParams((Node *) qualList, NULL))
+	{
+		return;
+	}
+
+	pull_varattnos((Node *) qualList, inputRel->relid, &attrsUsed);
+
+	List *aggregateNodeList =
+		pull_var_clause((Node *) outputRel->reltarget->exprs,
+						PVC_INCLUDE_AGGREGATES | PVC_INCLUDE_WINDOWFUNCS |
+						PVC_INCLUDE_PLACEHOLDERS);
+
+	Node *aggregateNode = NULL;
+	foreach_declared_ptr(aggregateNode, aggregateNodeList)
+	{
+		if (!IsA(aggregateNode, Aggref) ||
+			BuildColumnarVectorAggregate((Aggref *) aggregateNode) == NULL)
+		{
+			return;
+		}
+
+		pull_varattnos(aggregateNode, inputRel->relid, &attrsUsed);
+	}
+
+	/* system columns and whole-row references are not stored in chunk groups */
+	int attrIndex = -1;
+	while ((attrIndex = bms_next_member(attrsUsed, attrIndex)) >= 0)
+	{
+		if (attrIndex + FirstLowInvalidHeapAttributeNumber <= 0)
+		{
+			return;
+		}
+	}
+
+	/*
+	 * Cost the path like the scan it replaces, but without any per-row cost
+	 * for filtering or aggregating the rows.
+	 */
+	Oid relationId = rte->relid;
+	List *pushdownClauses = FilterPushdownClauses(root, inputRel,
+												  inputRel->baserestrictinfo);
+	Selectivity clauseSel = clauselist_selectivity(root, pushdownClauses,
+												   inputRel->relid, JOIN_INNER, NULL);
+	double stripesToRead = clauseSel * ColumnarTableStripeCount(relationId);
+	stripesToRead = Max(stripesToRead, 1.0);
+
+	int numberOfColumnsRead = bms_num_members(attrsUsed);
+
+	CustomPath *cpath = makeNode(CustomPath);
+	cpath->methods = &ColumnarAggregateScanPathMethods;
+	cpath->flags = CUSTOMPATH_SUPPORT_PROJECTION;
+
+	Path *path = &cpath->path;
+	path->pathtype = T_CustomScan;
+	path->parent = outputRel;
+	path->pathtarget = outputRel->reltarget;
+
+	/* we don't support parallel execution, and the scan returns a single row */
+	path->parallel_aware = false;
+	path->parallel_safe = false;
+	path->parallel_workers = 0;
+	path->rows = 1;
+	path->total_cost = stripesToRead *
+					   ColumnarPerStripeScanCost(inputRel, relationId,
+												 numberOfColumnsRead) +
+					   cpu_tuple_cost;
+	path->startup_cost = path->total_cost;
+
+	/*
+	 * The quals are kept in custom_private rather than custom_exprs, since
+	 * setrefs would otherwise try to match their Vars to custom_scan_tlist.
+	 */
+	cpath->custom_private = list_make2(qualList, makeInteger(inputRel->relid));
+
+	ereport(ColumnarPlannerDebugLevel,
+			(errmsg("columnar planner: adding aggregate scan path for %s",
+					get_rel_name(relationId)),
+			 errdetail("%d aggregates, %d quals, %d columns",
+					   list_length(aggregateNodeList), list_length(qualList),
+					   numberOfColumnsRead)));
+
+	add_path(outputRel, path);
+}
+
+
+static Plan *
+ColumnarAggregateScanPath_PlanCustomPath(PlannerInfo *root,
+										 RelOptInfo *rel,
+										 struct CustomPath *best_path,
+										 List *tlist,
+										 List *clauses,
+										 List *custom_plans)
+{
+	CustomScan *cscan = makeNode(CustomScan);
+
+	cscan->methods = &ColumnarAggregateScanScanMethods;
+
+	/*
+	 * The scan tuple holds the result of each aggregate, the final target
+	 * list is computed from them by projection.
+	 */
+	List *scanTargetList = NIL;
+	List *aggregateNodeList = pull_var_clause((Node *) tlist, PVC_INCLUDE_AGGREGATES);
+
+	Node *aggregateNode = NULL;
+	foreach_declared_ptr(aggregateNode, aggregateNodeList)
+	{
+		if (tlist_member((Expr *) aggregateNode, scanTargetList) == NULL)
+		{
+			TargetEntry *targetEntry =
+				makeTargetEntry((Expr *) copyObject(aggregateNode),
+								list_length(scanTargetList) + 1, NULL, false);
+			scanTargetList = lappend(scanTargetList, targetEntry);
+		}
+	}
+
+	List *qualList = copyObject(linitial(best_path->custom_private));
+	fix_opfuncids((Node *) qualList);
+
+	Integer *plannedRelid = lsecond(best_path->custom_private);
+
+	cscan->custom_scan_tlist = scanTargetList;
+	cscan->custom_private = list_make2(qualList, copyObject(plannedRelid));
+	cscan->scan.plan.targetlist = list_copy(tlist);
+	cscan->scan.plan.qual = NIL;
+	cscan->scan.scanrelid = intVal(plannedRelid);
+	cscan->flags = best_path->flags;
+
+	return (Plan *) cscan;
+}
+
+
+static Node *
+ColumnarAggregateScan_CreateCustomScanState(CustomScan *cscan)
+{
+	ColumnarAggregateScanState *aggregateScanState =
+		(ColumnarAggregateScanState *) newNode(sizeof(ColumnarAggregateScanState),
+											   T_CustomScanState);
+
+	CustomScanState *cscanstate = &aggregateScanState->custom_scanstate;
+	cscanstate->methods = &ColumnarAggregateScanExecuteMethods;
+
+	return (Node *) cscanstate;
+}
+
+
+static void
+ColumnarAggregateScan_BeginCustomScan(CustomScanState *cscanstate, EState *estate,
+									  int eflags)
+{
+	CustomScan *cscan = (CustomScan *) cscanstate->ss.ps.plan;
+	ColumnarAggregateScanState *aggregateScanState =
+		(ColumnarAggregateScanState *) cscanstate;
+	ExprContext *stdecontext = cscanstate->ss.ps.ps_ExprContext;
+	Relation relation = cscanstate->ss.ss_currentRelation;
+	TupleDesc tupleDescriptor = RelationGetDescr(relation);
+
+	/*
+	 * Make a new ExprContext just like the existing one, except that we don't
+	 * reset it every tuple.
+	 */
+	ExecAssignExprContext(estate, &cscanstate->ss.ps);
+	aggregateScanState->css_RuntimeContext = cscanstate->ss.ps.ps_ExprContext;
+	cscanstate->ss.ps.ps_ExprContext = stdecontext;
+
+	/*
+	 * Unlike custom_exprs, custom_private is not adjusted by setrefs, so the
+	 * Vars of the quals still refer to the range table index the plan was
+	 * built with.
+	 */
+	List *qualList = copyObject(linitial(cscan->custom_private));
+	Index plannedRelid = intVal(lsecond(cscan->custom_private));
+	if (plannedRelid != cscan->scan.scanrelid)
+	{
+		ChangeVarNodes((Node *) qualList, plannedRelid, cscan->scan.scanrelid, 0);
+	}
+
+	ResetExprContext(aggregateScanState->css_RuntimeContext);
+	aggregateScanState->qual = (List *) EvalParamsMutator(
+		(Node *) qualList, aggregateScanState->css_RuntimeContext);
+
+	aggregateScanState->vectorQualList =
+		BuildColumnarVectorQuals(aggregateScanState->qual,
+								 &aggregateScanState->allQualsVectorized);
+	if (!aggregateScanState->allQualsVectorized)
+	{
+		aggregateScanState->qualState = ExecInitQual(aggregateScanState->qual,
+													 &cscanstate->ss.ps);
+	}
+
+	bool allQualsFastPath = false;
+	aggregateScanState->rangeQualList =
+		BuildColumnarFastPathQuals(aggregateScanState->qual, &allQualsFastPath);
+
+	Bitmapset *attrNeeded = NULL;
+	pull_varattnos((Node *) aggregateScanState->qual, cscan->scan.scanrelid,
+				   &attrNeeded);
+
+	TargetEntry *targetEntry = NULL;
+	foreach_declared_ptr(targetEntry, cscan->custom_scan_tlist)
+	{
+		Aggref *aggref = castNode(Aggref, targetEntry->expr);
+		ColumnarVectorAggregate *aggregate = BuildColumnarVectorAggregate(aggref);
+		if (aggregate == NULL)
+		{
+			elog(ERROR, "unsupported aggregate in columnar aggregate scan");
+		}
+
+		aggregateScanState->aggregateList =
+			lappend(aggregateScanState->aggregateList, aggregate);
+
+		pull_varattnos((Node *) aggref, cscan->scan.scanrelid, &attrNeeded);
+	}
+
+	/* pull_varattnos offsets attribute numbers, ColumnarBeginRead wants 0-indexed */
+	int attrIndex = -1;
+	while ((attrIndex = bms_next_member(attrNeeded, attrIndex)) >= 0)
+	{
+		AttrNumber attnum = attrIndex + FirstLowInvalidHeapAttributeNumber;
+		if (attnum <= 0)
+		{
+			ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							errmsg("system columns and whole-row references are not "
+								   "supported by ColumnarAggregateScan")));
+		}
+
+		aggregateScanState->attrNeeded =
+			bms_add_member(aggregateScanState->attrNeeded, attnum - 1);
+	}
+
+	aggregateScanState->rowSlot = ExecInitExtraTupleSlot(estate, tupleDescriptor,
+														 &TTSOpsVirtual);
+	aggregateScanState->useSkipNodes =
+		ColumnarAggregateSkipNodesUsable(aggregateScanState, tupleDescriptor,
+										 allQualsFastPath);
+	aggregateScanState->chunkGroupsFromSkipNodes = 0;
+	aggregateScanState->finished = false;
+}
+
+
+/*
+ * ColumnarAggregateSkipNodesUsable returns true if the chunk groups whose
+ * rows all pass the quals can be aggregated from their skip nodes.
+ *
+ * Skip nodes don't tell how many NULLs a chunk has, so we can only conclude
+ * that all rows of a chunk group pass a qual if its column is NOT NULL.
+ */
+static bool
+ColumnarAggregateSkipNodesUsable(ColumnarAggregateScanState *aggregateScanState,
+								 TupleDesc tupleDescriptor, bool allQualsFastPath)
+{
+	if (!allQualsFastPath)
+	{
+		return false;
+	}
+
+	ColumnarVectorQual *rangeQual = NULL;
+	foreach_declared_ptr(rangeQual, aggregateScanState->rangeQualList)
+	{
+		if (!TupleDescAttr(tupleDescriptor, rangeQual->columnIndex)->attnotnull)
+		{
+			return false;
+		}
+	}
+
+	ColumnarVectorAggregate *aggregate = NULL;
+	foreach_declared_ptr(aggregate, aggregateScanState->aggregateList)
+	{
+		bool columnNotNull = aggregate->columnIndex >= 0 &&
+							 TupleDescAttr(tupleDescriptor,
+										   aggregate->columnIndex)->attnotnull;
+		if (!ColumnarVectorAggregateSkipNodeUsable(aggregate, columnNotNull))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+static TupleTableSlot *
+ColumnarAggregateScan_ExecCustomScan(CustomScanState *node)
+{
+	return ExecScan(&node->ss,
+					(ExecScanAccessMtd) ColumnarAggregateScanNext,
+					(ExecScanRecheckMtd) ColumnarAggregateScanRecheck);
+}
+
+
+/*
+ * ColumnarAggregateScanNext returns the single row holding the aggregate
+ * results the first time it is called, and NULL afterwards.
+ */
+static TupleTableSlot *
+ColumnarAggregateScanNext(ColumnarAggregateScanState *aggregateScanState)
+{
+	CustomScanState *node = (CustomScanState *) aggregateScanState;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+
+	if (aggregateScanState->finished)
+	{
+		ExecClearTuple(slot);
+		return NULL;
+	}
+
+	ColumnarAggregateScanRun(aggregateScanState);
+
+	ExecClearTuple(slot);
+
+	int attrIndex = 0;
+	ColumnarVectorAggregate *aggregate = NULL;
+	foreach_declared_ptr(aggregate, aggregateScanState->aggregateList)
+	{
+		slot->tts_values[attrIndex] =
+			ColumnarVectorAggregateResult(aggregate, &slot->tts_isnull[attrIndex]);
+		attrIndex++;
+	}
+
+	ExecStoreVirtualTuple(slot);
+
+	aggregateScanState->finished = true;
+
+	return slot;
+}
+
+
+/*
+ * ColumnarAggregateScanRun reads the chunk groups of the table and feeds the
+ * rows that pass the quals to the aggregates. Chunk groups that can be
+ * aggregated from their skip nodes are consumed by
+ * ColumnarAggregateChunkGroupCallback before they are read.
+ */
+static void
+ColumnarAggregateScanRun(ColumnarAggregateScanState *aggregateScanState)
+{
+	CustomScanState *node = (CustomScanState *) aggregateScanState;
+	EState *estate = node->ss.ps.state;
+	TableScanDesc scandesc = node->ss.ss_currentScanDesc;
+	TupleTableSlot *rowSlot = aggregateScanState->rowSlot;
+
+	if (scandesc == NULL)
+	{
+		/* the columnar access method does not use the flags, they are specific to heap */
+		uint32 flags = 0;
+
+		scandesc = columnar_beginscan_extended(node->ss.ss_currentRelation,
+											   estate->es_snapshot,
+											   0, NULL, NULL, flags,
+											   aggregateScanState->attrNeeded,
+											   aggregateScanState->qual);
+		if (aggregateScanState->useSkipNodes)
+		{
+			ColumnarScanSetChunkGroupCallback(scandesc,
+											  ColumnarAggregateChunkGroupCallback,
+											  aggregateScanState);
+		}
+
+		node->ss.ss_currentScanDesc = scandesc;
+	}
+
+	ColumnarBatch batch;
+	memset(&batch, 0, sizeof(ColumnarBatch));
+
+	while (ColumnarScanNextBatch(scandesc, rowSlot, &batch))
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (batch.rowCount > aggregateScanState->selectionVectorSize)
+		{
+			if (aggregateScanState->selectionVector != NULL)
+			{
+				pfree(aggregateScanState->selectionVector);
+			}
+
+			aggregateScanState->selectionVector =
+				MemoryContextAlloc(estate->es_query_cxt, batch.rowCount * sizeof(uint32));
+			aggregateScanState->selectionVectorSize = batch.rowCount;
+		}
+
+		uint32 selectedRowCount =
+			ColumnarAggregateScanFilterRows(aggregateScanState, &batch);
+		if (selectedRowCount == 0)
+		{
+			continue;
+		}
+
+		ColumnarVectorAggregate *aggregate = NULL;
+		foreach_declared_ptr(aggregate, aggregateScanState->aggregateList)
+		{
+			ColumnarVectorAggregateBatch(aggregate, batch.chunkData,
+										 aggregateScanState->selectionVector,
+										 selectedRowCount);
+		}
+	}
+}
+
+
+/*
+ * ColumnarAggregateScanFilterRows stores the indexes of the rows of given
+ * batch that pass the quals into the selection vector, and returns their
+ * number. The batch is materialized if any rows pass.
+ */
+static uint32
+ColumnarAggregateScanFilterRows(ColumnarAggregateScanState *aggregateScanState,
+								ColumnarBatch *batch)
+{
+	CustomScanState *node = (CustomScanState *) aggregateScanState;
+	TableScanDesc scandesc = node->ss.ss_currentScanDesc;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	uint32 *selectionVector = aggregateScanState->selectionVector;
+
+	/* operators might allocate memory, so evaluate them in per-tuple memory */
+	MemoryContext oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	uint32 selectedRowCount = ColumnarVectorFilter(aggregateScanState->vectorQualList,
+												   batch, selectionVector);
+
+	MemoryContextSwitchTo(oldContext);
+	ResetExprContext(econtext);
+
+	if (selectedRowCount == 0)
+	{
+		return 0;
+	}
+
+	ColumnarScanMaterializeBatch(scandesc, batch);
+
+	if (aggregateScanState->allQualsVectorized)
+	{
+		return selectedRowCount;
+	}
+
+	/* evaluate the rest of the quals row by row, compacting the selection */
+	uint32 newSelectedRowCount = 0;
+	for (uint32 index = 0; index < selectedRowCount; index++)
+	{
+		uint32 rowIndex = selectionVector[index];
+
+		ColumnarScanStoreBatchRow(batch, rowIndex, aggregateScanState->rowSlot);
+		econtext->ecxt_scantuple = aggregateScanState->rowSlot;
+
+		if (ExecQual(aggregateScanState->qualState, econtext))
+		{
+			selectionVector[newSelectedRowCount++] = rowIndex;
+		}
+
+		ResetExprContext(econtext);
+	}
+
+	return newSelectedRowCount;
+}
+
+
+/*
+ * ColumnarAggregateChunkGroupCallback aggregates the given chunk group using
+ * its skip nodes if the min/max values of the qual columns show that all of
+ * its rows pass the quals, and returns true if so.
+ *
+ * Columns that were added after the stripe was written have no skip nodes in
+ * it, so we leave such chunk groups to the reader, which fills in defaults.
+ */
+static bool
+ColumnarAggregateChunkGroupCallback(StripeMetadata *stripeMetadata,
+									StripeSkipList *stripeSkipList,
+									uint32 chunkGroupIndex, void *callbackArg)
+{
+	ColumnarAggregateScanState *aggregateScanState =
+		(ColumnarAggregateScanState *) callbackArg;
+
+	ColumnarVectorQual *rangeQual = NULL;
+	foreach_declared_ptr(rangeQual, aggregateScanState->rangeQualList)
+	{
+		if (rangeQual->columnIndex >= (int) stripeMetadata->columnCount)
+		{
+			return false;
+		}
+
+		ColumnChunkSkipNode *chunkSkipNode =
+			&stripeSkipList->chunkSkipNodeArray[rangeQual->columnIndex][chunkGroupIndex];
+		if (!chunkSkipNode->hasMinMax ||
+			!ColumnarVectorQualImpliedByRange(rangeQual, chunkSkipNode->minimumValue,
+											  chunkSkipNode->maximumValue))
+		{
+			return false;
+		}
+	}
+
+	ColumnarVectorAggregate *aggregate = NULL;
+	foreach_declared_ptr(aggregate, aggregateScanState->aggregateList)
+	{
+		if (aggregate->columnIndex >= (int) stripeMetadata->columnCount)
+		{
+			return false;
+		}
+	}
+
+	uint32 chunkGroupRowCount = stripeSkipList->chunkGroupRowCounts[chunkGroupIndex];
+
+	foreach_declared_ptr(aggregate, aggregateScanState->aggregateList)
+	{
+		ColumnChunkSkipNode *chunkSkipNode = NULL;
+		if (aggregate->columnIndex >= 0)
+		{
+			chunkSkipNode =
+				&stripeSkipList->chunkSkipNodeArray[aggregate->columnIndex][chunkGroupIndex];
+		}
+
+		ColumnarVectorAggregateSkipNode(aggregate, chunkSkipNode, chunkGroupRowCount);
+	}
+
+	aggregateScanState->chunkGroupsFromSkipNodes++;
+
+	return true;
+}
+
+
+/*
+ * ColumnarAggregateScanRecheck is never called, since the scan doesn't
+ * return table rows.
+ */
+static bool
+ColumnarAggregateScanRecheck(ColumnarAggregateScanState *aggregateScanState,
+							 TupleTableSlot *slot)
+{
+	return true;
+}
+
+
+static void
+ColumnarAggregateScan_EndCustomScan(CustomScanState *node)
+{
+	ColumnarAggregateScanState *aggregateScanState = (ColumnarAggregateScanState *) node;
+	TableScanDesc scanDesc = node->ss.ss_currentScanDesc;
+
+	if (node->ss.ps.ps_ResultTupleSlot)
+	{
+		ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	}
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	ExecClearTuple(aggregateScanState->rowSlot);
+
+	if (scanDesc != NULL)
+	{
+		table_endscan(scanDesc);
+	}
+}
+
+
+static void
+ColumnarAggregateScan_ReScanCustomScan(CustomScanState *node)
+{
+	ColumnarAggregateScanState *aggregateScanState = (ColumnarAggregateScanState *) node;
+
+	/* the quals don't depend on outer params, so we only need to start over */
+	ColumnarVectorAggregate *aggregate = NULL;
+	foreach_declared_ptr(aggregate, aggregateScanState->aggregateList)
+	{
+		ColumnarVectorAggregateReset(aggregate);
+	}
+
+	if (node->ss.ss_currentScanDesc != NULL)
+	{
+		table_endscan(node->ss.ss_currentScanDesc);
+		node->ss.ss_currentScanDesc = NULL;
+	}
+
+	aggregateScanState->chunkGroupsFromSkipNodes = 0;
+	aggregateScanState->finished = false;
+}
+
+
+static void
+ColumnarAggregateScan_ExplainCustomScan(CustomScanState *node, List *ancestors,
+										ExplainState *es)
+{
+	ColumnarAggregateScanState *aggregateScanState = (ColumnarAggregateScanState *) node;
+	ColumnarScanDesc columnarScanDesc = (ColumnarScanDesc) node->ss.ss_currentScanDesc;
+
+	ExplainPropertyInteger("Columnar Aggregates", NULL,
+						   list_length(aggregateScanState->aggregateList), es);
+
+	if (columnarScanDesc != NULL)
+	{
+		if (aggregateScanState->qual != NIL)
+		{
+			ExplainPropertyInteger(
+				"Columnar Chunk Groups Removed by Filter",
+				NULL, ColumnarScanChunkGroupsFiltered(columnarScanDesc), es);
+		}
+
+		ExplainPropertyInteger("Columnar Chunk Groups Aggregated from Metadata", NULL,
+							   aggregateScanState->chunkGroupsFromSkipNodes, es);
+	}
+}
@@ -0,0 +1,1077 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_encoding.c
+ *
+ * This file contains the lightweight encodings that columnar applies to the
+ * serialized values of a chunk before compressing them. The encoding of each
+ * chunk is chosen automatically at write time, based on which one results in
+ * the smallest buffer:
+ *
+ *  - run-length encoding, for columns with long runs of the same value,
+ *  - delta encoding, for sorted integer and timestamp columns,
+ *  - frame-of-reference encoding, for integer and timestamp columns whose
+ *    values are in a narrow range,
+ *  - dictionary encoding, for variable length columns with few distinct
+ *    values.
+ *
+ * Integer values produced by delta and frame-of-reference encodings are
+ * bit-packed using the minimum number of bits required for the chunk.
+ *
+ * Decoding always produces the same serialized value buffer that the writer
+ * would produce without an encoding, so the rest of the reader doesn't need
+ * to know about encodings.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "safe_lib.h"
+
+#include "access/tupmacs.h"
+#include "catalog/pg_type.h"
+#include "common/hashfn.h"
+#include "port/pg_bitutils.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
+
+#include "columnar/columnar_encoding.h"
+
+/* dictionary indexes are stored as uint16, so this is the maximum entry count */
+#define DICTIONARY_MAX_ENTRY_COUNT (PG_UINT16_MAX + 1)
+
+/*
+ * ColumnarEncodingHeader is stored at the start of all encoded buffers.
+ */
+typedef struct ColumnarEncodingHeader
+{
+	/* length of the serialized value buffer before encoding */
+	uint32 decodedLength;
+	uint32 valueCount;
+} ColumnarEncodingHeader;
+
+/*
+ * IntegerEncodingHeader follows ColumnarEncodingHeader in delta and
+ * frame-of-reference encoded buffers. For delta encoding, baseValue is the
+ * first value and the bit-packed values are zigzag encoded differences
+ * between consecutive values. For frame-of-reference encoding, baseValue is
+ * the minimum value and bit-packed values are the offsets from it.
+ */
+typedef struct IntegerEncodingHeader
+{
+	int64 baseValue;
+	uint32 bitWidth;
+} IntegerEncodingHeader;
+
+/*
+ * DictionaryEncodingHeader follows ColumnarEncodingHeader in dictionary
+ * encoded buffers. It is followed by entryCount dictionary entries, each
+ * stored as a uint32 length followed by the serialized value, and then by
+ * the uint16 dictionary index of each value.
+ */
+typedef struct DictionaryEncodingHeader
+{
+	uint32 entryCount;
+} DictionaryEncodingHeader;
+
+/*
+ * SerializedValues describes where each value resides in a serialized value
+ * buffer. Lengths include the alignment padding.
+ */
+typedef struct SerializedValues
+{
+	const char *data;
+	uint32 valueCount;
+	uint32 *offsets;
+	uint32 *lengths;
+} SerializedValues;
+
+/* key and entry of the hash table used for building a dictionary */
+typedef struct DictionaryKey
+{
+	const char *data;
+	uint32 length;
+} DictionaryKey;
+
+typedef struct DictionaryEntry
+{
+	DictionaryKey key;
+	uint32 index;
+} DictionaryEntry;
+
+/*
+ * Dictionary represents the dictionary of a chunk: the value index of the
+ * first occurrence of each distinct value, and the dictionary index of each
+ * value.
+ */
+typedef struct Dictionary
+{
+	uint32 entryCount;
+	uint32 *entryValueIndexes;
+	uint16 *valueEntryIndexes;
+} Dictionary;
+
+
+static bool ParseSerializedValues(StringInfo inputBuffer, uint32 valueCount,
+								  Form_pg_attribute attributeForm,
+								  SerializedValues *values);
+static bool IntegerEncodingSupported(Form_pg_attribute attributeForm);
+static int64 * ReadIntegerValues(SerializedValues *values,
+								 Form_pg_attribute attributeForm);
+static uint64 RunLengthEncodedSize(SerializedValues *values);
+static uint64 DeltaEncodedSize(int64 *integerValues, uint32 valueCount,
+							   int *bitWidth);
+static uint64 FrameOfReferenceEncodedSize(int64 *integerValues, uint32 valueCount,
+										  int64 *minimumValue, int *bitWidth);
+static Dictionary * BuildDictionary(SerializedValues *values);
+static uint64 DictionaryEncodedSize(SerializedValues *values, Dictionary *dictionary);
+static bool ValuesEqual(SerializedValues *values, uint32 leftIndex, uint32 rightIndex);
+static void RunLengthEncode(SerializedValues *values, StringInfo outputBuffer);
+static void DeltaEncode(int64 *integerValues, uint32 valueCount, int bitWidth,
+						StringInfo outputBuffer);
+static void FrameOfReferenceEncode(int64 *integerValues, uint32 valueCount,
+								   int64 minimumValue, int bitWidth,
+								   StringInfo outputBuffer);
+static void DictionaryEncode(SerializedValues *values, Dictionary *dictionary,
+							 StringInfo outputBuffer);
+static StringInfo RunLengthDecode(const char *input, uint32 inputLength,
+								  ColumnarEncodingHeader *header);
+static StringInfo IntegerDecode(const char *input, uint32 inputLength,
+								ColumnarEncodingHeader *header,
+								EncodingType encodingType,
+								Form_pg_attribute attributeForm);
+static StringInfo DictionaryDecode(const char *input, uint32 inputLength,
+								   ColumnarEncodingHeader *header);
+static uint32 DictionaryKeyHash(const void *key, Size keySize);
+static int DictionaryKeyCompare(const void *leftKey, const void *rightKey,
+								Size keySize);
+static int BitWidth(uint64 value);
+static uint64 BitPackedSize(uint32 valueCount, int bitWidth);
+static void BitPackValues(StringInfo outputBuffer, uint64 *packedValues,
+						  uint32 valueCount, int bitWidth);
+static void BitUnpackValues(const uint8 *input, uint64 *unpackedValues,
+							uint32 valueCount, int bitWidth);
+static void CheckEncodedDataLength(uint64 requiredLength, uint32 inputLength);
+
+
+/*
+ * EncodeValueBuffer chooses the encoding that results in the smallest buffer
+ * for the given serialized value buffer, which holds valueCount values of the
+ * given attribute. If such an encoding exists, the function writes the
+ * encoded buffer into outputBuffer and returns the chosen encoding. Otherwise,
+ * it returns ENCODING_NONE and outputBuffer should not be used.
+ */
+EncodingType
+EncodeValueBuffer(StringInfo inputBuffer, uint32 valueCount,
+				  Form_pg_attribute attributeForm, StringInfo outputBuffer)
+{
+	if (valueCount == 0)
+	{
+		return ENCODING_NONE;
+	}
+
+	MemoryContext encodingContext = AllocSetContextCreate(CurrentMemoryContext,
+														  "Columnar Encoding Context",
+														  ALLOCSET_DEFAULT_SIZES);
+	MemoryContext oldContext = MemoryContextSwitchTo(encodingContext);
+
+	EncodingType chosenEncodingType = ENCODING_NONE;
+	uint64 chosenEncodedSize = inputBuffer->len;
+
+	SerializedValues values = { 0 };
+	if (!ParseSerializedValues(inputBuffer, valueCount, attributeForm, &values))
+	{
+		MemoryContextSwitchTo(oldContext);
+		MemoryContextDelete(encodingContext);
+		return ENCODING_NONE;
+	}
+
+	int64 *integerValues = NULL;
+	int deltaBitWidth = 0;
+	int frameOfReferenceBitWidth = 0;
+	int64 minimumValue = 0;
+	if (IntegerEncodingSupported(attributeForm))
+	{
+		integerValues = ReadIntegerValues(&values, attributeForm);
+
+		uint64 deltaEncodedSize = DeltaEncodedSize(integerValues, valueCount,
+												   &deltaBitWidth);
+		if (deltaEncodedSize < chosenEncodedSize)
+		{
+			chosenEncodingType = ENCODING_DELTA;
+			chosenEncodedSize = deltaEncodedSize;
+		}
+
+		uint64 frameOfReferenceEncodedSize =
+			FrameOfReferenceEncodedSize(integerValues, valueCount, &minimumValue,
+										&frameOfReferenceBitWidth);
+		if (frameOfReferenceEncodedSize < chosenEncodedSize)
+		{
+			chosenEncodingType = ENCODING_FRAME_OF_REFERENCE;
+			chosenEncodedSize = frameOfReferenceEncodedSize;
+		}
+	}
+
+	uint64 runLengthEncodedSize = RunLengthEncodedSize(&values);
+	if (runLengthEncodedSize < chosenEncodedSize)
+	{
+		chosenEncodingType = ENCODING_RLE;
+		chosenEncodedSize = runLengthEncodedSize;
+	}
+
+	Dictionary *dictionary = NULL;
+	if (attributeForm->attlen == -1)
+	{
+		dictionary = BuildDictionary(&values);
+		if (dictionary != NULL)
+		{
+			uint64 dictionaryEncodedSize = DictionaryEncodedSize(&values, dictionary);
+			if (dictionaryEncodedSize < chosenEncodedSize)
+			{
+				chosenEncodingType = ENCODING_DICTIONARY;
+				chosenEncodedSize = dictionaryEncodedSize;
+			}
+		}
+	}
+
+	if (chosenEncodingType != ENCODING_NONE)
+	{
+		ColumnarEncodingHeader header = {
+			.decodedLength = inputBuffer->len,
+			.valueCount = valueCount
+		};
+
+		resetStringInfo(outputBuffer);
+		appendBinaryStringInfo(outputBuffer, (char *) &header, sizeof(header));
+
+		switch (chosenEncodingType)
+		{
+			case ENCODING_RLE:
+			{
+				RunLengthEncode(&values, outputBuffer);
+				break;
+			}
+
+			case ENCODING_DELTA:
+			{
+				DeltaEncode(integerValues, valueCount, deltaBitWidth, outputBuffer);
+				break;
+			}
+
+			case ENCODING_FRAME_OF_REFERENCE:
+			{
+				FrameOfReferenceEncode(integerValues, valueCount, minimumValue,
+									   frameOfReferenceBitWidth, outputBuffer);
+				break;
+			}
+
+			case ENCODING_DICTIONARY:
+			{
+				DictionaryEncode(&values, dictionary, outputBuffer);
+				break;
+			}
+
+			default:
+			{
+				ereport(ERROR, (errmsg("unexpected encoding type: %d",
+									   chosenEncodingType)));
+			}
+		}
+
+		Assert(outputBuffer->len == chosenEncodedSize);
+	}
+
+	MemoryContextSwitchTo(oldContext);
+	MemoryContextDelete(encodingContext);
+
+	return chosenEncodingType;
+}
+
+
+/*
+ * DecodeValueBuffer decodes the given buffer with the given encoding type and
+ * returns the serialized value buffer. This function returns the buffer as-is
+ * when no encoding is applied.
+ */
+StringInfo
+DecodeValueBuffer(StringInfo buffer, EncodingType encodingType,
+				  Form_pg_attribute attributeForm)
+{
+	if (encodingType == ENCODING_NONE)
+	{
+		return buffer;
+	}
+
+	ColumnarEncodingHeader header = { 0 };
+	CheckEncodedDataLength(sizeof(header), buffer->len);
+	memcpy_s(&header, sizeof(header), buffer->data, sizeof(header));
+
+	const char *input = buffer->data + sizeof(header);
+	uint32 inputLength = buffer->len - sizeof(header);
+
+	StringInfo decodedBuffer = NULL;
+
+	switch (encodingType)
+	{
+		case ENCODING_RLE:
+		{
+			decodedBuffer = RunLengthDecode(input, inputLength, &header);
+			break;
+		}
+
+		case ENCODING_DELTA:
+		case ENCODING_FRAME_OF_REFERENCE:
+		{
+			decodedBuffer = IntegerDecode(input, inputLength, &header, encodingType,
+										  attributeForm);
+			break;
+		}
+
+		case ENCODING_DICTIONARY:
+		{
+			decodedBuffer = DictionaryDecode(input, inputLength, &header);
+			break;
+		}
+
+		default:
+		{
+			ereport(ERROR, (errmsg("unexpected encoding type: %d", encodingType)));
+		}
+	}
+
+	if (decodedBuffer->len != header.decodedLength)
+	{
+		ereport(ERROR, (errmsg("cannot decode the buffer"),
+						errdetail("Expected %u bytes, but received %d bytes",
+								  header.decodedLength, decodedBuffer->len)));
+	}
+
+	return decodedBuffer;
+}
+
+
+/*
+ * ParseSerializedValues fills in the offsets and lengths of the values in the
+ * given serialized value buffer. Returns false if the buffer doesn't contain
+ * exactly valueCount values.
+ */
+static bool
+ParseSerializedValues(StringInfo inputBuffer, uint32 valueCount,
+					  Form_pg_attribute attributeForm, SerializedValues *values)
+{
+	uint32 currentOffset = 0;
+
+	values->data = inputBuffer->data;
+	values->valueCount = valueCount;
+	values->offsets = palloc(valueCount * sizeof(uint32));
+	values->lengths = palloc(valueCount * sizeof(uint32));
+
+	for (uint32 valueIndex = 0; valueIndex < valueCount; valueIndex++)
+	{
+		if (currentOffset >= inputBuffer->len)
+		{
+			return false;
+		}
+
+		const char *valuePointer = inputBuffer->data + currentOffset;
+		uint32 valueLength = att_addlength_pointer(0, attributeForm->attlen,
+												   valuePointer);
+		valueLength = att_align_nominal(valueLength, attributeForm->attalign);
+
+		values->offsets[valueIndex] = currentOffset;
+		values->lengths[valueIndex] = valueLength;
+		currentOffset += valueLength;
+	}
+
+	return currentOffset == inputBuffer->len;
+}
+
+
+/*
+ * IntegerEncodingSupported returns true if delta and frame-of-reference
+ * encodings can be used for the given attribute.
+ */
+static bool
+IntegerEncodingSupported(Form_pg_attribute attributeForm)
+{
+	if (!attributeForm->attbyval)
+	{
+		return false;
+	}
+
+	switch (attributeForm->atttypid)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		{
+			return true;
+		}
+
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+
+/*
+ * ReadIntegerValues returns the values of an integer-like attribute as an
+ * array of int64.
+ */
+static int64 *
+ReadIntegerValues(SerializedValues *values, Form_pg_attribute attributeForm)
+{
+	int64 *integerValues = palloc(values->valueCount * sizeof(int64));
+
+	for (uint32 valueIndex = 0; valueIndex < values->valueCount; valueIndex++)
+	{
+		const char *valuePointer = values->data + values->offsets[valueIndex];
+		Datum value = fetch_att(valuePointer, true, attributeForm->attlen);
+
+		switch (attributeForm->attlen)
+		{
+			case sizeof(int16):
+			{
+				integerValues[valueIndex] = DatumGetInt16(value);
+				break;
+			}
+
+			case sizeof(int32):
+			{
+				integerValues[valueIndex] = DatumGetInt32(value);
+				break;
+			}
+
+			default:
+			{
+				integerValues[valueIndex] = DatumGetInt64(value);
+				break;
+			}
+		}
+	}
+
+	return integerValues;
+}
+
+
+/*
+ * RunLengthEncodedSize returns the size of the run-length encoded buffer for
+ * the given values.
+ */
+static uint64
+RunLengthEncodedSize(SerializedValues *values)
+{
+	uint64 encodedSize = sizeof(ColumnarEncodingHeader);
+
+	for (uint32 valueIndex = 0; valueIndex < values->valueCount; valueIndex++)
+	{
+		if (valueIndex == 0 || !ValuesEqual(values, valueIndex - 1, valueIndex))
+		{
+			encodedSize += 2 * sizeof(uint32) + values->lengths[valueIndex];
+		}
+	}
+
+	return encodedSize;
+}
+
+
+/*
+ * DeltaEncodedSize returns the size of the delta encoded buffer for the given
+ * integer values, and sets bitWidth to the number of bits needed per delta.
+ */
+static uint64
+DeltaEncodedSize(int64 *integerValues, uint32 valueCount, int *bitWidth)
+{
+	uint64 packedValueUnion = 0;
+
+	for (uint32 valueIndex = 1; valueIndex < valueCount; valueIndex++)
+	{
+		int64 delta = (int64) ((uint64) integerValues[valueIndex] -
+							   (uint64) integerValues[valueIndex - 1]);
+		uint64 zigzagDelta = ((uint64) delta << 1) ^ (uint64) (delta >> 63);
+
+		packedValueUnion |= zigzagDelta;
+	}
+
+	*bitWidth = BitWidth(packedValueUnion);
+
+	return sizeof(ColumnarEncodingHeader) + sizeof(IntegerEncodingHeader) +
+		   BitPackedSize(valueCount - 1, *bitWidth);
+}
+
+
+/*
+ * FrameOfReferenceEncodedSize returns the size of the frame-of-reference
+ * encoded buffer for the given integer values, and sets minimumValue and
+ * bitWidth to the frame of reference and the number of bits needed per value.
+ */
+static uint64
+FrameOfReferenceEncodedSize(int64 *integerValues, uint32 valueCount,
+							int64 *minimumValue, int *bitWidth)
+{
+	int64 minimum = integerValues[0];
+	int64 maximum = integerValues[0];
+
+	for (uint32 valueIndex = 1; valueIndex < valueCount; valueIndex++)
+	{
+		minimum = Min(minimum, integerValues[valueIndex]);
+		maximum = Max(maximum, integerValues[valueIndex]);
+	}
+
+	*minimumValue = minimum;
+	*bitWidth = BitWidth((uint64) maximum - (uint64) minimum);
+
+	return sizeof(ColumnarEncodingHeader) + sizeof(IntegerEncodingHeader) +
+		   BitPackedSize(valueCount, *bitWidth);
+}
+
+
+/*
+ * BuildDictionary builds a dictionary of the distinct values, or returns NULL
+ * if there are too many distinct values for dictionary encoding.
+ */
+static Dictionary *
+BuildDictionary(SerializedValues *values)
+{
+	HASHCTL info;
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(DictionaryKey);
+	info.entrysize = sizeof(DictionaryEntry);
+	info.hash = DictionaryKeyHash;
+	info.match = DictionaryKeyCompare;
+	info.hcxt = CurrentMemoryContext;
+	int hashFlags = HASH_ELEM | HASH_FUNCTION | HASH_COMPARE | HASH_CONTEXT;
+
+	HTAB *dictionaryHash = hash_create("Columnar Dictionary Hash", 1024, &info,
+									   hashFlags);
+
+	Dictionary *dictionary = palloc0(sizeof(Dictionary));
+	dictionary->entryValueIndexes = palloc(Min(values->valueCount,
+											   DICTIONARY_MAX_ENTRY_COUNT) *
+										   sizeof(uint32));
+	dictionary->valueEntryIndexes = palloc(values->valueCount * sizeof(uint16));
+
+	for (uint32 valueIndex = 0; valueIndex < values->valueCount; valueIndex++)
+	{
+		DictionaryKey key = {
+			.data = values->data + values->offsets[valueIndex],
+			.length = values->lengths[valueIndex]
+		};
+
+		bool found = false;
+		DictionaryEntry *entry = hash_search(dictionaryHash, &key, HASH_ENTER, &found);
+		if (!found)
+		{
+			if (dictionary->entryCount == DICTIONARY_MAX_ENTRY_COUNT)
+			{
+				return NULL;
+			}
+
+			entry->index = dictionary->entryCount;
+			dictionary->entryValueIndexes[dictionary->entryCount] = valueIndex;
+			dictionary->entryCount++;
+		}
+
+		dictionary->valueEntryIndexes[valueIndex] = entry->index;
+	}
+
+	return dictionary;
+}
+
+
+/*
+ * DictionaryEncodedSize returns the size of the dictionary encoded buffer for
+ * the given values and dictionary.
+ */
+static uint64
+DictionaryEncodedSize(SerializedValues *values, Dictionary *dictionary)
+{
+	uint64 encodedSize = sizeof(ColumnarEncodingHeader) +
+						 sizeof(DictionaryEncodingHeader) +
+						 (uint64) values->valueCount * sizeof(uint16);
+
+	for (uint32 entryIndex = 0; entryIndex < dictionary->entryCount; entryIndex++)
+	{
+		uint32 valueIndex = dictionary->entryValueIndexes[entryIndex];
+		encodedSize += sizeof(uint32) + values->lengths[valueIndex];
+	}
+
+	return encodedSize;
+}
+
+
+/*
+ * ValuesEqual returns true if the serialized values at the given indexes are
+ * byte-wise equal.
+ */
+static bool
+ValuesEqual(SerializedValues *values, uint32 leftIndex, uint32 rightIndex)
+{
+	return values->lengths[leftIndex] == values->lengths[rightIndex] &&
+		   memcmp(values->data + values->offsets[leftIndex],
+				  values->data + values->offsets[rightIndex],
+				  values->lengths[leftIndex]) == 0;
+}
+
+
+/*
+ * RunLengthEncode appends the runs of the given values to outputBuffer. Each
+ * run is stored as its length, followed by the length of the serialized value
+ * and the serialized value itself.
+ */
+static void
+RunLengthEncode(SerializedValues *values, StringInfo outputBuffer)
+{
+	uint32 runStartIndex = 0;
+
+	for (uint32 valueIndex = 1; valueIndex <= values->valueCount; valueIndex++)
+	{
+		if (valueIndex < values->valueCount &&
+			ValuesEqual(values, runStartIndex, valueIndex))
+		{
+			continue;
+		}
+
+		uint32 runLength = valueIndex - runStartIndex;
+		uint32 valueLength = values->lengths[runStartIndex];
+
+		appendBinaryStringInfo(outputBuffer, (char *) &runLength, sizeof(uint32));
+		appendBinaryStringInfo(outputBuffer, (char *) &valueLength, sizeof(uint32));
+		appendBinaryStringInfo(outputBuffer,
+							   values->data + values->offsets[runStartIndex],
+							   valueLength);
+
+		runStartIndex = valueIndex;
+	}
+}
+
+
+/*
+ * DeltaEncode appends the first value and the bit-packed zigzag encoded
+ * differences between consecutive values to outputBuffer.
+ */
+static void
+DeltaEncode(int64 *integerValues, uint32 valueCount, int bitWidth,
+			StringInfo outputBuffer)
+{
+	IntegerEncodingHeader header = { 0 };
+	header.baseValue = integerValues[0];
+	header.bitWidth = bitWidth;
+	appendBinaryStringInfo(outputBuffer, (char *) &header, sizeof(header));
+
+	uint64 *packedValues = palloc(valueCount * sizeof(uint64));
+	for (uint32 valueIndex = 1; valueIndex < valueCount; valueIndex++)
+	{
+		int64 delta = (int64) ((uint64) integerValues[valueIndex] -
+							   (uint64) integerValues[valueIndex - 1]);
+		packedValues[valueIndex - 1] = ((uint64) delta << 1) ^ (uint64) (delta >> 63);
+	}
+
+	BitPackValues(outputBuffer, packedValues, valueCount - 1, bitWidth);
+}
+
+
+/*
+ * FrameOfReferenceEncode appends the minimum value and the bit-packed offsets
+ * of each value from the minimum to outputBuffer.
+ */
+static void
+FrameOfReferenceEncode(int64 *integerValues, uint32 valueCount, int64 minimumValue,
+					   int bitWidth, StringInfo outputBuffer)
+{
+	IntegerEncodingHeader header = { 0 };
+	header.baseValue = minimumValue;
+	header.bitWidth = bitWidth;
+	appendBinaryStringInfo(outputBuffer, (char *) &header, sizeof(header));
+
+	uint64 *packedValues = palloc(valueCount * sizeof(uint64));
+	for (uint32 valueIndex = 0; valueIndex < valueCount; valueIndex++)
+	{
+		packedValues[valueIndex] = (uint64) integerValues[valueIndex] -
+								   (uint64) minimumValue;
+	}
+
+	BitPackValues(outputBuffer, packedValues, valueCount, bitWidth);
+}
+
+
+/*
+ * DictionaryEncode appends the dictionary entries followed by the dictionary
+ * index of each value to outputBuffer.
+ */
+static void
+DictionaryEncode(SerializedValues *values, Dictionary *dictionary,
+				 StringInfo outputBuffer)
+{
+	DictionaryEncodingHeader header = { 0 };
+	header.entryCount = dictionary->entryCount;
+	appendBinaryStringInfo(outputBuffer, (char *) &header, sizeof(header));
+
+	for (uint32 entryIndex = 0; entryIndex < dictionary->entryCount; entryIndex++)
+	{
+		uint32 valueIndex = dictionary->entryValueIndexes[entryIndex];
+		uint32 valueLength = values->lengths[valueIndex];
+
+		appendBinaryStringInfo(outputBuffer, (char *) &valueLength, sizeof(uint32));
+		appendBinaryStringInfo(outputBuffer, values->data + values->offsets[valueIndex],
+							   valueLength);
+	}
+
+	appendBinaryStringInfo(outputBuffer, (char *) dictionary->valueEntryIndexes,
+						   values->valueCount * sizeof(uint16));
+}
+
+
+/*
+ * RunLengthDecode decodes a run-length encoded buffer.
+ */
+static StringInfo
+RunLengthDecode(const char *input, uint32 inputLength, ColumnarEncodingHeader *header)
+{
+	StringInfo decodedBuffer = makeStringInfo();
+	enlargeStringInfo(decodedBuffer, header->decodedLength);
+
+	uint32 inputOffset = 0;
+	uint32 decodedValueCount = 0;
+
+	while (decodedValueCount < header->valueCount)
+	{
+		uint32 runLength = 0;
+		uint32 valueLength = 0;
+
+		CheckEncodedDataLength((uint64) inputOffset + 2 * sizeof(uint32), inputLength);
+		memcpy_s(&runLength, sizeof(uint32), input + inputOffset, sizeof(uint32));
+		memcpy_s(&valueLength, sizeof(uint32), input + inputOffset + sizeof(uint32),
+				 sizeof(uint32));
+		inputOffset += 2 * sizeof(uint32);
+
+		CheckEncodedDataLength((uint64) inputOffset + valueLength, inputLength);
+		if (runLength == 0 ||
+			(uint64) runLength * valueLength > header->decodedLength - decodedBuffer->len)
+		{
+			ereport(ERROR, (errmsg("cannot decode the buffer"),
+							errdetail("encoded data is corrupted")));
+		}
+
+		for (uint32 runIndex = 0; runIndex < runLength; runIndex++)
+		{
+			appendBinaryStringInfo(decodedBuffer, input + inputOffset, valueLength);
+		}
+
+		inputOffset += valueLength;
+		decodedValueCount += runLength;
+	}
+
+	return decodedBuffer;
+}
+
+
+/*
+ * IntegerDecode decodes a delta or frame-of-reference encoded buffer.
+ */
+static StringInfo
+IntegerDecode(const char *input, uint32 inputLength, ColumnarEncodingHeader *header,
+			  EncodingType encodingType, Form_pg_attribute attributeForm)
+{
+	uint32 valueCount = header->valueCount;
+	int typeLength = attributeForm->attlen;
+	uint32 valueStride = att_align_nominal(typeLength, attributeForm->attalign);
+
+	if (!IntegerEncodingSupported(attributeForm) || valueCount == 0 ||
+		(uint64) valueCount * valueStride != header->decodedLength)
+	{
+		ereport(ERROR, (errmsg("cannot decode the buffer"),
+						errdetail("encoded data is corrupted")));
+	}
+
+	IntegerEncodingHeader integerHeader = { 0 };
+	CheckEncodedDataLength(sizeof(integerHeader), inputLength);
+	memcpy_s(&integerHeader, sizeof(integerHeader), input, sizeof(integerHeader));
+
+	int bitWidth = integerHeader.bitWidth;
+	uint32 packedValueCount = encodingType == ENCODING_DELTA ? valueCount - 1 :
+							  valueCount;
+	if (bitWidth > 64)
+	{
+		ereport(ERROR, (errmsg("cannot decode the buffer"),
+						errdetail("encoded data is corrupted")));
+	}
+
+	CheckEncodedDataLength(sizeof(integerHeader) +
+						   BitPackedSize(packedValueCount, bitWidth), inputLength);
+
+	uint64 *packedValues = palloc(valueCount * sizeof(uint64));
+	BitUnpackValues((const uint8 *) input + sizeof(integerHeader), packedValues,
+					packedValueCount, bitWidth);
+
+	StringInfo decodedBuffer = makeStringInfo();
+	enlargeStringInfo(decodedBuffer, header->decodedLength);
+	memset(decodedBuffer->data, 0, header->decodedLength);
+
+	uint64 currentValue = (uint64) integerHeader.baseValue;
+	for (uint32 valueIndex = 0; valueIndex < valueCount; valueIndex++)
+	{
+		if (encodingType == ENCODING_DELTA)
+		{
+			if (valueIndex > 0)
+			{
+				uint64 zigzagDelta = packedValues[valueIndex - 1];
+				currentValue += (zigzagDelta >> 1) ^ (~(zigzagDelta & 1) + 1);
+			}
+		}
+		else
+		{
+			currentValue = (uint64) integerHeader.baseValue + packedValues[valueIndex];
+		}
+
+		char *valuePointer = decodedBuffer->data + valueIndex * valueStride;
+		switch (typeLength)
+		{
+			case sizeof(int16):
+			{
+				store_att_byval(valuePointer, Int16GetDatum((int16) currentValue),
+								typeLength);
+				break;
+			}
+
+			case sizeof(int32):
+			{
+				store_att_byval(valuePointer, Int32GetDatum((int32) currentValue),
+								typeLength);
+				break;
+			}
+
+			default:
+			{
+				store_att_byval(valuePointer, Int64GetDatum((int64) currentValue),
+								typeLength);
+				break;
+			}
+		}
+	}
+
+	decodedBuffer->len = header->decodedLength;
+	pfree(packedValues);
+
+	return decodedBuffer;
+}
+
+
+/*
+ * DictionaryDecode decodes a dictionary encoded buffer.
+ */
+static StringInfo
+DictionaryDecode(const char *input, uint32 inputLength, ColumnarEncodingHeader *header)
+{
+	DictionaryEncodingHeader dictionaryHeader = { 0 };
+	CheckEncodedDataLength(sizeof(dictionaryHeader), inputLength);
+	memcpy_s(&dictionaryHeader, sizeof(dictionaryHeader), input,
+			 sizeof(dictionaryHeader));
+
+	uint32 entryCount = dictionaryHeader.entryCount;
+	if (entryCount == 0 || entryCount > DICTIONARY_MAX_ENTRY_COUNT)
+	{
+		ereport(ERROR, (errmsg("cannot decode the buffer"),
+						errdetail("encoded data is corrupted")));
+	}
+
+	const char **entryPointers = palloc(entryCount * sizeof(char *));
+	uint32 *entryLengths = palloc(entryCount * sizeof(uint32));
+	uint32 inputOffset = sizeof(dictionaryHeader);
+
+	for (uint32 entryIndex = 0; entryIndex < entryCount; entryIndex++)
+	{
+		uint32 valueLength = 0;
+
+		CheckEncodedDataLength((uint64) inputOffset + sizeof(uint32), inputLength);
+		memcpy_s(&valueLength, sizeof(uint32), input + inputOffset, sizeof(uint32));
+		inputOffset += sizeof(uint32);
+
+		CheckEncodedDataLength((uint64) inputOffset + valueLength, inputLength);
+		entryPointers[entryIndex] = input + inputOffset;
+		entryLengths[entryIndex] = valueLength;
+		inputOffset += valueLength;
+	}
+
+	CheckEncodedDataLength((uint64) inputOffset + header->valueCount * sizeof(uint16),
+						   inputLength);
+
+	StringInfo decodedBuffer = makeStringInfo();
+	enlargeStringInfo(decodedBuffer, header->decodedLength);
+
+	for (uint32 valueIndex = 0; valueIndex < header->valueCount; valueIndex++)
+	{
+		uint16 entryIndex = 0;
+		memcpy_s(&entryIndex, sizeof(uint16),
+				 input + inputOffset + valueIndex * sizeof(uint16), sizeof(uint16));
+
+		if (entryIndex >= entryCount ||
+			entryLengths[entryIndex] > header->decodedLength - decodedBuffer->len)
+		{
+			ereport(ERROR, (errmsg("cannot decode the buffer"),
+							errdetail("encoded data is corrupted")));
+		}
+
+		appendBinaryStringInfo(decodedBuffer, entryPointers[entryIndex],
+							   entryLengths[entryIndex]);
+	}
+
+	pfree(entryPointers);
+	pfree(entryLengths);
+
+	return decodedBuffer;
+}
+
+
+/*
+ * DictionaryKeyHash is the hash function for dictionary keys.
+ */
+static uint32
+DictionaryKeyHash(const void *key, Size keySize)
+{
+	const DictionaryKey *dictionaryKey = (const DictionaryKey *) key;
+
+	return hash_bytes((const unsigned char *) dictionaryKey->data,
+					  dictionaryKey->length);
+}
+
+
+/*
+ * DictionaryKeyCompare is the comparison function for dictionary keys. It
+ * returns 0 if the keys are equal, like memcmp.
+ */
+static int
+DictionaryKeyCompare(const void *leftKey, const void *rightKey, Size keySize)
+{
+	const DictionaryKey *leftDictionaryKey = (const DictionaryKey *) leftKey;
+	const DictionaryKey *rightDictionaryKey = (const DictionaryKey *) rightKey;
+
+	if (leftDictionaryKey->length != rightDictionaryKey->length)
+	{
+		return 1;
+	}
+
+	return memcmp(leftDictionaryKey->data, rightDictionaryKey->data,
+				  leftDictionaryKey->length);
+}
+
+
+/*
+ * BitWidth returns the number of bits needed to represent the given value.
+ */
+static int
+BitWidth(uint64 value)
+{
+	if (value == 0)
+	{
+		return 0;
+	}
+
+	return pg_leftmost_one_pos64(value) + 1;
+}
+
+
+/*
+ * BitPackedSize returns the number of bytes needed to bit-pack valueCount
+ * values with the given bit width.
+ */
+static uint64
+BitPackedSize(uint32 valueCount, int bitWidth)
+{
+	return ((uint64) valueCount * bitWidth + 7) / 8;
+}
+
+
+/*
+ * BitPackValues appends the lowest bitWidth bits of each of the given values
+ * to outputBuffer, starting from the least significant bit of each byte.
+ */
+static void
+BitPackValues(StringInfo outputBuffer, uint64 *packedValues, uint32 valueCount,
+			  int bitWidth)
+{
+	uint64 byteCount = BitPackedSize(valueCount, bitWidth);
+
+	enlargeStringInfo(outputBuffer, byteCount);
+
+	uint8 *output = (uint8 *) outputBuffer->data + outputBuffer->len;
+	memset(output, 0, byteCount);
+
+	uint64 bitOffset = 0;
+	for (uint32 valueIndex = 0; valueIndex < valueCount; valueIndex++)
+	{
+		uint64 value = packedValues[valueIndex];
+		int valueBitIndex = 0;
+
+		while (valueBitIndex < bitWidth)
+		{
+			int shift = bitOffset % 8;
+			int bitCount = Min(8 - shift, bitWidth - valueBitIndex);
+			uint8 bits = (value >> valueBitIndex) & ((1 << bitCount) - 1);
+
+			output[bitOffset / 8] |= bits << shift;
+
+			valueBitIndex += bitCount;
+			bitOffset += bitCount;
+		}
+	}
+
+	outputBuffer->len += byteCount;
+	outputBuffer->data[outputBuffer->len] = '\0';
+}
+
+
+/*
+ * BitUnpackValues reads valueCount values of bitWidth bits each, packed by
+ * BitPackValues.
+ */
+static void
+BitUnpackValues(const uint8 *input, uint64 *unpackedValues, uint32 valueCount,
+				int bitWidth)
+{
+	uint64 bitOffset = 0;
+
+	for (uint32 valueIndex = 0; valueIndex < valueCount; valueIndex++)
+	{
+		uint64 value = 0;
+		int valueBitIndex = 0;
+
+		while (valueBitIndex < bitWidth)
+		{
+			int shift = bitOffset % 8;
+			int bitCount = Min(8 - shift, bitWidth - valueBitIndex);
+			uint64 bits = (input[bitOffset / 8] >> shift) & ((1 << bitCount) - 1);
+
+			value |= bits << valueBitIndex;
+
+			valueBitIndex += bitCount;
+			bitOffset += bitCount;
+		}
+
+		unpackedValues[valueIndex] = value;
+	}
+}
+
+
+/*
+ * CheckEncodedDataLength errors out if the encoded buffer is shorter than
+ * required to decode it.
+ */
+static void
+CheckEncodedDataLength(uint64 requiredLength, uint32 inputLength)
+{
+	if (requiredLength > inputLength)
+	{
+		ereport(ERROR, (errmsg("cannot decode the buffer"),
+						errdetail("Expected at least " UINT64_FORMAT
+								  " bytes, but received %u bytes",
+								  requiredLength, inputLength)));
+	}
+}
@@ -27,12 +27,16 @@
 #include "port.h"
 #include "safe_lib.h"
 
+#include "access/hash.h"
 #include "access/heapam.h"
 #include "access/htup_details.h"
 #include "access/nbtree.h"
+#include "access/transam.h"
 #include "access/xact.h"
+#include "access/xlog.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_type.h"
@@ -43,20 +47,26 @@
 #include "executor/spi.h"
 #include "lib/stringinfo.h"
 #include "nodes/execnodes.h"
+#include "parser/scansup.h"
 #include "storage/fd.h"
 #include "storage/lmgr.h"
 #include "storage/procarray.h"
 #include "storage/smgr.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/syscache.h"
+#include "utils/typcache.h"
+#include "utils/varlena.h"
 
 #include "citus_version.h"
 #include "pg_version_constants.h"
 
 #include "columnar/columnar.h"
+#include "columnar/columnar_metadata_cache.h"
 #include "columnar/columnar_storage.h"
 #include "columnar/columnar_version_compat.h"
 
@@ -98,7 +108,37 @@ typedef enum RowNumberLookupMode
 	FIND_GREATER
 } RowNumberLookupMode;
 
+/* StripeTupleState is the state of a columnar.stripe tuple for all snapshots */
+typedef enum StripeTupleState
+{
+	/* visible to snapshots that see the inserting transaction as committed */
+	STRIPE_TUPLE_LIVE,
+
+	/*
+	 * Invisible to snapshots that see the deleting transaction as committed,
+	 * or to all snapshots if the inserting transaction aborted.
+	 */
+	STRIPE_TUPLE_DEAD,
+
+	/* inserting or deleting transaction is still running */
+	STRIPE_TUPLE_IN_PROGRESS
+} StripeTupleState;
+
 static void ParseColumnarRelOptions(List *reloptions, ColumnarOptions *options);
+static List * ParseColumnListOption(char *columnListString, char *optionDescription);
+static ArrayType * BloomFilterColumnsToAttnumArray(Oid regclass, List *columnNameList);
+static ArrayType * SortKeyColumnsToAttnumArray(Oid regclass, List *columnNameList);
+static ArrayType * AttnumListToArray(List *attnumList);
+static List * AttnumArrayToColumnNames(Oid regclass, ArrayType *attnumArray);
+static List * ParseColumnCompressionOption(char *optionString);
+static void ParseColumnCompressionSetting(char *settingString,
+										  ColumnarColumnCompression *columnCompression);
+static char * ColumnCompressionSettingString(ColumnarColumnCompression *columnCompression);
+static void ColumnCompressionsToArrays(Oid regclass, List *columnCompressionList,
+									   ArrayType **attnumArray,
+									   ArrayType **settingArray);
+static List * ArraysToColumnCompressions(Oid regclass, ArrayType *attnumArray,
+										 ArrayType *settingArray);
 static void InsertEmptyStripeMetadataRow(uint64 storageId, uint64 stripeId,
 										 uint32 columnCount, uint32 chunkGroupRowCount,
 										 uint64 firstRowNumber);
@@ -122,9 +162,20 @@ static Oid ColumnarChunkRelationId(void);
 static Oid ColumnarChunkGroupRelationId(void);
 static Oid ColumnarChunkIndexRelationId(void);
 static Oid ColumnarChunkGroupIndexRelationId(void);
+static Oid ColumnarZstdDictionaryRelationId(void);
+static Oid ColumnarZstdDictionaryIndexRelationId(void);
+static Oid ColumnarZstdDictionaryStorageIdIndexRelationId(void);
+static Oid ColumnarZstdDictionaryIdSequenceRelationId(void);
 static Oid ColumnarNamespaceId(void);
 static uint64 LookupStorageId(RelFileLocator relfilelocator);
 static uint64 GetHighestUsedRowNumber(uint64 storageId);
+static void DeleteStripeFromColumnarMetadataTable(Oid metadataTableId,
+												  AttrNumber storageIdAttrNumber,
+												  AttrNumber stripeAttrNumber,
+												  Oid indexId, uint64 storageId,
+												  uint64 stripeId);
+static void DeleteColumnarMetadataTableRows(Oid metadataTableId, Oid indexId,
+											ScanKey scanKey, int scanKeyCount);
 static void DeleteStorageFromColumnarMetadataTable(Oid metadataTableId,
 												   AttrNumber storageIdAtrrNumber,
 												   Oid storageIdIndexId,
@@ -142,16 +193,34 @@ static StripeMetadata * StripeMetadataLookupRowNumber(Relation relation, uint64
 													  Snapshot snapshot,
 													  RowNumberLookupMode lookupMode);
 static void CheckStripeMetadataConsistency(StripeMetadata *stripeMetadata);
+static bool CachedStripeMetadataLookupRowNumber(Relation relation, uint64 storageId,
+												uint64 rowNumber, Snapshot snapshot,
+												RowNumberLookupMode lookupMode,
+												StripeMetadata **stripeMetadata);
+static ColumnarCachedStripeList * GetCachedStripeList(Relation relation,
+													  uint64 storageId,
+													  Snapshot snapshot);
+static bool StripeListMayBeUnblocked(ColumnarCachedStripeList *stripeList,
+									 Snapshot snapshot);
+static ColumnarCachedStripeList * BuildCachedStripeList(Relation relation,
+														uint64 storageId,
+														Snapshot snapshot);
+static StripeTupleState GetStripeTupleState(HeapTupleHeader tuple,
+											TransactionId *xid);
 
 PG_FUNCTION_INFO_V1(columnar_relation_storageid);
 
 /* constants for columnar.options */
-#define Natts_columnar_options 5
+#define Natts_columnar_options 9
 #define Anum_columnar_options_regclass 1
 #define Anum_columnar_options_chunk_group_row_limit 2
 #define Anum_columnar_options_stripe_row_limit 3
 #define Anum_columnar_options_compression_level 4
 #define Anum_columnar_options_compression 5
+#define Anum_columnar_options_bloom_filter_columns 6
+#define Anum_columnar_options_sort_key 7
+#define Anum_columnar_options_column_compression_columns 8
+#define Anum_columnar_options_column_compression 9
 
 /* ----------------
  *		columnar.options definition.
@@ -191,7 +260,7 @@ typedef FormData_columnar_options *Form_columnar_options;
 #define Anum_columnar_chunkgroup_row_count 4
 
 /* constants for columnar.chunk */
-#define Natts_columnar_chunk 14
+#define Natts_columnar_chunk 16
 #define Anum_columnar_chunk_storageid 1
 #define Anum_columnar_chunk_stripe 2
 #define Anum_columnar_chunk_attr 3
@@ -206,6 +275,14 @@ typedef FormData_columnar_options *Form_columnar_options;
 #define Anum_columnar_chunk_value_compression_level 12
 #define Anum_columnar_chunk_value_decompressed_size 13
 #define Anum_columnar_chunk_value_count 14
+#define Anum_columnar_chunk_value_encoding_type 15
+#define Anum_columnar_chunk_value_bloom_filter 16
+
+/* constants for columnar.zstd_dictionary */
+#define Natts_columnar_zstd_dictionary 3
+#define Anum_columnar_zstd_dictionary_storageid 1
+#define Anum_columnar_zstd_dictionary_dictionary_id 2
+#define Anum_columnar_zstd_dictionary_dictionary 3
 
 
 /*
@@ -296,6 +373,27 @@ ParseColumnarRelOptions(List *reloptions, ColumnarOptions *options)
 									   quote_identifier(defGetString(elem)))));
 			}
 		}
+		else if (strcmp(elem->defname, "bloom_filter_columns") == 0)
+		{
+			options->bloomFilterColumns = (elem->arg == NULL) ?
+										  NIL :
+										  ParseColumnListOption(defGetString(elem),
+																"bloom filter columns");
+		}
+		else if (strcmp(elem->defname, "sort_key") == 0)
+		{
+			options->sortKeyColumns = (elem->arg == NULL) ?
+									  NIL :
+									  ParseColumnListOption(defGetString(elem),
+															"sort key");
+		}
+		else if (strcmp(elem->defname, "column_compression") == 0)
+		{
+			options->columnCompressions = (elem->arg == NULL) ?
+										  NIL :
+										  ParseColumnCompressionOption(
+				defGetString(elem));
+		}
 		else if (strcmp(elem->defname, "compression_level") == 0)
 		{
 			options->compressionLevel = (elem->arg == NULL) ?
@@ -319,6 +417,251 @@ ParseColumnarRelOptions(List *reloptions, ColumnarOptions *options)
 }
 
 
+/*
+ * ParseColumnListOption parses the comma-separated list of column names given
+ * to columnar.bloom_filter_columns or columnar.sort_key. Whether the columns
+ * exist is only checked when the options are written, since we don't know the
+ * relation here.
+ */
+static List *
+ParseColumnListOption(char *columnListString, char *optionDescription)
+{
+	List *columnNameList = NIL;
+
+	/* SplitIdentifierString modifies the string, so make a copy */
+	char *rawString = pstrdup(columnListString);
+	if (!SplitIdentifierString(rawString, ',', &columnNameList))
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						errmsg("invalid list syntax for columnar %s: %s",
+							   optionDescription,
+							   quote_literal_cstr(columnListString))));
+	}
+
+	return columnNameList;
+}
+
+
+/*
+ * ParseColumnCompressionOption parses the comma-separated list of
+ * column:compression entries given to columnar.column_compression, e.g.
+ * 'payload:zstd:19, metrics:none, notes:auto'. Column names may be
+ * double-quoted. Whether the columns exist is only checked when the options
+ * are written, since we don't know the relation here.
+ */
+static List *
+ParseColumnCompressionOption(char *optionString)
+{
+	List *columnCompressionList = NIL;
+	char *position = optionString;
+
+	while (scanner_isspace(*position))
+	{
+		position++;
+	}
+
+	while (*position != '\0')
+	{
+		char *columnName = NULL;
+
+		if (*position == '"')
+		{
+			StringInfoData quotedName = { 0 };
+			initStringInfo(&quotedName);
+
+			position++;
+			while (*position != '\0')
+			{
+				if (*position == '"')
+				{
+					/* a doubled quote stands for a quote in the name */
+					if (position[1] != '"')
+					{
+						break;
+					}
+
+					position++;
+				}
+
+				appendStringInfoChar(&quotedName, *position);
+				position++;
+			}
+
+			if (*position != '"')
+			{
+				ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+								errmsg("unterminated quoted column name in columnar "
+									   "column compression: %s",
+									   quote_literal_cstr(optionString))));
+			}
+
+			position++;
+			columnName = quotedName.data;
+		}
+		else
+		{
+			char *nameStart = position;
+			while (*position != '\0' && *position != ':' && *position != ',' &&
+				   !scanner_isspace(*position))
+			{
+				position++;
+			}
+
+			columnName = downcase_truncate_identifier(nameStart, position - nameStart,
+													  false);
+		}
+
+		while (scanner_isspace(*position))
+		{
+			position++;
+		}
+
+		if (*position != ':' || columnName[0] == '\0')
+		{
+			ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+							errmsg("invalid syntax for columnar column compression: %s",
+								   quote_literal_cstr(optionString)),
+							errhint("Use a comma-separated list of "
+									"column:compression[:level] entries.")));
+		}
+
+		position++;
+		char *settingStart = position;
+		while (*position != '\0' && *position != ',')
+		{
+			position++;
+		}
+
+		ColumnarColumnCompression *columnCompression =
+			palloc0(sizeof(ColumnarColumnCompression));
+		columnCompression->columnName = columnName;
+		ParseColumnCompressionSetting(pnstrdup(settingStart, position - settingStart),
+									  columnCompression);
+
+		columnCompressionList = lappend(columnCompressionList, columnCompression);
+
+		if (*position == ',')
+		{
+			position++;
+		}
+
+		while (scanner_isspace(*position))
+		{
+			position++;
+		}
+	}
+
+	return columnCompressionList;
+}
+
+
+/*
+ * ParseColumnCompressionSetting parses the compression[:level] part of a
+ * columnar.column_compression entry into the given columnCompression, where
+ * compression is either a compression type or auto. auto uses the
+ * compression type of the table, but stores the chunks that don't compress
+ * well uncompressed.
+ */
+static void
+ParseColumnCompressionSetting(char *settingString,
+							  ColumnarColumnCompression *columnCompression)
+{
+	char *levelString = strchr(settingString, ':');
+	if (levelString != NULL)
+	{
+		*levelString = '\0';
+		levelString++;
+	}
+
+	char *compressionName = settingString;
+	while (scanner_isspace(*compressionName))
+	{
+		compressionName++;
+	}
+
+	int compressionNameLength = strlen(compressionName);
+	while (compressionNameLength > 0 &&
+		   scanner_isspace(compressionName[compressionNameLength - 1]))
+	{
+		compressionNameLength--;
+	}
+
+	compressionName = downcase_identifier(compressionName, compressionNameLength,
+										  false, false);
+
+	if (strcmp(compressionName, "auto") == 0)
+	{
+		columnCompression->compressionType = COMPRESSION_TYPE_INVALID;
+		columnCompression->autoCompression = true;
+	}
+	else
+	{
+		columnCompression->compressionType = ParseCompressionType(compressionName);
+		columnCompression->autoCompression = false;
+
+		if (columnCompression->compressionType == COMPRESSION_TYPE_INVALID)
+		{
+			ereport(ERROR, (errmsg("unknown compression type for columnar column "
+								   "%s: %s", quote_identifier(
+									   columnCompression->columnName),
+								   quote_identifier(compressionName))));
+		}
+	}
+
+	columnCompression->compressionLevel = 0;
+	if (levelString != NULL)
+	{
+		char *levelEnd = NULL;
+		long compressionLevel = strtol(levelString, &levelEnd, 10);
+
+		while (scanner_isspace(*levelEnd))
+		{
+			levelEnd++;
+		}
+
+		if (levelEnd == levelString || *levelEnd != '\0')
+		{
+			ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+							errmsg("invalid compression level for columnar column "
+								   "%s: %s", quote_identifier(
+									   columnCompression->columnName),
+								   quote_literal_cstr(levelString))));
+		}
+
+		if (compressionLevel < COMPRESSION_LEVEL_MIN ||
+			compressionLevel > COMPRESSION_LEVEL_MAX)
+		{
+			ereport(ERROR, (errmsg("compression level out of range"),
+							errhint("compression level must be between %d and %d",
+									COMPRESSION_LEVEL_MIN,
+									COMPRESSION_LEVEL_MAX)));
+		}
+
+		columnCompression->compressionLevel = compressionLevel;
+	}
+}
+
+
+/*
+ * ColumnCompressionSettingString is the inverse of
+ * ParseColumnCompressionSetting.
+ */
+static char *
+ColumnCompressionSettingString(ColumnarColumnCompression *columnCompression)
+{
+	const char *compressionName = columnCompression->autoCompression ?
+								  "auto" :
+								  CompressionTypeStr(columnCompression->compressionType);
+
+	if (columnCompression->compressionLevel == 0)
+	{
+		return pstrdup(compressionName);
+	}
+
+	return psprintf("%s:%d", compressionName, columnCompression->compressionLevel);
+}
+
+
 /*
  * ExtractColumnarOptions - extract columnar options from inOptions, appending
  * to inoutColumnarOptions. Return the remaining (non-columnar) options.
@@ -421,6 +764,10 @@ WriteColumnarOptions(Oid regclass, ColumnarOptions *options, bool overwrite)
 		Int32GetDatum(options->stripeRowCount),
 		Int32GetDatum(options->compressionLevel),
 		0, /* to be filled below */
+		0, /* to be filled below */
+		0, /* to be filled below */
+		0, /* to be filled below */
+		0, /* to be filled below */
 	};
 
 	NameData compressionName = { 0 };
@@ -432,6 +779,77 @@ WriteColumnarOptions(Oid regclass, ColumnarOptions *options, bool overwrite)
 											 RowExclusiveLock);
 	TupleDesc tupleDescriptor = RelationGetDescr(columnarOptions);
 
+	if (options->bloomFilterColumns == NIL)
+	{
+		nulls[Anum_columnar_options_bloom_filter_columns - 1] = true;
+	}
+	else if (tupleDescriptor->natts < Anum_columnar_options_bloom_filter_columns)
+	{
+		/* bloom_filter_columns doesn't exist before citus_columnar 13.2-1 */
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("columnar bloom filters are not supported by the "
+							   "installed version of citus_columnar"),
+						errhint("Run ALTER EXTENSION citus_columnar UPDATE and try "
+								"again.")));
+	}
+	else
+	{
+		/*
+		 * We store attribute numbers rather than the column names, so that
+		 * renaming a column doesn't disable its bloom filters.
+		 */
+		ArrayType *attnumArray =
+			BloomFilterColumnsToAttnumArray(regclass, options->bloomFilterColumns);
+		values[Anum_columnar_options_bloom_filter_columns - 1] =
+			PointerGetDatum(attnumArray);
+	}
+
+	if (options->sortKeyColumns == NIL)
+	{
+		nulls[Anum_columnar_options_sort_key - 1] = true;
+	}
+	else if (tupleDescriptor->natts < Anum_columnar_options_sort_key)
+	{
+		/* sort_key doesn't exist before citus_columnar 13.2-1 */
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("columnar sort keys are not supported by the "
+							   "installed version of citus_columnar"),
+						errhint("Run ALTER EXTENSION citus_columnar UPDATE and try "
+								"again.")));
+	}
+	else
+	{
+		ArrayType *attnumArray =
+			SortKeyColumnsToAttnumArray(regclass, options->sortKeyColumns);
+		values[Anum_columnar_options_sort_key - 1] = PointerGetDatum(attnumArray);
+	}
+
+	if (options->columnCompressions == NIL)
+	{
+		nulls[Anum_columnar_options_column_compression_columns - 1] = true;
+		nulls[Anum_columnar_options_column_compression - 1] = true;
+	}
+	else if (tupleDescriptor->natts < Anum_columnar_options_column_compression)
+	{
+		/* column_compression doesn't exist before citus_columnar 13.2-1 */
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("columnar column compression is not supported by the "
+							   "installed version of citus_columnar"),
+						errhint("Run ALTER EXTENSION citus_columnar UPDATE and try "
+								"again.")));
+	}
+	else
+	{
+		ArrayType *attnumArray = NULL;
+		ArrayType *settingArray = NULL;
+		ColumnCompressionsToArrays(regclass, options->columnCompressions,
+								   &attnumArray, &settingArray);
+		values[Anum_columnar_options_column_compression_columns - 1] =
+			PointerGetDatum(attnumArray);
+		values[Anum_columnar_options_column_compression - 1] =
+			PointerGetDatum(settingArray);
+	}
+
 	/* find existing item to perform update if exist */
 	ScanKeyData scanKey[1] = { 0 };
 	ScanKeyInit(&scanKey[0], Anum_columnar_options_regclass, BTEqualStrategyNumber,
@@ -455,6 +873,22 @@ WriteColumnarOptions(Oid regclass, ColumnarOptions *options, bool overwrite)
 			update[Anum_columnar_options_compression_level - 1] = true;
 			update[Anum_columnar_options_compression - 1] = true;
 
+			if (tupleDescriptor->natts >= Anum_columnar_options_bloom_filter_columns)
+			{
+				update[Anum_columnar_options_bloom_filter_columns - 1] = true;
+			}
+
+			if (tupleDescriptor->natts >= Anum_columnar_options_sort_key)
+			{
+				update[Anum_columnar_options_sort_key - 1] = true;
+			}
+
+			if (tupleDescriptor->natts >= Anum_columnar_options_column_compression)
+			{
+				update[Anum_columnar_options_column_compression_columns - 1] = true;
+				update[Anum_columnar_options_column_compression - 1] = true;
+			}
+
 			HeapTuple tuple = heap_modify_tuple(heapTuple, tupleDescriptor,
 												values, nulls, update);
 			CatalogTupleUpdate(columnarOptions, &tuple->t_self, tuple);
@@ -579,6 +1013,61 @@ ReadColumnarOptions(Oid regclass, ColumnarOptions *options)
 		options->stripeRowCount = tupOptions->stripe_row_limit;
 		options->compressionLevel = tupOptions->compressionLevel;
 		options->compressionType = ParseCompressionType(NameStr(tupOptions->compression));
+		options->bloomFilterColumns = NIL;
+		options->sortKeyColumns = NIL;
+		options->columnCompressions = NIL;
+
+		/*
+		 * bloom_filter_columns, sort_key and column_compression don't exist
+		 * before citus_columnar 13.2-1
+		 */
+		TupleDesc tupleDescriptor = RelationGetDescr(columnarOptions);
+		if (tupleDescriptor->natts >= Anum_columnar_options_bloom_filter_columns)
+		{
+			bool isNull = false;
+			Datum attnumArrayDatum =
+				heap_getattr(heapTuple, Anum_columnar_options_bloom_filter_columns,
+							 tupleDescriptor, &isNull);
+			if (!isNull)
+			{
+				options->bloomFilterColumns =
+					AttnumArrayToColumnNames(regclass,
+											 DatumGetArrayTypeP(attnumArrayDatum));
+			}
+		}
+
+		if (tupleDescriptor->natts >= Anum_columnar_options_sort_key)
+		{
+			bool isNull = false;
+			Datum attnumArrayDatum =
+				heap_getattr(heapTuple, Anum_columnar_options_sort_key,
+							 tupleDescriptor, &isNull);
+			if (!isNull)
+			{
+				options->sortKeyColumns =
+					AttnumArrayToColumnNames(regclass,
+											 DatumGetArrayTypeP(attnumArrayDatum));
+			}
+		}
+
+		if (tupleDescriptor->natts >= Anum_columnar_options_column_compression)
+		{
+			bool attnumsNull = false;
+			Datum attnumArrayDatum =
+				heap_getattr(heapTuple, Anum_columnar_options_column_compression_columns,
+							 tupleDescriptor, &attnumsNull);
+			bool settingsNull = false;
+			Datum settingArrayDatum =
+				heap_getattr(heapTuple, Anum_columnar_options_column_compression,
+							 tupleDescriptor, &settingsNull);
+			if (!attnumsNull && !settingsNull)
+			{
+				options->columnCompressions =
+					ArraysToColumnCompressions(regclass,
+											   DatumGetArrayTypeP(attnumArrayDatum),
+											   DatumGetArrayTypeP(settingArrayDatum));
+			}
+		}
 	}
 	else
 	{
@@ -587,6 +1076,9 @@ ReadColumnarOptions(Oid regclass, ColumnarOptions *options)
 		options->stripeRowCount = columnar_stripe_row_limit;
 		options->chunkRowCount = columnar_chunk_group_row_limit;
 		options->compressionLevel = columnar_compression_level;
+		options->bloomFilterColumns = NIL;
+		options->sortKeyColumns = NIL;
+		options->columnCompressions = NIL;
 	}
 
 	systable_endscan_ordered(scanDescriptor);
@@ -597,6 +1089,298 @@ ReadColumnarOptions(Oid regclass, ColumnarOptions *options)
 }
 
 
+/*
+ * BloomFilterColumnsToAttnumArray returns an int2 array with the attribute
+ * numbers of the given columns of the relation, which is how we store the
+ * bloom filter columns in columnar.options. The columns must exist and have
+ * a type that has a default hash operator class.
+ */
+static ArrayType *
+BloomFilterColumnsToAttnumArray(Oid regclass, List *columnNameList)
+{
+	List *attnumList = NIL;
+
+	char *columnName = NULL;
+	foreach_declared_ptr(columnName, columnNameList)
+	{
+		AttrNumber attnum = get_attnum(regclass, columnName);
+		if (attnum == InvalidAttrNumber)
+		{
+			ereport(ERROR, (errcode(ERRCODE_UNDEFINED_COLUMN),
+							errmsg("column \"%s\" of relation \"%s\" does not exist",
+								   columnName, get_rel_name(regclass))));
+		}
+
+		if (attnum < 0)
+		{
+			ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							errmsg("cannot build bloom filters for system column "
+								   "\"%s\"", columnName)));
+		}
+
+		Oid typeId = get_atttype(regclass, attnum);
+		if (GetFunctionInfoOrNull(typeId, HASH_AM_OID, HASHSTANDARD_PROC) == NULL)
+		{
+			ereport(ERROR, (errcode(ERRCODE_UNDEFINED_OBJECT),
+							errmsg("cannot build bloom filters for column \"%s\"",
+								   columnName),
+							errdetail("Data type %s has no default hash operator "
+									  "class.", format_type_be(typeId))));
+		}
+
+		attnumList = list_append_unique_int(attnumList, attnum);
+	}
+
+	list_sort(attnumList, list_int_cmp);
+
+	return AttnumListToArray(attnumList);
+}
+
+
+/*
+ * SortKeyColumnsToAttnumArray returns an int2 array with the attribute numbers
+ * of the given columns of the relation, in the order of the sort key. The
+ * columns must exist and have a type that has a default btree operator class.
+ */
+static ArrayType *
+SortKeyColumnsToAttnumArray(Oid regclass, List *columnNameList)
+{
+	List *attnumList = NIL;
+
+	char *columnName = NULL;
+	foreach_declared_ptr(columnName, columnNameList)
+	{
+		AttrNumber attnum = get_attnum(regclass, columnName);
+		if (attnum == InvalidAttrNumber)
+		{
+			ereport(ERROR, (errcode(ERRCODE_UNDEFINED_COLUMN),
+							errmsg("column \"%s\" of relation \"%s\" does not exist",
+								   columnName, get_rel_name(regclass))));
+		}
+
+		if (attnum < 0)
+		{
+			ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							errmsg("cannot sort by system column \"%s\"", columnName)));
+		}
+
+		Oid typeId = get_atttype(regclass, attnum);
+		TypeCacheEntry *typeEntry = lookup_type_cache(typeId, TYPECACHE_LT_OPR);
+		if (!OidIsValid(typeEntry->lt_opr))
+		{
+			ereport(ERROR, (errcode(ERRCODE_UNDEFINED_FUNCTION),
+							errmsg("cannot sort by column \"%s\"", columnName),
+							errdetail("Data type %s has no default btree operator "
+									  "class.", format_type_be(typeId))));
+		}
+
+		/* a column that is repeated doesn't change the order */
+		attnumList = list_append_unique_int(attnumList, attnum);
+	}
+
+	return AttnumListToArray(attnumList);
+}
+
+
+/*
+ * AttnumListToArray converts the given list of attribute numbers to an int2
+ * array.
+ */
+static ArrayType *
+AttnumListToArray(List *attnumList)
+{
+	int attnumCount = list_length(attnumList);
+	Datum *attnumDatums = palloc0(attnumCount * sizeof(Datum));
+	for (int attnumIndex = 0; attnumIndex < attnumCount; attnumIndex++)
+	{
+		attnumDatums[attnumIndex] = Int16GetDatum(list_nth_int(attnumList, attnumIndex));
+	}
+
+	return construct_array(attnumDatums, attnumCount, INT2OID, sizeof(int16), true,
+						   TYPALIGN_SHORT);
+}
+
+
+/*
+ * AttnumArrayToColumnNames is the inverse of BloomFilterColumnsToAttnumArray
+ * and SortKeyColumnsToAttnumArray, it returns the names of the columns in the
+ * order of the array. Columns that were dropped since the options were written
+ * are skipped.
+ */
+static List *
+AttnumArrayToColumnNames(Oid regclass, ArrayType *attnumArray)
+{
+	List *columnNameList = NIL;
+
+	Datum *attnumDatums = NULL;
+	bool *attnumNulls = NULL;
+	int attnumCount = 0;
+	deconstruct_array(attnumArray, INT2OID, sizeof(int16), true, TYPALIGN_SHORT,
+					  &attnumDatums, &attnumNulls, &attnumCount);
+
+	for (int attnumIndex = 0; attnumIndex < attnumCount; attnumIndex++)
+	{
+		if (attnumNulls[attnumIndex])
+		{
+			continue;
+		}
+
+		AttrNumber attnum = DatumGetInt16(attnumDatums[attnumIndex]);
+		HeapTuple attributeTuple = SearchSysCache2(ATTNUM, ObjectIdGetDatum(regclass),
+												   Int16GetDatum(attnum));
+		if (!HeapTupleIsValid(attributeTuple))
+		{
+			continue;
+		}
+
+		Form_pg_attribute attributeForm =
+			(Form_pg_attribute) GETSTRUCT(attributeTuple);
+		if (!attributeForm->attisdropped)
+		{
+			columnNameList = lappend(columnNameList,
+									 pstrdup(NameStr(attributeForm->attname)));
+		}
+
+		ReleaseSysCache(attributeTuple);
+	}
+
+	return columnNameList;
+}
+
+
+/*
+ * ColumnCompressionsToArrays converts the given list of
+ * ColumnarColumnCompression to an int2 array with the attribute numbers of
+ * the columns and a text array with their compression settings, which is how
+ * we store them in columnar.options. The columns must exist. If a column is
+ * listed more than once, the last entry takes effect.
+ */
+static void
+ColumnCompressionsToArrays(Oid regclass, List *columnCompressionList,
+						   ArrayType **attnumArray, ArrayType **settingArray)
+{
+	List *attnumList = NIL;
+	List *settingList = NIL;
+
+	ColumnarColumnCompression *columnCompression = NULL;
+	foreach_declared_ptr(columnCompression, columnCompressionList)
+	{
+		char *columnName = columnCompression->columnName;
+		AttrNumber attnum = get_attnum(regclass, columnName);
+		if (attnum == InvalidAttrNumber)
+		{
+			ereport(ERROR, (errcode(ERRCODE_UNDEFINED_COLUMN),
+							errmsg("column \"%s\" of relation \"%s\" does not exist",
+								   columnName, get_rel_name(regclass))));
+		}
+
+		if (attnum < 0)
+		{
+			ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							errmsg("cannot set compression of system column \"%s\"",
+								   columnName)));
+		}
+
+		char *settingString = ColumnCompressionSettingString(columnCompression);
+
+		int attnumIndex = 0;
+		int existingAttnum = 0;
+		bool found = false;
+		foreach_declared_int(existingAttnum, attnumList)
+		{
+			if (existingAttnum == attnum)
+			{
+				lfirst(list_nth_cell(settingList, attnumIndex)) = settingString;
+				found = true;
+				break;
+			}
+
+			attnumIndex++;
+		}
+
+		if (!found)
+		{
+			attnumList = lappend_int(attnumList, attnum);
+			settingList = lappend(settingList, settingString);
+		}
+	}
+
+	*attnumArray = AttnumListToArray(attnumList);
+
+	int settingCount = list_length(settingList);
+	Datum *settingDatums = palloc0(settingCount * sizeof(Datum));
+	for (int settingIndex = 0; settingIndex < settingCount; settingIndex++)
+	{
+		settingDatums[settingIndex] =
+			CStringGetTextDatum((char *) list_nth(settingList, settingIndex));
+	}
+
+	*settingArray = construct_array(settingDatums, settingCount, TEXTOID, -1, false,
+									TYPALIGN_INT);
+}
+
+
+/*
+ * ArraysToColumnCompressions is the inverse of ColumnCompressionsToArrays.
+ * Columns that were dropped since the options were written are skipped.
+ */
+static List *
+ArraysToColumnCompressions(Oid regclass, ArrayType *attnumArray,
+						   ArrayType *settingArray)
+{
+	List *columnCompressionList = NIL;
+
+	Datum *attnumDatums = NULL;
+	bool *attnumNulls = NULL;
+	int attnumCount = 0;
+	deconstruct_array(attnumArray, INT2OID, sizeof(int16), true, TYPALIGN_SHORT,
+					  &attnumDatums, &attnumNulls, &attnumCount);
+
+	Datum *settingDatums = NULL;
+	bool *settingNulls = NULL;
+	int settingCount = 0;
+	deconstruct_array(settingArray, TEXTOID, -1, false, TYPALIGN_INT,
+					  &settingDatums, &settingNulls, &settingCount);
+
+	for (int index = 0; index < attnumCount && index < settingCount; index++)
+	{
+		if (attnumNulls[index] || settingNulls[index])
+		{
+			continue;
+		}
+
+		AttrNumber attnum = DatumGetInt16(attnumDatums[index]);
+		HeapTuple attributeTuple = SearchSysCache2(ATTNUM, ObjectIdGetDatum(regclass),
+												   Int16GetDatum(attnum));
+		if (!HeapTupleIsValid(attributeTuple))
+		{
+			continue;
+		}
+
+		Form_pg_attribute attributeForm =
+			(Form_pg_attribute) GETSTRUCT(attributeTuple);
+		char *columnName = attributeForm->attisdropped ?
+						   NULL : pstrdup(NameStr(attributeForm->attname));
+		ReleaseSysCache(attributeTuple);
+
+		if (columnName == NULL)
+		{
+			continue;
+		}
+
+		ColumnarColumnCompression *columnCompression =
+			palloc0(sizeof(ColumnarColumnCompression));
+		columnCompression->columnName = columnName;
+		ParseColumnCompressionSetting(TextDatumGetCString(settingDatums[index]),
+									  columnCompression);
+
+		columnCompressionList = lappend(columnCompressionList, columnCompression);
+	}
+
+	return columnCompressionList;
+}
+
+
 /*
  * SaveStripeSkipList saves chunkList for a given stripe as rows
  * of columnar.chunk.
@@ -636,32 +1420,218 @@ SaveStripeSkipList(RelFileLocator relfilelocator, uint64 stripe,
 				Int32GetDatum(chunk->valueCompressionType),
 				Int32GetDatum(chunk->valueCompressionLevel),
 				Int64GetDatum(chunk->decompressedValueSize),
-				Int64GetDatum(chunk->rowCount)
+				Int64GetDatum(chunk->rowCount),
+				Int32GetDatum(chunk->valueEncodingType),
+				0 /* to be filled below */
 			};
 
-			bool nulls[Natts_columnar_chunk] = { false };
+			bool nulls[Natts_columnar_chunk] = { false };
+
+			if (chunk->hasMinMax)
+			{
+				values[Anum_columnar_chunk_minimum_value - 1] =
+					PointerGetDatum(DatumToBytea(chunk->minimumValue,
+												 &tupleDescriptor->attrs[columnIndex]));
+				values[Anum_columnar_chunk_maximum_value - 1] =
+					PointerGetDatum(DatumToBytea(chunk->maximumValue,
+												 &tupleDescriptor->attrs[columnIndex]));
+			}
+			else
+			{
+				nulls[Anum_columnar_chunk_minimum_value - 1] = true;
+				nulls[Anum_columnar_chunk_maximum_value - 1] = true;
+			}
+
+			if (chunk->bloomFilter != NULL)
+			{
+				values[Anum_columnar_chunk_value_bloom_filter - 1] =
+					PointerGetDatum(chunk->bloomFilter);
+			}
+			else
+			{
+				nulls[Anum_columnar_chunk_value_bloom_filter - 1] = true;
+			}
+
+			InsertTupleAndEnforceConstraints(modifyState, values, nulls);
+		}
+	}
+
+	FinishModifyRelation(modifyState);
+	table_close(columnarChunk, RowExclusiveLock);
+}
+
+
+/*
+ * ColumnarChunkEncodingSupported returns true if columnar.chunk has a column to
+ * record the encoding of chunks, which is not the case until citus_columnar is
+ * updated to 13.2-1.
+ */
+bool
+ColumnarChunkEncodingSupported(void)
+{
+	Relation columnarChunk = table_open(ColumnarChunkRelationId(), AccessShareLock);
+	bool encodingSupported = RelationGetDescr(columnarChunk)->natts >=
+							 Anum_columnar_chunk_value_encoding_type;
+	table_close(columnarChunk, AccessShareLock);
+
+	return encodingSupported;
+}
+
+
+/*
+ * ColumnarMetadataNewZstdDictionaryId returns a new, unique id for a zstd
+ * dictionary. The ids are in the range that zstd reserves for private use.
+ */
+uint32
+ColumnarMetadataNewZstdDictionaryId(void)
+{
+	Oid sequenceId = ColumnarZstdDictionaryIdSequenceRelationId();
+	if (!OidIsValid(sequenceId))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("zstd dictionaries are not supported by the "
+							   "installed version of citus_columnar"),
+						errhint("Run ALTER EXTENSION citus_columnar UPDATE and try "
+								"again.")));
+	}
+
+	return (uint32) nextval_internal(sequenceId, false);
+}
+
+
+/*
+ * SaveColumnarZstdDictionary stores the given zstd dictionary for the given
+ * relfilenode in columnar.zstd_dictionary.
+ */
+void
+SaveColumnarZstdDictionary(RelFileLocator relfilelocator, uint32 dictionaryId,
+						   StringInfo dictionary)
+{
+	uint64 storageId = LookupStorageId(relfilelocator);
+
+	bytea *dictionaryBytea = palloc(dictionary->len + VARHDRSZ);
+	SET_VARSIZE(dictionaryBytea, dictionary->len + VARHDRSZ);
+	memcpy_s(VARDATA(dictionaryBytea), dictionary->len, dictionary->data,
+			 dictionary->len);
+
+	bool nulls[Natts_columnar_zstd_dictionary] = { false };
+	Datum values[Natts_columnar_zstd_dictionary] = { 0 };
+	values[Anum_columnar_zstd_dictionary_storageid - 1] = UInt64GetDatum(storageId);
+	values[Anum_columnar_zstd_dictionary_dictionary_id - 1] =
+		Int64GetDatum(dictionaryId);
+	values[Anum_columnar_zstd_dictionary_dictionary - 1] =
+		PointerGetDatum(dictionaryBytea);
+
+	Relation zstdDictionaries = table_open(ColumnarZstdDictionaryRelationId(),
+										   RowExclusiveLock);
+
+	ModifyState *modifyState = StartModifyRelation(zstdDictionaries);
+	InsertTupleAndEnforceConstraints(modifyState, values, nulls);
+	FinishModifyRelation(modifyState);
+
+	table_close(zstdDictionaries, RowExclusiveLock);
+}
+
+
+/*
+ * LatestColumnarZstdDictionaryId returns the id of the most recently trained
+ * zstd dictionary of the given relfilenode, or InvalidZstdDictionaryId if it
+ * has none.
+ *
+ * Dictionaries are read with SnapshotSelf, here and in
+ * ReadColumnarZstdDictionary, since their rows are never updated and a chunk
+ * written by a committed transaction can only refer to a committed
+ * dictionary, which might not be visible to the snapshot of the reader yet.
+ */
+uint32
+LatestColumnarZstdDictionaryId(RelFileLocator relfilelocator)
+{
+	Oid zstdDictionariesOid = ColumnarZstdDictionaryRelationId();
+	if (!OidIsValid(zstdDictionariesOid))
+	{
+		return InvalidZstdDictionaryId;
+	}
+
+	uint64 storageId = LookupStorageId(relfilelocator);
+
+	ScanKeyData scanKey[1];
+	ScanKeyInit(&scanKey[0], Anum_columnar_zstd_dictionary_storageid,
+				BTEqualStrategyNumber, F_INT8EQ, UInt64GetDatum(storageId));
+
+	Relation zstdDictionaries = table_open(zstdDictionariesOid, AccessShareLock);
+
+	Oid indexId = ColumnarZstdDictionaryStorageIdIndexRelationId();
+	SysScanDesc scanDescriptor = systable_beginscan(zstdDictionaries, indexId,
+													OidIsValid(indexId), SnapshotSelf,
+													1, scanKey);
+
+	uint32 latestDictionaryId = InvalidZstdDictionaryId;
+
+	HeapTuple heapTuple = NULL;
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		bool isNull = false;
+		Datum dictionaryIdDatum = heap_getattr(heapTuple,
+											   Anum_columnar_zstd_dictionary_dictionary_id,
+											   RelationGetDescr(zstdDictionaries),
+											   &isNull);
+		uint32 dictionaryId = (uint32) DatumGetInt64(dictionaryIdDatum);
+
+		/* ids are assigned in increasing order */
+		if (dictionaryId > latestDictionaryId)
+		{
+			latestDictionaryId = dictionaryId;
+		}
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(zstdDictionaries, AccessShareLock);
+
+	return latestDictionaryId;
+}
+
+
+/*
+ * ReadColumnarZstdDictionary returns the content of the zstd dictionary with
+ * the given id, or NULL if it doesn't exist.
+ */
+bytea *
+ReadColumnarZstdDictionary(uint32 dictionaryId)
+{
+	Oid zstdDictionariesOid = ColumnarZstdDictionaryRelationId();
+	if (!OidIsValid(zstdDictionariesOid))
+	{
+		return NULL;
+	}
+
+	ScanKeyData scanKey[1];
+	ScanKeyInit(&scanKey[0], Anum_columnar_zstd_dictionary_dictionary_id,
+				BTEqualStrategyNumber, F_INT8EQ, Int64GetDatum(dictionaryId));
+
+	Relation zstdDictionaries = table_open(zstdDictionariesOid, AccessShareLock);
 
-			if (chunk->hasMinMax)
-			{
-				values[Anum_columnar_chunk_minimum_value - 1] =
-					PointerGetDatum(DatumToBytea(chunk->minimumValue,
-												 &tupleDescriptor->attrs[columnIndex]));
-				values[Anum_columnar_chunk_maximum_value - 1] =
-					PointerGetDatum(DatumToBytea(chunk->maximumValue,
-												 &tupleDescriptor->attrs[columnIndex]));
-			}
-			else
-			{
-				nulls[Anum_columnar_chunk_minimum_value - 1] = true;
-				nulls[Anum_columnar_chunk_maximum_value - 1] = true;
-			}
+	Oid indexId = ColumnarZstdDictionaryIndexRelationId();
+	SysScanDesc scanDescriptor = systable_beginscan(zstdDictionaries, indexId,
+													OidIsValid(indexId), SnapshotSelf,
+													1, scanKey);
 
-			InsertTupleAndEnforceConstraints(modifyState, values, nulls);
-		}
+	bytea *dictionary = NULL;
+
+	HeapTuple heapTuple = systable_getnext(scanDescriptor);
+	if (HeapTupleIsValid(heapTuple))
+	{
+		bool isNull = false;
+		Datum dictionaryDatum = heap_getattr(heapTuple,
+											 Anum_columnar_zstd_dictionary_dictionary,
+											 RelationGetDescr(zstdDictionaries),
+											 &isNull);
+		dictionary = DatumGetByteaPCopy(dictionaryDatum);
 	}
 
-	FinishModifyRelation(modifyState);
-	table_close(columnarChunk, RowExclusiveLock);
+	systable_endscan(scanDescriptor);
+	table_close(zstdDictionaries, AccessShareLock);
+
+	return dictionary;
 }
 
 
@@ -716,6 +1686,24 @@ ReadStripeSkipList(RelFileLocator relfilelocator, uint64 stripe,
 
 	uint64 storageId = LookupStorageId(relfilelocator);
 
+	/*
+	 * Callers only read the skip lists of the stripes that they see as flushed,
+	 * which can't change anymore. Empty stripes are still being written.
+	 */
+	bool useMetadataCache = ColumnarMetadataCacheEnabled() && snapshot != NULL &&
+							snapshot->snapshot_type == SNAPSHOT_MVCC &&
+							chunkCount > 0;
+	if (useMetadataCache)
+	{
+		StripeSkipList *cachedSkipList =
+			ColumnarMetadataCacheLookupSkipList(storageId, stripe, tupleDescriptor,
+												chunkCount);
+		if (cachedSkipList != NULL)
+		{
+			return cachedSkipList;
+		}
+	}
+
 	Oid columnarChunkOid = ColumnarChunkRelationId();
 	Relation columnarChunk = table_open(columnarChunkOid, AccessShareLock);
 
@@ -754,6 +1742,16 @@ ReadStripeSkipList(RelFileLocator relfilelocator, uint64 stripe,
 		heap_deform_tuple(heapTuple, RelationGetDescr(columnarChunk), datumArray,
 						  isNullArray);
 
+		/*
+		 * A snapshot taken earlier in the current transaction might not see
+		 * all chunks of a stripe that was flushed later, don't cache those.
+		 */
+		if (TransactionIdIsCurrentTransactionId(
+				HeapTupleHeaderGetXmin(heapTuple->t_data)))
+		{
+			useMetadataCache = false;
+		}
+
 		int32 attr = DatumGetInt32(datumArray[Anum_columnar_chunk_attr - 1]);
 		int32 chunkIndex = DatumGetInt32(datumArray[Anum_columnar_chunk_chunk - 1]);
 
@@ -790,6 +1788,32 @@ ReadStripeSkipList(RelFileLocator relfilelocator, uint64 stripe,
 		chunk->decompressedValueSize =
 			DatumGetInt64(datumArray[Anum_columnar_chunk_value_decompressed_size - 1]);
 
+		/* value_encoding_type doesn't exist before citus_columnar 13.2-1 */
+		if (RelationGetDescr(columnarChunk)->natts >=
+			Anum_columnar_chunk_value_encoding_type &&
+			!isNullArray[Anum_columnar_chunk_value_encoding_type - 1])
+		{
+			chunk->valueEncodingType =
+				DatumGetInt32(datumArray[Anum_columnar_chunk_value_encoding_type - 1]);
+		}
+		else
+		{
+			chunk->valueEncodingType = ENCODING_NONE;
+		}
+
+		/* value_bloom_filter doesn't exist before citus_columnar 13.2-1 either */
+		if (RelationGetDescr(columnarChunk)->natts >=
+			Anum_columnar_chunk_value_bloom_filter &&
+			!isNullArray[Anum_columnar_chunk_value_bloom_filter - 1])
+		{
+			chunk->bloomFilter =
+				DatumGetByteaPCopy(datumArray[Anum_columnar_chunk_value_bloom_filter - 1]);
+		}
+		else
+		{
+			chunk->bloomFilter = NULL;
+		}
+
 		if (isNullArray[Anum_columnar_chunk_minimum_value - 1] ||
 			isNullArray[Anum_columnar_chunk_maximum_value - 1])
 		{
@@ -817,6 +1841,12 @@ ReadStripeSkipList(RelFileLocator relfilelocator, uint64 stripe,
 	chunkList->chunkGroupRowCounts =
 		ReadChunkGroupRowCounts(storageId, stripe, chunkCount, snapshot);
 
+	if (useMetadataCache)
+	{
+		ColumnarMetadataCacheInsertSkipList(storageId, stripe, tupleDescriptor,
+											chunkList);
+	}
+
 	return chunkList;
 }
 
@@ -926,6 +1956,13 @@ StripeMetadataLookupRowNumber(Relation relation, uint64 rowNumber, Snapshot snap
 	StripeMetadata *foundStripeMetadata = NULL;
 
 	uint64 storageId = ColumnarStorageGetStorageId(relation, false);
+
+	if (CachedStripeMetadataLookupRowNumber(relation, storageId, rowNumber, snapshot,
+											lookupMode, &foundStripeMetadata))
+	{
+		return foundStripeMetadata;
+	}
+
 	ScanKeyData scanKey[2];
 	ScanKeyInit(&scanKey[0], Anum_columnar_stripe_storageid,
 				BTEqualStrategyNumber, F_INT8EQ, Int64GetDatum(storageId));
@@ -1016,6 +2053,293 @@ StripeMetadataLookupRowNumber(Relation relation, uint64 rowNumber, Snapshot snap
 }
 
 
+/*
+ * CachedStripeMetadataLookupRowNumber does the same lookup as
+ * StripeMetadataLookupRowNumber using the cached stripe list of the storage,
+ * and sets *stripeMetadata to a copy of the found stripe, or to NULL if there
+ * is no such stripe. Returns false if the cached stripe list can't be used
+ * for the given snapshot.
+ */
+static bool
+CachedStripeMetadataLookupRowNumber(Relation relation, uint64 storageId,
+									uint64 rowNumber, Snapshot snapshot,
+									RowNumberLookupMode lookupMode,
+									StripeMetadata **stripeMetadata)
+{
+	ColumnarCachedStripeList *stripeList =
+		GetCachedStripeList(relation, storageId, snapshot);
+	if (stripeList == NULL)
+	{
+		return false;
+	}
+
+	/* find the first stripe whose firstRowNumber is greater than rowNumber */
+	int lowIndex = 0;
+	int highIndex = stripeList->stripeCount;
+	while (lowIndex < highIndex)
+	{
+		int middleIndex = lowIndex + (highIndex - lowIndex) / 2;
+		if (stripeList->stripes[middleIndex].firstRowNumber > rowNumber)
+		{
+			highIndex = middleIndex;
+		}
+		else
+		{
+			lowIndex = middleIndex + 1;
+		}
+	}
+
+	int foundIndex = (lookupMode == FIND_GREATER) ? lowIndex : lowIndex - 1;
+
+	*stripeMetadata = NULL;
+	if (foundIndex >= 0 && foundIndex < stripeList->stripeCount)
+	{
+		*stripeMetadata = palloc0(sizeof(StripeMetadata));
+		**stripeMetadata = stripeList->stripes[foundIndex];
+	}
+
+	return true;
+}
+
+
+/*
+ * GetCachedStripeList returns the cached stripe list of the given storage if
+ * it is exactly the list of stripes visible to the given snapshot, caching it
+ * first if needed. Returns NULL if the stripe list can't be cached or used
+ * with the given snapshot.
+ */
+static ColumnarCachedStripeList *
+GetCachedStripeList(Relation relation, uint64 storageId, Snapshot snapshot)
+{
+	if (!ColumnarMetadataCacheEnabled() || snapshot == NULL ||
+		snapshot->snapshot_type != SNAPSHOT_MVCC)
+	{
+		return NULL;
+	}
+
+	uint64 reservedStripeId = ColumnarStorageGetReservedStripeId(relation, false);
+	ColumnarCachedStripeList *stripeList =
+		ColumnarMetadataCacheLookupStripeList(storageId, reservedStripeId);
+
+	if (stripeList == NULL || StripeListMayBeUnblocked(stripeList, snapshot))
+	{
+		stripeList = BuildCachedStripeList(relation, storageId, snapshot);
+	}
+
+	if (stripeList == NULL || !ColumnarCachedStripeListIsVisible(stripeList, snapshot))
+	{
+		return NULL;
+	}
+
+	return stripeList;
+}
+
+
+/*
+ * StripeListMayBeUnblocked returns whether it's worth trying to read the given
+ * blocked stripe list again, that is, whether the transaction that blocked it
+ * has finished, or whether any transaction has finished since the last try if
+ * we don't know which transactions blocked it.
+ */
+static bool
+StripeListMayBeUnblocked(ColumnarCachedStripeList *stripeList, Snapshot snapshot)
+{
+	if (!stripeList->blocked)
+	{
+		return false;
+	}
+
+	if (TransactionIdIsValid(stripeList->blockingXid))
+	{
+		return !TransactionIdIsCurrentTransactionId(stripeList->blockingXid) &&
+			   !TransactionIdIsInProgress(stripeList->blockingXid);
+	}
+
+	return !TransactionIdEquals(stripeList->blockedSnapshotXmax, snapshot->xmax);
+}
+
+
+/*
+ * BuildCachedStripeList reads all columnar.stripe tuples of the given storage,
+ * regardless of their visibility, and caches the stripes that are visible to
+ * the snapshots that see all transactions that inserted or deleted a stripe
+ * as committed. Returns the cached stripe list, or NULL if it can't be cached.
+ *
+ * If the stripe list can't be read because of running transactions, a blocked
+ * stripe list is cached instead, so that we don't try to read it again until
+ * those transactions might have finished, see StripeListMayBeUnblocked.
+ */
+static ColumnarCachedStripeList *
+BuildCachedStripeList(Relation relation, uint64 storageId, Snapshot snapshot)
+{
+	/* the cached stripe list must be in row number order */
+	Oid indexId = ColumnarStripeFirstRowNumberIndexRelationId();
+	if (!OidIsValid(indexId) || RecoveryInProgress() || IsInParallelMode())
+	{
+		return NULL;
+	}
+
+	ColumnarCachedStripeList stripeList = { 0 };
+	stripeList.reservedStripeId = ColumnarStorageGetReservedStripeId(relation, false);
+
+	/*
+	 * Writers reserve a stripe id and then insert the stripe, so we could miss
+	 * a stripe that is about to be inserted with a stripe id smaller than the
+	 * reserved stripe id we read. ShareLock conflicts with the locks writers
+	 * hold, so there are no such stripes while we hold it, except for the ones
+	 * of our own transaction, which we detect as running below.
+	 */
+	if (!ConditionalLockRelation(relation, ShareLock))
+	{
+		stripeList.blocked = true;
+		stripeList.blockedSnapshotXmax = snapshot->xmax;
+
+		return ColumnarMetadataCacheInsertStripeList(storageId,
+													 RelationGetRelid(relation),
+													 &stripeList);
+	}
+
+	/* no reservations can happen now, read it again to be accurate */
+	stripeList.reservedStripeId = ColumnarStorageGetReservedStripeId(relation, false);
+
+	int maxStripeCount = 16;
+	stripeList.stripes = palloc0(maxStripeCount * sizeof(StripeMetadata));
+	int maxXidCount = 16;
+	stripeList.xids = palloc0(maxXidCount * sizeof(TransactionId));
+
+	ScanKeyData scanKey[1];
+	ScanKeyInit(&scanKey[0], Anum_columnar_stripe_storageid,
+				BTEqualStrategyNumber, F_INT8EQ, Int64GetDatum(storageId));
+
+	Relation columnarStripes = table_open(ColumnarStripeRelationId(), AccessShareLock);
+	SysScanDesc scanDescriptor = systable_beginscan(columnarStripes, indexId, true,
+													SnapshotAny, 1, scanKey);
+
+	HeapTuple heapTuple = NULL;
+	while (HeapTupleIsValid(heapTuple = systable_getnext(scanDescriptor)))
+	{
+		TransactionId xid = InvalidTransactionId;
+		StripeTupleState tupleState = GetStripeTupleState(heapTuple->t_data, &xid);
+
+		if (tupleState == STRIPE_TUPLE_IN_PROGRESS)
+		{
+			stripeList.blocked = true;
+			stripeList.blockingXid = xid;
+			stripeList.blockedSnapshotXmax = snapshot->xmax;
+			stripeList.stripeCount = 0;
+			stripeList.xidCount = 0;
+			break;
+		}
+
+		if (TransactionIdIsNormal(xid))
+		{
+			if (stripeList.xidCount == maxXidCount)
+			{
+				maxXidCount *= 2;
+				stripeList.xids = repalloc(stripeList.xids,
+										   maxXidCount * sizeof(TransactionId));
+			}
+
+			stripeList.xids[stripeList.xidCount++] = xid;
+		}
+
+		if (tupleState == STRIPE_TUPLE_LIVE)
+		{
+			if (stripeList.stripeCount == maxStripeCount)
+			{
+				maxStripeCount *= 2;
+				stripeList.stripes = repalloc(stripeList.stripes,
+											  maxStripeCount * sizeof(StripeMetadata));
+			}
+
+			StripeMetadata *stripeMetadata =
+				BuildStripeMetadata(columnarStripes, heapTuple);
+			stripeList.stripes[stripeList.stripeCount++] = *stripeMetadata;
+			pfree(stripeMetadata);
+		}
+	}
+
+	systable_endscan(scanDescriptor);
+	table_close(columnarStripes, AccessShareLock);
+
+	UnlockRelation(relation, ShareLock);
+
+	ColumnarCachedStripeList *cachedStripeList =
+		ColumnarMetadataCacheInsertStripeList(storageId, RelationGetRelid(relation),
+											  &stripeList);
+
+	pfree(stripeList.stripes);
+	pfree(stripeList.xids);
+
+	return cachedStripeList;
+}
+
+
+/*
+ * GetStripeTupleState returns the state of the given columnar.stripe tuple
+ * for all snapshots. For live and dead tuples, it sets *xid to the transaction
+ * that a snapshot needs to see as committed for that state, which is
+ * InvalidTransactionId if the state holds for all snapshots. For tuples that
+ * are in progress, it sets *xid to the running transaction, if known.
+ */
+static StripeTupleState
+GetStripeTupleState(HeapTupleHeader tuple, TransactionId *xid)
+{
+	TransactionId xmin = HeapTupleHeaderGetXmin(tuple);
+
+	*xid = InvalidTransactionId;
+
+	if (HeapTupleHeaderXminInvalid(tuple))
+	{
+		return STRIPE_TUPLE_DEAD;
+	}
+
+	if (!HeapTupleHeaderXminFrozen(tuple))
+	{
+		if (TransactionIdIsCurrentTransactionId(xmin) ||
+			TransactionIdIsInProgress(xmin))
+		{
+			*xid = xmin;
+			return STRIPE_TUPLE_IN_PROGRESS;
+		}
+
+		if (!TransactionIdDidCommit(xmin))
+		{
+			return STRIPE_TUPLE_DEAD;
+		}
+	}
+
+	if ((tuple->t_infomask & HEAP_XMAX_INVALID) ||
+		HEAP_XMAX_IS_LOCKED_ONLY(tuple->t_infomask))
+	{
+		*xid = xmin;
+		return STRIPE_TUPLE_LIVE;
+	}
+
+	if (tuple->t_infomask & HEAP_XMAX_IS_MULTI)
+	{
+		/* stripe tuples are never updated, so this doesn't happen in practice */
+		return STRIPE_TUPLE_IN_PROGRESS;
+	}
+
+	TransactionId xmax = HeapTupleHeaderGetRawXmax(tuple);
+	if (TransactionIdIsCurrentTransactionId(xmax) || TransactionIdIsInProgress(xmax))
+	{
+		*xid = xmax;
+		return STRIPE_TUPLE_IN_PROGRESS;
+	}
+
+	if (TransactionIdDidCommit(xmax))
+	{
+		*xid = xmax;
+		return STRIPE_TUPLE_DEAD;
+	}
+
+	*xid = xmin;
+	return STRIPE_TUPLE_LIVE;
+}
+
+
 /*
  * CheckStripeMetadataConsistency first decides if stripe write operation for
  * given stripe is "flushed", "aborted" or "in-progress", then errors out if
@@ -1338,6 +2662,9 @@ ReserveEmptyStripe(Relation rel, uint64 columnCount, uint64 chunkGroupRowCount,
 								 columnCount, chunkGroupRowCount,
 								 stripeReservation->stripeFirstRowNumber);
 
+	/* the cached stripe list is stale anyway, see columnar_metadata_cache.c */
+	ColumnarMetadataCacheInvalidateStripeList(storageId);
+
 	return stripeReservation;
 }
 
@@ -1577,6 +2904,71 @@ DeleteMetadataRows(RelFileLocator relfilelocator)
 										   Anum_columnar_chunk_storageid,
 										   ColumnarChunkIndexRelationId(),
 										   storageId);
+
+	/* zstd dictionaries don't exist until citus_columnar is updated to 13.2-1 */
+	Oid zstdDictionariesOid = ColumnarZstdDictionaryRelationId();
+	if (OidIsValid(zstdDictionariesOid))
+	{
+		DeleteStorageFromColumnarMetadataTable(zstdDictionariesOid,
+											   Anum_columnar_zstd_dictionary_storageid,
+											   ColumnarZstdDictionaryStorageIdIndexRelationId(),
+											   storageId);
+	}
+
+	/* chunks of the storage will never be read again, see columnar_cache.c */
+	ColumnarChunkCacheInvalidateStorage(storageId);
+	ColumnarMetadataCacheInvalidateStorage(storageId);
+}
+
+
+/*
+ * DeleteStripeMetadataRows removes the rows of the given stripe of the given
+ * relfilenode from columnar metadata tables. Readers whose snapshot still
+ * sees the rows can keep reading the stripe, since its data is not removed
+ * from the storage.
+ */
+void
+DeleteStripeMetadataRows(RelFileLocator relfilelocator, uint64 stripeId)
+{
+	uint64 storageId = LookupStorageId(relfilelocator);
+
+	DeleteStripeFromColumnarMetadataTable(ColumnarStripeRelationId(),
+										  Anum_columnar_stripe_storageid,
+										  Anum_columnar_stripe_stripe,
+										  ColumnarStripePKeyIndexRelationId(),
+										  storageId, stripeId);
+	DeleteStripeFromColumnarMetadataTable(ColumnarChunkGroupRelationId(),
+										  Anum_columnar_chunkgroup_storageid,
+										  Anum_columnar_chunkgroup_stripe,
+										  ColumnarChunkGroupIndexRelationId(),
+										  storageId, stripeId);
+	DeleteStripeFromColumnarMetadataTable(ColumnarChunkRelationId(),
+										  Anum_columnar_chunk_storageid,
+										  Anum_columnar_chunk_stripe,
+										  ColumnarChunkIndexRelationId(),
+										  storageId, stripeId);
+
+	ColumnarMetadataCacheInvalidateStorage(storageId);
+}
+
+
+/*
+ * DeleteStripeFromColumnarMetadataTable removes the rows with given storageId
+ * and stripeId from given columnar metadata table.
+ */
+static void
+DeleteStripeFromColumnarMetadataTable(Oid metadataTableId,
+									  AttrNumber storageIdAttrNumber,
+									  AttrNumber stripeAttrNumber,
+									  Oid indexId, uint64 storageId, uint64 stripeId)
+{
+	ScanKeyData scanKey[2];
+	ScanKeyInit(&scanKey[0], storageIdAttrNumber, BTEqualStrategyNumber,
+				F_INT8EQ, Int64GetDatum(storageId));
+	ScanKeyInit(&scanKey[1], stripeAttrNumber, BTEqualStrategyNumber,
+				F_INT8EQ, Int64GetDatum(stripeId));
+
+	DeleteColumnarMetadataTableRows(metadataTableId, indexId, scanKey, 2);
 }
 
 
@@ -1593,6 +2985,19 @@ DeleteStorageFromColumnarMetadataTable(Oid metadataTableId,
 	ScanKeyInit(&scanKey[0], storageIdAtrrNumber, BTEqualStrategyNumber,
 				F_INT8EQ, Int64GetDatum(storageId));
 
+	DeleteColumnarMetadataTableRows(metadataTableId, storageIdIndexId, scanKey, 1);
+}
+
+
+/*
+ * DeleteColumnarMetadataTableRows removes the rows that match the given scan
+ * keys from given columnar metadata table, using the given index if it is
+ * available.
+ */
+static void
+DeleteColumnarMetadataTableRows(Oid metadataTableId, Oid indexId,
+								ScanKey scanKey, int scanKeyCount)
+{
 	Relation metadataTable = try_relation_open(metadataTableId, AccessShareLock);
 	if (metadataTable == NULL)
 	{
@@ -1600,9 +3005,10 @@ DeleteStorageFromColumnarMetadataTable(Oid metadataTableId,
 		return;
 	}
 
-	bool indexOk = OidIsValid(storageIdIndexId);
-	SysScanDesc scanDescriptor = systable_beginscan(metadataTable, storageIdIndexId,
-													indexOk, NULL, 1, scanKey);
+	bool indexOk = OidIsValid(indexId);
+	SysScanDesc scanDescriptor = systable_beginscan(metadataTable, indexId,
+													indexOk, NULL, scanKeyCount,
+													scanKey);
 
 	static bool loggedSlowMetadataAccessWarning = false;
 	if (!indexOk && !loggedSlowMetadataAccessWarning)
@@ -1913,6 +3319,51 @@ ColumnarChunkGroupIndexRelationId(void)
 }
 
 
+/*
+ * ColumnarZstdDictionaryRelationId returns relation id of
+ * columnar.zstd_dictionary, or InvalidOid if citus_columnar is not updated
+ * to 13.2-1 yet.
+ */
+static Oid
+ColumnarZstdDictionaryRelationId(void)
+{
+	return get_relname_relid("zstd_dictionary", ColumnarNamespaceId());
+}
+
+
+/*
+ * ColumnarZstdDictionaryIndexRelationId returns relation id of
+ * columnar.zstd_dictionary_pkey.
+ */
+static Oid
+ColumnarZstdDictionaryIndexRelationId(void)
+{
+	return get_relname_relid("zstd_dictionary_pkey", ColumnarNamespaceId());
+}
+
+
+/*
+ * ColumnarZstdDictionaryStorageIdIndexRelationId returns relation id of
+ * columnar.zstd_dictionary_storage_id_idx.
+ */
+static Oid
+ColumnarZstdDictionaryStorageIdIndexRelationId(void)
+{
+	return get_relname_relid("zstd_dictionary_storage_id_idx", ColumnarNamespaceId());
+}
+
+
+/*
+ * ColumnarZstdDictionaryIdSequenceRelationId returns relation id of
+ * columnar.zstd_dictionary_id_seq.
+ */
+static Oid
+ColumnarZstdDictionaryIdSequenceRelationId(void)
+{
+	return get_relname_relid("zstd_dictionary_id_seq", ColumnarNamespaceId());
+}
+
+
 /*
  * ColumnarNamespaceId returns namespace id of the schema we store columnar
  * related tables.
@@ -0,0 +1,773 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_metadata_cache.c
+ *
+ * Backend-local LRU cache of columnar stripe lists and stripe skip lists.
+ *
+ * Reading a columnar table requires looking up its stripes in columnar.stripe,
+ * and the chunk metadata of each stripe in columnar.chunk and
+ * columnar.chunk_group. For short queries on tables with many stripes, these
+ * catalog scans cost more than reading the data itself, so we keep the most
+ * recently used stripe lists and deserialized skip lists around, up to
+ * columnar.metadata_cache_size kilobytes per backend.
+ *
+ * Skip lists are keyed by storage id and stripe id. A stripe and its chunk
+ * metadata never change once the stripe is flushed, and neither storage ids
+ * nor stripe ids are reused, so a cached skip list never becomes stale.
+ *
+ * Stripe lists are keyed by storage id, and they are harder to cache since the
+ * set of stripes visible to a scan depends on its snapshot. A stripe list is
+ * only cached when none of the transactions that inserted or deleted stripes
+ * are still running (see BuildCachedStripeList), and we remember those
+ * transactions so that a snapshot can use the cached list only if it sees all
+ * of them as committed. Any new stripe gets a stripe id from the metapage of
+ * the storage first, so a cached stripe list is stale as soon as the reserved
+ * stripe id in the metapage moves past the one we read when caching it. This
+ * check is what makes the writes of other backends visible to us, since they
+ * don't send invalidation messages for each stripe they write. In addition,
+ * the stripe list of a relation is dropped on its relcache invalidation, when
+ * this backend writes to it, and when its stripes are deleted.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "funcapi.h"
+#include "safe_lib.h"
+
+#include "access/htup_details.h"
+#include "access/transam.h"
+#include "lib/ilist.h"
+#include "utils/datum.h"
+#include "utils/hsearch.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/snapmgr.h"
+
+#include "columnar/columnar.h"
+#include "columnar/columnar_metadata_cache.h"
+
+/* kinds of metadata kept in the cache */
+typedef enum MetadataCacheEntryKind
+{
+	METADATA_CACHE_SKIP_LIST = 1,
+	METADATA_CACHE_STRIPE_LIST = 2
+} MetadataCacheEntryKind;
+
+/*
+ * MetadataCacheKey identifies a cache entry. Keys are hashed as blobs, so they
+ * must always be zeroed before their fields are set, see MakeSkipListKey and
+ * MakeStripeListKey.
+ */
+typedef struct MetadataCacheKey
+{
+	uint64 storageId;
+
+	/* below fields are only set for skip lists */
+	uint64 stripeId;
+	uint32 columnCount;
+	uint32 chunkCount;
+
+	uint32 kind;
+} MetadataCacheKey;
+
+/*
+ * MetadataCacheEntry is an entry of the metadata cache. The cached metadata is
+ * allocated in a memory context of its own, so that it can be freed at once.
+ * Entries are kept in MetadataCacheLRUList from the most recently used to the
+ * least recently used, and stripe list entries are also kept in
+ * StripeListEntryList so that relcache invalidations don't need to go through
+ * all the entries.
+ */
+typedef struct MetadataCacheEntry
+{
+	/* key must be the first field, see hash_search */
+	MetadataCacheKey key;
+
+	dlist_node lruNode;
+	dlist_node stripeListNode;
+	MemoryContext context;
+	Size size;
+
+	/* relation the stripe list belongs to, to handle relcache invalidations */
+	Oid relationId;
+
+	StripeSkipList *skipList;
+	ColumnarCachedStripeList *stripeList;
+} MetadataCacheEntry;
+
+static MemoryContext MetadataCacheContext = NULL;
+static HTAB *MetadataCacheHash = NULL;
+static dlist_head MetadataCacheLRUList = DLIST_STATIC_INIT(MetadataCacheLRUList);
+static dlist_head StripeListEntryList = DLIST_STATIC_INIT(StripeListEntryList);
+static Size MetadataCacheUsedSize = 0;
+
+/* counters reported by columnar.metadata_cache_stats() */
+static int64 MetadataCacheHits = 0;
+static int64 MetadataCacheMisses = 0;
+static int64 MetadataCacheEvictions = 0;
+
+static MetadataCacheKey MakeSkipListKey(uint64 storageId, uint64 stripeId,
+										uint32 columnCount, uint32 chunkCount);
+static MetadataCacheKey MakeStripeListKey(uint64 storageId);
+static MetadataCacheEntry * LookupMetadataCacheEntry(MetadataCacheKey *key);
+static MemoryContext CreateEntryContext(void);
+static MetadataCacheEntry * AddMetadataCacheEntry(MetadataCacheKey *key,
+												  MemoryContext entryContext);
+static StripeSkipList * CopyStripeSkipList(StripeSkipList *skipList,
+										   TupleDesc tupleDescriptor);
+static int CompareTransactionIdsNewestFirst(const void *left, const void *right,
+											void *arg);
+static Size MetadataCacheSizeLimit(int cacheSizeKB);
+static void CreateMetadataCache(void);
+static void ReleaseMetadataCache(void);
+static void EnforceMetadataCacheLimit(Size sizeLimit);
+static void RemoveMetadataCacheEntry(MetadataCacheEntry *entry);
+static void InvalidateMetadataCacheRelcacheCallback(Datum argument, Oid relationId);
+
+PG_FUNCTION_INFO_V1(columnar_metadata_cache_stats);
+
+
+/*
+ * ColumnarMetadataCacheInit registers the relcache invalidation callback of
+ * the metadata cache. It is called once when the library is loaded.
+ */
+void
+ColumnarMetadataCacheInit(void)
+{
+	CacheRegisterRelcacheCallback(InvalidateMetadataCacheRelcacheCallback,
+								  (Datum) 0);
+}
+
+
+/*
+ * ColumnarMetadataCacheEnabled returns whether the metadata cache is enabled.
+ */
+bool
+ColumnarMetadataCacheEnabled(void)
+{
+	return columnar_metadata_cache_size > 0;
+}
+
+
+/*
+ * ColumnarMetadataCacheLookupSkipList returns a copy of the cached skip list
+ * of the given stripe, allocated in the current memory context, or NULL if it
+ * is not cached.
+ */
+StripeSkipList *
+ColumnarMetadataCacheLookupSkipList(uint64 storageId, uint64 stripeId,
+									TupleDesc tupleDescriptor, uint32 chunkCount)
+{
+	MetadataCacheKey key = MakeSkipListKey(storageId, stripeId, tupleDescriptor->natts,
+										   chunkCount);
+	MetadataCacheEntry *entry = LookupMetadataCacheEntry(&key);
+	if (entry == NULL)
+	{
+		return NULL;
+	}
+
+	return CopyStripeSkipList(entry->skipList, tupleDescriptor);
+}
+
+
+/*
+ * ColumnarMetadataCacheInsertSkipList stores a copy of the given skip list in
+ * the cache. Caller must make sure that the stripe is flushed and that its
+ * chunk metadata is visible to the snapshot the skip list was read with.
+ */
+void
+ColumnarMetadataCacheInsertSkipList(uint64 storageId, uint64 stripeId,
+									TupleDesc tupleDescriptor, StripeSkipList *skipList)
+{
+	MetadataCacheKey key = MakeSkipListKey(storageId, stripeId, skipList->columnCount,
+										   skipList->chunkCount);
+
+	if (MetadataCacheHash != NULL &&
+		hash_search(MetadataCacheHash, &key, HASH_FIND, NULL) != NULL)
+	{
+		return;
+	}
+
+	MemoryContext entryContext = CreateEntryContext();
+	MemoryContext oldContext = MemoryContextSwitchTo(entryContext);
+	StripeSkipList *skipListCopy = CopyStripeSkipList(skipList, tupleDescriptor);
+	MemoryContextSwitchTo(oldContext);
+
+	MetadataCacheEntry *entry = AddMetadataCacheEntry(&key, entryContext);
+	if (entry != NULL)
+	{
+		entry->skipList = skipListCopy;
+	}
+}
+
+
+/*
+ * ColumnarMetadataCacheLookupStripeList returns the cached stripe list of the
+ * given storage if it was read when the reserved stripe id of the storage was
+ * reservedStripeId, and NULL otherwise. Caller must check whether its snapshot
+ * can use the list by calling ColumnarCachedStripeListIsVisible.
+ *
+ * The returned list is owned by the cache, so it must not be modified, and it
+ * is only valid until the cache is accessed again.
+ */
+ColumnarCachedStripeList *
+ColumnarMetadataCacheLookupStripeList(uint64 storageId, uint64 reservedStripeId)
+{
+	MetadataCacheKey key = MakeStripeListKey(storageId);
+	MetadataCacheEntry *entry = NULL;
+
+	if (MetadataCacheHash != NULL)
+	{
+		entry = hash_search(MetadataCacheHash, &key, HASH_FIND, NULL);
+	}
+
+	if (entry != NULL && entry->stripeList->reservedStripeId != reservedStripeId)
+	{
+		/* stripes were written since we read the list */
+		RemoveMetadataCacheEntry(entry);
+		entry = NULL;
+	}
+
+	if (entry == NULL)
+	{
+		MetadataCacheMisses++;
+		return NULL;
+	}
+
+	MetadataCacheHits++;
+	dlist_move_head(&MetadataCacheLRUList, &entry->lruNode);
+
+	return entry->stripeList;
+}
+
+
+/*
+ * ColumnarMetadataCacheInsertStripeList stores a copy of the given stripe list
+ * of a storage in the cache, replacing the stale one if any.
+ *
+ * Returns the cached stripe list, which is only valid until the cache is
+ * accessed again, or NULL if it doesn't fit into the cache.
+ */
+ColumnarCachedStripeList *
+ColumnarMetadataCacheInsertStripeList(uint64 storageId, Oid relationId,
+									  ColumnarCachedStripeList *stripeList)
+{
+	MetadataCacheKey key = MakeStripeListKey(storageId);
+
+	ColumnarMetadataCacheInvalidateStripeList(storageId);
+
+	MemoryContext entryContext = CreateEntryContext();
+	MemoryContext oldContext = MemoryContextSwitchTo(entryContext);
+
+	ColumnarCachedStripeList *stripeListCopy = palloc0(sizeof(ColumnarCachedStripeList));
+	*stripeListCopy = *stripeList;
+
+	Size stripesSize = stripeList->stripeCount * sizeof(StripeMetadata);
+	stripeListCopy->stripes = palloc0(Max(stripesSize, 1));
+	if (stripesSize > 0)
+	{
+		memcpy_s(stripeListCopy->stripes, stripesSize, stripeList->stripes,
+				 stripesSize);
+	}
+
+	Size xidsSize = stripeList->xidCount * sizeof(TransactionId);
+	stripeListCopy->xids = palloc0(Max(xidsSize, 1));
+	if (xidsSize > 0)
+	{
+		memcpy_s(stripeListCopy->xids, xidsSize, stripeList->xids, xidsSize);
+	}
+
+	qsort_arg(stripeListCopy->xids, stripeListCopy->xidCount, sizeof(TransactionId),
+			  CompareTransactionIdsNewestFirst, NULL);
+
+	MemoryContextSwitchTo(oldContext);
+
+	MetadataCacheEntry *entry = AddMetadataCacheEntry(&key, entryContext);
+	if (entry == NULL)
+	{
+		return NULL;
+	}
+
+	entry->relationId = relationId;
+	entry->stripeList = stripeListCopy;
+
+	return stripeListCopy;
+}
+
+
+/*
+ * ColumnarCachedStripeListIsVisible returns whether the given cached stripe
+ * list is exactly the list of stripes visible to the given MVCC snapshot,
+ * that is, whether the snapshot sees all transactions that inserted or
+ * deleted stripes as committed.
+ */
+bool
+ColumnarCachedStripeListIsVisible(ColumnarCachedStripeList *stripeList,
+								  Snapshot snapshot)
+{
+	Assert(snapshot->snapshot_type == SNAPSHOT_MVCC);
+
+	if (stripeList->blocked)
+	{
+		return false;
+	}
+
+	for (int xidIndex = 0; xidIndex < stripeList->xidCount; xidIndex++)
+	{
+		TransactionId xid = stripeList->xids[xidIndex];
+
+		/* xids are sorted newest first, so the rest are older than xmin too */
+		if (TransactionIdPrecedes(xid, snapshot->xmin))
+		{
+			break;
+		}
+
+		if (XidInMVCCSnapshot(xid, snapshot))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * ColumnarMetadataCacheInvalidateStripeList removes the cached stripe list of
+ * the given storage.
+ */
+void
+ColumnarMetadataCacheInvalidateStripeList(uint64 storageId)
+{
+	if (MetadataCacheHash == NULL)
+	{
+		return;
+	}
+
+	MetadataCacheKey key = MakeStripeListKey(storageId);
+	MetadataCacheEntry *entry = hash_search(MetadataCacheHash, &key, HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		RemoveMetadataCacheEntry(entry);
+	}
+}
+
+
+/*
+ * ColumnarMetadataCacheInvalidateStorage removes the cached stripe list and
+ * the cached skip lists of the given storage.
+ */
+void
+ColumnarMetadataCacheInvalidateStorage(uint64 storageId)
+{
+	if (MetadataCacheHash == NULL)
+	{
+		return;
+	}
+
+	HASH_SEQ_STATUS status;
+	MetadataCacheEntry *entry = NULL;
+
+	hash_seq_init(&status, MetadataCacheHash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		/* removing the entry just returned by hash_seq_search is safe */
+		if (entry->key.storageId == storageId)
+		{
+			RemoveMetadataCacheEntry(entry);
+		}
+	}
+}
+
+
+/*
+ * ColumnarMetadataCacheSizeAssignHook evicts entries when
+ * columnar.metadata_cache_size is lowered, and releases the cache altogether
+ * when it is disabled.
+ */
+void
+ColumnarMetadataCacheSizeAssignHook(int newval, void *extra)
+{
+	if (MetadataCacheHash == NULL)
+	{
+		return;
+	}
+
+	if (newval == 0)
+	{
+		ReleaseMetadataCache();
+	}
+	else
+	{
+		EnforceMetadataCacheLimit(MetadataCacheSizeLimit(newval));
+	}
+}
+
+
+/*
+ * MakeSkipListKey returns the cache key of the skip list of the given stripe.
+ * The shape of a skip list depends on the number of columns of the relation
+ * and on the number of chunks of the stripe, so both are part of the key.
+ */
+static MetadataCacheKey
+MakeSkipListKey(uint64 storageId, uint64 stripeId, uint32 columnCount,
+				uint32 chunkCount)
+{
+	MetadataCacheKey key;
+	memset(&key, 0, sizeof(key));
+	key.storageId = storageId;
+	key.stripeId = stripeId;
+	key.columnCount = columnCount;
+	key.chunkCount = chunkCount;
+	key.kind = METADATA_CACHE_SKIP_LIST;
+
+	return key;
+}
+
+
+/*
+ * MakeStripeListKey returns the cache key of the stripe list of the given
+ * storage.
+ */
+static MetadataCacheKey
+MakeStripeListKey(uint64 storageId)
+{
+	MetadataCacheKey key;
+	memset(&key, 0, sizeof(key));
+	key.storageId = storageId;
+	key.kind = METADATA_CACHE_STRIPE_LIST;
+
+	return key;
+}
+
+
+/*
+ * LookupMetadataCacheEntry returns the cache entry with the given key, or NULL
+ * if there is no such entry, and updates the counters accordingly.
+ */
+static MetadataCacheEntry *
+LookupMetadataCacheEntry(MetadataCacheKey *key)
+{
+	MetadataCacheEntry *entry = NULL;
+
+	if (MetadataCacheHash != NULL)
+	{
+		entry = hash_search(MetadataCacheHash, key, HASH_FIND, NULL);
+	}
+
+	if (entry == NULL)
+	{
+		MetadataCacheMisses++;
+		return NULL;
+	}
+
+	MetadataCacheHits++;
+	dlist_move_head(&MetadataCacheLRUList, &entry->lruNode);
+
+	return entry;
+}
+
+
+/*
+ * CreateEntryContext creates the memory context to copy the data of a new
+ * cache entry into. It is a child of the current memory context until the
+ * entry is added to the cache, so that it is freed if copying fails.
+ */
+static MemoryContext
+CreateEntryContext(void)
+{
+	return AllocSetContextCreate(CurrentMemoryContext,
+								 "Columnar Metadata Cache Entry",
+								 ALLOCSET_SMALL_SIZES);
+}
+
+
+/*
+ * AddMetadataCacheEntry adds an entry with the given key whose data lives in
+ * entryContext to the cache, evicting the least recently used entries to make
+ * room for it. Caller must set the data of the returned entry. Returns NULL,
+ * and frees entryContext, if the entry is too large for the cache or if it
+ * already exists.
+ */
+static MetadataCacheEntry *
+AddMetadataCacheEntry(MetadataCacheKey *key, MemoryContext entryContext)
+{
+	Size sizeLimit = MetadataCacheSizeLimit(columnar_metadata_cache_size);
+	Size entrySize = MemoryContextMemAllocated(entryContext, true) +
+					 sizeof(MetadataCacheEntry);
+
+	if (entrySize > sizeLimit)
+	{
+		MemoryContextDelete(entryContext);
+		return NULL;
+	}
+
+	if (MetadataCacheHash == NULL)
+	{
+		CreateMetadataCache();
+	}
+
+	EnforceMetadataCacheLimit(sizeLimit - entrySize);
+
+	bool found = false;
+	MetadataCacheEntry *entry = hash_search(MetadataCacheHash, key, HASH_ENTER, &found);
+	if (found)
+	{
+		/* another scan in this backend cached the same metadata meanwhile */
+		MemoryContextDelete(entryContext);
+		dlist_move_head(&MetadataCacheLRUList, &entry->lruNode);
+		return NULL;
+	}
+
+	MemoryContextSetParent(entryContext, MetadataCacheContext);
+
+	entry->context = entryContext;
+	entry->size = entrySize;
+	entry->relationId = InvalidOid;
+	entry->skipList = NULL;
+	entry->stripeList = NULL;
+	dlist_push_head(&MetadataCacheLRUList, &entry->lruNode);
+	if (key->kind == METADATA_CACHE_STRIPE_LIST)
+	{
+		dlist_push_head(&StripeListEntryList, &entry->stripeListNode);
+	}
+	MetadataCacheUsedSize += entrySize;
+
+	return entry;
+}
+
+
+/*
+ * CopyStripeSkipList returns a copy of the given skip list in the current
+ * memory context.
+ */
+static StripeSkipList *
+CopyStripeSkipList(StripeSkipList *skipList, TupleDesc tupleDescriptor)
+{
+	uint32 columnCount = skipList->columnCount;
+	uint32 chunkCount = skipList->chunkCount;
+	Size chunkArraySize = chunkCount * sizeof(ColumnChunkSkipNode);
+
+	StripeSkipList *skipListCopy = palloc0(sizeof(StripeSkipList));
+	skipListCopy->columnCount = columnCount;
+	skipListCopy->chunkCount = chunkCount;
+	skipListCopy->chunkSkipNodeArray = palloc0(columnCount *
+											   sizeof(ColumnChunkSkipNode *));
+
+	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
+		ColumnChunkSkipNode *chunkArray = skipList->chunkSkipNodeArray[columnIndex];
+		ColumnChunkSkipNode *chunkArrayCopy = palloc0(chunkArraySize);
+
+		memcpy_s(chunkArrayCopy, chunkArraySize, chunkArray, chunkArraySize);
+
+		for (uint32 chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+		{
+			ColumnChunkSkipNode *chunk = &chunkArrayCopy[chunkIndex];
+
+			if (chunk->hasMinMax)
+			{
+				chunk->minimumValue = datumCopy(chunk->minimumValue,
+												attributeForm->attbyval,
+												attributeForm->attlen);
+				chunk->maximumValue = datumCopy(chunk->maximumValue,
+												attributeForm->attbyval,
+												attributeForm->attlen);
+			}
+
+			if (chunk->bloomFilter != NULL)
+			{
+				chunk->bloomFilter =
+					DatumGetByteaPCopy(PointerGetDatum(chunk->bloomFilter));
+			}
+		}
+
+		skipListCopy->chunkSkipNodeArray[columnIndex] = chunkArrayCopy;
+	}
+
+	Size rowCountsSize = chunkCount * sizeof(uint32);
+	skipListCopy->chunkGroupRowCounts = palloc0(rowCountsSize);
+	memcpy_s(skipListCopy->chunkGroupRowCounts, rowCountsSize,
+			 skipList->chunkGroupRowCounts, rowCountsSize);
+
+	return skipListCopy;
+}
+
+
+/*
+ * CompareTransactionIdsNewestFirst is a qsort_arg comparator that orders
+ * transaction ids from the newest to the oldest.
+ */
+static int
+CompareTransactionIdsNewestFirst(const void *left, const void *right, void *arg)
+{
+	TransactionId leftXid = *((const TransactionId *) left);
+	TransactionId rightXid = *((const TransactionId *) right);
+
+	if (TransactionIdEquals(leftXid, rightXid))
+	{
+		return 0;
+	}
+
+	return TransactionIdPrecedes(leftXid, rightXid) ? 1 : -1;
+}
+
+
+/*
+ * MetadataCacheSizeLimit converts the given cache size in kilobytes to bytes.
+ */
+static Size
+MetadataCacheSizeLimit(int cacheSizeKB)
+{
+	return (Size) cacheSizeKB * 1024;
+}
+
+
+/*
+ * CreateMetadataCache creates the memory context and the hash table of the
+ * cache. The cache lives until the end of the backend.
+ */
+static void
+CreateMetadataCache(void)
+{
+	MetadataCacheContext = AllocSetContextCreate(TopMemoryContext,
+												 "Columnar Metadata Cache Context",
+												 ALLOCSET_DEFAULT_SIZES);
+
+	HASHCTL info;
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(MetadataCacheKey);
+	info.entrysize = sizeof(MetadataCacheEntry);
+	info.hcxt = MetadataCacheContext;
+
+	MetadataCacheHash = hash_create("columnar metadata cache", 256, &info,
+									HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	dlist_init(&MetadataCacheLRUList);
+	dlist_init(&StripeListEntryList);
+	MetadataCacheUsedSize = 0;
+}
+
+
+/*
+ * ReleaseMetadataCache frees all memory used by the cache. Evictions are
+ * counted so that the counters stay consistent with the number of cached
+ * entries.
+ */
+static void
+ReleaseMetadataCache(void)
+{
+	MetadataCacheEvictions += hash_get_num_entries(MetadataCacheHash);
+
+	MemoryContextDelete(MetadataCacheContext);
+	MetadataCacheContext = NULL;
+	MetadataCacheHash = NULL;
+	dlist_init(&MetadataCacheLRUList);
+	dlist_init(&StripeListEntryList);
+	MetadataCacheUsedSize = 0;
+}
+
+
+/*
+ * EnforceMetadataCacheLimit evicts the least recently used entries until the
+ * cache uses at most sizeLimit bytes.
+ */
+static void
+EnforceMetadataCacheLimit(Size sizeLimit)
+{
+	while (MetadataCacheUsedSize > sizeLimit &&
+		   !dlist_is_empty(&MetadataCacheLRUList))
+	{
+		MetadataCacheEntry *entry = dlist_tail_element(MetadataCacheEntry, lruNode,
+													   &MetadataCacheLRUList);
+		RemoveMetadataCacheEntry(entry);
+		MetadataCacheEvictions++;
+	}
+}
+
+
+/*
+ * RemoveMetadataCacheEntry removes the given entry from the cache and frees
+ * its data.
+ */
+static void
+RemoveMetadataCacheEntry(MetadataCacheEntry *entry)
+{
+	MetadataCacheUsedSize -= entry->size;
+	dlist_delete(&entry->lruNode);
+
+	if (entry->key.kind == METADATA_CACHE_STRIPE_LIST)
+	{
+		dlist_delete(&entry->stripeListNode);
+	}
+
+	MemoryContextDelete(entry->context);
+
+	hash_search(MetadataCacheHash, &entry->key, HASH_REMOVE, NULL);
+}
+
+
+/*
+ * InvalidateMetadataCacheRelcacheCallback removes the cached stripe list of
+ * the invalidated relation, or all cached stripe lists if relationId is
+ * InvalidOid. Skip lists never become stale, so they are kept.
+ */
+static void
+InvalidateMetadataCacheRelcacheCallback(Datum argument, Oid relationId)
+{
+	if (MetadataCacheHash == NULL)
+	{
+		return;
+	}
+
+	dlist_mutable_iter iter;
+	dlist_foreach_modify(iter, &StripeListEntryList)
+	{
+		MetadataCacheEntry *entry = dlist_container(MetadataCacheEntry,
+													stripeListNode, iter.cur);
+
+		if (relationId == InvalidOid || entry->relationId == relationId)
+		{
+			RemoveMetadataCacheEntry(entry);
+		}
+	}
+}
+
+
+/*
+ * columnar_metadata_cache_stats returns the hit, miss and eviction counters of
+ * the metadata cache of the current backend, together with the number of
+ * entries and the memory they use.
+ */
+Datum
+columnar_metadata_cache_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc tupleDescriptor = NULL;
+	if (get_call_result_type(fcinfo, NULL, &tupleDescriptor) != TYPEFUNC_COMPOSITE)
+	{
+		elog(ERROR, "return type must be a row type");
+	}
+
+	int64 entryCount = 0;
+	if (MetadataCacheHash != NULL)
+	{
+		entryCount = hash_get_num_entries(MetadataCacheHash);
+	}
+
+	bool nulls[5] = { false };
+	Datum values[5] = {
+		Int64GetDatum(MetadataCacheHits),
+		Int64GetDatum(MetadataCacheMisses),
+		Int64GetDatum(MetadataCacheEvictions),
+		Int64GetDatum(entryCount),
+		Int64GetDatum((int64) MetadataCacheUsedSize)
+	};
+
+	HeapTuple tuple = heap_form_tuple(tupleDescriptor, values, nulls);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(tuple));
+}
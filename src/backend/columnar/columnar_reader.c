@@ -16,6 +16,7 @@
 
 #include "postgres.h"
 
+#include "miscadmin.h"
 #include "safe_lib.h"
 
 #include "access/nbtree.h"
@@ -34,8 +35,10 @@
 #include "utils/rel.h"
 
 #include "columnar/columnar.h"
+#include "columnar/columnar_bloom.h"
 #include "columnar/columnar_storage.h"
 #include "columnar/columnar_tableam.h"
+#include "columnar/columnar_vector.h"
 #include "columnar/columnar_version_compat.h"
 
 #include "distributed/listutils.h"
@@ -51,6 +54,13 @@ typedef struct ChunkGroupReadState
 	int columnCount;
 	List *projectedColumnList;  /* borrowed reference */
 	ChunkData *chunkGroupData;
+
+	/*
+	 * Integer list of attribute numbers (1-indexed) for projected columns
+	 * that are not deserialized into chunkGroupData yet, see
+	 * ColumnarReadMaterializeBatch.
+	 */
+	List *pendingColumnList;
 } ChunkGroupReadState;
 
 typedef struct StripeReadState
@@ -65,9 +75,66 @@ typedef struct StripeReadState
 	MemoryContext stripeReadContext;
 	StripeBuffers *stripeBuffers;   /* allocated in stripeReadContext */
 	List *projectedColumnList;      /* borrowed reference */
+	List *filterColumnList;         /* borrowed reference */
 	ChunkGroupReadState *chunkGroupReadState; /* owned */
+
+	/*
+	 * Only set when reading rows for a bitmap heap scan, see
+	 * ColumnarReadBitmapRow. Then stripeBuffers only hold the chunk group
+	 * being read and are allocated in chunkGroupReadContext.
+	 */
+	StripeSkipList *stripeSkipList;
+	MemoryContext chunkGroupReadContext;
 } StripeReadState;
 
+/*
+ * ChunkReadAhead tracks the prefetch requests issued for the chunks of a
+ * stripe. Chunks are read in the order they are laid out in the stripe, so
+ * while reading a chunk, we keep prefetching the chunks that come after it
+ * until we are columnar_prefetch_depth blocks ahead of it.
+ */
+typedef struct ChunkReadAhead
+{
+	Relation relation;
+
+	/* logical ranges of the chunks to be read, in the order they are read */
+	uint64 *rangeOffsets;
+	uint64 *rangeLengths;
+	uint32 rangeCount;
+
+	/* index of the first range that is not completely prefetched yet */
+	uint32 nextRangeIndex;
+
+	/* logical offset up to which prefetch requests are issued */
+	uint64 prefetchedOffset;
+} ChunkReadAhead;
+
+/*
+ * ChunkGroupFilter holds what SelectedChunkMask needs to filter the chunk
+ * groups of a stripe. None of it depends on the stripe being read, so it is
+ * built once per scan rather than for every stripe.
+ */
+typedef struct ChunkGroupFilter
+{
+	List *whereClauseList;
+	List *whereClauseVars;
+
+	/* equality quals that are checked against the bloom filters */
+	List *bloomQualList;
+
+	/* simple comparisons that are checked against the min/max values */
+	List *fastPathQualList;
+	bool allQualsConverted;
+
+	/*
+	 * Base constraints of the columns that have a comparator, along with the
+	 * indexes of those columns. These are only built if some quals can't take
+	 * the fast path, and are then refuted via predicate_refuted_by.
+	 */
+	List *baseConstraintList;
+	List *constraintColumnIndexList;
+} ChunkGroupFilter;
+
 struct ColumnarReadState
 {
 	TupleDesc tupleDescriptor;
@@ -82,12 +149,27 @@ struct ColumnarReadState
 	 */
 	List *projectedColumnList;
 
-	List *whereClauseList;
-	List *whereClauseVars;
+	ChunkGroupFilter *chunkGroupFilter;
+
+	/*
+	 * Integer list of attribute numbers (1-indexed) for projected columns
+	 * that are referenced by the scan quals. When reading batches, only
+	 * these are deserialized upfront, see ColumnarReadMaterializeBatch. NIL
+	 * if deserializing them first wouldn't save us anything.
+	 */
+	List *filterColumnList;
 
 	MemoryContext stripeReadContext;
 	int64 chunkGroupsFiltered;
 
+	/*
+	 * If restrictedToStripeList is true, then only the stripes in
+	 * stripeReadList are read, see ColumnarReadSetStripeList. The stripes
+	 * are removed from the list as they are read.
+	 */
+	bool restrictedToStripeList;
+	List *stripeReadList;
+
 	/*
 	 * Memory context guaranteed to be not freed during scan so we can
 	 * safely use for any memory allocations regarding ColumnarReadState
@@ -97,6 +179,32 @@ struct ColumnarReadState
 
 	Snapshot snapshot;
 	bool snapshotRegisteredByUs;
+
+	/*
+	 * Shared state of a parallel scan, NULL if not doing a parallel scan.
+	 * Stripes are claimed through it so that each stripe is read by exactly
+	 * one of the participants.
+	 */
+	ParallelColumnarScanDesc parallelScan;
+
+	/*
+	 * Skip list of the stripe with readAheadStripeId, read by
+	 * ReadAheadNextStripe and allocated in readAheadContext. NULL if we
+	 * didn't read ahead.
+	 */
+	MemoryContext readAheadContext;
+	uint64 readAheadStripeId;
+	StripeSkipList *readAheadSkipList;
+
+	/* see ColumnarReadSetChunkGroupCallback */
+	ColumnarChunkGroupCallback chunkGroupCallback;
+	void *chunkGroupCallbackArg;
+
+	/*
+	 * Set by ColumnarReadBitmapRow when it finds out that there are no
+	 * visible rows between the requested row number and this one.
+	 */
+	uint64 bitmapMissingRowsEnd;
 };
 
 /* static function declarations */
@@ -107,6 +215,13 @@ static StripeMetadata * ColumnarReadGetCurrentStripe(ColumnarReadState *readStat
 static void ReadStripeRowByRowNumber(ColumnarReadState *readState,
 									 uint64 rowNumber, Datum *columnValues,
 									 bool *columnNulls);
+static StripeReadState * BeginBitmapStripeRead(ColumnarReadState *readState,
+											   StripeMetadata *stripeMetadata);
+static void BeginBitmapChunkGroupRead(ColumnarReadState *readState,
+									  int chunkGroupIndex);
+static bool IsOtherChunkGroup(StripeMetadata *stripeMetadata,
+							  StripeSkipList *stripeSkipList,
+							  uint32 chunkGroupIndex, void *callbackArg);
 static bool StripeReadIsCurrentChunkGroup(StripeReadState *stripeReadState,
 										  int chunkGroupIndex);
 static void ReadChunkGroupRowByRowOffset(ChunkGroupReadState *chunkGroupReadState,
@@ -117,10 +232,17 @@ static bool StripeReadInProgress(ColumnarReadState *readState);
 static bool HasUnreadStripe(ColumnarReadState *readState);
 static StripeReadState * BeginStripeRead(StripeMetadata *stripeMetadata, Relation rel,
 										 TupleDesc tupleDesc, List *projectedColumnList,
-										 List *whereClauseList, List *whereClauseVars,
+										 List *filterColumnList,
+										 ChunkGroupFilter *chunkGroupFilter,
 										 MemoryContext stripeReadContext,
-										 Snapshot snapshot);
+										 Snapshot snapshot, StripeSkipList *stripeSkipList,
+										 ColumnarChunkGroupCallback chunkGroupCallback,
+										 void *chunkGroupCallbackArg);
 static void AdvanceStripeRead(ColumnarReadState *readState);
+static void ReadAheadNextStripe(ColumnarReadState *readState);
+static StripeSkipList * ReadAheadSkipList(ColumnarReadState *readState);
+static StripeMetadata * FindNextStripeToRead(ColumnarReadState *readState,
+											 uint64 rowNumber);
 static bool SnapshotMightSeeUnflushedStripes(Snapshot snapshot);
 static bool ReadStripeNextRow(StripeReadState *stripeReadState, Datum *columnValues,
 							  bool *columnNulls);
@@ -128,6 +250,7 @@ static ChunkGroupReadState * BeginChunkGroupRead(StripeBuffers *stripeBuffers, i
 												 chunkIndex,
 												 TupleDesc tupleDesc,
 												 List *projectedColumnList,
+												 List *filterColumnList,
 												 MemoryContext cxt);
 static void EndChunkGroupRead(ChunkGroupReadState *chunkGroupReadState);
 static bool ReadChunkGroupNextRow(ChunkGroupReadState *chunkGroupReadState,
@@ -137,19 +260,44 @@ static StripeBuffers * LoadFilteredStripeBuffers(Relation relation,
 												 StripeMetadata *stripeMetadata,
 												 TupleDesc tupleDescriptor,
 												 List *projectedColumnList,
-												 List *whereClauseList,
-												 List *whereClauseVars,
+												 ChunkGroupFilter *chunkGroupFilter,
 												 int64 *chunkGroupsFiltered,
-												 Snapshot snapshot);
+												 Snapshot snapshot,
+												 StripeSkipList *stripeSkipList,
+												 ColumnarChunkGroupCallback
+												 chunkGroupCallback,
+												 void *chunkGroupCallbackArg);
 static ColumnBuffers * LoadColumnBuffers(Relation relation,
 										 ColumnChunkSkipNode *chunkSkipNodeArray,
 										 uint32 chunkCount, uint64 stripeOffset,
-										 Form_pg_attribute attributeForm);
+										 Form_pg_attribute attributeForm,
+										 ChunkReadAhead *readAhead,
+										 ColumnarChunkCacheKey *chunkCacheKeys);
+static ColumnarChunkCacheKey * BuildChunkCacheKeys(uint64 storageId, uint64 stripeId,
+												   uint32 columnIndex,
+												   bool *selectedChunkMask,
+												   uint32 chunkCount,
+												   uint32 selectedChunkCount);
+static ChunkReadAhead * BuildChunkReadAhead(Relation relation,
+											StripeMetadata *stripeMetadata,
+											StripeSkipList *selectedChunkSkipList,
+											bool *projectedColumnMask);
+static void AdvanceChunkReadAhead(ChunkReadAhead *readAhead, uint64 readOffset);
+static ChunkGroupFilter * BuildChunkGroupFilter(List *whereClauseList,
+												TupleDesc tupleDescriptor);
+static void SelectChunksUsingBloomFilters(StripeSkipList *stripeSkipList,
+										  List *bloomQualList,
+										  bool *selectedChunkMask,
+										  int64 *chunkGroupsFiltered);
+static void SelectChunksUsingFastPath(StripeSkipList *stripeSkipList,
+									  List *fastPathQualList, bool *selectedChunkMask,
+									  int64 *chunkGroupsFiltered);
 static bool * SelectedChunkMask(StripeSkipList *stripeSkipList,
-								List *whereClauseList, List *whereClauseVars,
+								ChunkGroupFilter *chunkGroupFilter,
 								int64 *chunkGroupsFiltered);
 static Node * BuildBaseConstraint(Var *variable);
 static List * GetClauseVars(List *clauses, int natts);
+static List * FilterColumnList(List *projectedColumnList, List *whereClauseVars);
 static OpExpr * MakeOpExpression(Var *variable, int16 strategyNumber);
 static Oid GetOperatorByType(Oid typeId, Oid accessMethodId, int16 strategyNumber);
 static void UpdateConstraint(Node *baseConstraint, Datum minValue, Datum maxValue);
@@ -158,15 +306,19 @@ static StripeSkipList * SelectedChunkSkipList(StripeSkipList *stripeSkipList,
 											  bool *selectedChunkMask);
 static uint32 StripeSkipListRowCount(StripeSkipList *stripeSkipList);
 static bool * ProjectedColumnMask(uint32 columnCount, List *projectedColumnList);
-static void DeserializeBoolArray(StringInfo boolArrayBuffer, bool *boolArray,
+static bool DeserializeBoolArray(StringInfo boolArrayBuffer, bool *boolArray,
 								 uint32 boolArrayLength);
 static void DeserializeDatumArray(StringInfo datumBuffer, bool *existsArray,
-								  uint32 datumCount, bool datumTypeByValue,
-								  int datumTypeLength, char datumTypeAlign,
-								  Datum *datumArray);
+								  bool allExist, uint32 datumCount,
+								  bool datumTypeByValue, int datumTypeLength,
+								  char datumTypeAlign, Datum *datumArray);
+static bool IsPackedDatumArray(Form_pg_attribute attributeForm);
+static void DeserializeChunkColumns(StripeBuffers *stripeBuffers, uint64 chunkIndex,
+									TupleDesc tupleDescriptor, List *columnList,
+									ChunkData *chunkData);
 static ChunkData * DeserializeChunkData(StripeBuffers *stripeBuffers, uint64 chunkIndex,
 										uint32 rowCount, TupleDesc tupleDescriptor,
-										List *projectedColumnList);
+										List *columnList);
 static Datum ColumnDefaultValue(TupleConstr *tupleConstraints,
 								Form_pg_attribute attributeForm);
 
@@ -175,12 +327,15 @@ static Datum ColumnDefaultValue(TupleConstr *tupleConstraints,
  * read handle that's used during reading rows and finishing the read operation.
  *
  * projectedColumnList is an integer list of attribute numbers (1-indexed).
+ *
+ * If parallelScan is not NULL, then the stripes to read are claimed from the
+ * given shared state, see FindNextStripeToRead.
  */
 ColumnarReadState *
 ColumnarBeginRead(Relation relation, TupleDesc tupleDescriptor,
 				  List *projectedColumnList, List *whereClauseList,
 				  MemoryContext scanContext, Snapshot snapshot,
-				  bool randomAccess)
+				  bool randomAccess, ParallelColumnarScanDesc parallelScan)
 {
 	/*
 	 * We allocate all stripe specific data in the stripeReadContext, and reset
@@ -192,13 +347,23 @@ ColumnarBeginRead(Relation relation, TupleDesc tupleDescriptor,
 	ColumnarReadState *readState = palloc0(sizeof(ColumnarReadState));
 	readState->relation = relation;
 	readState->projectedColumnList = projectedColumnList;
-	readState->whereClauseList = whereClauseList;
-	readState->whereClauseVars = GetClauseVars(whereClauseList, tupleDescriptor->natts);
+	readState->chunkGroupFilter = BuildChunkGroupFilter(whereClauseList,
+														tupleDescriptor);
+	readState->filterColumnList =
+		FilterColumnList(projectedColumnList,
+						 readState->chunkGroupFilter->whereClauseVars);
 	readState->chunkGroupsFiltered = 0;
 	readState->tupleDescriptor = tupleDescriptor;
 	readState->stripeReadContext = stripeReadContext;
 	readState->stripeReadState = NULL;
 	readState->scanContext = scanContext;
+	readState->parallelScan = parallelScan;
+	readState->readAheadContext = AllocSetContextCreate(CurrentMemoryContext,
+														"Columnar Read Ahead Context",
+														ALLOCSET_DEFAULT_SIZES);
+	readState->readAheadSkipList = NULL;
+	readState->chunkGroupCallback = NULL;
+	readState->chunkGroupCallbackArg = NULL;
 
 	/*
 	 * Note that ColumnarReadFlushPendingWrites might update those two by
@@ -214,7 +379,30 @@ ColumnarBeginRead(Relation relation, TupleDesc tupleDescriptor,
 		 * pending writes until we need to read them.
 		 * columnar_index_fetch_tuple would do so when needed.
 		 */
-		ColumnarReadFlushPendingWrites(readState);
+		if (parallelScan == NULL)
+		{
+			ColumnarReadFlushPendingWrites(readState);
+		}
+		else
+		{
+			/*
+			 * Flushing requires a command counter increment, which is not
+			 * allowed in parallel mode. The planner doesn't consider parallel
+			 * scans for such relations, but the pending writes might have
+			 * been made after the plan was built (e.g.: by a cursor).
+			 */
+			RelFileNumber relfilenumber = RelationPhysicalIdentifierNumber_compat(
+				RelationPhysicalIdentifier_compat(relation));
+			if (PendingWritesInUpperTransactions(relfilenumber,
+												 InvalidSubTransactionId))
+			{
+				ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+								errmsg("cannot read pending writes to columnar "
+									   "table \"%s\" in a parallel scan",
+									   RelationGetRelationName(relation)),
+								errhint("Try disabling columnar.enable_parallel_scan.")));
+			}
+		}
 
 		/*
 		 * AdvanceStripeRead sets currentStripeMetadata for the first stripe
@@ -337,10 +525,14 @@ ColumnarReadNextRow(ColumnarReadState *readState, Datum *columnValues, bool *col
 														 readState->relation,
 														 readState->tupleDescriptor,
 														 readState->projectedColumnList,
-														 readState->whereClauseList,
-														 readState->whereClauseVars,
+														 readState->filterColumnList,
+														 readState->chunkGroupFilter,
 														 readState->stripeReadContext,
-														 readState->snapshot);
+														 readState->snapshot,
+														 ReadAheadSkipList(readState),
+														 readState->chunkGroupCallback,
+														 readState->chunkGroupCallbackArg);
+			ReadAheadNextStripe(readState);
 		}
 
 		if (!ReadStripeNextRow(readState->stripeReadState, columnValues, columnNulls))
@@ -362,6 +554,279 @@ ColumnarReadNextRow(ColumnarReadState *readState, Datum *columnValues, bool *col
 }
 
 
+/*
+ * ColumnarReadNextBatch hands out the unread rows of the next chunk group as
+ * a whole rather than row by row. On success, it fills in the given batch and
+ * returns true. If there are no more rows to read, the function returns false.
+ *
+ * The chunk group referenced by the batch is owned by the read state and is
+ * only valid until the next call on the same read state.
+ */
+bool
+ColumnarReadNextBatch(ColumnarReadState *readState, ColumnarBatch *batch)
+{
+	while (true)
+	{
+		if (!StripeReadInProgress(readState))
+		{
+			if (!HasUnreadStripe(readState))
+			{
+				return false;
+			}
+
+			readState->stripeReadState = BeginStripeRead(readState->currentStripeMetadata,
+														 readState->relation,
+														 readState->tupleDescriptor,
+														 readState->projectedColumnList,
+														 readState->filterColumnList,
+														 readState->chunkGroupFilter,
+														 readState->stripeReadContext,
+														 readState->snapshot,
+														 ReadAheadSkipList(readState),
+														 readState->chunkGroupCallback,
+														 readState->chunkGroupCallbackArg);
+			ReadAheadNextStripe(readState);
+		}
+
+		StripeReadState *stripeReadState = readState->stripeReadState;
+		if (stripeReadState->currentRow >= stripeReadState->rowCount)
+		{
+			AdvanceStripeRead(readState);
+			continue;
+		}
+
+		ChunkGroupReadState *chunkGroupReadState = stripeReadState->chunkGroupReadState;
+		if (chunkGroupReadState != NULL &&
+			chunkGroupReadState->currentRow >= chunkGroupReadState->rowCount)
+		{
+			/* previous batch consumed this chunk group, fetch the next one */
+			EndChunkGroupRead(chunkGroupReadState);
+			stripeReadState->chunkGroupReadState = NULL;
+			stripeReadState->chunkGroupIndex++;
+		}
+
+		if (stripeReadState->chunkGroupReadState == NULL)
+		{
+			/*
+			 * Only deserialize the filter columns for now, the caller asks
+			 * for the rest via ColumnarReadMaterializeBatch if any of the
+			 * rows pass the filter.
+			 */
+			stripeReadState->chunkGroupReadState =
+				BeginChunkGroupRead(stripeReadState->stripeBuffers,
+									stripeReadState->chunkGroupIndex,
+									stripeReadState->tupleDescriptor,
+									stripeReadState->projectedColumnList,
+									stripeReadState->filterColumnList,
+									stripeReadState->stripeReadContext);
+		}
+
+		chunkGroupReadState = stripeReadState->chunkGroupReadState;
+
+		batch->chunkData = chunkGroupReadState->chunkGroupData;
+		batch->materialized = (chunkGroupReadState->pendingColumnList == NIL);
+		batch->projectedColumnList = chunkGroupReadState->projectedColumnList;
+		batch->startRow = chunkGroupReadState->currentRow;
+		batch->rowCount = chunkGroupReadState->rowCount;
+		batch->firstRowNumber = readState->currentStripeMetadata->firstRowNumber +
+								stripeReadState->currentRow;
+
+		/* the whole chunk group is consumed by the caller */
+		stripeReadState->currentRow += chunkGroupReadState->rowCount -
+									   chunkGroupReadState->currentRow;
+		chunkGroupReadState->currentRow = chunkGroupReadState->rowCount;
+
+		return true;
+	}
+
+	return false;
+}
+
+
+/*
+ * ColumnarReadSetChunkGroupCallback sets a callback that is called for each
+ * chunk group that passes the skip list checks of the scan quals, right before
+ * the stripe that contains it is read. The chunk groups for which the callback
+ * returns true are skipped as if they were filtered out, but they are not
+ * counted as filtered.
+ *
+ * This allows callers that only need aggregates of the rows to use the skip
+ * nodes of chunk groups instead of their values where possible.
+ */
+void
+ColumnarReadSetChunkGroupCallback(ColumnarReadState *readState,
+								  ColumnarChunkGroupCallback callback,
+								  void *callbackArg)
+{
+	readState->chunkGroupCallback = callback;
+	readState->chunkGroupCallbackArg = callbackArg;
+}
+
+
+/*
+ * ColumnarReadSetStripeList restricts the read to the given list of flushed
+ * stripes, which are then read in the order they are listed. This allows
+ * reading the rows of a few stripes sequentially, rather than one by one via
+ * ColumnarReadRowByRowNumber. It should be called on a read state that was
+ * begun for random access, before any rows are read.
+ */
+void
+ColumnarReadSetStripeList(ColumnarReadState *readState, List *stripeList)
+{
+	Assert(readState->currentStripeMetadata == NULL);
+
+	MemoryContext oldContext = MemoryContextSwitchTo(readState->scanContext);
+
+	readState->restrictedToStripeList = true;
+	readState->stripeReadList = list_copy(stripeList);
+
+	MemoryContextSwitchTo(oldContext);
+
+	/* set currentStripeMetadata for the first stripe to read */
+	AdvanceStripeRead(readState);
+}
+
+
+/*
+ * ColumnarReadMaterializeBatch deserializes the projected columns of the
+ * given batch that ColumnarReadNextBatch left out, i.e., the ones that are
+ * not referenced by the scan quals. Callers are expected to call this only
+ * if some rows of the batch pass the quals, so we don't decompress and
+ * deserialize the rest of the columns for chunk groups that are filtered
+ * out entirely.
+ *
+ * The batch must be the last one returned by ColumnarReadNextBatch on the
+ * same read state.
+ */
+void
+ColumnarReadMaterializeBatch(ColumnarReadState *readState, ColumnarBatch *batch)
+{
+	if (batch->materialized)
+	{
+		return;
+	}
+
+	StripeReadState *stripeReadState = readState->stripeReadState;
+	ChunkGroupReadState *chunkGroupReadState = stripeReadState->chunkGroupReadState;
+
+	Assert(chunkGroupReadState->chunkGroupData == batch->chunkData);
+
+	MemoryContext oldContext =
+		MemoryContextSwitchTo(stripeReadState->stripeReadContext);
+
+	DeserializeChunkColumns(stripeReadState->stripeBuffers,
+							stripeReadState->chunkGroupIndex,
+							stripeReadState->tupleDescriptor,
+							chunkGroupReadState->pendingColumnList,
+							chunkGroupReadState->chunkGroupData);
+
+	MemoryContextSwitchTo(oldContext);
+
+	chunkGroupReadState->pendingColumnList = NIL;
+	batch->materialized = true;
+}
+
+
+/*
+ * ColumnarBatchGetRow fills in columnValues and columnNulls for the row at
+ * rowIndex of the given batch. Only projected columns are set, the others
+ * are left as NULL.
+ */
+void
+ColumnarBatchGetRow(ColumnarBatch *batch, uint32 rowIndex, Datum *columnValues,
+					bool *columnNulls)
+{
+	const ChunkData *chunkData = batch->chunkData;
+
+	Assert(batch->materialized);
+	Assert(rowIndex >= batch->startRow && rowIndex < batch->rowCount);
+
+	memset(columnNulls, true, sizeof(bool) * chunkData->columnCount);
+
+	int attno;
+	foreach_declared_int(attno, batch->projectedColumnList)
+	{
+		/* attno is 1-indexed; existsArray is 0-indexed */
+		const uint32 columnIndex = attno - 1;
+
+		if (chunkData->existsArray[columnIndex][rowIndex])
+		{
+			columnValues[columnIndex] = chunkData->valueArray[columnIndex][rowIndex];
+			columnNulls[columnIndex] = false;
+		}
+	}
+}
+
+
+/*
+ * ColumnarReadAllRows calls the given callback for each row of the relation
+ * that is visible to the given snapshot. Unlike a table scan, it reads the
+ * table a chunk group at a time and hands out the deserialized column values
+ * directly, so bulk exports don't have to go through a tuple slot per row.
+ *
+ * Dropped and stored generated columns are not read and are passed to the
+ * callback as NULLs. Returns the number of rows read.
+ */
+uint64
+ColumnarReadAllRows(Relation relation, Snapshot snapshot,
+					ColumnarRowCallback callback, void *callbackArg)
+{
+	TupleDesc tupleDescriptor = RelationGetDescr(relation);
+	List *projectedColumnList = NIL;
+
+	for (int columnIndex = 0; columnIndex < tupleDescriptor->natts; columnIndex++)
+	{
+		Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
+		if (attributeForm->attisdropped ||
+			attributeForm->attgenerated == ATTRIBUTE_GENERATED_STORED)
+		{
+			continue;
+		}
+
+		projectedColumnList = lappend_int(projectedColumnList, columnIndex + 1);
+	}
+
+	MemoryContext scanContext = AllocSetContextCreate(CurrentMemoryContext,
+													  "Columnar Export Context",
+													  ALLOCSET_DEFAULT_SIZES);
+	MemoryContext oldContext = MemoryContextSwitchTo(scanContext);
+
+	Datum *columnValues = palloc0(tupleDescriptor->natts * sizeof(Datum));
+	bool *columnNulls = palloc0(tupleDescriptor->natts * sizeof(bool));
+
+	List *whereClauseList = NIL;
+	bool randomAccess = false;
+	ColumnarReadState *readState = ColumnarBeginRead(relation, tupleDescriptor,
+													 projectedColumnList,
+													 whereClauseList, scanContext,
+													 snapshot, randomAccess, NULL);
+
+	MemoryContextSwitchTo(oldContext);
+
+	uint64 rowCount = 0;
+	ColumnarBatch batch;
+	while (ColumnarReadNextBatch(readState, &batch))
+	{
+		ColumnarReadMaterializeBatch(readState, &batch);
+
+		for (uint32 rowIndex = batch.startRow; rowIndex < batch.rowCount; rowIndex++)
+		{
+			ColumnarBatchGetRow(&batch, rowIndex, columnValues, columnNulls);
+			callback(columnValues, columnNulls, callbackArg);
+		}
+
+		rowCount += batch.rowCount - batch.startRow;
+
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	ColumnarEndRead(readState);
+	MemoryContextDelete(scanContext);
+
+	return rowCount;
+}
+
+
 /*
  * ColumnarReadRowByRowNumberOrError is a wrapper around
  * ColumnarReadRowByRowNumber that throws an error if tuple
@@ -421,17 +886,17 @@ ColumnarReadRowByRowNumber(ColumnarReadState *readState,
 		ColumnarResetRead(readState);
 
 		TupleDesc relationTupleDesc = RelationGetDescr(columnarRelation);
-		List *whereClauseList = NIL;
-		List *whereClauseVars = NIL;
+		ChunkGroupFilter *chunkGroupFilter = NULL;
+		List *filterColumnList = NIL;
 		MemoryContext stripeReadContext = readState->stripeReadContext;
 		readState->stripeReadState = BeginStripeRead(stripeMetadata,
 													 columnarRelation,
 													 relationTupleDesc,
 													 readState->projectedColumnList,
-													 whereClauseList,
-													 whereClauseVars,
+													 filterColumnList,
+													 chunkGroupFilter,
 													 stripeReadContext,
-													 snapshot);
+													 snapshot, NULL, NULL, NULL);
 
 		readState->currentStripeMetadata = stripeMetadata;
 	}
@@ -442,6 +907,179 @@ ColumnarReadRowByRowNumber(ColumnarReadState *readState,
 }
 
 
+/*
+ * ColumnarReadBitmapRow reads row with rowNumber from given relation into
+ * columnValues and columnNulls, and returns true. If no such row is visible,
+ * then returns false.
+ *
+ * Unlike ColumnarReadRowByRowNumber, this is meant to be used by bitmap heap
+ * scans, which request row numbers in ascending order. For this reason, we
+ * only read the chunk groups that contain requested rows, and each of them
+ * only once, instead of reading the whole stripe upfront. Moreover, we
+ * remember the gaps between the stripes so that looking up the row numbers
+ * that fall into them (e.g.: for lossy bitmap pages) doesn't need stripe
+ * metadata lookups.
+ */
+bool
+ColumnarReadBitmapRow(ColumnarReadState *readState, uint64 rowNumber,
+					  Datum *columnValues, bool *columnNulls)
+{
+	if (!ColumnarReadIsCurrentStripe(readState, rowNumber))
+	{
+		if (rowNumber < readState->bitmapMissingRowsEnd)
+		{
+			return false;
+		}
+
+		Relation columnarRelation = readState->relation;
+		Snapshot snapshot = readState->snapshot;
+		StripeMetadata *stripeMetadata = FindStripeByRowNumber(columnarRelation,
+															   rowNumber, snapshot);
+		if (stripeMetadata == NULL)
+		{
+			StripeMetadata *nextStripeMetadata =
+				FindNextStripeByRowNumber(columnarRelation, rowNumber, snapshot);
+			if (nextStripeMetadata == NULL)
+			{
+				readState->bitmapMissingRowsEnd = COLUMNAR_MAX_ROW_NUMBER;
+			}
+			else
+			{
+				readState->bitmapMissingRowsEnd = nextStripeMetadata->firstRowNumber;
+				pfree(nextStripeMetadata);
+			}
+
+			return false;
+		}
+
+		if (StripeWriteState(stripeMetadata) != STRIPE_WRITE_FLUSHED)
+		{
+			/* caller is expected to flush pending writes before reading */
+			ereport(ERROR, (errmsg(UNEXPECTED_STRIPE_READ_ERR_MSG,
+								   RelationGetRelationName(columnarRelation),
+								   stripeMetadata->id)));
+		}
+
+		/* do the cleanup before reading a new stripe */
+		ColumnarResetRead(readState);
+
+		readState->stripeReadState = BeginBitmapStripeRead(readState, stripeMetadata);
+		readState->currentStripeMetadata = stripeMetadata;
+	}
+
+	StripeMetadata *stripeMetadata = ColumnarReadGetCurrentStripe(readState);
+	StripeReadState *stripeReadState = readState->stripeReadState;
+
+	uint64 stripeRowOffset = rowNumber - stripeMetadata->firstRowNumber;
+	int chunkGroupIndex = stripeRowOffset / stripeMetadata->chunkGroupRowCount;
+	if (!StripeReadIsCurrentChunkGroup(stripeReadState, chunkGroupIndex))
+	{
+		BeginBitmapChunkGroupRead(readState, chunkGroupIndex);
+	}
+
+	ReadChunkGroupRowByRowOffset(stripeReadState->chunkGroupReadState,
+								 stripeMetadata, stripeRowOffset,
+								 columnValues, columnNulls);
+
+	return true;
+}
+
+
+/*
+ * BeginBitmapStripeRead allocates state for reading given stripe via
+ * ColumnarReadBitmapRow. Different than BeginStripeRead, this doesn't load
+ * any chunk groups, see BeginBitmapChunkGroupRead.
+ */
+static StripeReadState *
+BeginBitmapStripeRead(ColumnarReadState *readState, StripeMetadata *stripeMetadata)
+{
+	Relation relation = readState->relation;
+	TupleDesc relationTupleDesc = RelationGetDescr(relation);
+	MemoryContext stripeReadContext = readState->stripeReadContext;
+
+	MemoryContext oldContext = MemoryContextSwitchTo(stripeReadContext);
+
+	StripeReadState *stripeReadState = palloc0(sizeof(StripeReadState));
+
+	stripeReadState->relation = relation;
+	stripeReadState->tupleDescriptor = relationTupleDesc;
+	stripeReadState->columnCount = relationTupleDesc->natts;
+	stripeReadState->rowCount = stripeMetadata->rowCount;
+	stripeReadState->chunkGroupIndex = -1;
+	stripeReadState->chunkGroupReadState = NULL;
+	stripeReadState->projectedColumnList = readState->projectedColumnList;
+	stripeReadState->filterColumnList = NIL;
+	stripeReadState->stripeReadContext = stripeReadContext;
+	stripeReadState->stripeSkipList =
+		ReadStripeSkipList(RelationPhysicalIdentifier_compat(relation),
+						   stripeMetadata->id, relationTupleDesc,
+						   stripeMetadata->chunkCount, readState->snapshot);
+	stripeReadState->chunkGroupReadContext =
+		AllocSetContextCreate(stripeReadContext, "Columnar Chunk Group Read Context",
+							  ALLOCSET_DEFAULT_SIZES);
+
+	MemoryContextSwitchTo(oldContext);
+
+	return stripeReadState;
+}
+
+
+/*
+ * BeginBitmapChunkGroupRead loads the chunk group with given index of the
+ * stripe being read via ColumnarReadBitmapRow, after releasing the one that
+ * was being read.
+ */
+static void
+BeginBitmapChunkGroupRead(ColumnarReadState *readState, int chunkGroupIndex)
+{
+	StripeMetadata *stripeMetadata = ColumnarReadGetCurrentStripe(readState);
+	StripeReadState *stripeReadState = readState->stripeReadState;
+	MemoryContext chunkGroupReadContext = stripeReadState->chunkGroupReadContext;
+
+	stripeReadState->chunkGroupReadState = NULL;
+	stripeReadState->stripeBuffers = NULL;
+	MemoryContextReset(chunkGroupReadContext);
+
+	MemoryContext oldContext = MemoryContextSwitchTo(chunkGroupReadContext);
+
+	/* skip all chunk groups but the requested one */
+	ChunkGroupFilter *chunkGroupFilter = NULL;
+	int64 chunkGroupsFiltered = 0;
+	stripeReadState->stripeBuffers =
+		LoadFilteredStripeBuffers(stripeReadState->relation, stripeMetadata,
+								  stripeReadState->tupleDescriptor,
+								  stripeReadState->projectedColumnList,
+								  chunkGroupFilter,
+								  &chunkGroupsFiltered, readState->snapshot,
+								  stripeReadState->stripeSkipList,
+								  IsOtherChunkGroup, &chunkGroupIndex);
+
+	/* so the requested chunk group is the first one in stripeBuffers */
+	int selectedChunkGroupIndex = 0;
+	stripeReadState->chunkGroupIndex = chunkGroupIndex;
+	stripeReadState->chunkGroupReadState =
+		BeginChunkGroupRead(stripeReadState->stripeBuffers, selectedChunkGroupIndex,
+							stripeReadState->tupleDescriptor,
+							stripeReadState->projectedColumnList, NIL,
+							chunkGroupReadContext);
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * IsOtherChunkGroup is a ColumnarChunkGroupCallback that makes the reader
+ * skip all chunk groups but the one with the index pointed by callbackArg.
+ */
+static bool
+IsOtherChunkGroup(StripeMetadata *stripeMetadata, StripeSkipList *stripeSkipList,
+				  uint32 chunkGroupIndex, void *callbackArg)
+{
+	int requestedChunkGroupIndex = *((int *) callbackArg);
+	return chunkGroupIndex != (uint32) requestedChunkGroupIndex;
+}
+
+
 /*
  * ColumnarReadIsCurrentStripe returns true if stripe being read contains
  * row with given rowNumber.
@@ -511,6 +1149,7 @@ ReadStripeRowByRowNumber(ColumnarReadState *readState,
 			stripeReadState->chunkGroupIndex,
 			stripeReadState->tupleDescriptor,
 			stripeReadState->projectedColumnList,
+			NIL,
 			stripeReadState->stripeReadContext);
 	}
 
@@ -595,7 +1234,12 @@ ColumnarRescan(ColumnarReadState *readState, List *scanQual)
 
 	readState->chunkGroupsFiltered = 0;
 
-	readState->whereClauseList = copyObject(scanQual);
+	/* new quals might reference different columns */
+	readState->chunkGroupFilter = BuildChunkGroupFilter(copyObject(scanQual),
+														readState->tupleDescriptor);
+	readState->filterColumnList =
+		FilterColumnList(readState->projectedColumnList,
+						 readState->chunkGroupFilter->whereClauseVars);
 	MemoryContextSwitchTo(oldContext);
 }
 
@@ -616,6 +1260,7 @@ ColumnarEndRead(ColumnarReadState *readState)
 	}
 
 	MemoryContextDelete(readState->stripeReadContext);
+	MemoryContextDelete(readState->readAheadContext);
 	if (readState->currentStripeMetadata)
 	{
 		pfree(readState->currentStripeMetadata);
@@ -644,12 +1289,19 @@ ColumnarResetRead(ColumnarReadState *readState)
 
 
 /*
- * BeginStripeRead allocates state for reading a stripe.
+ * BeginStripeRead allocates state for reading a stripe. If stripeSkipList is
+ * NULL, then the skip list of the stripe is read from the metadata. If
+ * chunkGroupCallback is not NULL, then the chunk groups it consumes are not
+ * read, see ColumnarReadSetChunkGroupCallback.
  */
 static StripeReadState *
 BeginStripeRead(StripeMetadata *stripeMetadata, Relation rel, TupleDesc tupleDesc,
-				List *projectedColumnList, List *whereClauseList, List *whereClauseVars,
-				MemoryContext stripeReadContext, Snapshot snapshot)
+				List *projectedColumnList, List *filterColumnList,
+				ChunkGroupFilter *chunkGroupFilter,
+				MemoryContext stripeReadContext, Snapshot snapshot,
+				StripeSkipList *stripeSkipList,
+				ColumnarChunkGroupCallback chunkGroupCallback,
+				void *chunkGroupCallbackArg)
 {
 	MemoryContext oldContext = MemoryContextSwitchTo(stripeReadContext);
 
@@ -660,17 +1312,20 @@ BeginStripeRead(StripeMetadata *stripeMetadata, Relation rel, TupleDesc tupleDes
 	stripeReadState->columnCount = tupleDesc->natts;
 	stripeReadState->chunkGroupReadState = NULL;
 	stripeReadState->projectedColumnList = projectedColumnList;
+	stripeReadState->filterColumnList = filterColumnList;
 	stripeReadState->stripeReadContext = stripeReadContext;
 
 	stripeReadState->stripeBuffers = LoadFilteredStripeBuffers(rel,
 															   stripeMetadata,
 															   tupleDesc,
 															   projectedColumnList,
-															   whereClauseList,
-															   whereClauseVars,
+															   chunkGroupFilter,
 															   &stripeReadState->
 															   chunkGroupsFiltered,
-															   snapshot);
+															   snapshot,
+															   stripeSkipList,
+															   chunkGroupCallback,
+															   chunkGroupCallbackArg);
 
 	stripeReadState->rowCount = stripeReadState->stripeBuffers->rowCount;
 
@@ -701,9 +1356,8 @@ AdvanceStripeRead(ColumnarReadState *readState)
 			readState->stripeReadState->chunkGroupsFiltered;
 	}
 
-	readState->currentStripeMetadata = FindNextStripeByRowNumber(readState->relation,
-																 lastReadRowNumber,
-																 readState->snapshot);
+	readState->currentStripeMetadata = FindNextStripeToRead(readState,
+															lastReadRowNumber);
 
 	if (readState->currentStripeMetadata &&
 		StripeWriteState(readState->currentStripeMetadata) != STRIPE_WRITE_FLUSHED &&
@@ -723,9 +1377,8 @@ AdvanceStripeRead(ColumnarReadState *readState)
 		   StripeWriteState(readState->currentStripeMetadata) != STRIPE_WRITE_FLUSHED)
 	{
 		readState->currentStripeMetadata =
-			FindNextStripeByRowNumber(readState->relation,
-									  readState->currentStripeMetadata->firstRowNumber,
-									  readState->snapshot);
+			FindNextStripeToRead(readState,
+								 readState->currentStripeMetadata->firstRowNumber);
 	}
 
 	readState->stripeReadState = NULL;
@@ -735,6 +1388,170 @@ AdvanceStripeRead(ColumnarReadState *readState)
 }
 
 
+/*
+ * ReadAheadNextStripe issues prefetch requests for the first blocks of the
+ * stripe that comes after the current one, so that they are fetched while
+ * the current stripe is being processed. The skip list of the next stripe
+ * is kept in readState so that we don't read it again when we begin reading
+ * that stripe, see ReadAheadSkipList.
+ *
+ * Note that this resets readAheadContext, which is fine since the stripe
+ * buffers of the current stripe don't reference its skip list once loaded.
+ *
+ * We don't read ahead for parallel scans since we don't know which stripe
+ * will be claimed by this participant next. Similarly, we don't read ahead if
+ * there is a chunk group callback, since we don't know which chunk groups it
+ * will consume.
+ */
+static void
+ReadAheadNextStripe(ColumnarReadState *readState)
+{
+	readState->readAheadSkipList = NULL;
+	MemoryContextReset(readState->readAheadContext);
+
+	if (columnar_prefetch_depth == 0 || readState->parallelScan != NULL ||
+		readState->chunkGroupCallback != NULL)
+	{
+		return;
+	}
+
+	MemoryContext oldContext = MemoryContextSwitchTo(readState->readAheadContext);
+
+	StripeMetadata *stripeMetadata = NULL;
+	if (readState->restrictedToStripeList)
+	{
+		if (readState->stripeReadList != NIL)
+		{
+			stripeMetadata = linitial(readState->stripeReadList);
+		}
+	}
+	else
+	{
+		uint64 lastRowNumber =
+			StripeGetHighestRowNumber(readState->currentStripeMetadata);
+		stripeMetadata = FindNextStripeByRowNumber(readState->relation, lastRowNumber,
+												   readState->snapshot);
+	}
+
+	if (stripeMetadata != NULL &&
+		StripeWriteState(stripeMetadata) == STRIPE_WRITE_FLUSHED)
+	{
+		TupleDesc tupleDescriptor = readState->tupleDescriptor;
+		StripeSkipList *stripeSkipList =
+			ReadStripeSkipList(RelationPhysicalIdentifier_compat(readState->relation),
+							   stripeMetadata->id, tupleDescriptor,
+							   stripeMetadata->chunkCount, readState->snapshot);
+
+		/* filtered chunk groups are counted when the stripe is actually read */
+		int64 chunkGroupsFiltered = 0;
+		bool *selectedChunkMask = SelectedChunkMask(stripeSkipList,
+													readState->chunkGroupFilter,
+													&chunkGroupsFiltered);
+		bool *projectedColumnMask = ProjectedColumnMask(tupleDescriptor->natts,
+														readState->projectedColumnList);
+		StripeSkipList *selectedChunkSkipList =
+			SelectedChunkSkipList(stripeSkipList, projectedColumnMask,
+								  selectedChunkMask);
+
+		ChunkReadAhead *readAhead = BuildChunkReadAhead(readState->relation,
+														stripeMetadata,
+														selectedChunkSkipList,
+														projectedColumnMask);
+		if (readAhead->rangeCount > 0)
+		{
+			AdvanceChunkReadAhead(readAhead, readAhead->rangeOffsets[0]);
+		}
+
+		readState->readAheadStripeId = stripeMetadata->id;
+		readState->readAheadSkipList = stripeSkipList;
+	}
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * ReadAheadSkipList returns the skip list of the current stripe if it was
+ * read by ReadAheadNextStripe, or NULL otherwise.
+ */
+static StripeSkipList *
+ReadAheadSkipList(ColumnarReadState *readState)
+{
+	if (readState->readAheadSkipList == NULL ||
+		readState->readAheadStripeId != readState->currentStripeMetadata->id)
+	{
+		return NULL;
+	}
+
+	return readState->readAheadSkipList;
+}
+
+
+/*
+ * FindNextStripeToRead returns the metadata of the stripe that comes after
+ * given row number and that should be read by this scan, or NULL if there is
+ * no such stripe.
+ *
+ * For parallel scans, the stripe is claimed by advancing the shared cursor
+ * from the last claimed stripe to it. If another participant advanced the
+ * cursor in the meantime, then we retry starting from the stripe claimed by
+ * that participant. Since the cursor only moves forward in row number order
+ * and each participant claims the stripe right after the cursor, every
+ * stripe is read by exactly one participant, and rowNumber is ignored.
+ *
+ * If the read is restricted to a list of stripes, then the next stripe in the
+ * list is returned instead.
+ */
+static StripeMetadata *
+FindNextStripeToRead(ColumnarReadState *readState, uint64 rowNumber)
+{
+	if (readState->restrictedToStripeList)
+	{
+		if (readState->stripeReadList == NIL)
+		{
+			return NULL;
+		}
+
+		/* the read state owns the returned metadata, see ColumnarResetRead */
+		StripeMetadata *stripeMetadata = palloc(sizeof(StripeMetadata));
+		*stripeMetadata = *((StripeMetadata *) linitial(readState->stripeReadList));
+		readState->stripeReadList = list_delete_first(readState->stripeReadList);
+
+		return stripeMetadata;
+	}
+
+	ParallelColumnarScanDesc parallelScan = readState->parallelScan;
+	if (parallelScan == NULL)
+	{
+		return FindNextStripeByRowNumber(readState->relation, rowNumber,
+										 readState->snapshot);
+	}
+
+	uint64 lastClaimedRowNumber =
+		pg_atomic_read_u64(&parallelScan->lastClaimedRowNumber);
+	while (true)
+	{
+		StripeMetadata *stripeMetadata =
+			FindNextStripeByRowNumber(readState->relation, lastClaimedRowNumber,
+									  readState->snapshot);
+		if (stripeMetadata == NULL)
+		{
+			return NULL;
+		}
+
+		/* on failure, lastClaimedRowNumber is set to the current value */
+		if (pg_atomic_compare_exchange_u64(&parallelScan->lastClaimedRowNumber,
+										   &lastClaimedRowNumber,
+										   stripeMetadata->firstRowNumber))
+		{
+			return stripeMetadata;
+		}
+
+		pfree(stripeMetadata);
+	}
+}
+
+
 /*
  * SnapshotMightSeeUnflushedStripes returns true if given snapshot is
  * expected to see un-flushed stripes either because of other backends'
@@ -793,6 +1610,7 @@ ReadStripeNextRow(StripeReadState *stripeReadState, Datum *columnValues,
 				tupleDescriptor,
 				stripeReadState->
 				projectedColumnList,
+				NIL,
 				stripeReadState->
 				stripeReadContext);
 		}
@@ -818,10 +1636,15 @@ ReadStripeNextRow(StripeReadState *stripeReadState, Datum *columnValues,
 
 /*
  * BeginChunkGroupRead allocates state for reading a chunk.
+ *
+ * If filterColumnList is not NIL, then only those columns are deserialized
+ * and the rest of the projected columns are left to
+ * ColumnarReadMaterializeBatch.
  */
 static ChunkGroupReadState *
 BeginChunkGroupRead(StripeBuffers *stripeBuffers, int chunkIndex, TupleDesc tupleDesc,
-					List *projectedColumnList, MemoryContext cxt)
+					List *projectedColumnList, List *filterColumnList,
+					MemoryContext cxt)
 {
 	uint32 chunkGroupRowCount =
 		stripeBuffers->selectedChunkGroupRowCounts[chunkIndex];
@@ -835,10 +1658,18 @@ BeginChunkGroupRead(StripeBuffers *stripeBuffers, int chunkIndex, TupleDesc tupl
 	chunkGroupReadState->columnCount = tupleDesc->natts;
 	chunkGroupReadState->projectedColumnList = projectedColumnList;
 
+	List *columnList = projectedColumnList;
+	if (filterColumnList != NIL)
+	{
+		columnList = filterColumnList;
+		chunkGroupReadState->pendingColumnList =
+			list_difference_int(projectedColumnList, filterColumnList);
+	}
+
 	chunkGroupReadState->chunkGroupData = DeserializeChunkData(stripeBuffers, chunkIndex,
 															   chunkGroupRowCount,
 															   tupleDesc,
-															   projectedColumnList);
+															   columnList);
 	MemoryContextSwitchTo(oldContext);
 
 	return chunkGroupReadState;
@@ -874,6 +1705,8 @@ ReadChunkGroupNextRow(ChunkGroupReadState *chunkGroupReadState, Datum *columnVal
 		return false;
 	}
 
+	Assert(chunkGroupReadState->pendingColumnList == NIL);
+
 	/*
 	 * Initialize to all-NULL. Only non-NULL projected attributes will be set.
 	 */
@@ -1002,33 +1835,63 @@ ColumnarTableRowCount(Relation relation)
 /*
  * LoadFilteredStripeBuffers reads serialized stripe data from the given file.
  * The function skips over chunks whose rows are refuted by restriction qualifiers,
- * and only loads columns that are projected in the query.
+ * or that are consumed by chunkGroupCallback, and only loads columns that are
+ * projected in the query.
  */
 static StripeBuffers *
 LoadFilteredStripeBuffers(Relation relation, StripeMetadata *stripeMetadata,
 						  TupleDesc tupleDescriptor, List *projectedColumnList,
-						  List *whereClauseList, List *whereClauseVars,
-						  int64 *chunkGroupsFiltered, Snapshot snapshot)
+						  ChunkGroupFilter *chunkGroupFilter,
+						  int64 *chunkGroupsFiltered, Snapshot snapshot,
+						  StripeSkipList *stripeSkipList,
+						  ColumnarChunkGroupCallback chunkGroupCallback,
+						  void *chunkGroupCallbackArg)
 {
 	uint32 columnIndex = 0;
 	uint32 columnCount = tupleDescriptor->natts;
 
 	bool *projectedColumnMask = ProjectedColumnMask(columnCount, projectedColumnList);
 
-	StripeSkipList *stripeSkipList = ReadStripeSkipList(RelationPhysicalIdentifier_compat(
-															relation),
-														stripeMetadata->id,
-														tupleDescriptor,
-														stripeMetadata->chunkCount,
-														snapshot);
+	if (stripeSkipList == NULL)
+	{
+		stripeSkipList = ReadStripeSkipList(RelationPhysicalIdentifier_compat(relation),
+											stripeMetadata->id,
+											tupleDescriptor,
+											stripeMetadata->chunkCount,
+											snapshot);
+	}
 
-	bool *selectedChunkMask = SelectedChunkMask(stripeSkipList, whereClauseList,
-												whereClauseVars, chunkGroupsFiltered);
+	bool *selectedChunkMask = SelectedChunkMask(stripeSkipList, chunkGroupFilter,
+												chunkGroupsFiltered);
+
+	if (chunkGroupCallback != NULL)
+	{
+		for (uint32 chunkIndex = 0; chunkIndex < stripeSkipList->chunkCount; chunkIndex++)
+		{
+			if (selectedChunkMask[chunkIndex] &&
+				chunkGroupCallback(stripeMetadata, stripeSkipList, chunkIndex,
+								   chunkGroupCallbackArg))
+			{
+				selectedChunkMask[chunkIndex] = false;
+			}
+		}
+	}
 
 	StripeSkipList *selectedChunkSkipList =
 		SelectedChunkSkipList(stripeSkipList, projectedColumnMask,
 							  selectedChunkMask);
 
+	ChunkReadAhead *readAhead = BuildChunkReadAhead(relation, stripeMetadata,
+													selectedChunkSkipList,
+													projectedColumnMask);
+
+	bool useChunkCache = ColumnarChunkCacheEnabled();
+	uint64 storageId = 0;
+	if (useChunkCache)
+	{
+		storageId = ColumnarStorageGetStorageId(relation, false);
+	}
+
 	/* load column data for projected columns */
 	ColumnBuffers **columnBuffersArray = palloc0(columnCount * sizeof(ColumnBuffers *));
 
@@ -1041,35 +1904,83 @@ LoadFilteredStripeBuffers(Relation relation, StripeMetadata *stripeMetadata,
 			Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
 			uint32 chunkCount = selectedChunkSkipList->chunkCount;
 
+			ColumnarChunkCacheKey *chunkCacheKeys = NULL;
+			if (useChunkCache)
+			{
+				chunkCacheKeys = BuildChunkCacheKeys(storageId, stripeMetadata->id,
+													 columnIndex, selectedChunkMask,
+													 stripeSkipList->chunkCount,
+													 chunkCount);
+			}
+
 			ColumnBuffers *columnBuffers = LoadColumnBuffers(relation, chunkSkipNode,
 															 chunkCount,
 															 stripeMetadata->fileOffset,
-															 attributeForm);
+															 attributeForm,
+															 readAhead,
+															 chunkCacheKeys);
 
 			columnBuffersArray[columnIndex] = columnBuffers;
 		}
 	}
 
-	StripeBuffers *stripeBuffers = palloc0(sizeof(StripeBuffers));
-	stripeBuffers->columnCount = columnCount;
-	stripeBuffers->rowCount = StripeSkipListRowCount(selectedChunkSkipList);
-	stripeBuffers->columnBuffersArray = columnBuffersArray;
-	stripeBuffers->selectedChunkGroupRowCounts =
-		selectedChunkSkipList->chunkGroupRowCounts;
+	StripeBuffers *stripeBuffers = palloc0(sizeof(StripeBuffers));
+	stripeBuffers->columnCount = columnCount;
+	stripeBuffers->rowCount = StripeSkipListRowCount(selectedChunkSkipList);
+	stripeBuffers->columnBuffersArray = columnBuffersArray;
+	stripeBuffers->selectedChunkGroupRowCounts =
+		selectedChunkSkipList->chunkGroupRowCounts;
+
+	return stripeBuffers;
+}
+
+
+/*
+ * BuildChunkCacheKeys returns the chunk cache keys of the chunks of the given
+ * column that are selected by selectedChunkMask, in the order they appear in
+ * the selected chunk skip list.
+ */
+static ColumnarChunkCacheKey *
+BuildChunkCacheKeys(uint64 storageId, uint64 stripeId, uint32 columnIndex,
+					bool *selectedChunkMask, uint32 chunkCount,
+					uint32 selectedChunkCount)
+{
+	ColumnarChunkCacheKey *chunkCacheKeys =
+		palloc0(selectedChunkCount * sizeof(ColumnarChunkCacheKey));
+	uint32 selectedChunkIndex = 0;
+
+	for (uint32 chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+	{
+		if (!selectedChunkMask[chunkIndex])
+		{
+			continue;
+		}
+
+		ColumnarChunkCacheKey *chunkCacheKey = &chunkCacheKeys[selectedChunkIndex++];
+		chunkCacheKey->storageId = storageId;
+		chunkCacheKey->stripeId = stripeId;
+		chunkCacheKey->chunkGroupIndex = chunkIndex;
+		chunkCacheKey->columnIndex = columnIndex;
+	}
+
+	Assert(selectedChunkIndex == selectedChunkCount);
 
-	return stripeBuffers;
+	return chunkCacheKeys;
 }
 
 
 /*
  * LoadColumnBuffers reads serialized column data from the given file. These
  * column data are laid out as sequential chunks in the file; and chunk positions
- * and lengths are retrieved from the column chunk skip node array.
+ * and lengths are retrieved from the column chunk skip node array. If
+ * chunkCacheKeys is given, value buffers found in the chunk cache are not read
+ * from the file but copied from the cache instead.
  */
 static ColumnBuffers *
 LoadColumnBuffers(Relation relation, ColumnChunkSkipNode *chunkSkipNodeArray,
 				  uint32 chunkCount, uint64 stripeOffset,
-				  Form_pg_attribute attributeForm)
+				  Form_pg_attribute attributeForm, ChunkReadAhead *readAhead,
+				  ColumnarChunkCacheKey *chunkCacheKeys)
 {
 	uint32 chunkIndex = 0;
 	ColumnChunkBuffers **chunkBuffersArray =
@@ -1093,6 +2004,7 @@ LoadColumnBuffers(Relation relation, ColumnChunkSkipNode *chunkSkipNodeArray,
 
 		enlargeStringInfo(rawExistsBuffer, chunkSkipNode->existsLength);
 		rawExistsBuffer->len = chunkSkipNode->existsLength;
+		AdvanceChunkReadAhead(readAhead, existsOffset);
 		ColumnarStorageRead(relation, existsOffset, rawExistsBuffer->data,
 							chunkSkipNode->existsLength);
 
@@ -1105,15 +2017,43 @@ LoadColumnBuffers(Relation relation, ColumnChunkSkipNode *chunkSkipNodeArray,
 		ColumnChunkSkipNode *chunkSkipNode = &chunkSkipNodeArray[chunkIndex];
 		CompressionType compressionType = chunkSkipNode->valueCompressionType;
 		uint64 valueOffset = stripeOffset + chunkSkipNode->valueChunkOffset;
+
+		/*
+		 * Plain value buffers are as cheap to read from the file as from the
+		 * cache, so we only cache the ones that need decompressing or decoding.
+		 */
+		if (chunkCacheKeys != NULL &&
+			(compressionType != COMPRESSION_NONE ||
+			 chunkSkipNode->valueEncodingType != ENCODING_NONE))
+		{
+			ColumnarChunkCacheKey *chunkCacheKey = &chunkCacheKeys[chunkIndex];
+			StringInfo cachedValueBuffer = ColumnarChunkCacheLookup(chunkCacheKey);
+			if (cachedValueBuffer != NULL)
+			{
+				chunkBuffersArray[chunkIndex]->valueBuffer = cachedValueBuffer;
+				chunkBuffersArray[chunkIndex]->valueCompressionType = COMPRESSION_NONE;
+				chunkBuffersArray[chunkIndex]->valueEncodingType = ENCODING_NONE;
+				chunkBuffersArray[chunkIndex]->decompressedValueSize =
+					cachedValueBuffer->len;
+				continue;
+			}
+
+			/* cache the value buffer once it is decoded */
+			chunkBuffersArray[chunkIndex]->cacheKey = chunkCacheKey;
+		}
+
 		StringInfo rawValueBuffer = makeStringInfo();
 
 		enlargeStringInfo(rawValueBuffer, chunkSkipNode->valueLength);
 		rawValueBuffer->len = chunkSkipNode->valueLength;
+		AdvanceChunkReadAhead(readAhead, valueOffset);
 		ColumnarStorageRead(relation, valueOffset, rawValueBuffer->data,
 							chunkSkipNode->valueLength);
 
 		chunkBuffersArray[chunkIndex]->valueBuffer = rawValueBuffer;
 		chunkBuffersArray[chunkIndex]->valueCompressionType = compressionType;
+		chunkBuffersArray[chunkIndex]->valueEncodingType =
+			chunkSkipNode->valueEncodingType;
 		chunkBuffersArray[chunkIndex]->decompressedValueSize =
 			chunkSkipNode->decompressedValueSize;
 	}
@@ -1126,25 +2066,137 @@ LoadColumnBuffers(Relation relation, ColumnChunkSkipNode *chunkSkipNodeArray,
 
 
 /*
- * SelectedChunkMask walks over each column's chunks and checks if a chunk can
- * be filtered without reading its data. The filtering happens when all rows in
- * the chunk can be refuted by the given qualifier conditions.
+ * BuildChunkReadAhead returns the read-ahead state for the chunks of the
+ * projected columns that LoadColumnBuffers would read for the given stripe,
+ * or NULL if prefetching is disabled.
  */
-static bool *
-SelectedChunkMask(StripeSkipList *stripeSkipList, List *whereClauseList,
-				  List *whereClauseVars, int64 *chunkGroupsFiltered)
+static ChunkReadAhead *
+BuildChunkReadAhead(Relation relation, StripeMetadata *stripeMetadata,
+					StripeSkipList *selectedChunkSkipList, bool *projectedColumnMask)
 {
-	ListCell *columnCell = NULL;
-	uint32 chunkIndex = 0;
+	if (columnar_prefetch_depth == 0)
+	{
+		return NULL;
+	}
 
-	bool *selectedChunkMask = palloc0(stripeSkipList->chunkCount * sizeof(bool));
-	memset(selectedChunkMask, true, stripeSkipList->chunkCount * sizeof(bool));
+	uint32 chunkCount = selectedChunkSkipList->chunkCount;
+	uint32 maxRangeCount = 2 * chunkCount * stripeMetadata->columnCount;
+
+	ChunkReadAhead *readAhead = palloc0(sizeof(ChunkReadAhead));
+	readAhead->relation = relation;
+	readAhead->rangeOffsets = palloc0(maxRangeCount * sizeof(uint64));
+	readAhead->rangeLengths = palloc0(maxRangeCount * sizeof(uint64));
+
+	for (uint32 columnIndex = 0; columnIndex < stripeMetadata->columnCount;
+		 columnIndex++)
+	{
+		if (!projectedColumnMask[columnIndex])
+		{
+			continue;
+		}
+
+		ColumnChunkSkipNode *chunkSkipNodeArray =
+			selectedChunkSkipList->chunkSkipNodeArray[columnIndex];
+
+		/* same order as LoadColumnBuffers, which is also the on-disk order */
+		for (uint32 chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+		{
+			ColumnChunkSkipNode *chunkSkipNode = &chunkSkipNodeArray[chunkIndex];
+			uint32 rangeIndex = readAhead->rangeCount++;
+
+			readAhead->rangeOffsets[rangeIndex] =
+				stripeMetadata->fileOffset + chunkSkipNode->existsChunkOffset;
+			readAhead->rangeLengths[rangeIndex] = chunkSkipNode->existsLength;
+		}
+
+		for (uint32 chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+		{
+			ColumnChunkSkipNode *chunkSkipNode = &chunkSkipNodeArray[chunkIndex];
+			uint32 rangeIndex = readAhead->rangeCount++;
+
+			readAhead->rangeOffsets[rangeIndex] =
+				stripeMetadata->fileOffset + chunkSkipNode->valueChunkOffset;
+			readAhead->rangeLengths[rangeIndex] = chunkSkipNode->valueLength;
+		}
+	}
+
+	return readAhead;
+}
+
+
+/*
+ * AdvanceChunkReadAhead issues prefetch requests for the upcoming chunks up
+ * to columnar_prefetch_depth blocks after readOffset, which is the logical
+ * offset that is about to be read. Chunks that were already prefetched are
+ * skipped.
+ */
+static void
+AdvanceChunkReadAhead(ChunkReadAhead *readAhead, uint64 readOffset)
+{
+	if (readAhead == NULL)
+	{
+		return;
+	}
+
+	uint64 readAheadLimit = readOffset +
+							(uint64) columnar_prefetch_depth * COLUMNAR_BYTES_PER_PAGE;
+
+	while (readAhead->nextRangeIndex < readAhead->rangeCount)
+	{
+		uint32 rangeIndex = readAhead->nextRangeIndex;
+		uint64 rangeEnd = readAhead->rangeOffsets[rangeIndex] +
+						  readAhead->rangeLengths[rangeIndex];
+		uint64 prefetchStart = Max(readAhead->rangeOffsets[rangeIndex],
+								   readAhead->prefetchedOffset);
+		if (prefetchStart >= readAheadLimit)
+		{
+			break;
+		}
+
+		uint64 prefetchEnd = Min(rangeEnd, readAheadLimit);
+		if (prefetchEnd > prefetchStart)
+		{
+			ColumnarStoragePrefetch(readAhead->relation, prefetchStart,
+									prefetchEnd - prefetchStart);
+			readAhead->prefetchedOffset = prefetchEnd;
+		}
+
+		if (prefetchEnd < rangeEnd)
+		{
+			/* we will continue with the rest of this range later */
+			break;
+		}
+
+		readAhead->nextRangeIndex++;
+	}
+}
 
-	foreach(columnCell, whereClauseVars)
+
+/*
+ * BuildChunkGroupFilter builds the ChunkGroupFilter that the chunk groups of
+ * each stripe are filtered with for the given qualifiers.
+ */
+static ChunkGroupFilter *
+BuildChunkGroupFilter(List *whereClauseList, TupleDesc tupleDescriptor)
+{
+	ChunkGroupFilter *chunkGroupFilter = palloc0(sizeof(ChunkGroupFilter));
+	chunkGroupFilter->whereClauseList = whereClauseList;
+	chunkGroupFilter->whereClauseVars = GetClauseVars(whereClauseList,
+													  tupleDescriptor->natts);
+	chunkGroupFilter->bloomQualList = BuildColumnarBloomFilterQuals(whereClauseList,
+																	tupleDescriptor);
+	chunkGroupFilter->fastPathQualList =
+		BuildColumnarFastPathQuals(whereClauseList,
+								   &chunkGroupFilter->allQualsConverted);
+
+	if (chunkGroupFilter->allQualsConverted)
 	{
-		Var *column = lfirst(columnCell);
-		uint32 columnIndex = column->varattno - 1;
+		return chunkGroupFilter;
+	}
 
+	Var *column = NULL;
+	foreach_declared_ptr(column, chunkGroupFilter->whereClauseVars)
+	{
 		/* if this column's data type doesn't have a comparator, skip it */
 		FmgrInfo *comparisonFunction = GetFunctionInfoOrNull(column->vartype,
 															 BTREE_AM_OID,
@@ -1154,13 +2206,73 @@ SelectedChunkMask(StripeSkipList *stripeSkipList, List *whereClauseList,
 			continue;
 		}
 
-		Node *baseConstraint = BuildBaseConstraint(column);
+		chunkGroupFilter->baseConstraintList =
+			lappend(chunkGroupFilter->baseConstraintList, BuildBaseConstraint(column));
+		chunkGroupFilter->constraintColumnIndexList =
+			lappend_int(chunkGroupFilter->constraintColumnIndexList,
+						column->varattno - 1);
+	}
+
+	return chunkGroupFilter;
+}
+
+
+/*
+ * SelectedChunkMask walks over each column's chunks and checks if a chunk can
+ * be filtered without reading its data. The filtering happens when all rows in
+ * the chunk can be refuted by the qualifier conditions of chunkGroupFilter.
+ * If chunkGroupFilter is NULL, then all chunks are selected.
+ *
+ * Equality comparisons on columns with bloom filters are first checked against
+ * the bloom filters of the chunks. Then, simple comparisons on fixed-width
+ * columns are checked against the min/max values directly, which is much
+ * cheaper than predicate_refuted_by. We only fall back to the latter if some
+ * of the qualifiers couldn't be handled that way.
+ */
+static bool *
+SelectedChunkMask(StripeSkipList *stripeSkipList, ChunkGroupFilter *chunkGroupFilter,
+				  int64 *chunkGroupsFiltered)
+{
+	ListCell *constraintCell = NULL;
+	ListCell *columnIndexCell = NULL;
+	uint32 chunkIndex = 0;
+
+	bool *selectedChunkMask = palloc0(stripeSkipList->chunkCount * sizeof(bool));
+	memset(selectedChunkMask, true, stripeSkipList->chunkCount * sizeof(bool));
+
+	if (chunkGroupFilter == NULL)
+	{
+		return selectedChunkMask;
+	}
+
+	SelectChunksUsingBloomFilters(stripeSkipList, chunkGroupFilter->bloomQualList,
+								  selectedChunkMask, chunkGroupsFiltered);
+
+	SelectChunksUsingFastPath(stripeSkipList, chunkGroupFilter->fastPathQualList,
+							  selectedChunkMask, chunkGroupsFiltered);
+	if (chunkGroupFilter->allQualsConverted)
+	{
+		return selectedChunkMask;
+	}
+
+	forboth(constraintCell, chunkGroupFilter->baseConstraintList,
+			columnIndexCell, chunkGroupFilter->constraintColumnIndexList)
+	{
+		Node *baseConstraint = lfirst(constraintCell);
+		uint32 columnIndex = lfirst_int(columnIndexCell);
+
 		for (chunkIndex = 0; chunkIndex < stripeSkipList->chunkCount; chunkIndex++)
 		{
 			ColumnChunkSkipNode *chunkSkipNodeArray =
 				stripeSkipList->chunkSkipNodeArray[columnIndex];
 			ColumnChunkSkipNode *chunkSkipNode = &chunkSkipNodeArray[chunkIndex];
 
+			/* already filtered by the fast path or by another column */
+			if (!selectedChunkMask[chunkIndex])
+			{
+				continue;
+			}
+
 			/*
 			 * A column chunk with comparable data type can miss min/max values
 			 * if all values in the chunk are NULL.
@@ -1175,7 +2287,8 @@ SelectedChunkMask(StripeSkipList *stripeSkipList, List *whereClauseList,
 
 			List *constraintList = list_make1(baseConstraint);
 			bool predicateRefuted =
-				predicate_refuted_by(constraintList, whereClauseList, false);
+				predicate_refuted_by(constraintList, chunkGroupFilter->whereClauseList,
+									 false);
 			if (predicateRefuted && selectedChunkMask[chunkIndex])
 			{
 				selectedChunkMask[chunkIndex] = false;
@@ -1188,6 +2301,78 @@ SelectedChunkMask(StripeSkipList *stripeSkipList, List *whereClauseList,
 }
 
 
+/*
+ * SelectChunksUsingBloomFilters filters out the chunks of given stripe that
+ * certainly don't contain any of the values that a column is compared against
+ * by one of the equality quals in bloomQualList, based on the bloom filters
+ * of the column's chunks.
+ */
+static void
+SelectChunksUsingBloomFilters(StripeSkipList *stripeSkipList, List *bloomQualList,
+							  bool *selectedChunkMask, int64 *chunkGroupsFiltered)
+{
+	ColumnarBloomFilterQual *bloomQual = NULL;
+	foreach_declared_ptr(bloomQual, bloomQualList)
+	{
+		ColumnChunkSkipNode *chunkSkipNodeArray =
+			stripeSkipList->chunkSkipNodeArray[bloomQual->columnIndex];
+
+		for (uint32 chunkIndex = 0; chunkIndex < stripeSkipList->chunkCount;
+			 chunkIndex++)
+		{
+			ColumnChunkSkipNode *chunkSkipNode = &chunkSkipNodeArray[chunkIndex];
+			if (!selectedChunkMask[chunkIndex])
+			{
+				continue;
+			}
+
+			if (ColumnarBloomFilterQualRefutesChunk(bloomQual,
+													chunkSkipNode->bloomFilter))
+			{
+				selectedChunkMask[chunkIndex] = false;
+				*chunkGroupsFiltered += 1;
+			}
+		}
+	}
+}
+
+
+/*
+ * SelectChunksUsingFastPath filters out the chunks of given stripe that are
+ * refuted by any of the simple comparisons in fastPathQualList, based on the
+ * min/max values of the compared column.
+ */
+static void
+SelectChunksUsingFastPath(StripeSkipList *stripeSkipList, List *fastPathQualList,
+						  bool *selectedChunkMask, int64 *chunkGroupsFiltered)
+{
+	ColumnarVectorQual *fastPathQual = NULL;
+	foreach_declared_ptr(fastPathQual, fastPathQualList)
+	{
+		ColumnChunkSkipNode *chunkSkipNodeArray =
+			stripeSkipList->chunkSkipNodeArray[fastPathQual->columnIndex];
+
+		for (uint32 chunkIndex = 0; chunkIndex < stripeSkipList->chunkCount;
+			 chunkIndex++)
+		{
+			ColumnChunkSkipNode *chunkSkipNode = &chunkSkipNodeArray[chunkIndex];
+			if (!selectedChunkMask[chunkIndex] || !chunkSkipNode->hasMinMax)
+			{
+				continue;
+			}
+
+			if (ColumnarVectorQualRefutesRange(fastPathQual,
+											   chunkSkipNode->minimumValue,
+											   chunkSkipNode->maximumValue))
+			{
+				selectedChunkMask[chunkIndex] = false;
+				*chunkGroupsFiltered += 1;
+			}
+		}
+	}
+}
+
+
 /*
  * GetFunctionInfoOrNull first resolves the operator for the given data type,
  * access method, and support procedure. The function then uses the resolved
@@ -1296,6 +2481,41 @@ GetClauseVars(List *whereClauseList, int natts)
 }
 
 
+/*
+ * FilterColumnList returns an integer list of the projected attribute numbers
+ * that are referenced by the given where clause Vars. If there are no such
+ * columns, or if all projected columns are such, then deserializing those
+ * columns first wouldn't save us anything, so it returns NIL.
+ */
+static List *
+FilterColumnList(List *projectedColumnList, List *whereClauseVars)
+{
+	List *filterColumnList = NIL;
+
+	int attno;
+	foreach_declared_int(attno, projectedColumnList)
+	{
+		Var *var = NULL;
+		foreach_declared_ptr(var, whereClauseVars)
+		{
+			if (var->varattno == attno)
+			{
+				filterColumnList = lappend_int(filterColumnList, attno);
+				break;
+			}
+		}
+	}
+
+	if (list_length(filterColumnList) == list_length(projectedColumnList))
+	{
+		list_free(filterColumnList);
+		return NIL;
+	}
+
+	return filterColumnList;
+}
+
+
 /*
  * MakeOpExpression builds an operator expression node. This operator expression
  * implements the operator clause as defined by the variable and the strategy
@@ -1502,9 +2722,9 @@ ProjectedColumnMask(uint32 columnCount, List *projectedColumnList)
 
 /*
  * DeserializeBoolArray reads an array of bits from the given buffer and stores
- * it in provided bool array.
+ * it in provided bool array. Returns true if all the bits are set.
  */
-static void
+static bool
 DeserializeBoolArray(StringInfo boolArrayBuffer, bool *boolArray,
 					 uint32 boolArrayLength)
 {
@@ -1516,6 +2736,26 @@ DeserializeBoolArray(StringInfo boolArrayBuffer, bool *boolArray,
 		ereport(ERROR, (errmsg("insufficient data for reading boolean array")));
 	}
 
+	/* fast path for the common case where all the bits are set */
+	uint32 fullByteCount = boolArrayLength / 8;
+	uint32 fullByteIndex = 0;
+	while (fullByteIndex < fullByteCount && (uint8) boolArrayBuffer->data[fullByteIndex] == 0xFF)
+	{
+		fullByteIndex++;
+	}
+
+	if (fullByteIndex == fullByteCount)
+	{
+		uint32 remainingBitCount = boolArrayLength % 8;
+		uint8 remainingBitmask = (1 << remainingBitCount) - 1;
+		if (remainingBitCount == 0 ||
+			(boolArrayBuffer->data[fullByteCount] & remainingBitmask) == remainingBitmask)
+		{
+			memset(boolArray, true, boolArrayLength * sizeof(bool));
+			return true;
+		}
+	}
+
 	for (boolArrayIndex = 0; boolArrayIndex < boolArrayLength; boolArrayIndex++)
 	{
 		uint32 byteIndex = boolArrayIndex / 8;
@@ -1532,6 +2772,8 @@ DeserializeBoolArray(StringInfo boolArrayBuffer, bool *boolArray,
 			boolArray[boolArrayIndex] = true;
 		}
 	}
+
+	return false;
 }
 
 
@@ -1539,15 +2781,74 @@ DeserializeBoolArray(StringInfo boolArrayBuffer, bool *boolArray,
  * DeserializeDatumArray reads an array of datums from the given buffer and stores
  * them in provided datumArray. If a value is marked as false in the exists array,
  * the function assumes that the datum isn't in the buffer, and simply skips it.
+ *
+ * If allExist is true, then all values of a fixed-width by-value type are
+ * stored back to back in the buffer, so we skip the per-value offset
+ * calculations.
  */
 static void
-DeserializeDatumArray(StringInfo datumBuffer, bool *existsArray, uint32 datumCount,
-					  bool datumTypeByValue, int datumTypeLength,
+DeserializeDatumArray(StringInfo datumBuffer, bool *existsArray, bool allExist,
+					  uint32 datumCount, bool datumTypeByValue, int datumTypeLength,
 					  char datumTypeAlign, Datum *datumArray)
 {
 	uint32 datumIndex = 0;
 	uint32 currentDatumDataOffset = 0;
 
+	if (allExist && datumTypeByValue &&
+		att_align_nominal(datumTypeLength, datumTypeAlign) == datumTypeLength)
+	{
+		if ((uint64) datumCount * datumTypeLength > datumBuffer->len)
+		{
+			ereport(ERROR, (errmsg("insufficient data left in datum buffer")));
+		}
+
+		const char *datumData = datumBuffer->data;
+		switch (datumTypeLength)
+		{
+			case sizeof(Datum):
+			{
+				memcpy_s(datumArray, datumCount * sizeof(Datum), datumData,
+						 datumCount * sizeof(Datum));
+				return;
+			}
+
+			case sizeof(int32):
+			{
+				const int32 *values = (const int32 *) datumData;
+				for (datumIndex = 0; datumIndex < datumCount; datumIndex++)
+				{
+					datumArray[datumIndex] = Int32GetDatum(values[datumIndex]);
+				}
+				return;
+			}
+
+			case sizeof(int16):
+			{
+				const int16 *values = (const int16 *) datumData;
+				for (datumIndex = 0; datumIndex < datumCount; datumIndex++)
+				{
+					datumArray[datumIndex] = Int16GetDatum(values[datumIndex]);
+				}
+				return;
+			}
+
+			case sizeof(char):
+			{
+				for (datumIndex = 0; datumIndex < datumCount; datumIndex++)
+				{
+					datumArray[datumIndex] = CharGetDatum(datumData[datumIndex]);
+				}
+				return;
+			}
+
+			default:
+			{
+				/* fall back to the generic loop below */
+				break;
+			}
+		}
+	}
+
 	for (datumIndex = 0; datumIndex < datumCount; datumIndex++)
 	{
 		if (!existsArray[datumIndex])
@@ -1574,32 +2875,66 @@ DeserializeDatumArray(StringInfo datumBuffer, bool *existsArray, uint32 datumCou
 
 
 /*
- * DeserializeChunkGroupData deserializes requested data chunk for all columns and
- * stores in chunkDataArray. It uncompresses serialized data if necessary. The
- * function also deallocates data buffers used for previous chunk, and compressed
- * data buffers for the current chunk which will not be needed again. If a column
- * data is not present serialized buffer, then default value (or null) is used
- * to fill value array.
+ * IsPackedDatumArray returns true if the serialized values of the given
+ * column are laid out exactly like a Datum array when none of them is null.
+ */
+static bool
+IsPackedDatumArray(Form_pg_attribute attributeForm)
+{
+	return attributeForm->attbyval && attributeForm->attlen == sizeof(Datum) &&
+		   att_align_nominal(attributeForm->attlen,
+							 attributeForm->attalign) == sizeof(Datum);
+}
+
+
+/*
+ * DeserializeChunkGroupData deserializes requested data chunk for the columns in
+ * columnList and stores in chunkDataArray. See DeserializeChunkColumns.
  */
 static ChunkData *
 DeserializeChunkData(StripeBuffers *stripeBuffers, uint64 chunkIndex,
 					 uint32 rowCount, TupleDesc tupleDescriptor,
-					 List *projectedColumnList)
+					 List *columnList)
 {
-	int columnIndex = 0;
-	bool *columnMask = ProjectedColumnMask(tupleDescriptor->natts, projectedColumnList);
+	bool *columnMask = ProjectedColumnMask(tupleDescriptor->natts, columnList);
 	ChunkData *chunkData = CreateEmptyChunkData(tupleDescriptor->natts, columnMask,
 												rowCount);
 
-	for (columnIndex = 0; columnIndex < stripeBuffers->columnCount; columnIndex++)
+	DeserializeChunkColumns(stripeBuffers, chunkIndex, tupleDescriptor, columnList,
+							chunkData);
+
+	return chunkData;
+}
+
+
+/*
+ * DeserializeChunkColumns deserializes requested data chunk for the columns in
+ * columnList into chunkData. It uncompresses serialized data if necessary. The
+ * function also deallocates data buffers used for previous chunk, and compressed
+ * data buffers for the current chunk which will not be needed again. If a column
+ * data is not present serialized buffer, then default value (or null) is used
+ * to fill value array.
+ */
+static void
+DeserializeChunkColumns(StripeBuffers *stripeBuffers, uint64 chunkIndex,
+						TupleDesc tupleDescriptor, List *columnList,
+						ChunkData *chunkData)
+{
+	uint32 rowCount = chunkData->rowCount;
+
+	int attno;
+	foreach_declared_int(attno, columnList)
 	{
+		/* attno is 1-indexed; columnBuffersArray is 0-indexed */
+		int columnIndex = attno - 1;
 		Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
 		ColumnBuffers *columnBuffers = stripeBuffers->columnBuffersArray[columnIndex];
-		bool columnAdded = false;
 
-		if (columnBuffers == NULL && columnMask[columnIndex])
+		/* columns deserialized late are not allocated by CreateEmptyChunkData */
+		if (chunkData->existsArray[columnIndex] == NULL)
 		{
-			columnAdded = true;
+			chunkData->existsArray[columnIndex] = palloc0(rowCount * sizeof(bool));
+			chunkData->valueArray[columnIndex] = palloc0(rowCount * sizeof(Datum));
 		}
 
 		if (columnBuffers != NULL)
@@ -1607,24 +2942,58 @@ DeserializeChunkData(StripeBuffers *stripeBuffers, uint64 chunkIndex,
 			ColumnChunkBuffers *chunkBuffers =
 				columnBuffers->chunkBuffersArray[chunkIndex];
 
-			/* decompress and deserialize current chunk's data */
-			StringInfo valueBuffer =
+			/* decompress, decode and deserialize current chunk's data */
+			StringInfo decompressedBuffer =
 				DecompressBuffer(chunkBuffers->valueBuffer,
 								 chunkBuffers->valueCompressionType,
 								 chunkBuffers->decompressedValueSize);
+			StringInfo valueBuffer =
+				DecodeValueBuffer(decompressedBuffer,
+								  chunkBuffers->valueEncodingType,
+								  attributeForm);
+
+			if (chunkBuffers->cacheKey != NULL)
+			{
+				ColumnarChunkCacheInsert(chunkBuffers->cacheKey, valueBuffer);
+			}
+
+			/* decompressed buffer is not needed anymore if we decoded a copy */
+			if (valueBuffer != decompressedBuffer &&
+				decompressedBuffer != chunkBuffers->valueBuffer)
+			{
+				pfree(decompressedBuffer->data);
+				pfree(decompressedBuffer);
+			}
+
+			bool allExist = DeserializeBoolArray(chunkBuffers->existsBuffer,
+												 chunkData->existsArray[columnIndex],
+												 rowCount);
+
+			if (allExist && IsPackedDatumArray(attributeForm) &&
+				valueBuffer != chunkBuffers->valueBuffer &&
+				valueBuffer->len == rowCount * sizeof(Datum))
+			{
+				/*
+				 * The buffer was allocated for this chunk only and is already
+				 * the Datum array we need, so use it as-is. FreeChunkData
+				 * frees it with the value array.
+				 */
+				pfree(chunkData->valueArray[columnIndex]);
+				chunkData->valueArray[columnIndex] = (Datum *) valueBuffer->data;
+				chunkData->valueBufferArray[columnIndex] = NULL;
+				pfree(valueBuffer);
+				continue;
+			}
 
-			DeserializeBoolArray(chunkBuffers->existsBuffer,
-								 chunkData->existsArray[columnIndex],
-								 rowCount);
 			DeserializeDatumArray(valueBuffer, chunkData->existsArray[columnIndex],
-								  rowCount, attributeForm->attbyval,
+								  allExist, rowCount, attributeForm->attbyval,
 								  attributeForm->attlen, attributeForm->attalign,
 								  chunkData->valueArray[columnIndex]);
 
 			/* store current chunk's data buffer to be freed at next chunk read */
 			chunkData->valueBufferArray[columnIndex] = valueBuffer;
 		}
-		else if (columnAdded)
+		else
 		{
 			/*
 			 * This is a column that was added after creation of this stripe.
@@ -1650,8 +3019,6 @@ DeserializeChunkData(StripeBuffers *stripeBuffers, uint64 chunkIndex,
 			}
 		}
 	}
-
-	return chunkData;
 }
 
 
@@ -496,6 +496,29 @@ ColumnarStorageRead(Relation rel, uint64 logicalOffset, char *data, uint32 amoun
 }
 
 
+/*
+ * ColumnarStoragePrefetch - issue prefetch requests for the blocks that the
+ * given logical range maps to, so that a later ColumnarStorageRead on the
+ * range doesn't need to wait for them synchronously.
+ */
+void
+ColumnarStoragePrefetch(Relation rel, uint64 logicalOffset, uint64 amount)
+{
+	if (amount == 0 || !ColumnarLogicalOffsetIsValid(logicalOffset))
+	{
+		return;
+	}
+
+	BlockNumber firstBlockno = LogicalToPhysical(logicalOffset).blockno;
+	BlockNumber lastBlockno = LogicalToPhysical(logicalOffset + amount - 1).blockno;
+
+	for (BlockNumber blockno = firstBlockno; blockno <= lastBlockno; blockno++)
+	{
+		PrefetchBuffer(rel, MAIN_FORKNUM, blockno);
+	}
+}
+
+
 /*
  * ColumnarStorageWrite - map the logical offset to a block and offset, then
  * write the buffer across multiple blocks if necessary.
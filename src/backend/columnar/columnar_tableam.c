@@ -29,7 +29,10 @@
 #include "commands/progress.h"
 #include "commands/vacuum.h"
 #include "executor/executor.h"
+#include "nodes/execnodes.h"
 #include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/tidbitmap.h"
 #include "optimizer/plancat.h"
 #include "storage/bufmgr.h"
 #include "storage/bufpage.h"
@@ -38,6 +41,7 @@
 #include "storage/procarray.h"
 #include "storage/smgr.h"
 #include "tcop/utility.h"
+#include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
@@ -46,12 +50,15 @@
 #include "utils/rel.h"
 #include "utils/relcache.h"
 #include "utils/syscache.h"
+#include "utils/tuplesort.h"
+#include "utils/typcache.h"
 
 #include "citus_version.h"
 #include "pg_version_compat.h"
 
 #include "columnar/columnar.h"
 #include "columnar/columnar_customscan.h"
+#include "columnar/columnar_metadata_cache.h"
 #include "columnar/columnar_storage.h"
 #include "columnar/columnar_tableam.h"
 #include "columnar/columnar_version_compat.h"
@@ -66,6 +73,16 @@
 #define VACUUM_TRUNCATE_LOCK_WAIT_INTERVAL 50       /* ms */
 #define VACUUM_TRUNCATE_LOCK_TIMEOUT 4500               /* ms */
 
+/*
+ * Limits of the size of zstd dictionaries. Dictionaries are trained from
+ * about ZSTD_DICTIONARY_SAMPLE_RATIO times their size of samples, which are
+ * pieces of at most ZSTD_DICTIONARY_SAMPLE_SIZE bytes of value buffers.
+ */
+#define ZSTD_DICTIONARY_SIZE_MIN 1024
+#define ZSTD_DICTIONARY_SIZE_MAX (1024 * 1024)
+#define ZSTD_DICTIONARY_SAMPLE_RATIO 100
+#define ZSTD_DICTIONARY_SAMPLE_SIZE (16 * 1024)
+
 /*
  * ColumnarScanDescData is the scan state passed between beginscan(),
  * getnextslot(), rescan(), and endscan() calls.
@@ -82,6 +99,18 @@ typedef struct ColumnarScanDescData
 	MemoryContext scanContext;
 	Bitmapset *attr_needed;
 	List *scanQual;
+
+	/* see ColumnarScanSetChunkGroupCallback */
+	ColumnarChunkGroupCallback chunkGroupCallback;
+	void *chunkGroupCallbackArg;
+
+	/*
+	 * Row numbers to be fetched from the current bitmap page in a bitmap heap
+	 * scan, see columnar_scan_bitmap_next_block.
+	 */
+	uint64 *bitmapRowNumbers;
+	int bitmapRowNumberCount;
+	int bitmapRowNumberIndex;
 } ColumnarScanDescData;
 
 
@@ -105,6 +134,7 @@ typedef struct IndexFetchColumnarData
 
 static object_access_hook_type PrevObjectAccessHook = NULL;
 static ProcessUtility_hook_type PrevProcessUtilityHook = NULL;
+static ExecutorStart_hook_type PrevExecutorStartHook = NULL;
 
 /* forward declaration for static functions */
 static MemoryContext CreateColumnarScanMemoryContext(void);
@@ -123,9 +153,22 @@ static void ColumnarProcessUtility(PlannedStmt *pstmt,
 								   struct QueryEnvironment *queryEnv,
 								   DestReceiver *dest,
 								   QueryCompletion *completionTag);
+static void ColumnarExecutorStart(QueryDesc *queryDesc, int eflags);
+static bool DisableColumnarBitmapPrefetchWalker(PlanState *planState, void *context);
 static bool ConditionalLockRelationWithTimeout(Relation rel, LOCKMODE lockMode,
 											   int timeout, int retryInterval);
 static List * NeededColumnsList(TupleDesc tupdesc, Bitmapset *attr_needed);
+static double CopyRowsInSortKeyOrder(ColumnarReadState *readState,
+									 ColumnarWriteState *writeState,
+									 TupleDesc tupleDescriptor,
+									 List *sortKeyColumnIndexes);
+static int64 CompactColumnarStripes(Relation relation);
+static bool IsStripeToCompact(StripeMetadata *stripeMetadata,
+							  ColumnarOptions *columnarOptions);
+static int64 MergeColumnarStripes(Relation relation, List *stripeList,
+								  ColumnarOptions *columnarOptions, Snapshot snapshot);
+static void SampleChunkValueBuffers(Relation relation, uint64 sampleByteLimit,
+									StringInfo sampleBuffer, List **sampleSizeList);
 static void LogRelationStats(Relation rel, int elevel);
 static void TruncateColumnar(Relation rel, int elevel);
 static HeapTuple ColumnarSlotCopyHeapTuple(TupleTableSlot *slot);
@@ -265,19 +308,19 @@ CreateColumnarScanMemoryContext(void)
 
 /*
  * init_columnar_read_state initializes a column store table read and returns the
- * state.
+ * state. parallelScan is the shared state of a parallel scan, or NULL.
  */
 static ColumnarReadState *
 init_columnar_read_state(Relation relation, TupleDesc tupdesc, Bitmapset *attr_needed,
 						 List *scanQual, MemoryContext scanContext, Snapshot snapshot,
-						 bool randomAccess)
+						 bool randomAccess, ParallelColumnarScanDesc parallelScan)
 {
 	MemoryContext oldContext = MemoryContextSwitchTo(scanContext);
 
 	List *neededColumnList = NeededColumnsList(tupdesc, attr_needed);
 	ColumnarReadState *readState = ColumnarBeginRead(relation, tupdesc, neededColumnList,
 													 scanQual, scanContext, snapshot,
-													 randomAccess);
+													 randomAccess, parallelScan);
 
 	MemoryContextSwitchTo(oldContext);
 
@@ -311,10 +354,43 @@ columnar_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
 	/* XXX: hack to pass in new quals that aren't actually scan keys */
 	List *scanQual = (List *) key;
 
-	if (scan->cs_readState != NULL)
+	if (scan->cs_readState == NULL)
 	{
-		ColumnarRescan(scan->cs_readState, scanQual);
+		return;
+	}
+
+	if (scan->cs_base.rs_flags & SO_TYPE_BITMAPSCAN)
+	{
+		/*
+		 * Bitmap heap scans read row numbers in ascending order, so start
+		 * over with a fresh read state, see ColumnarReadBitmapRow.
+		 */
+		ColumnarEndRead(scan->cs_readState);
+		scan->cs_readState = NULL;
+		scan->bitmapRowNumberCount = 0;
+		scan->bitmapRowNumberIndex = 0;
+
+		return;
 	}
+
+	if (scan->cs_base.rs_parallel != NULL)
+	{
+		/*
+		 * Restarting the read would claim a stripe right away, but the shared
+		 * state is reset only after rescan (see ExecParallelReinitialize), so
+		 * re-initialize the read state lazily in the next read instead.
+		 */
+		ColumnarEndRead(scan->cs_readState);
+		scan->cs_readState = NULL;
+
+		MemoryContext oldContext = MemoryContextSwitchTo(scan->scanContext);
+		scan->scanQual = copyObject(scanQual);
+		MemoryContextSwitchTo(oldContext);
+
+		return;
+	}
+
+	ColumnarRescan(scan->cs_readState, scanQual);
 }
 
 
@@ -333,7 +409,8 @@ columnar_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableSlo
 			init_columnar_read_state(scan->cs_base.rs_rd, slot->tts_tupleDescriptor,
 									 scan->attr_needed, scan->scanQual,
 									 scan->scanContext, scan->cs_base.rs_snapshot,
-									 randomAccess);
+									 randomAccess,
+									 (ParallelColumnarScanDesc) scan->cs_base.rs_parallel);
 	}
 
 	ExecClearTuple(slot);
@@ -355,6 +432,86 @@ columnar_getnextslot(TableScanDesc sscan, ScanDirection direction, TupleTableSlo
 }
 
 
+/*
+ * ColumnarScanNextBatch is the batch counterpart of columnar_getnextslot. It
+ * fills in the given batch with the next chunk group to be scanned and returns
+ * true, or returns false if the scan is exhausted. slot is only used to
+ * initialize the read state on first call, see columnar_getnextslot.
+ */
+bool
+ColumnarScanNextBatch(TableScanDesc sscan, TupleTableSlot *slot, ColumnarBatch *batch)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	if (scan->cs_readState == NULL)
+	{
+		bool randomAccess = false;
+		scan->cs_readState =
+			init_columnar_read_state(scan->cs_base.rs_rd, slot->tts_tupleDescriptor,
+									 scan->attr_needed, scan->scanQual,
+									 scan->scanContext, scan->cs_base.rs_snapshot,
+									 randomAccess,
+									 (ParallelColumnarScanDesc) scan->cs_base.rs_parallel);
+		ColumnarReadSetChunkGroupCallback(scan->cs_readState,
+										  scan->chunkGroupCallback,
+										  scan->chunkGroupCallbackArg);
+	}
+
+	return ColumnarReadNextBatch(scan->cs_readState, batch);
+}
+
+
+/*
+ * ColumnarScanSetChunkGroupCallback sets the chunk group callback of the read
+ * state that ColumnarScanNextBatch initializes, see
+ * ColumnarReadSetChunkGroupCallback. It must be called before the first batch
+ * is read.
+ */
+void
+ColumnarScanSetChunkGroupCallback(TableScanDesc sscan,
+								  ColumnarChunkGroupCallback callback,
+								  void *callbackArg)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	Assert(scan->cs_readState == NULL);
+
+	scan->chunkGroupCallback = callback;
+	scan->chunkGroupCallbackArg = callbackArg;
+}
+
+
+/*
+ * ColumnarScanMaterializeBatch deserializes the columns of the given batch
+ * that ColumnarScanNextBatch deferred, see ColumnarReadMaterializeBatch.
+ */
+void
+ColumnarScanMaterializeBatch(TableScanDesc sscan, ColumnarBatch *batch)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	ColumnarReadMaterializeBatch(scan->cs_readState, batch);
+}
+
+
+/*
+ * ColumnarScanStoreBatchRow stores the row at rowIndex of the given batch
+ * into slot as a virtual tuple.
+ */
+void
+ColumnarScanStoreBatchRow(ColumnarBatch *batch, uint32 rowIndex, TupleTableSlot *slot)
+{
+	ExecClearTuple(slot);
+
+	ColumnarBatchGetRow(batch, rowIndex, slot->tts_values, slot->tts_isnull);
+
+	ExecStoreVirtualTuple(slot);
+
+	slot->tts_tid = row_number_to_tid(batch->firstRowNumber +
+									  (rowIndex - batch->startRow));
+}
+
+
 /*
  * row_number_to_tid maps given rowNumber to ItemPointerData.
  */
@@ -412,21 +569,36 @@ ErrorIfInvalidRowNumber(uint64 rowNumber)
 static Size
 columnar_parallelscan_estimate(Relation rel)
 {
-	elog(ERROR, "columnar_parallelscan_estimate not implemented");
+	return sizeof(ParallelColumnarScanDescData);
 }
 
 
 static Size
 columnar_parallelscan_initialize(Relation rel, ParallelTableScanDesc pscan)
 {
-	elog(ERROR, "columnar_parallelscan_initialize not implemented");
+	ParallelColumnarScanDesc parallelScan = (ParallelColumnarScanDesc) pscan;
+
+	/*
+	 * Let the block-based implementation initialize the common fields. We
+	 * don't use the block related fields, but this spares us from tracking
+	 * the changes to ParallelTableScanDescData across PostgreSQL versions.
+	 */
+	table_block_parallelscan_initialize(rel, pscan);
+
+	pg_atomic_init_u64(&parallelScan->lastClaimedRowNumber,
+					   COLUMNAR_INVALID_ROW_NUMBER);
+
+	return sizeof(ParallelColumnarScanDescData);
 }
 
 
 static void
 columnar_parallelscan_reinitialize(Relation rel, ParallelTableScanDesc pscan)
 {
-	elog(ERROR, "columnar_parallelscan_reinitialize not implemented");
+	ParallelColumnarScanDesc parallelScan = (ParallelColumnarScanDesc) pscan;
+
+	pg_atomic_write_u64(&parallelScan->lastClaimedRowNumber,
+						COLUMNAR_INVALID_ROW_NUMBER);
 }
 
 
@@ -521,7 +693,7 @@ columnar_index_fetch_tuple(struct IndexFetchTableData *sscan,
 													  slot->tts_tupleDescriptor,
 													  attr_needed, scanQual,
 													  scan->scanContext,
-													  snapshot, randomAccess);
+													  snapshot, randomAccess, NULL);
 	}
 
 	uint64 rowNumber = tid_to_row_number(*tid);
@@ -922,10 +1094,12 @@ columnar_relation_copy_data(Relation rel, const RelFileLocator *newrnode)
 
 /*
  * columnar_relation_copy_for_cluster is called on VACUUM FULL, at which
- * we should copy data from OldHeap to NewHeap.
+ * we should copy data from OldHeap to NewHeap. If the table has a sort key,
+ * the rows of the whole table are written in sort key order. This is safe
+ * even if the table has indexes, since they are rebuilt afterwards.
  *
- * In general TableAM case this can also be called for the CLUSTER command
- * which is not applicable for columnar since it doesn't support indexes.
+ * In general TableAM case this can also be called for the CLUSTER command,
+ * which we don't support for columnar tables.
  */
 static void
 columnar_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
@@ -960,6 +1134,11 @@ columnar_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 	ColumnarOptions columnarOptions = { 0 };
 	ReadColumnarOptions(OldHeap->rd_id, &columnarOptions);
 
+	/* we sort the whole table below, so the writer doesn't need to sort stripes */
+	List *sortKeyColumnIndexes =
+		ColumnarSortKeyColumnIndexes(columnarOptions.sortKeyColumns, sourceDesc);
+	columnarOptions.sortKeyColumns = NIL;
+
 	ColumnarWriteState *writeState = ColumnarBeginWrite(RelationPhysicalIdentifier_compat(
 															NewHeap),
 														columnarOptions,
@@ -980,18 +1159,26 @@ columnar_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 	ColumnarReadState *readState = init_columnar_read_state(OldHeap, sourceDesc,
 															attr_needed, scanQual,
 															scanContext, snapshot,
-															randomAccess);
-
-	Datum *values = palloc0(sourceDesc->natts * sizeof(Datum));
-	bool *nulls = palloc0(sourceDesc->natts * sizeof(bool));
+															randomAccess, NULL);
 
 	*num_tuples = 0;
 
-	/* we don't need to know rowNumber here */
-	while (ColumnarReadNextRow(readState, values, nulls, NULL))
+	if (sortKeyColumnIndexes != NIL)
 	{
-		ColumnarWriteRow(writeState, values, nulls);
-		(*num_tuples)++;
+		*num_tuples = CopyRowsInSortKeyOrder(readState, writeState, sourceDesc,
+											 sortKeyColumnIndexes);
+	}
+	else
+	{
+		Datum *values = palloc0(sourceDesc->natts * sizeof(Datum));
+		bool *nulls = palloc0(sourceDesc->natts * sizeof(bool));
+
+		/* we don't need to know rowNumber here */
+		while (ColumnarReadNextRow(readState, values, nulls, NULL))
+		{
+			ColumnarWriteRow(writeState, values, nulls);
+			(*num_tuples)++;
+		}
 	}
 
 	*tups_vacuumed = 0;
@@ -1001,6 +1188,77 @@ columnar_relation_copy_for_cluster(Relation OldHeap, Relation NewHeap,
 }
 
 
+/*
+ * CopyRowsInSortKeyOrder reads all rows of the given read state, sorts them by
+ * the given (0-indexed) sort key columns and writes them to the given write
+ * state in that order. Returns the number of rows copied.
+ */
+static double
+CopyRowsInSortKeyOrder(ColumnarReadState *readState, ColumnarWriteState *writeState,
+					   TupleDesc tupleDescriptor, List *sortKeyColumnIndexes)
+{
+	int sortKeyCount = list_length(sortKeyColumnIndexes);
+	AttrNumber *sortColumns = palloc0(sortKeyCount * sizeof(AttrNumber));
+	Oid *sortOperators = palloc0(sortKeyCount * sizeof(Oid));
+	Oid *sortCollations = palloc0(sortKeyCount * sizeof(Oid));
+	bool *nullsFirstFlags = palloc0(sortKeyCount * sizeof(bool));
+
+	for (int keyIndex = 0; keyIndex < sortKeyCount; keyIndex++)
+	{
+		int columnIndex = list_nth_int(sortKeyColumnIndexes, keyIndex);
+		Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
+		TypeCacheEntry *typeEntry = lookup_type_cache(attributeForm->atttypid,
+													  TYPECACHE_LT_OPR);
+
+		sortColumns[keyIndex] = columnIndex + 1;
+		sortOperators[keyIndex] = typeEntry->lt_opr;
+		sortCollations[keyIndex] = attributeForm->attcollation;
+		nullsFirstFlags[keyIndex] = false;
+	}
+
+	Tuplesortstate *sortState = tuplesort_begin_heap(tupleDescriptor, sortKeyCount,
+													 sortColumns, sortOperators,
+													 sortCollations, nullsFirstFlags,
+													 maintenance_work_mem, NULL,
+													 TUPLESORT_NONE);
+
+	TupleTableSlot *readSlot = MakeSingleTupleTableSlot(tupleDescriptor,
+														&TTSOpsVirtual);
+	TupleTableSlot *sortedSlot = MakeSingleTupleTableSlot(tupleDescriptor,
+														  &TTSOpsMinimalTuple);
+	double rowCount = 0;
+
+	while (true)
+	{
+		ExecClearTuple(readSlot);
+
+		if (!ColumnarReadNextRow(readState, readSlot->tts_values, readSlot->tts_isnull,
+								 NULL))
+		{
+			break;
+		}
+
+		ExecStoreVirtualTuple(readSlot);
+		tuplesort_puttupleslot(sortState, readSlot);
+		rowCount++;
+	}
+
+	tuplesort_performsort(sortState);
+
+	while (tuplesort_gettupleslot(sortState, true, false, sortedSlot, NULL))
+	{
+		slot_getallattrs(sortedSlot);
+		ColumnarWriteRow(writeState, sortedSlot->tts_values, sortedSlot->tts_isnull);
+	}
+
+	tuplesort_end(sortState);
+	ExecDropSingleTupleTableSlot(readSlot);
+	ExecDropSingleTupleTableSlot(sortedSlot);
+
+	return rowCount;
+}
+
+
 /*
  * NeededColumnsList returns a list of AttrNumber's for the columns that
  * are not dropped and specified by attr_needed.
@@ -1085,6 +1343,11 @@ columnar_vacuum_rel(Relation rel, VacuumParams *params,
 
 	LogRelationStats(rel, elevel);
 
+	/* release the cached chunks and metadata of this relation */
+	uint64 storageId = ColumnarStorageGetStorageId(rel, false);
+	ColumnarChunkCacheInvalidateStorage(storageId);
+	ColumnarMetadataCacheInvalidateStorage(storageId);
+
 	/*
 	 * We don't have updates, deletes, or concurrent updates, so all we
 	 * care for now is truncating the unused space at the end of storage.
@@ -1504,15 +1767,6 @@ columnar_index_build_range_scan(Relation columnarRelation,
 		ereport(ERROR, (errmsg("BRIN indexes on columnar tables are not supported")));
 	}
 
-	if (scan)
-	{
-		/*
-		 * Parallel scans on columnar tables are already discardad by
-		 * ColumnarGetRelationInfoHook but be on the safe side.
-		 */
-		elog(ERROR, "parallel scans on columnar are not supported");
-	}
-
 	/*
 	 * In a normal index build, we use SnapshotAny to retrieve all tuples. In
 	 * a concurrent build or during bootstrap, we take a regular MVCC snapshot
@@ -1531,22 +1785,33 @@ columnar_index_build_range_scan(Relation columnarRelation,
 	/*
 	 * For serial index build, we begin our own scan. We may also need to
 	 * register a snapshot whose lifetime is under our direct control.
+	 *
+	 * For parallel index build, the caller already began a parallel scan
+	 * with the snapshot shared by the leader. In that case, each participant
+	 * reads the stripes it claims from the shared scan state.
 	 */
-	if (!TransactionIdIsValid(OldestXmin))
+	if (scan != NULL)
 	{
-		snapshot = RegisterSnapshot(GetTransactionSnapshot());
-		snapshotRegisteredByUs = true;
+		snapshot = scan->rs_snapshot;
 	}
 	else
 	{
-		snapshot = SnapshotAny;
-	}
+		if (!TransactionIdIsValid(OldestXmin))
+		{
+			snapshot = RegisterSnapshot(GetTransactionSnapshot());
+			snapshotRegisteredByUs = true;
+		}
+		else
+		{
+			snapshot = SnapshotAny;
+		}
 
-	int nkeys = 0;
-	ScanKeyData *scanKey = NULL;
-	bool allowAccessStrategy = true;
-	scan = table_beginscan_strat(columnarRelation, snapshot, nkeys, scanKey,
-								 allowAccessStrategy, allow_sync);
+		int nkeys = 0;
+		ScanKeyData *scanKey = NULL;
+		bool allowAccessStrategy = true;
+		scan = table_beginscan_strat(columnarRelation, snapshot, nkeys, scanKey,
+									 allowAccessStrategy, allow_sync);
+	}
 
 	if (progress)
 	{
@@ -1566,7 +1831,6 @@ columnar_index_build_range_scan(Relation columnarRelation,
 	double reltuples = ColumnarReadRowsIntoIndex(scan, indexRelation, indexInfo,
 												 progress, callback, callback_state,
 												 estate, predicate);
-	table_endscan(scan);
 
 	if (progress)
 	{
@@ -1575,6 +1839,9 @@ columnar_index_build_range_scan(Relation columnarRelation,
 										 PROGRESS_SCAN_BLOCKS_DONE);
 	}
 
+	/* might unregister the snapshot of a parallel scan, so do this last */
+	table_endscan(scan);
+
 	if (snapshotRegisteredByUs)
 	{
 		UnregisterSnapshot(snapshot);
@@ -1956,6 +2223,158 @@ columnar_estimate_rel_size(Relation rel, int32 *attr_widths,
 }
 
 
+/*
+ * columnar_scan_bitmap_next_block prepares the row numbers to be fetched from
+ * given bitmap page. A block number maps to VALID_ITEMPOINTER_OFFSETS
+ * consecutive row numbers, see row_number_to_tid. For lossy pages, we don't
+ * know which of them are needed, so we fetch all and let executor recheck
+ * them.
+ *
+ * The rows are read by columnar_scan_bitmap_next_tuple via
+ * ColumnarReadBitmapRow, which decodes each chunk group only once as the
+ * pages are visited in block number order.
+ */
+static bool
+columnar_scan_bitmap_next_block(TableScanDesc sscan, TBMIterateResult *tbmres)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	if (scan->bitmapRowNumbers == NULL)
+	{
+		scan->bitmapRowNumbers = MemoryContextAlloc(scan->scanContext,
+													VALID_ITEMPOINTER_OFFSETS *
+													sizeof(uint64));
+	}
+
+	scan->bitmapRowNumberCount = 0;
+	scan->bitmapRowNumberIndex = 0;
+
+	uint64 firstRowNumber = (uint64) tbmres->blockno * VALID_ITEMPOINTER_OFFSETS;
+	if (tbmres->ntuples >= 0)
+	{
+		for (int tupleIndex = 0; tupleIndex < tbmres->ntuples; tupleIndex++)
+		{
+			OffsetNumber offset = tbmres->offsets[tupleIndex];
+			if (offset < FirstOffsetNumber || offset > VALID_ITEMPOINTER_OFFSETS)
+			{
+				/* cannot be a tid that we gave out */
+				continue;
+			}
+
+			scan->bitmapRowNumbers[scan->bitmapRowNumberCount++] =
+				firstRowNumber + (offset - FirstOffsetNumber);
+		}
+	}
+	else
+	{
+		for (uint64 offset = 0; offset < VALID_ITEMPOINTER_OFFSETS; offset++)
+		{
+			scan->bitmapRowNumbers[scan->bitmapRowNumberCount++] =
+				firstRowNumber + offset;
+		}
+	}
+
+	return scan->bitmapRowNumberCount > 0;
+}
+
+
+/*
+ * columnar_scan_bitmap_next_tuple fetches the next visible row among the
+ * ones prepared by columnar_scan_bitmap_next_block into given slot.
+ */
+static bool
+columnar_scan_bitmap_next_tuple(TableScanDesc sscan, TBMIterateResult *tbmres,
+								TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	Relation relation = scan->cs_base.rs_rd;
+
+	if (scan->cs_readState == NULL)
+	{
+		bool randomAccess = true;
+		scan->cs_readState =
+			init_columnar_read_state(relation, slot->tts_tupleDescriptor,
+									 scan->attr_needed, scan->scanQual,
+									 scan->scanContext, scan->cs_base.rs_snapshot,
+									 randomAccess, NULL);
+
+		/*
+		 * Bitmap might contain the rows that we didn't flush yet, read them
+		 * as sequential scans would do.
+		 */
+		ColumnarReadFlushPendingWrites(scan->cs_readState);
+	}
+
+	ExecClearTuple(slot);
+
+	while (scan->bitmapRowNumberIndex < scan->bitmapRowNumberCount)
+	{
+		uint64 rowNumber = scan->bitmapRowNumbers[scan->bitmapRowNumberIndex++];
+		if (ColumnarReadBitmapRow(scan->cs_readState, rowNumber, slot->tts_values,
+								  slot->tts_isnull))
+		{
+			slot->tts_tableOid = RelationGetRelid(relation);
+			slot->tts_tid = row_number_to_tid(rowNumber);
+			ExecStoreVirtualTuple(slot);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*
+ * ColumnarExecutorStart is the ExecutorStart_hook for columnar. It disables
+ * the prefetching done by bitmap heap scans on columnar tables, see
+ * DisableColumnarBitmapPrefetchWalker.
+ */
+static void
+ColumnarExecutorStart(QueryDesc *queryDesc, int eflags)
+{
+	if (PrevExecutorStartHook)
+	{
+		PrevExecutorStartHook(queryDesc, eflags);
+	}
+	else
+	{
+		standard_ExecutorStart(queryDesc, eflags);
+	}
+
+	if (queryDesc->planstate != NULL)
+	{
+		DisableColumnarBitmapPrefetchWalker(queryDesc->planstate, NULL);
+	}
+}
+
+
+/*
+ * DisableColumnarBitmapPrefetchWalker disables prefetching for the bitmap heap
+ * scans on columnar tables in given plan state tree. Postgres prefetches the
+ * blocks that the bitmap points to from the main fork of the relation, but
+ * the block numbers of columnar tids don't correspond to physical blocks, and
+ * prefetching the blocks beyond the last segment of the relation would error
+ * out.
+ */
+static bool
+DisableColumnarBitmapPrefetchWalker(PlanState *planState, void *context)
+{
+	if (IsA(planState, BitmapHeapScanState))
+	{
+		BitmapHeapScanState *bitmapHeapScanState = (BitmapHeapScanState *) planState;
+		Relation relation = bitmapHeapScanState->ss.ss_currentRelation;
+		if (relation != NULL && relation->rd_tableam == GetColumnarTableAmRoutine())
+		{
+			bitmapHeapScanState->prefetch_maximum = 0;
+		}
+	}
+
+	return planstate_tree_walker(planState, DisableColumnarBitmapPrefetchWalker,
+								 context);
+}
+
+
 static bool
 columnar_scan_sample_next_block(TableScanDesc scan, SampleScanState *scanstate)
 {
@@ -2044,6 +2463,9 @@ columnar_tableam_init()
 							 standard_ProcessUtility;
 	ProcessUtility_hook = ColumnarProcessUtility;
 
+	PrevExecutorStartHook = ExecutorStart_hook;
+	ExecutorStart_hook = ColumnarExecutorStart;
+
 	columnar_customscan_init();
 
 	TTSOpsColumnar = TTSOpsVirtual;
@@ -2564,8 +2986,8 @@ static const TableAmRoutine columnar_am_methods = {
 
 	.relation_estimate_size = columnar_estimate_rel_size,
 
-	.scan_bitmap_next_block = NULL,
-	.scan_bitmap_next_tuple = NULL,
+	.scan_bitmap_next_block = columnar_scan_bitmap_next_block,
+	.scan_bitmap_next_tuple = columnar_scan_bitmap_next_tuple,
 	.scan_sample_next_block = columnar_scan_sample_next_block,
 	.scan_sample_next_tuple = columnar_scan_sample_next_tuple
 };
@@ -2769,6 +3191,473 @@ downgrade_columnar_storage(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * columnar_compact_stripes merges the runs of adjacent stripes of the given
+ * columnar table that have fewer rows than stripe_row_limit into full-sized
+ * stripes, and returns the number of stripes that were merged away.
+ *
+ * Only ShareUpdateExclusiveLock is taken, so the table can be read and
+ * written meanwhile. Readers keep seeing the old stripes until compaction
+ * commits, since stripe metadata is MVCC and the data of the old stripes is
+ * not removed from the storage. That space is reclaimed by VACUUM FULL.
+ *
+ * If nowait is true, tables whose lock is not available and tables whose
+ * stripes cannot be merged, see ColumnarRelationKeepsRowNumbers, are skipped
+ * rather than waited for or reported as errors. That is what the maintenance
+ * daemon relies on to pick the tables to compact. Tables that are dropped
+ * before the lock is acquired and temporary tables of other sessions are
+ * always skipped.
+ *
+ * DDL:
+ *   CREATE FUNCTION columnar.compact_stripes(table_name regclass,
+ *                                            nowait bool DEFAULT false)
+ *     RETURNS bigint
+ *     STRICT
+ *     LANGUAGE c AS 'MODULE_PATHNAME', 'columnar_compact_stripes';
+ */
+PG_FUNCTION_INFO_V1(columnar_compact_stripes);
+Datum
+columnar_compact_stripes(PG_FUNCTION_ARGS)
+{
+	Oid relationId = PG_GETARG_OID(0);
+	bool nowait = PG_GETARG_BOOL(1);
+
+	CheckCitusColumnarVersion(ERROR);
+
+	/*
+	 * ShareUpdateExclusiveLock conflicts with itself, VACUUM and with the
+	 * commands that create indexes or triggers, but not with reads and
+	 * inserts.
+	 */
+	if (nowait)
+	{
+		if (!ConditionalLockRelationOid(relationId, ShareUpdateExclusiveLock))
+		{
+			ereport(DEBUG1, (errmsg("skipping compaction of \"%s\" --- lock not "
+									"available", get_rel_name(relationId))));
+			PG_RETURN_INT64(0);
+		}
+	}
+	else
+	{
+		LockRelationOid(relationId, ShareUpdateExclusiveLock);
+	}
+
+	/* the table might have been dropped while we were waiting for the lock */
+	if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(relationId)))
+	{
+		UnlockRelationOid(relationId, ShareUpdateExclusiveLock);
+		PG_RETURN_INT64(0);
+	}
+
+	Relation relation = table_open(relationId, NoLock);
+
+	if (!object_ownercheck(RelationRelationId, relationId, GetUserId()))
+	{
+		aclcheck_error(ACLCHECK_NOT_OWNER, OBJECT_TABLE,
+					   RelationGetRelationName(relation));
+	}
+
+	if (!IsColumnarTableAmTable(relationId))
+	{
+		ereport(ERROR, (errmsg("table %s is not a columnar table",
+							   quote_identifier(RelationGetRelationName(relation)))));
+	}
+
+	/* we cannot read the buffers of temporary tables of other sessions */
+	if (RELATION_IS_OTHER_TEMP(relation))
+	{
+		table_close(relation, ShareUpdateExclusiveLock);
+		PG_RETURN_INT64(0);
+	}
+
+	/* merging stripes gives their rows new row numbers */
+	if (ColumnarRelationKeepsRowNumbers(relation))
+	{
+		if (nowait)
+		{
+			ereport(DEBUG1, (errmsg("skipping compaction of \"%s\" --- it has "
+									"indexes or row triggers",
+									RelationGetRelationName(relation))));
+			table_close(relation, ShareUpdateExclusiveLock);
+			PG_RETURN_INT64(0);
+		}
+
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("cannot compact stripes of columnar table %s because "
+							   "it has indexes or row triggers",
+							   quote_identifier(RelationGetRelationName(relation))),
+						errhint("Use VACUUM FULL to rewrite the table instead.")));
+	}
+
+	int64 mergedStripeCount = CompactColumnarStripes(relation);
+
+	/* keep the lock until the end of the transaction */
+	table_close(relation, NoLock);
+
+	PG_RETURN_INT64(mergedStripeCount);
+}
+
+
+/*
+ * CompactColumnarStripes merges each run of adjacent stripes of the given
+ * relation that should be compacted, see IsStripeToCompact. Returns the
+ * number of stripes that were merged away.
+ */
+static int64
+CompactColumnarStripes(Relation relation)
+{
+	ColumnarOptions columnarOptions = { 0 };
+	ReadColumnarOptions(RelationGetRelid(relation), &columnarOptions);
+
+	/* stripes are ordered by their first row numbers */
+	List *stripeList = StripesForRelfilelocator(RelationPhysicalIdentifier_compat(
+													relation));
+
+	/*
+	 * Read the rows with a snapshot taken after listing the stripes, so that
+	 * it sees all of them even in READ COMMITTED.
+	 */
+	Snapshot snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	int64 mergedStripeCount = 0;
+	List *stripeRun = NIL;
+
+	StripeMetadata *stripeMetadata = NULL;
+	foreach_declared_ptr(stripeMetadata, stripeList)
+	{
+		if (IsStripeToCompact(stripeMetadata, &columnarOptions))
+		{
+			stripeRun = lappend(stripeRun, stripeMetadata);
+			continue;
+		}
+
+		mergedStripeCount += MergeColumnarStripes(relation, stripeRun,
+												  &columnarOptions, snapshot);
+		stripeRun = NIL;
+	}
+
+	mergedStripeCount += MergeColumnarStripes(relation, stripeRun,
+											  &columnarOptions, snapshot);
+
+	UnregisterSnapshot(snapshot);
+
+	return mergedStripeCount;
+}
+
+
+/*
+ * IsStripeToCompact returns whether the given stripe is a flushed stripe that
+ * has fewer rows than the stripe_row_limit of the table.
+ */
+static bool
+IsStripeToCompact(StripeMetadata *stripeMetadata, ColumnarOptions *columnarOptions)
+{
+	return StripeWriteState(stripeMetadata) == STRIPE_WRITE_FLUSHED &&
+		   stripeMetadata->rowCount < columnarOptions->stripeRowCount;
+}
+
+
+/*
+ * MergeColumnarStripes rewrites the rows of the given stripes into as few new
+ * stripes as possible and removes the metadata of the given stripes. Returns
+ * the number of stripes that were merged away, which is 0 if merging wouldn't
+ * reduce the number of stripes.
+ */
+static int64
+MergeColumnarStripes(Relation relation, List *stripeList,
+					 ColumnarOptions *columnarOptions, Snapshot snapshot)
+{
+	uint64 totalRowCount = 0;
+
+	StripeMetadata *stripeMetadata = NULL;
+	foreach_declared_ptr(stripeMetadata, stripeList)
+	{
+		totalRowCount += stripeMetadata->rowCount;
+	}
+
+	uint64 stripeRowCount = columnarOptions->stripeRowCount;
+	int64 newStripeCount = (totalRowCount + stripeRowCount - 1) / stripeRowCount;
+	if (newStripeCount >= list_length(stripeList))
+	{
+		return 0;
+	}
+
+	RelFileLocator relfilelocator = RelationPhysicalIdentifier_compat(relation);
+	TupleDesc tupleDescriptor = RelationGetDescr(relation);
+	ColumnarWriteState *writeState = ColumnarBeginWrite(relfilelocator,
+														*columnarOptions,
+														tupleDescriptor);
+
+	int natts = tupleDescriptor->natts;
+	Bitmapset *attr_needed = bms_add_range(NULL, 0, natts - 1);
+	MemoryContext scanContext = CreateColumnarScanMemoryContext();
+
+	/* we pick the stripes to read ourselves, see ColumnarReadSetStripeList */
+	bool randomAccess = true;
+	ColumnarReadState *readState = init_columnar_read_state(relation, tupleDescriptor,
+															attr_needed, NIL,
+															scanContext, snapshot,
+															randomAccess, NULL);
+
+	/*
+	 * Only read the given stripes, but read them sequentially rather than
+	 * row by row. Stripes that were committed after we listed the stripes
+	 * might sit between them in row number order.
+	 */
+	ColumnarReadSetStripeList(readState, stripeList);
+
+	Datum *values = palloc0(natts * sizeof(Datum));
+	bool *nulls = palloc0(natts * sizeof(bool));
+
+	uint64 readRowCount = 0;
+	while (ColumnarReadNextRow(readState, values, nulls, NULL))
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		ColumnarWriteRow(writeState, values, nulls);
+		readRowCount++;
+	}
+
+	if (readRowCount != totalRowCount)
+	{
+		ereport(ERROR, (errmsg("cannot compact stripes of columnar table %s, read "
+							   UINT64_FORMAT " rows while the stripes have "
+							   UINT64_FORMAT " rows",
+							   quote_identifier(RelationGetRelationName(relation)),
+							   readRowCount, totalRowCount)));
+	}
+
+	ColumnarEndWrite(writeState);
+	ColumnarEndRead(readState);
+	MemoryContextDelete(scanContext);
+
+	foreach_declared_ptr(stripeMetadata, stripeList)
+	{
+		DeleteStripeMetadataRows(relfilelocator, stripeMetadata->id);
+	}
+
+	CommandCounterIncrement();
+
+	return list_length(stripeList) - newStripeCount;
+}
+
+
+/*
+ * columnar_train_zstd_dictionary trains a zstd dictionary from a sample of the
+ * value buffers of the chunks of the given columnar table, stores it in
+ * columnar.zstd_dictionary and returns its id.
+ *
+ * Each chunk is compressed on its own, so small chunks compress poorly when
+ * they share a vocabulary that zstd has to learn again for every chunk. The
+ * chunks that are written with zstd compression after the dictionary is
+ * trained are compressed with it. Existing chunks keep their compression
+ * until they are rewritten, e.g. by columnar.compact_stripes. Since a table
+ * rewrite like VACUUM FULL gives the table a new storage, it also discards
+ * the dictionaries of the table.
+ *
+ * DDL:
+ *   CREATE FUNCTION columnar.train_zstd_dictionary(table_name regclass,
+ *                                                  dictionary_size int
+ *                                                  DEFAULT 65536)
+ *     RETURNS bigint
+ *     STRICT
+ *     LANGUAGE c AS 'MODULE_PATHNAME', 'columnar_train_zstd_dictionary';
+ */
+PG_FUNCTION_INFO_V1(columnar_train_zstd_dictionary);
+Datum
+columnar_train_zstd_dictionary(PG_FUNCTION_ARGS)
+{
+	Oid relationId = PG_GETARG_OID(0);
+	int32 dictionarySize = PG_GETARG_INT32(1);
+
+	CheckCitusColumnarVersion(ERROR);
+
+	if (dictionarySize < ZSTD_DICTIONARY_SIZE_MIN ||
+		dictionarySize > ZSTD_DICTIONARY_SIZE_MAX)
+	{
+		ereport(ERROR, (errmsg("zstd dictionary size out of range"),
+						errhint("zstd dictionary size must be between %d and %d",
+								ZSTD_DICTIONARY_SIZE_MIN, ZSTD_DICTIONARY_SIZE_MAX)));
+	}
+
+	/* dictionaries are only added, so the table can be read and written */
+	Relation relation = table_open(relationId, ShareUpdateExclusiveLock);
+
+	if (!object_ownercheck(RelationRelationId, relationId, GetUserId()))
+	{
+		aclcheck_error(ACLCHECK_NOT_OWNER, OBJECT_TABLE,
+					   RelationGetRelationName(relation));
+	}
+
+	if (!IsColumnarTableAmTable(relationId))
+	{
+		ereport(ERROR, (errmsg("table %s is not a columnar table",
+							   quote_identifier(RelationGetRelationName(relation)))));
+	}
+
+	StringInfo sampleBuffer = makeStringInfo();
+	List *sampleSizeList = NIL;
+	SampleChunkValueBuffers(relation,
+							(uint64) dictionarySize * ZSTD_DICTIONARY_SAMPLE_RATIO,
+							sampleBuffer, &sampleSizeList);
+
+	uint32 sampleCount = list_length(sampleSizeList);
+	if (sampleCount == 0)
+	{
+		ereport(ERROR, (errmsg("cannot train zstd dictionary for table %s because "
+							   "it has no data",
+							   quote_identifier(RelationGetRelationName(relation)))));
+	}
+
+	size_t *sampleSizes = palloc(sampleCount * sizeof(size_t));
+	uint32 sampleIndex = 0;
+
+	int sampleSize = 0;
+	foreach_declared_int(sampleSize, sampleSizeList)
+	{
+		sampleSizes[sampleIndex++] = sampleSize;
+	}
+
+	uint32 dictionaryId = ColumnarMetadataNewZstdDictionaryId();
+	StringInfo dictionary = TrainZstdDictionary(sampleBuffer, sampleSizes, sampleCount,
+												dictionarySize, dictionaryId);
+
+	SaveColumnarZstdDictionary(RelationPhysicalIdentifier_compat(relation),
+							   dictionaryId, dictionary);
+
+	/* keep the lock until the end of the transaction */
+	table_close(relation, NoLock);
+
+	PG_RETURN_INT64(dictionaryId);
+}
+
+
+/*
+ * SampleChunkValueBuffers appends about sampleByteLimit bytes of decompressed
+ * value buffers of the chunks of the given relation to sampleBuffer, taken
+ * from chunks that are spread evenly over the relation, and appends the size
+ * of each sample to sampleSizeList. Value buffers are cut into samples of at
+ * most ZSTD_DICTIONARY_SAMPLE_SIZE bytes.
+ */
+static void
+SampleChunkValueBuffers(Relation relation, uint64 sampleByteLimit,
+						StringInfo sampleBuffer, List **sampleSizeList)
+{
+	RelFileLocator relfilelocator = RelationPhysicalIdentifier_compat(relation);
+	TupleDesc tupleDescriptor = RelationGetDescr(relation);
+	List *stripeList = StripesForRelfilelocator(relfilelocator);
+	Snapshot snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/* first find the chunks to sample from and their total size */
+	List *chunkOffsetList = NIL;
+	List *chunkSkipNodeList = NIL;
+	uint64 totalByteCount = 0;
+
+	StripeMetadata *stripeMetadata = NULL;
+	foreach_declared_ptr(stripeMetadata, stripeList)
+	{
+		if (StripeWriteState(stripeMetadata) != STRIPE_WRITE_FLUSHED)
+		{
+			continue;
+		}
+
+		StripeSkipList *stripeSkipList =
+			ReadStripeSkipList(relfilelocator, stripeMetadata->id, tupleDescriptor,
+							   stripeMetadata->chunkCount, snapshot);
+
+		for (uint32 columnIndex = 0; columnIndex < stripeSkipList->columnCount;
+			 columnIndex++)
+		{
+			if (TupleDescAttr(tupleDescriptor, columnIndex)->attisdropped)
+			{
+				continue;
+			}
+
+			for (uint32 chunkIndex = 0; chunkIndex < stripeSkipList->chunkCount;
+				 chunkIndex++)
+			{
+				ColumnChunkSkipNode *chunkSkipNode =
+					&stripeSkipList->chunkSkipNodeArray[columnIndex][chunkIndex];
+				if (chunkSkipNode->valueLength == 0)
+				{
+					continue;
+				}
+
+				uint64 *chunkOffset = palloc(sizeof(uint64));
+				*chunkOffset = stripeMetadata->fileOffset +
+							   chunkSkipNode->valueChunkOffset;
+
+				chunkOffsetList = lappend(chunkOffsetList, chunkOffset);
+				chunkSkipNodeList = lappend(chunkSkipNodeList, chunkSkipNode);
+				totalByteCount += chunkSkipNode->decompressedValueSize;
+			}
+		}
+	}
+
+	/*
+	 * Then read a chunk whenever the samples fall behind their share of the
+	 * chunks seen so far, until there are sampleByteLimit bytes of samples.
+	 */
+	uint64 seenByteCount = 0;
+
+	ListCell *chunkOffsetCell = NULL;
+	ListCell *chunkSkipNodeCell = NULL;
+	forboth(chunkOffsetCell, chunkOffsetList, chunkSkipNodeCell, chunkSkipNodeList)
+	{
+		uint64 chunkOffset = *(uint64 *) lfirst(chunkOffsetCell);
+		ColumnChunkSkipNode *chunkSkipNode = lfirst(chunkSkipNodeCell);
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (sampleBuffer->len >= sampleByteLimit)
+		{
+			break;
+		}
+
+		seenByteCount += chunkSkipNode->decompressedValueSize;
+		if ((double) sampleBuffer->len >=
+			(double) sampleByteLimit * seenByteCount / totalByteCount)
+		{
+			continue;
+		}
+
+		StringInfo valueBuffer = makeStringInfo();
+		enlargeStringInfo(valueBuffer, chunkSkipNode->valueLength);
+		ColumnarStorageRead(relation, chunkOffset, valueBuffer->data,
+							chunkSkipNode->valueLength);
+		valueBuffer->len = chunkSkipNode->valueLength;
+
+		StringInfo decompressedBuffer =
+			DecompressBuffer(valueBuffer, chunkSkipNode->valueCompressionType,
+							 chunkSkipNode->decompressedValueSize);
+
+		for (int sampleOffset = 0; sampleOffset < decompressedBuffer->len;
+			 sampleOffset += ZSTD_DICTIONARY_SAMPLE_SIZE)
+		{
+			int sampleSize = Min(ZSTD_DICTIONARY_SAMPLE_SIZE,
+								 decompressedBuffer->len - sampleOffset);
+
+			appendBinaryStringInfo(sampleBuffer,
+								   decompressedBuffer->data + sampleOffset,
+								   sampleSize);
+			*sampleSizeList = lappend_int(*sampleSizeList, sampleSize);
+		}
+
+		if (decompressedBuffer != valueBuffer)
+		{
+			pfree(decompressedBuffer->data);
+			pfree(decompressedBuffer);
+		}
+
+		pfree(valueBuffer->data);
+		pfree(valueBuffer);
+	}
+
+	UnregisterSnapshot(snapshot);
+}
+
+
 /*
  * Code to check the Citus Version, helps remove dependency from Citus
  */
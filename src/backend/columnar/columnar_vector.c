@@ -0,0 +1,1573 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_vector.c
+ *
+ * This file contains the functions to evaluate pushed-down quals over the
+ * column vectors of a deserialized chunk group. Rows that pass all quals are
+ * tracked in a selection vector, so that the custom scan only needs to
+ * materialize those rows into tuple slots.
+ *
+ * Quals on int2, int4, int8, float8, date, timestamp and timestamptz columns
+ * with a btree comparison operator take a fast path that compares the values
+ * directly in tight loops (which compilers can auto-vectorize) instead of
+ * calling the operator function for each value. The same comparisons are used
+ * by the reader to skip chunk groups based on their min/max values.
+ *
+ * This file also contains the transition functions of the aggregates that the
+ * columnar aggregate scan computes, either over the selected rows of a chunk
+ * group or directly from the skip nodes of chunk groups whose rows all pass
+ * the quals.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "fmgr.h"
+
+#include "catalog/pg_aggregate.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_namespace.h"
+#include "catalog/pg_type.h"
+#include "commands/defrem.h"
+#include "common/int.h"
+#include "nodes/nodeFuncs.h"
+#include "nodes/primnodes.h"
+#include "optimizer/optimizer.h"
+#include "utils/builtins.h"
+#include "utils/float.h"
+#include "utils/lsyscache.h"
+#include "utils/numeric.h"
+
+#include "columnar/columnar.h"
+#include "columnar/columnar_vector.h"
+
+#include "distributed/listutils.h"
+
+static void BuildColumnarVectorQualsRec(Node *node, List **vectorQualList,
+										bool fastPathOnly, bool *allQualsConverted);
+static ColumnarVectorQual * BuildColumnarVectorQual(OpExpr *opExpr);
+static void SetVectorQualFastPath(ColumnarVectorQual *vectorQual, OpExpr *opExpr,
+								  Var *var, Const *constValue);
+static ColumnarVectorFastPath FastPathForType(Oid typeId);
+static bool FastPathConstTypeMatches(Oid varTypeId, Oid constTypeId);
+static int64 FastPathIntValue(Oid typeId, Datum value);
+static StrategyNumber CommuteStrategy(StrategyNumber strategy);
+static uint32 FilterColumnVector(ColumnarVectorQual *vectorQual, ChunkData *chunkData,
+								 uint32 *selectionVector, uint32 selectedRowCount);
+static uint32 FilterColumnVectorFastPath(ColumnarVectorQual *vectorQual,
+										 bool *existsArray, Datum *valueArray,
+										 uint32 *selectionVector,
+										 uint32 selectedRowCount);
+static uint32 FilterInt64Values(const int64 *values, const bool *exists,
+								uint32 *selectionVector, uint32 selectedRowCount,
+								StrategyNumber strategy, int64 constValue);
+static uint32 FilterFloat8Values(const float8 *values, const bool *exists,
+								 uint32 *selectionVector, uint32 selectedRowCount,
+								 StrategyNumber strategy, float8 constValue);
+static int CompareFastPathValue(ColumnarVectorQual *vectorQual, Datum value);
+static Datum FastPathIntDatum(ColumnarVectorFastPath fastPath, int64 value);
+static uint32 GatherInt64Values(ColumnarVectorFastPath fastPath, bool *existsArray,
+								Datum *valueArray, uint32 *selectionVector,
+								uint32 selectedRowCount, int64 *values);
+static uint32 GatherFloat8Values(bool *existsArray, Datum *valueArray,
+								 uint32 *selectionVector, uint32 selectedRowCount,
+								 float8 *values);
+static void AggregateInt64Values(ColumnarVectorAggregate *aggregate,
+								 const int64 *values, uint32 valueCount);
+static void AggregateFloat8Values(ColumnarVectorAggregate *aggregate,
+								  const float8 *values, uint32 valueCount);
+static void AddToNumericSum(ColumnarVectorAggregate *aggregate, int64 value);
+static Oid SumResultType(Oid typeId);
+
+
+/*
+ * BuildColumnarVectorQuals returns a list of ColumnarVectorQual's for the
+ * quals in given (implicitly AND'ed) qual list that can be evaluated over
+ * column vectors. Quals that cannot be vectorized are simply skipped, so
+ * unless allQualsConverted is set to true, callers must still evaluate the
+ * full qual list for the rows that pass the vectorized quals.
+ *
+ * allQualsConverted can be NULL if the caller evaluates the full qual list
+ * anyway.
+ */
+List *
+BuildColumnarVectorQuals(List *qualList, bool *allQualsConverted)
+{
+	List *vectorQualList = NIL;
+	bool allConverted = true;
+
+	Node *qual = NULL;
+	foreach_declared_ptr(qual, qualList)
+	{
+		BuildColumnarVectorQualsRec(qual, &vectorQualList, false, &allConverted);
+	}
+
+	if (allQualsConverted != NULL)
+	{
+		*allQualsConverted = allConverted;
+	}
+
+	return vectorQualList;
+}
+
+
+/*
+ * BuildColumnarFastPathQuals is similar to BuildColumnarVectorQuals, but only
+ * returns the quals that can take the fast path. allQualsConverted is set to
+ * true if the returned quals are equivalent to the given qual list, i.e., if
+ * every qual in the list could be converted.
+ */
+List *
+BuildColumnarFastPathQuals(List *qualList, bool *allQualsConverted)
+{
+	List *vectorQualList = NIL;
+	*allQualsConverted = true;
+
+	Node *qual = NULL;
+	foreach_declared_ptr(qual, qualList)
+	{
+		BuildColumnarVectorQualsRec(qual, &vectorQualList, true, allQualsConverted);
+	}
+
+	return vectorQualList;
+}
+
+
+/*
+ * BuildColumnarVectorQualsRec descends into AND expressions and appends the
+ * vectorizable quals found to vectorQualList. If fastPathOnly is true, then
+ * only the quals that can take the fast path are appended. allQualsConverted
+ * is set to false if we come across a qual that is not appended.
+ */
+static void
+BuildColumnarVectorQualsRec(Node *node, List **vectorQualList, bool fastPathOnly,
+							bool *allQualsConverted)
+{
+	if (node == NULL)
+	{
+		return;
+	}
+
+	if (is_andclause(node))
+	{
+		Node *arg = NULL;
+		foreach_declared_ptr(arg, ((BoolExpr *) node)->args)
+		{
+			BuildColumnarVectorQualsRec(arg, vectorQualList, fastPathOnly,
+										allQualsConverted);
+		}
+
+		return;
+	}
+
+	ColumnarVectorQual *vectorQual = NULL;
+	if (IsA(node, OpExpr))
+	{
+		vectorQual = BuildColumnarVectorQual((OpExpr *) node);
+	}
+
+	if (vectorQual != NULL &&
+		(!fastPathOnly || vectorQual->fastPath != VECTOR_FAST_PATH_NONE))
+	{
+		*vectorQualList = lappend(*vectorQualList, vectorQual);
+	}
+	else
+	{
+		*allQualsConverted = false;
+	}
+}
+
+
+/*
+ * BuildColumnarVectorQual returns a ColumnarVectorQual for given operator
+ * expression if it is in the form of "Var op Const" or "Const op Var", or
+ * NULL otherwise.
+ *
+ * We only vectorize strict and leakproof operators. Strictness allows us to
+ * skip NULL values without calling the operator, and since the vectorized
+ * quals might be evaluated before other quals of the scan (such as row level
+ * security policies), operators must not leak any information about the
+ * values they are called with.
+ */
+static ColumnarVectorQual *
+BuildColumnarVectorQual(OpExpr *opExpr)
+{
+	if (list_length(opExpr->args) != 2)
+	{
+		return NULL;
+	}
+
+	Node *leftArg = (Node *) linitial(opExpr->args);
+	Node *rightArg = (Node *) lsecond(opExpr->args);
+
+	Var *var = NULL;
+	Const *constValue = NULL;
+	bool varOnRight = false;
+
+	if (IsA(leftArg, Var) && IsA(rightArg, Const))
+	{
+		var = (Var *) leftArg;
+		constValue = (Const *) rightArg;
+	}
+	else if (IsA(leftArg, Const) && IsA(rightArg, Var))
+	{
+		var = (Var *) rightArg;
+		constValue = (Const *) leftArg;
+		varOnRight = true;
+	}
+	else
+	{
+		return NULL;
+	}
+
+	if (var->varattno <= 0 || var->varlevelsup != 0 || constValue->constisnull)
+	{
+		return NULL;
+	}
+
+	Oid functionId = opExpr->opfuncid;
+	if (!OidIsValid(functionId))
+	{
+		functionId = get_opcode(opExpr->opno);
+	}
+
+	if (!OidIsValid(functionId) || opExpr->opretset ||
+		!func_strict(functionId) || !get_func_leakproof(functionId))
+	{
+		return NULL;
+	}
+
+	ColumnarVectorQual *vectorQual = palloc0(sizeof(ColumnarVectorQual));
+	vectorQual->columnIndex = var->varattno - 1;
+	vectorQual->inputCollation = opExpr->inputcollid;
+	vectorQual->constValue = constValue->constvalue;
+	vectorQual->varOnRight = varOnRight;
+	fmgr_info(functionId, &vectorQual->operatorFunction);
+
+	SetVectorQualFastPath(vectorQual, opExpr, var, constValue);
+
+	return vectorQual;
+}
+
+
+/*
+ * SetVectorQualFastPath sets the fast path fields of given vector qual if the
+ * Var has one of the types supported by the fast path and the operator is a
+ * member of the default btree operator family of that type.
+ */
+static void
+SetVectorQualFastPath(ColumnarVectorQual *vectorQual, OpExpr *opExpr, Var *var,
+					  Const *constValue)
+{
+	vectorQual->fastPath = VECTOR_FAST_PATH_NONE;
+
+	ColumnarVectorFastPath fastPath = FastPathForType(var->vartype);
+	if (fastPath == VECTOR_FAST_PATH_NONE ||
+		!FastPathConstTypeMatches(var->vartype, constValue->consttype))
+	{
+		return;
+	}
+
+	Oid operatorClassId = GetDefaultOpClass(var->vartype, BTREE_AM_OID);
+	if (!OidIsValid(operatorClassId))
+	{
+		return;
+	}
+
+	Oid operatorFamilyId = get_opclass_family(operatorClassId);
+	if (!op_in_opfamily(opExpr->opno, operatorFamilyId))
+	{
+		return;
+	}
+
+	int strategy = InvalidStrategy;
+	Oid leftTypeId = InvalidOid;
+	Oid rightTypeId = InvalidOid;
+	get_op_opfamily_properties(opExpr->opno, operatorFamilyId, false,
+							   &strategy, &leftTypeId, &rightTypeId);
+
+	Oid varSideTypeId = vectorQual->varOnRight ? rightTypeId : leftTypeId;
+	Oid constSideTypeId = vectorQual->varOnRight ? leftTypeId : rightTypeId;
+	if (varSideTypeId != var->vartype || constSideTypeId != constValue->consttype ||
+		strategy < BTLessStrategyNumber || strategy > BTGreaterStrategyNumber)
+	{
+		return;
+	}
+
+	vectorQual->fastPath = fastPath;
+	vectorQual->strategy = vectorQual->varOnRight ? CommuteStrategy(strategy) :
+						   strategy;
+
+	if (fastPath == VECTOR_FAST_PATH_FLOAT8)
+	{
+		vectorQual->floatConstValue = DatumGetFloat8(constValue->constvalue);
+	}
+	else
+	{
+		vectorQual->intConstValue = FastPathIntValue(constValue->consttype,
+													 constValue->constvalue);
+	}
+}
+
+
+/*
+ * FastPathForType returns how values of given type are compared by the fast
+ * path, or VECTOR_FAST_PATH_NONE if the type is not supported.
+ */
+static ColumnarVectorFastPath
+FastPathForType(Oid typeId)
+{
+	switch (typeId)
+	{
+		case INT2OID:
+		{
+			return VECTOR_FAST_PATH_INT16;
+		}
+
+		case INT4OID:
+		case DATEOID:
+		{
+			return VECTOR_FAST_PATH_INT32;
+		}
+
+		case INT8OID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		{
+			return VECTOR_FAST_PATH_INT64;
+		}
+
+		case FLOAT8OID:
+		{
+			return VECTOR_FAST_PATH_FLOAT8;
+		}
+
+		default:
+		{
+			return VECTOR_FAST_PATH_NONE;
+		}
+	}
+}
+
+
+/*
+ * FastPathConstTypeMatches returns true if a constant of type constTypeId can
+ * be compared to the values of type varTypeId by the fast path. Integer types
+ * can be compared to each other after converting to int64, but other types
+ * need to match exactly since cross-type operators (e.g. date < timestamp)
+ * compare values that are represented in different units.
+ */
+static bool
+FastPathConstTypeMatches(Oid varTypeId, Oid constTypeId)
+{
+	switch (varTypeId)
+	{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		{
+			return constTypeId == INT2OID || constTypeId == INT4OID ||
+				   constTypeId == INT8OID;
+		}
+
+		default:
+		{
+			return varTypeId == constTypeId;
+		}
+	}
+}
+
+
+/*
+ * FastPathIntValue converts given datum of an integer-like type supported by
+ * the fast path into an int64.
+ */
+static int64
+FastPathIntValue(Oid typeId, Datum value)
+{
+	switch (FastPathForType(typeId))
+	{
+		case VECTOR_FAST_PATH_INT16:
+		{
+			return DatumGetInt16(value);
+		}
+
+		case VECTOR_FAST_PATH_INT32:
+		{
+			return DatumGetInt32(value);
+		}
+
+		case VECTOR_FAST_PATH_INT64:
+		{
+			return DatumGetInt64(value);
+		}
+
+		default:
+		{
+			elog(ERROR, "unexpected type for columnar fast path: %u", typeId);
+		}
+	}
+}
+
+
+/*
+ * CommuteStrategy returns the btree strategy for "b op a" given the strategy
+ * for "a op b".
+ */
+static StrategyNumber
+CommuteStrategy(StrategyNumber strategy)
+{
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+		{
+			return BTGreaterStrategyNumber;
+		}
+
+		case BTLessEqualStrategyNumber:
+		{
+			return BTGreaterEqualStrategyNumber;
+		}
+
+		case BTGreaterEqualStrategyNumber:
+		{
+			return BTLessEqualStrategyNumber;
+		}
+
+		case BTGreaterStrategyNumber:
+		{
+			return BTLessStrategyNumber;
+		}
+
+		default:
+		{
+			return strategy;
+		}
+	}
+}
+
+
+/*
+ * ColumnarVectorQualRefutesRange returns true if no value in the range
+ * [minimumValue, maximumValue] can satisfy given fast path qual. Since min/max
+ * values of chunks are computed with the btree comparison function of the
+ * column type, the comparisons here follow the same ordering (e.g. NaN is
+ * larger than any other float8 value).
+ */
+bool
+ColumnarVectorQualRefutesRange(ColumnarVectorQual *vectorQual, Datum minimumValue,
+							   Datum maximumValue)
+{
+	Assert(vectorQual->fastPath != VECTOR_FAST_PATH_NONE);
+
+	if (vectorQual->fastPath == VECTOR_FAST_PATH_FLOAT8)
+	{
+		float8 minimum = DatumGetFloat8(minimumValue);
+		float8 maximum = DatumGetFloat8(maximumValue);
+		float8 constant = vectorQual->floatConstValue;
+
+		switch (vectorQual->strategy)
+		{
+			case BTLessStrategyNumber:
+			{
+				return float8_ge(minimum, constant);
+			}
+
+			case BTLessEqualStrategyNumber:
+			{
+				return float8_gt(minimum, constant);
+			}
+
+			case BTEqualStrategyNumber:
+			{
+				return float8_lt(constant, minimum) || float8_gt(constant, maximum);
+			}
+
+			case BTGreaterEqualStrategyNumber:
+			{
+				return float8_lt(maximum, constant);
+			}
+
+			case BTGreaterStrategyNumber:
+			{
+				return float8_le(maximum, constant);
+			}
+
+			default:
+			{
+				return false;
+			}
+		}
+	}
+
+	int64 minimum = 0;
+	int64 maximum = 0;
+	switch (vectorQual->fastPath)
+	{
+		case VECTOR_FAST_PATH_INT16:
+		{
+			minimum = DatumGetInt16(minimumValue);
+			maximum = DatumGetInt16(maximumValue);
+			break;
+		}
+
+		case VECTOR_FAST_PATH_INT32:
+		{
+			minimum = DatumGetInt32(minimumValue);
+			maximum = DatumGetInt32(maximumValue);
+			break;
+		}
+
+		default:
+		{
+			minimum = DatumGetInt64(minimumValue);
+			maximum = DatumGetInt64(maximumValue);
+			break;
+		}
+	}
+
+	int64 constant = vectorQual->intConstValue;
+
+	switch (vectorQual->strategy)
+	{
+		case BTLessStrategyNumber:
+		{
+			return minimum >= constant;
+		}
+
+		case BTLessEqualStrategyNumber:
+		{
+			return minimum > constant;
+		}
+
+		case BTEqualStrategyNumber:
+		{
+			return constant < minimum || constant > maximum;
+		}
+
+		case BTGreaterEqualStrategyNumber:
+		{
+			return maximum < constant;
+		}
+
+		case BTGreaterStrategyNumber:
+		{
+			return maximum <= constant;
+		}
+
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+
+/*
+ * ColumnarVectorQualImpliedByRange returns true if every value in the range
+ * [minimumValue, maximumValue] satisfies given fast path qual, i.e., if all
+ * non-NULL values of a chunk with these min/max values pass the qual.
+ */
+bool
+ColumnarVectorQualImpliedByRange(ColumnarVectorQual *vectorQual, Datum minimumValue,
+								 Datum maximumValue)
+{
+	Assert(vectorQual->fastPath != VECTOR_FAST_PATH_NONE);
+
+	switch (vectorQual->strategy)
+	{
+		case BTLessStrategyNumber:
+		{
+			return CompareFastPathValue(vectorQual, maximumValue) < 0;
+		}
+
+		case BTLessEqualStrategyNumber:
+		{
+			return CompareFastPathValue(vectorQual, maximumValue) <= 0;
+		}
+
+		case BTEqualStrategyNumber:
+		{
+			return CompareFastPathValue(vectorQual, minimumValue) == 0 &&
+				   CompareFastPathValue(vectorQual, maximumValue) == 0;
+		}
+
+		case BTGreaterEqualStrategyNumber:
+		{
+			return CompareFastPathValue(vectorQual, minimumValue) >= 0;
+		}
+
+		case BTGreaterStrategyNumber:
+		{
+			return CompareFastPathValue(vectorQual, minimumValue) > 0;
+		}
+
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+
+/*
+ * CompareFastPathValue compares given value of the qual's column to the
+ * qual's constant, and returns a negative number, zero or a positive number
+ * if the value is smaller than, equal to or larger than the constant.
+ */
+static int
+CompareFastPathValue(ColumnarVectorQual *vectorQual, Datum value)
+{
+	if (vectorQual->fastPath == VECTOR_FAST_PATH_FLOAT8)
+	{
+		return float8_cmp_internal(DatumGetFloat8(value), vectorQual->floatConstValue);
+	}
+
+	int64 intValue = 0;
+	switch (vectorQual->fastPath)
+	{
+		case VECTOR_FAST_PATH_INT16:
+		{
+			intValue = DatumGetInt16(value);
+			break;
+		}
+
+		case VECTOR_FAST_PATH_INT32:
+		{
+			intValue = DatumGetInt32(value);
+			break;
+		}
+
+		default:
+		{
+			intValue = DatumGetInt64(value);
+			break;
+		}
+	}
+
+	if (intValue < vectorQual->intConstValue)
+	{
+		return -1;
+	}
+
+	return intValue > vectorQual->intConstValue ? 1 : 0;
+}
+
+
+/*
+ * ColumnarVectorFilter evaluates the given vectorized quals over the rows of
+ * given batch. It stores the indexes of the rows that pass all the quals into
+ * selectionVector, which must have room for batch->rowCount entries, and
+ * returns the number of such rows.
+ */
+uint32
+ColumnarVectorFilter(List *vectorQualList, ColumnarBatch *batch,
+					 uint32 *selectionVector)
+{
+	uint32 selectedRowCount = 0;
+
+	for (uint32 rowIndex = batch->startRow; rowIndex < batch->rowCount; rowIndex++)
+	{
+		selectionVector[selectedRowCount++] = rowIndex;
+	}
+
+	ColumnarVectorQual *vectorQual = NULL;
+	foreach_declared_ptr(vectorQual, vectorQualList)
+	{
+		if (selectedRowCount == 0)
+		{
+			break;
+		}
+
+		selectedRowCount = FilterColumnVector(vectorQual, batch->chunkData,
+											  selectionVector, selectedRowCount);
+	}
+
+	return selectedRowCount;
+}
+
+
+/*
+ * FilterColumnVector evaluates given vectorized qual for the rows listed in
+ * selectionVector, compacts selectionVector in place to the rows that pass
+ * the qual and returns the number of such rows.
+ */
+static uint32
+FilterColumnVector(ColumnarVectorQual *vectorQual, ChunkData *chunkData,
+				   uint32 *selectionVector, uint32 selectedRowCount)
+{
+	bool *existsArray = chunkData->existsArray[vectorQual->columnIndex];
+	Datum *valueArray = chunkData->valueArray[vectorQual->columnIndex];
+
+	if (existsArray == NULL)
+	{
+		/* column is not loaded, leave it to the executor */
+		return selectedRowCount;
+	}
+
+	if (vectorQual->fastPath != VECTOR_FAST_PATH_NONE)
+	{
+		return FilterColumnVectorFastPath(vectorQual, existsArray, valueArray,
+										  selectionVector, selectedRowCount);
+	}
+
+	int varArgIndex = vectorQual->varOnRight ? 1 : 0;
+	int constArgIndex = 1 - varArgIndex;
+
+	LOCAL_FCINFO(fcinfo, 2);
+	InitFunctionCallInfoData(*fcinfo, &vectorQual->operatorFunction, 2,
+							 vectorQual->inputCollation, NULL, NULL);
+	fcinfo->args[constArgIndex].value = vectorQual->constValue;
+	fcinfo->args[constArgIndex].isnull = false;
+	fcinfo->args[varArgIndex].isnull = false;
+
+	uint32 newSelectedRowCount = 0;
+	for (uint32 selectionIndex = 0; selectionIndex < selectedRowCount; selectionIndex++)
+	{
+		uint32 rowIndex = selectionVector[selectionIndex];
+
+		/* operator is strict, so NULL values can never pass the qual */
+		if (!existsArray[rowIndex])
+		{
+			continue;
+		}
+
+		fcinfo->args[varArgIndex].value = valueArray[rowIndex];
+		fcinfo->isnull = false;
+
+		Datum result = FunctionCallInvoke(fcinfo);
+		if (!fcinfo->isnull && DatumGetBool(result))
+		{
+			selectionVector[newSelectedRowCount++] = rowIndex;
+		}
+	}
+
+	return newSelectedRowCount;
+}
+
+
+/*
+ * FilterColumnVectorFastPath is the fast path of FilterColumnVector. It first
+ * gathers the selected values into a contiguous array of int64 or float8 and
+ * then runs the comparison kernel for the qual's strategy over that array.
+ */
+static uint32
+FilterColumnVectorFastPath(ColumnarVectorQual *vectorQual, bool *existsArray,
+						   Datum *valueArray, uint32 *selectionVector,
+						   uint32 selectedRowCount)
+{
+	bool *exists = palloc(selectedRowCount * sizeof(bool));
+	uint32 newSelectedRowCount = 0;
+
+	for (uint32 selectionIndex = 0; selectionIndex < selectedRowCount; selectionIndex++)
+	{
+		exists[selectionIndex] = existsArray[selectionVector[selectionIndex]];
+	}
+
+	if (vectorQual->fastPath == VECTOR_FAST_PATH_FLOAT8)
+	{
+		float8 *values = palloc0(selectedRowCount * sizeof(float8));
+
+		/* values of NULL rows are not set, so skip them */
+		for (uint32 selectionIndex = 0; selectionIndex < selectedRowCount;
+			 selectionIndex++)
+		{
+			if (exists[selectionIndex])
+			{
+				uint32 rowIndex = selectionVector[selectionIndex];
+				values[selectionIndex] = DatumGetFloat8(valueArray[rowIndex]);
+			}
+		}
+
+		newSelectedRowCount = FilterFloat8Values(values, exists, selectionVector,
+												 selectedRowCount, vectorQual->strategy,
+												 vectorQual->floatConstValue);
+		pfree(values);
+	}
+	else
+	{
+		int64 *values = palloc0(selectedRowCount * sizeof(int64));
+
+		for (uint32 selectionIndex = 0; selectionIndex < selectedRowCount;
+			 selectionIndex++)
+		{
+			if (!exists[selectionIndex])
+			{
+				continue;
+			}
+
+			Datum value = valueArray[selectionVector[selectionIndex]];
+			switch (vectorQual->fastPath)
+			{
+				case VECTOR_FAST_PATH_INT16:
+				{
+					values[selectionIndex] = DatumGetInt16(value);
+					break;
+				}
+
+				case VECTOR_FAST_PATH_INT32:
+				{
+					values[selectionIndex] = DatumGetInt32(value);
+					break;
+				}
+
+				default:
+				{
+					values[selectionIndex] = DatumGetInt64(value);
+					break;
+				}
+			}
+		}
+
+		newSelectedRowCount = FilterInt64Values(values, exists, selectionVector,
+												selectedRowCount, vectorQual->strategy,
+												vectorQual->intConstValue);
+		pfree(values);
+	}
+
+	pfree(exists);
+
+	return newSelectedRowCount;
+}
+
+
+/*
+ * FilterInt64Values compacts selectionVector to the entries whose value is
+ * not NULL and satisfies "value strategy constValue", and returns the number
+ * of such entries. values and exists are indexed by position in the selection
+ * vector. The loops are kept branch-free so that they can be vectorized.
+ */
+static uint32
+FilterInt64Values(const int64 *values, const bool *exists, uint32 *selectionVector,
+				  uint32 selectedRowCount, StrategyNumber strategy, int64 constValue)
+{
+	uint32 newSelectedRowCount = 0;
+
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+		{
+			for (uint32 index = 0; index < selectedRowCount; index++)
+			{
+				selectionVector[newSelectedRowCount] = selectionVector[index];
+				newSelectedRowCount += exists[index] & (values[index] < constValue);
+			}
+			break;
+		}
+
+		case BTLessEqualStrategyNumber:
+		{
+			for (uint32 index = 0; index < selectedRowCount; index++)
+			{
+				selectionVector[newSelectedRowCount] = selectionVector[index];
+				newSelectedRowCount += exists[index] & (values[index] <= constValue);
+			}
+			break;
+		}
+
+		case BTEqualStrategyNumber:
+		{
+			for (uint32 index = 0; index < selectedRowCount; index++)
+			{
+				selectionVector[newSelectedRowCount] = selectionVector[index];
+				newSelectedRowCount += exists[index] & (values[index] == constValue);
+			}
+			break;
+		}
+
+		case BTGreaterEqualStrategyNumber:
+		{
+			for (uint32 index = 0; index < selectedRowCount; index++)
+			{
+				selectionVector[newSelectedRowCount] = selectionVector[index];
+				newSelectedRowCount += exists[index] & (values[index] >= constValue);
+			}
+			break;
+		}
+
+		case BTGreaterStrategyNumber:
+		{
+			for (uint32 index = 0; index < selectedRowCount; index++)
+			{
+				selectionVector[newSelectedRowCount] = selectionVector[index];
+				newSelectedRowCount += exists[index] & (values[index] > constValue);
+			}
+			break;
+		}
+
+		default:
+		{
+			elog(ERROR, "unexpected strategy number: %d", strategy);
+		}
+	}
+
+	return newSelectedRowCount;
+}
+
+
+/*
+ * FilterFloat8Values is the float8 version of FilterInt64Values. Comparisons
+ * use the float8 btree semantics, under which NaN equals NaN and is larger
+ * than any other value.
+ */
+static uint32
+FilterFloat8Values(const float8 *values, const bool *exists, uint32 *selectionVector,
+				   uint32 selectedRowCount, StrategyNumber strategy, float8 constValue)
+{
+	uint32 newSelectedRowCount = 0;
+
+	switch (strategy)
+	{
+		case BTLessStrategyNumber:
+		{
+			for (uint32 index = 0; index < selectedRowCount; index++)
+			{
+				selectionVector[newSelectedRowCount] = selectionVector[index];
+				newSelectedRowCount += exists[index] &
+									   float8_lt(values[index], constValue);
+			}
+			break;
+		}
+
+		case BTLessEqualStrategyNumber:
+		{
+			for (uint32 index = 0; index < selectedRowCount; index++)
+			{
+				selectionVector[newSelectedRowCount] = selectionVector[index];
+				newSelectedRowCount += exists[index] &
+									   float8_le(values[index], constValue);
+			}
+			break;
+		}
+
+		case BTEqualStrategyNumber:
+		{
+			for (uint32 index = 0; index < selectedRowCount; index++)
+			{
+				selectionVector[newSelectedRowCount] = selectionVector[index];
+				newSelectedRowCount += exists[index] &
+									   float8_eq(values[index], constValue);
+			}
+			break;
+		}
+
+		case BTGreaterEqualStrategyNumber:
+		{
+			for (uint32 index = 0; index < selectedRowCount; index++)
+			{
+				selectionVector[newSelectedRowCount] = selectionVector[index];
+				newSelectedRowCount += exists[index] &
+									   float8_ge(values[index], constValue);
+			}
+			break;
+		}
+
+		case BTGreaterStrategyNumber:
+		{
+			for (uint32 index = 0; index < selectedRowCount; index++)
+			{
+				selectionVector[newSelectedRowCount] = selectionVector[index];
+				newSelectedRowCount += exists[index] &
+									   float8_gt(values[index], constValue);
+			}
+			break;
+		}
+
+		default:
+		{
+			elog(ERROR, "unexpected strategy number: %d", strategy);
+		}
+	}
+
+	return newSelectedRowCount;
+}
+
+
+/*
+ * BuildColumnarVectorAggregate returns a ColumnarVectorAggregate for given
+ * aggregate if it is count(*), or count(), min(), max() or sum() over a plain
+ * column that we know how to aggregate, and NULL otherwise.
+ *
+ * Other than count(column), only the types supported by the fast path are
+ * allowed, and we only consider the built-in aggregates, identified by their
+ * name and result type.
+ */
+ColumnarVectorAggregate *
+BuildColumnarVectorAggregate(Aggref *aggref)
+{
+	if (aggref->aggdistinct != NIL || aggref->aggorder != NIL ||
+		aggref->aggfilter != NULL || aggref->agglevelsup != 0 ||
+		aggref->aggkind != AGGKIND_NORMAL || aggref->aggsplit != AGGSPLIT_SIMPLE ||
+		get_func_namespace(aggref->aggfnoid) != PG_CATALOG_NAMESPACE)
+	{
+		return NULL;
+	}
+
+	char *aggregateName = get_func_name(aggref->aggfnoid);
+
+	ColumnarVectorAggregate *aggregate = palloc0(sizeof(ColumnarVectorAggregate));
+	aggregate->columnIndex = -1;
+
+	if (aggref->aggstar)
+	{
+		if (strcmp(aggregateName, "count") != 0)
+		{
+			return NULL;
+		}
+
+		aggregate->kind = VECTOR_AGGREGATE_COUNT_STAR;
+		return aggregate;
+	}
+
+	if (list_length(aggref->args) != 1)
+	{
+		return NULL;
+	}
+
+	TargetEntry *argument = linitial_node(TargetEntry, aggref->args);
+	if (!IsA(argument->expr, Var))
+	{
+		return NULL;
+	}
+
+	Var *var = (Var *) argument->expr;
+	if (var->varattno <= 0 || var->varlevelsup != 0)
+	{
+		return NULL;
+	}
+
+	aggregate->columnIndex = var->varattno - 1;
+	aggregate->argumentTypeId = var->vartype;
+	aggregate->fastPath = FastPathForType(var->vartype);
+
+	if (strcmp(aggregateName, "count") == 0)
+	{
+		aggregate->kind = VECTOR_AGGREGATE_COUNT;
+		return aggregate;
+	}
+
+	if (aggregate->fastPath == VECTOR_FAST_PATH_NONE)
+	{
+		return NULL;
+	}
+
+	if (strcmp(aggregateName, "min") == 0 && aggref->aggtype == var->vartype)
+	{
+		aggregate->kind = VECTOR_AGGREGATE_MIN;
+	}
+	else if (strcmp(aggregateName, "max") == 0 && aggref->aggtype == var->vartype)
+	{
+		aggregate->kind = VECTOR_AGGREGATE_MAX;
+	}
+	else if (strcmp(aggregateName, "sum") == 0 &&
+			 aggref->aggtype == SumResultType(var->vartype))
+	{
+		aggregate->kind = VECTOR_AGGREGATE_SUM;
+	}
+	else
+	{
+		return NULL;
+	}
+
+	return aggregate;
+}
+
+
+/*
+ * SumResultType returns the result type of the built-in sum() aggregate over
+ * given type if we know how to compute it, or InvalidOid otherwise.
+ */
+static Oid
+SumResultType(Oid typeId)
+{
+	switch (typeId)
+	{
+		case INT2OID:
+		case INT4OID:
+		{
+			return INT8OID;
+		}
+
+		case INT8OID:
+		{
+			return NUMERICOID;
+		}
+
+		case FLOAT8OID:
+		{
+			return FLOAT8OID;
+		}
+
+		default:
+		{
+			return InvalidOid;
+		}
+	}
+}
+
+
+/*
+ * ColumnarVectorAggregateSkipNodeUsable returns true if given aggregate can be
+ * computed over a chunk group whose rows all pass the quals using only the
+ * skip node of its argument.
+ *
+ * Skip nodes keep the min/max of the non-NULL values of a chunk, if any, but
+ * not the number of NULLs in it. So count(column) can only be answered if the
+ * column is NOT NULL, and sum() always needs the values.
+ */
+bool
+ColumnarVectorAggregateSkipNodeUsable(ColumnarVectorAggregate *aggregate,
+									  bool columnNotNull)
+{
+	switch (aggregate->kind)
+	{
+		case VECTOR_AGGREGATE_COUNT_STAR:
+		case VECTOR_AGGREGATE_MIN:
+		case VECTOR_AGGREGATE_MAX:
+		{
+			return true;
+		}
+
+		case VECTOR_AGGREGATE_COUNT:
+		{
+			return columnNotNull;
+		}
+
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+
+/*
+ * ColumnarVectorAggregateSkipNode aggregates all rows of a chunk group using
+ * the skip node of the aggregate's argument, which is NULL for count(*). The
+ * caller must have checked ColumnarVectorAggregateSkipNodeUsable.
+ */
+void
+ColumnarVectorAggregateSkipNode(ColumnarVectorAggregate *aggregate,
+								ColumnChunkSkipNode *chunkSkipNode,
+								uint32 chunkGroupRowCount)
+{
+	switch (aggregate->kind)
+	{
+		case VECTOR_AGGREGATE_COUNT_STAR:
+		case VECTOR_AGGREGATE_COUNT:
+		{
+			aggregate->count += chunkGroupRowCount;
+			break;
+		}
+
+		case VECTOR_AGGREGATE_MIN:
+		case VECTOR_AGGREGATE_MAX:
+		{
+			/* there are no min/max values if the chunk has only NULLs */
+			if (!chunkSkipNode->hasMinMax)
+			{
+				break;
+			}
+
+			Datum value = (aggregate->kind == VECTOR_AGGREGATE_MIN) ?
+						  chunkSkipNode->minimumValue :
+						  chunkSkipNode->maximumValue;
+
+			if (aggregate->fastPath == VECTOR_FAST_PATH_FLOAT8)
+			{
+				float8 floatValue = DatumGetFloat8(value);
+				AggregateFloat8Values(aggregate, &floatValue, 1);
+			}
+			else
+			{
+				int64 intValue = FastPathIntValue(aggregate->argumentTypeId, value);
+				AggregateInt64Values(aggregate, &intValue, 1);
+			}
+
+			break;
+		}
+
+		default:
+		{
+			elog(ERROR, "cannot aggregate chunk group using its skip nodes");
+		}
+	}
+}
+
+
+/*
+ * ColumnarVectorAggregateBatch aggregates the rows of given chunk group that
+ * are listed in selectionVector. Partial sums that don't fit into an int64
+ * are allocated in the current memory context, which must live until the
+ * result is computed.
+ */
+void
+ColumnarVectorAggregateBatch(ColumnarVectorAggregate *aggregate, ChunkData *chunkData,
+							 uint32 *selectionVector, uint32 selectedRowCount)
+{
+	if (aggregate->kind == VECTOR_AGGREGATE_COUNT_STAR)
+	{
+		aggregate->count += selectedRowCount;
+		return;
+	}
+
+	bool *existsArray = chunkData->existsArray[aggregate->columnIndex];
+	Datum *valueArray = chunkData->valueArray[aggregate->columnIndex];
+
+	if (aggregate->kind == VECTOR_AGGREGATE_COUNT)
+	{
+		int64 valueCount = 0;
+		for (uint32 index = 0; index < selectedRowCount; index++)
+		{
+			valueCount += existsArray[selectionVector[index]];
+		}
+
+		aggregate->count += valueCount;
+		return;
+	}
+
+	if (aggregate->fastPath == VECTOR_FAST_PATH_FLOAT8)
+	{
+		float8 *values = palloc(selectedRowCount * sizeof(float8));
+		uint32 valueCount = GatherFloat8Values(existsArray, valueArray, selectionVector,
+											   selectedRowCount, values);
+
+		AggregateFloat8Values(aggregate, values, valueCount);
+		pfree(values);
+	}
+	else
+	{
+		int64 *values = palloc(selectedRowCount * sizeof(int64));
+		uint32 valueCount = GatherInt64Values(aggregate->fastPath, existsArray,
+											  valueArray, selectionVector,
+											  selectedRowCount, values);
+
+		AggregateInt64Values(aggregate, values, valueCount);
+		pfree(values);
+	}
+}
+
+
+/*
+ * GatherInt64Values copies the non-NULL values of the rows listed in
+ * selectionVector into a contiguous array of int64 and returns their number.
+ */
+static uint32
+GatherInt64Values(ColumnarVectorFastPath fastPath, bool *existsArray,
+				  Datum *valueArray, uint32 *selectionVector, uint32 selectedRowCount,
+				  int64 *values)
+{
+	uint32 valueCount = 0;
+
+	for (uint32 index = 0; index < selectedRowCount; index++)
+	{
+		uint32 rowIndex = selectionVector[index];
+		if (!existsArray[rowIndex])
+		{
+			continue;
+		}
+
+		switch (fastPath)
+		{
+			case VECTOR_FAST_PATH_INT16:
+			{
+				values[valueCount++] = DatumGetInt16(valueArray[rowIndex]);
+				break;
+			}
+
+			case VECTOR_FAST_PATH_INT32:
+			{
+				values[valueCount++] = DatumGetInt32(valueArray[rowIndex]);
+				break;
+			}
+
+			default:
+			{
+				values[valueCount++] = DatumGetInt64(valueArray[rowIndex]);
+				break;
+			}
+		}
+	}
+
+	return valueCount;
+}
+
+
+/*
+ * GatherFloat8Values is the float8 version of GatherInt64Values.
+ */
+static uint32
+GatherFloat8Values(bool *existsArray, Datum *valueArray, uint32 *selectionVector,
+				   uint32 selectedRowCount, float8 *values)
+{
+	uint32 valueCount = 0;
+
+	for (uint32 index = 0; index < selectedRowCount; index++)
+	{
+		uint32 rowIndex = selectionVector[index];
+		if (existsArray[rowIndex])
+		{
+			values[valueCount++] = DatumGetFloat8(valueArray[rowIndex]);
+		}
+	}
+
+	return valueCount;
+}
+
+
+/*
+ * AggregateInt64Values advances the state of given min, max or sum aggregate
+ * over a column of an integer-like type with the given values. The min/max
+ * loops are kept branch-free so that they can be vectorized.
+ */
+static void
+AggregateInt64Values(ColumnarVectorAggregate *aggregate, const int64 *values,
+					 uint32 valueCount)
+{
+	if (valueCount == 0)
+	{
+		return;
+	}
+
+	switch (aggregate->kind)
+	{
+		case VECTOR_AGGREGATE_MIN:
+		{
+			int64 minimum = (aggregate->count > 0) ? aggregate->intValue : PG_INT64_MAX;
+			for (uint32 index = 0; index < valueCount; index++)
+			{
+				minimum = Min(minimum, values[index]);
+			}
+
+			aggregate->intValue = minimum;
+			break;
+		}
+
+		case VECTOR_AGGREGATE_MAX:
+		{
+			int64 maximum = (aggregate->count > 0) ? aggregate->intValue : PG_INT64_MIN;
+			for (uint32 index = 0; index < valueCount; index++)
+			{
+				maximum = Max(maximum, values[index]);
+			}
+
+			aggregate->intValue = maximum;
+			break;
+		}
+
+		case VECTOR_AGGREGATE_SUM:
+		{
+			int64 sum = aggregate->intValue;
+
+			if (aggregate->fastPath != VECTOR_FAST_PATH_INT64)
+			{
+				/* like int2_sum and int4_sum, we don't expect int64 to overflow */
+				for (uint32 index = 0; index < valueCount; index++)
+				{
+					sum += values[index];
+				}
+			}
+			else
+			{
+				for (uint32 index = 0; index < valueCount; index++)
+				{
+					int64 newSum = 0;
+					if (unlikely(pg_add_s64_overflow(sum, values[index], &newSum)))
+					{
+						/* move what we have so far into the numeric sum */
+						AddToNumericSum(aggregate, sum);
+						newSum = values[index];
+					}
+
+					sum = newSum;
+				}
+			}
+
+			aggregate->intValue = sum;
+			break;
+		}
+
+		default:
+		{
+			elog(ERROR, "unexpected columnar vector aggregate: %d", aggregate->kind);
+		}
+	}
+
+	aggregate->count += valueCount;
+}
+
+
+/*
+ * AggregateFloat8Values is the float8 version of AggregateInt64Values. It
+ * follows float8smaller, float8larger and float8pl, including the order in
+ * which the values are added.
+ */
+static void
+AggregateFloat8Values(ColumnarVectorAggregate *aggregate, const float8 *values,
+					  uint32 valueCount)
+{
+	if (valueCount == 0)
+	{
+		return;
+	}
+
+	/* like the built-in aggregates, start with the first value */
+	uint32 index = 0;
+	float8 result = aggregate->floatValue;
+	if (aggregate->count == 0)
+	{
+		result = values[index++];
+	}
+
+	switch (aggregate->kind)
+	{
+		case VECTOR_AGGREGATE_MIN:
+		{
+			for (; index < valueCount; index++)
+			{
+				result = float8_lt(result, values[index]) ? result : values[index];
+			}
+			break;
+		}
+
+		case VECTOR_AGGREGATE_MAX:
+		{
+			for (; index < valueCount; index++)
+			{
+				result = float8_gt(result, values[index]) ? result : values[index];
+			}
+			break;
+		}
+
+		case VECTOR_AGGREGATE_SUM:
+		{
+			for (; index < valueCount; index++)
+			{
+				result = float8_pl(result, values[index]);
+			}
+			break;
+		}
+
+		default:
+		{
+			elog(ERROR, "unexpected columnar vector aggregate: %d", aggregate->kind);
+		}
+	}
+
+	aggregate->floatValue = result;
+	aggregate->count += valueCount;
+}
+
+
+/*
+ * AddToNumericSum adds given value to the numeric part of the sum of an int8
+ * column.
+ */
+static void
+AddToNumericSum(ColumnarVectorAggregate *aggregate, int64 value)
+{
+	Datum valueDatum = NumericGetDatum(int64_to_numeric(value));
+
+	if (!aggregate->hasNumericSum)
+	{
+		aggregate->numericSum = valueDatum;
+		aggregate->hasNumericSum = true;
+	}
+	else
+	{
+		aggregate->numericSum = DirectFunctionCall2(numeric_add, aggregate->numericSum,
+													valueDatum);
+	}
+}
+
+
+/*
+ * ColumnarVectorAggregateResult returns the final value of given aggregate,
+ * which has the result type of the corresponding built-in aggregate.
+ */
+Datum
+ColumnarVectorAggregateResult(ColumnarVectorAggregate *aggregate, bool *isNull)
+{
+	*isNull = false;
+
+	if (aggregate->kind == VECTOR_AGGREGATE_COUNT_STAR ||
+		aggregate->kind == VECTOR_AGGREGATE_COUNT)
+	{
+		return Int64GetDatum(aggregate->count);
+	}
+
+	/* min, max and sum of no values are NULL */
+	if (aggregate->count == 0)
+	{
+		*isNull = true;
+		return (Datum) 0;
+	}
+
+	if (aggregate->fastPath == VECTOR_FAST_PATH_FLOAT8)
+	{
+		return Float8GetDatum(aggregate->floatValue);
+	}
+
+	if (aggregate->kind != VECTOR_AGGREGATE_SUM)
+	{
+		return FastPathIntDatum(aggregate->fastPath, aggregate->intValue);
+	}
+
+	if (aggregate->fastPath != VECTOR_FAST_PATH_INT64)
+	{
+		return Int64GetDatum(aggregate->intValue);
+	}
+
+	Datum sum = NumericGetDatum(int64_to_numeric(aggregate->intValue));
+	if (aggregate->hasNumericSum)
+	{
+		sum = DirectFunctionCall2(numeric_add, aggregate->numericSum, sum);
+	}
+
+	return sum;
+}
+
+
+/*
+ * FastPathIntDatum converts given int64 back into a datum of an integer-like
+ * type that is compared using given fast path.
+ */
+static Datum
+FastPathIntDatum(ColumnarVectorFastPath fastPath, int64 value)
+{
+	switch (fastPath)
+	{
+		case VECTOR_FAST_PATH_INT16:
+		{
+			return Int16GetDatum((int16) value);
+		}
+
+		case VECTOR_FAST_PATH_INT32:
+		{
+			return Int32GetDatum((int32) value);
+		}
+
+		default:
+		{
+			return Int64GetDatum(value);
+		}
+	}
+}
+
+
+/*
+ * ColumnarVectorAggregateReset resets the transition state of given aggregate
+ * so that it can be computed again, e.g. on rescan.
+ */
+void
+ColumnarVectorAggregateReset(ColumnarVectorAggregate *aggregate)
+{
+	aggregate->count = 0;
+	aggregate->intValue = 0;
+	aggregate->floatValue = 0;
+	aggregate->numericSum = (Datum) 0;
+	aggregate->hasNumericSum = false;
+}
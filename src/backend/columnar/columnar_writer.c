@@ -19,22 +19,30 @@
 #include "miscadmin.h"
 #include "safe_lib.h"
 
+#include "access/hash.h"
 #include "access/heapam.h"
 #include "access/nbtree.h"
 #include "catalog/pg_am.h"
+#include "executor/tuptable.h"
 #include "storage/fd.h"
 #include "storage/smgr.h"
 #include "utils/guc.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/sortsupport.h"
+#include "utils/typcache.h"
 
 #include "pg_version_compat.h"
 #include "pg_version_constants.h"
 
 #include "columnar/columnar.h"
+#include "columnar/columnar_bloom.h"
+#include "columnar/columnar_compression_pool.h"
 #include "columnar/columnar_storage.h"
 #include "columnar/columnar_version_compat.h"
 
+#include "distributed/listutils.h"
+
 #if PG_VERSION_NUM >= PG_VERSION_16
 #include "storage/relfilelocator.h"
 #include "utils/relfilenumbermap.h"
@@ -42,6 +50,22 @@
 #include "utils/relfilenodemap.h"
 #endif
 
+/*
+ * BufferedRow is a row that is buffered to be sorted by the sort key of the
+ * table before it is written to the stripe.
+ */
+typedef struct BufferedRow
+{
+	MinimalTuple tuple;
+
+	/* values of the sort key columns, by-reference values point into tuple */
+	Datum *keyValues;
+	bool *keyNulls;
+
+	/* position of the row in the buffer, to keep ties in arrival order */
+	uint32 rowIndex;
+} BufferedRow;
+
 struct ColumnarWriteState
 {
 	TupleDesc tupleDescriptor;
@@ -65,6 +89,77 @@ struct ColumnarWriteState
 	 * deallocated when memory context is reset.
 	 */
 	StringInfo compressionBuffer;
+
+	/*
+	 * encodingBuffer is used similarly as temporary storage while encoding
+	 * the data values. Encoding is only attempted if encodingEnabled is true.
+	 */
+	StringInfo encodingBuffer;
+	bool encodingEnabled;
+
+	/*
+	 * For the columns in bloomFilterColumns option, bloomFilterHashFunctions
+	 * has the function to hash the values with and bloomFilterHashValues has
+	 * the hashes of the (non-NULL) values in the current chunk, from which
+	 * we build the bloom filter of the chunk when it is serialized. These are
+	 * NULL for other columns.
+	 */
+	FmgrInfo **bloomFilterHashFunctions;
+	uint32 **bloomFilterHashValues;
+	uint32 *bloomFilterHashCounts;
+
+	/*
+	 * compressionPool has the background workers that compress the chunks
+	 * when columnar.compression_workers is set. It is started when the first
+	 * chunk of a stripe fills up, so that small writes don't start workers,
+	 * and is destroyed once the stripe is flushed, so that the workers don't
+	 * sit idle while the next stripe is being filled.
+	 */
+	ColumnarCompressionPool *compressionPool;
+	bool compressionPoolStarted;
+
+	/*
+	 * Compression type and level of each column, which are the ones of the
+	 * table unless the column_compression option overrides them. Chunks of
+	 * columns with auto compression that don't compress by at least
+	 * columnar.auto_compression_min_ratio are stored uncompressed, and the
+	 * rest of such a column in the stripe is not compressed at all, which
+	 * is tracked in columnCompressionSkipped.
+	 */
+	CompressionType *columnCompressionTypes;
+	int *columnCompressionLevels;
+	bool *columnAutoCompression;
+	bool *columnCompressionSkipped;
+
+	/*
+	 * Chunks of the columns that are compressed with zstd are compressed
+	 * with the most recently trained zstd dictionary of the table, if it has
+	 * one. See columnar.train_zstd_dictionary.
+	 */
+	uint32 zstdDictionaryId;
+
+	/*
+	 * Stripes that fit into a single chunk group and have fewer rows than
+	 * stagingRowLimit when they are flushed are written as staging stripes,
+	 * without encoding, compression and bloom filters. These are the stripes
+	 * written by small transactions, which columnar.compact_stripes merges
+	 * into full-sized, compressed stripes later on. 0 disables staging.
+	 */
+	uint32 stagingRowLimit;
+
+	/*
+	 * If the table has a sort key, rows are not appended to the stripe as
+	 * they arrive. Instead they are buffered in bufferedRows, and sorted by
+	 * the sortKeys when the stripe is flushed. bufferedRows lives in
+	 * stripeWriteContext.
+	 */
+	int sortKeyCount;
+	int *sortKeyColumnIndexes;
+	SortSupport sortKeys;
+	TupleTableSlot *sortSlot;
+	BufferedRow **bufferedRows;
+	uint32 bufferedRowCount;
+	uint32 bufferedRowCapacity;
 };
 
 static StripeBuffers * CreateEmptyStripeBuffers(uint32 stripeMaxRowCount,
@@ -73,13 +168,27 @@ static StripeBuffers * CreateEmptyStripeBuffers(uint32 stripeMaxRowCount,
 static StripeSkipList * CreateEmptyStripeSkipList(uint32 stripeMaxRowCount,
 												  uint32 chunkRowCount,
 												  uint32 columnCount);
+static void StartStripe(ColumnarWriteState *writeState);
+static void AppendRowToStripe(ColumnarWriteState *writeState, Datum *columnValues,
+							  bool *columnNulls);
 static void FlushStripe(ColumnarWriteState *writeState);
+static void InitRowSorting(ColumnarWriteState *writeState, List *sortKeyColumns);
+static void BufferRowForSorting(ColumnarWriteState *writeState, Datum *columnValues,
+								bool *columnNulls);
+static void AppendBufferedRowsToStripe(ColumnarWriteState *writeState);
+static int CompareBufferedRows(const void *leftElement, const void *rightElement,
+							   void *arg);
 static StringInfo SerializeBoolArray(bool *boolArray, uint32 boolArrayLength);
 static void SerializeSingleDatum(StringInfo datumBuffer, Datum datum,
 								 bool datumTypeByValue, int datumTypeLength,
 								 char datumTypeAlign);
 static void SerializeChunkData(ColumnarWriteState *writeState, uint32 chunkIndex,
-							   uint32 rowCount);
+							   uint32 rowCount, bool stagingChunk);
+static void StartCompressionPool(ColumnarWriteState *writeState);
+static void InitColumnCompressions(ColumnarWriteState *writeState,
+								   List *columnCompressionList);
+static FmgrInfo ** BloomFilterHashFunctions(List *bloomFilterColumns,
+											TupleDesc tupleDescriptor);
 static void UpdateChunkSkipNodeMinMax(ColumnChunkSkipNode *chunkSkipNode,
 									  Datum columnValue, bool columnTypeByValue,
 									  int columnTypeLength, Oid columnCollation,
@@ -143,10 +252,48 @@ ColumnarBeginWrite(RelFileLocator relfilelocator,
 	writeState->stripeWriteContext = stripeWriteContext;
 	writeState->chunkData = chunkData;
 	writeState->compressionBuffer = NULL;
+	writeState->encodingBuffer = NULL;
+	writeState->compressionPool = NULL;
+	writeState->compressionPoolStarted = false;
+
+	/*
+	 * Encoded chunks can only be read back if their encoding can be recorded
+	 * in columnar.chunk, which might not be the case if the extension is not
+	 * updated yet.
+	 */
+	writeState->encodingEnabled = columnar_enable_encoding &&
+								  ColumnarChunkEncodingSupported();
 	writeState->perTupleContext = AllocSetContextCreate(CurrentMemoryContext,
 														"Columnar per tuple context",
 														ALLOCSET_DEFAULT_SIZES);
 
+	InitRowSorting(writeState, options.sortKeyColumns);
+	InitColumnCompressions(writeState, options.columnCompressions);
+
+	writeState->zstdDictionaryId = InvalidZstdDictionaryId;
+	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		if (writeState->columnCompressionTypes[columnIndex] == COMPRESSION_ZSTD)
+		{
+			writeState->zstdDictionaryId =
+				LatestColumnarZstdDictionaryId(relfilelocator);
+			break;
+		}
+	}
+
+	writeState->bloomFilterHashFunctions =
+		BloomFilterHashFunctions(options.bloomFilterColumns, tupleDescriptor);
+	writeState->bloomFilterHashValues = palloc0(columnCount * sizeof(uint32 *));
+	writeState->bloomFilterHashCounts = palloc0(columnCount * sizeof(uint32));
+	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		if (writeState->bloomFilterHashFunctions[columnIndex] != NULL)
+		{
+			writeState->bloomFilterHashValues[columnIndex] =
+				palloc0(options.chunkRowCount * sizeof(uint32));
+		}
+	}
+
 	return writeState;
 }
 
@@ -159,49 +306,114 @@ ColumnarBeginWrite(RelFileLocator relfilelocator,
  * rowChunkCount insertion. Then, if row count exceeds stripeMaxRowCount, we flush
  * the stripe, and add its metadata to the table footer.
  *
+ * If the table has a sort key, the row is buffered instead, and appended to the
+ * stripe in sort key order when the stripe is flushed.
+ *
  * Returns the "row number" assigned to written row.
  */
 uint64
 ColumnarWriteRow(ColumnarWriteState *writeState, Datum *columnValues, bool *columnNulls)
 {
-	uint32 columnIndex = 0;
-	StripeBuffers *stripeBuffers = writeState->stripeBuffers;
-	StripeSkipList *stripeSkipList = writeState->stripeSkipList;
+	ColumnarOptions *options = &writeState->options;
+	MemoryContext oldContext = MemoryContextSwitchTo(writeState->stripeWriteContext);
+
+	if (writeState->stripeBuffers == NULL)
+	{
+		StartStripe(writeState);
+	}
+
+	uint64 stripeRowIndex = 0;
+	if (writeState->sortKeyCount > 0)
+	{
+		stripeRowIndex = writeState->bufferedRowCount;
+		BufferRowForSorting(writeState, columnValues, columnNulls);
+	}
+	else
+	{
+		stripeRowIndex = writeState->stripeBuffers->rowCount;
+		AppendRowToStripe(writeState, columnValues, columnNulls);
+	}
+
+	uint64 writtenRowNumber = writeState->emptyStripeReservation->stripeFirstRowNumber +
+							  stripeRowIndex;
+	if (stripeRowIndex + 1 >= options->stripeRowCount)
+	{
+		ColumnarFlushPendingWrites(writeState);
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	return writtenRowNumber;
+}
+
+
+/*
+ * StartStripe creates the structures to hold the data and the skip list of a
+ * new stripe, and reserves the stripe. It should be called in the
+ * stripeWriteContext.
+ */
+static void
+StartStripe(ColumnarWriteState *writeState)
+{
 	uint32 columnCount = writeState->tupleDescriptor->natts;
 	ColumnarOptions *options = &writeState->options;
 	const uint32 chunkRowCount = options->chunkRowCount;
 	ChunkData *chunkData = writeState->chunkData;
-	MemoryContext oldContext = MemoryContextSwitchTo(writeState->stripeWriteContext);
 
-	if (stripeBuffers == NULL)
-	{
-		stripeBuffers = CreateEmptyStripeBuffers(options->stripeRowCount,
-												 chunkRowCount, columnCount);
-		stripeSkipList = CreateEmptyStripeSkipList(options->stripeRowCount,
-												   chunkRowCount, columnCount);
-		writeState->stripeBuffers = stripeBuffers;
-		writeState->stripeSkipList = stripeSkipList;
-		writeState->compressionBuffer = makeStringInfo();
-
-		Oid relationId = RelidByRelfilenumber(RelationTablespace_compat(
-												  writeState->relfilelocator),
-											  RelationPhysicalIdentifierNumber_compat(
-												  writeState->relfilelocator));
-		Relation relation = relation_open(relationId, NoLock);
-		writeState->emptyStripeReservation =
-			ReserveEmptyStripe(relation, columnCount, chunkRowCount,
-							   options->stripeRowCount);
-		relation_close(relation, NoLock);
+	writeState->stripeBuffers = CreateEmptyStripeBuffers(options->stripeRowCount,
+														 chunkRowCount, columnCount);
+	writeState->stripeSkipList = CreateEmptyStripeSkipList(options->stripeRowCount,
+														   chunkRowCount, columnCount);
+	writeState->compressionBuffer = makeStringInfo();
+	writeState->encodingBuffer = makeStringInfo();
 
-		/*
-		 * serializedValueBuffer lives in stripe write memory context so it needs to be
-		 * initialized when the stripe is created.
-		 */
-		for (columnIndex = 0; columnIndex < columnCount; columnIndex++)
-		{
-			chunkData->valueBufferArray[columnIndex] = makeStringInfo();
-		}
+	/* columns with auto compression try to compress again in each stripe */
+	memset(writeState->columnCompressionSkipped, false, columnCount * sizeof(bool));
+
+	Oid relationId = RelidByRelfilenumber(RelationTablespace_compat(
+											  writeState->relfilelocator),
+										  RelationPhysicalIdentifierNumber_compat(
+											  writeState->relfilelocator));
+	Relation relation = relation_open(relationId, NoLock);
+	writeState->emptyStripeReservation =
+		ReserveEmptyStripe(relation, columnCount, chunkRowCount,
+						   options->stripeRowCount);
+	relation_close(relation, NoLock);
+
+	/*
+	 * serializedValueBuffer lives in stripe write memory context so it needs to be
+	 * initialized when the stripe is created.
+	 */
+	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		chunkData->valueBufferArray[columnIndex] = makeStringInfo();
+	}
+
+	if (writeState->sortKeyCount > 0)
+	{
+		writeState->bufferedRowCapacity = Min(options->stripeRowCount, 1024);
+		writeState->bufferedRows =
+			palloc(writeState->bufferedRowCapacity * sizeof(BufferedRow *));
+		writeState->bufferedRowCount = 0;
 	}
+}
+
+
+/*
+ * AppendRowToStripe serializes the given row into the chunk being filled in
+ * the current stripe, and serializes the chunk once it is full. It should be
+ * called in the stripeWriteContext.
+ */
+static void
+AppendRowToStripe(ColumnarWriteState *writeState, Datum *columnValues,
+				  bool *columnNulls)
+{
+	uint32 columnIndex = 0;
+	StripeBuffers *stripeBuffers = writeState->stripeBuffers;
+	StripeSkipList *stripeSkipList = writeState->stripeSkipList;
+	uint32 columnCount = writeState->tupleDescriptor->natts;
+	const uint32 chunkRowCount = writeState->options.chunkRowCount;
+	ChunkData *chunkData = writeState->chunkData;
 
 	uint32 chunkIndex = stripeBuffers->rowCount / chunkRowCount;
 	uint32 chunkRowIndex = stripeBuffers->rowCount % chunkRowCount;
@@ -236,6 +448,16 @@ ColumnarWriteRow(ColumnarWriteState *writeState, Datum *columnValues, bool *colu
 			UpdateChunkSkipNodeMinMax(chunkSkipNode, columnValues[columnIndex],
 									  columnTypeByValue, columnTypeLength,
 									  columnCollation, comparisonFunction);
+
+			FmgrInfo *hashFunction = writeState->bloomFilterHashFunctions[columnIndex];
+			if (hashFunction != NULL)
+			{
+				Datum hashDatum = FunctionCall1Coll(hashFunction, columnCollation,
+													columnValues[columnIndex]);
+				uint32 hashIndex = writeState->bloomFilterHashCounts[columnIndex]++;
+				writeState->bloomFilterHashValues[columnIndex][hashIndex] =
+					DatumGetUInt32(hashDatum);
+			}
 		}
 
 		chunkSkipNode->rowCount++;
@@ -246,20 +468,15 @@ ColumnarWriteRow(ColumnarWriteState *writeState, Datum *columnValues, bool *colu
 	/* last row of the chunk is inserted serialize the chunk */
 	if (chunkRowIndex == chunkRowCount - 1)
 	{
-		SerializeChunkData(writeState, chunkIndex, chunkRowCount);
-	}
+		if (!writeState->compressionPoolStarted)
+		{
+			StartCompressionPool(writeState);
+		}
 
-	uint64 writtenRowNumber = writeState->emptyStripeReservation->stripeFirstRowNumber +
-							  stripeBuffers->rowCount;
-	stripeBuffers->rowCount++;
-	if (stripeBuffers->rowCount >= options->stripeRowCount)
-	{
-		ColumnarFlushPendingWrites(writeState);
+		SerializeChunkData(writeState, chunkIndex, chunkRowCount, false);
 	}
 
-	MemoryContextSwitchTo(oldContext);
-
-	return writtenRowNumber;
+	stripeBuffers->rowCount++;
 }
 
 
@@ -270,11 +487,33 @@ ColumnarWriteRow(ColumnarWriteState *writeState, Datum *columnValues, bool *colu
 void
 ColumnarEndWrite(ColumnarWriteState *writeState)
 {
+	uint32 columnCount = writeState->tupleDescriptor->natts;
+
 	ColumnarFlushPendingWrites(writeState);
 
+	if (writeState->sortSlot != NULL)
+	{
+		ExecDropSingleTupleTableSlot(writeState->sortSlot);
+		pfree(writeState->sortKeyColumnIndexes);
+		pfree(writeState->sortKeys);
+	}
+
 	MemoryContextDelete(writeState->stripeWriteContext);
 	pfree(writeState->comparisonFunctionArray);
 	FreeChunkData(writeState->chunkData);
+	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		if (writeState->bloomFilterHashValues[columnIndex] != NULL)
+		{
+			pfree(writeState->bloomFilterHashValues[columnIndex]);
+		}
+	}
+	pfree(writeState->bloomFilterHashValues);
+	pfree(writeState->bloomFilterHashCounts);
+	pfree(writeState->columnCompressionTypes);
+	pfree(writeState->columnCompressionLevels);
+	pfree(writeState->columnAutoCompression);
+	pfree(writeState->columnCompressionSkipped);
 	pfree(writeState);
 }
 
@@ -287,12 +526,19 @@ ColumnarFlushPendingWrites(ColumnarWriteState *writeState)
 	{
 		MemoryContext oldContext = MemoryContextSwitchTo(writeState->stripeWriteContext);
 
+		if (writeState->bufferedRowCount > 0)
+		{
+			AppendBufferedRowsToStripe(writeState);
+		}
+
 		FlushStripe(writeState);
 		MemoryContextReset(writeState->stripeWriteContext);
 
 		/* set stripe data and skip list to NULL so they are recreated next time */
 		writeState->stripeBuffers = NULL;
 		writeState->stripeSkipList = NULL;
+		writeState->bufferedRows = NULL;
+		writeState->bufferedRowCount = 0;
 
 		MemoryContextSwitchTo(oldContext);
 	}
@@ -335,6 +581,7 @@ CreateEmptyStripeBuffers(uint32 stripeMaxRowCount, uint32 chunkRowCount,
 			chunkBuffersArray[chunkIndex]->existsBuffer = NULL;
 			chunkBuffersArray[chunkIndex]->valueBuffer = NULL;
 			chunkBuffersArray[chunkIndex]->valueCompressionType = COMPRESSION_NONE;
+			chunkBuffersArray[chunkIndex]->valueEncodingType = ENCODING_NONE;
 		}
 
 		columnBuffersArray[columnIndex] = palloc0(sizeof(ColumnBuffers));
@@ -416,9 +663,27 @@ FlushStripe(ColumnarWriteState *writeState)
 	 */
 	if (lastChunkRowCount > 0)
 	{
-		SerializeChunkData(writeState, lastChunkIndex, lastChunkRowCount);
+		bool stagingChunk = lastChunkIndex == 0 &&
+							stripeRowCount < writeState->stagingRowLimit;
+		if (stagingChunk)
+		{
+			elog(DEBUG1, "Writing staging stripe of size " UINT64_FORMAT,
+				 stripeRowCount);
+		}
+
+		SerializeChunkData(writeState, lastChunkIndex, lastChunkRowCount,
+						   stagingChunk);
 	}
 
+	/* wait for the workers to compress the chunks they were given */
+	if (writeState->compressionPool != NULL)
+	{
+		ColumnarCompressionPoolWait(writeState->compressionPool);
+		ColumnarCompressionPoolDestroy(writeState->compressionPool);
+		writeState->compressionPool = NULL;
+	}
+	writeState->compressionPoolStarted = false;
+
 	/* update buffer sizes in stripe skip list */
 	for (columnIndex = 0; columnIndex < columnCount; columnIndex++)
 	{
@@ -448,7 +713,9 @@ FlushStripe(ColumnarWriteState *writeState)
 			chunkSkipNode->valueChunkOffset = stripeSize;
 			chunkSkipNode->valueLength = valueBufferSize;
 			chunkSkipNode->valueCompressionType = valueCompressionType;
-			chunkSkipNode->valueCompressionLevel = writeState->options.compressionLevel;
+			chunkSkipNode->valueCompressionLevel =
+				writeState->columnCompressionLevels[columnIndex];
+			chunkSkipNode->valueEncodingType = chunkBuffers->valueEncodingType;
 			chunkSkipNode->decompressedValueSize = chunkBuffers->decompressedValueSize;
 
 			stripeSize += valueBufferSize;
@@ -582,19 +849,21 @@ SerializeSingleDatum(StringInfo datumBuffer, Datum datum, bool datumTypeByValue,
 
 
 /*
- * SerializeChunkData serializes and compresses chunk data at given chunk index with given
- * compression type for every column.
+ * SerializeChunkData serializes, encodes and compresses chunk data at given chunk
+ * index with given compression type for every column. If stagingChunk is true,
+ * the chunk belongs to a staging stripe and is neither encoded nor compressed,
+ * and no bloom filters are built for it.
  */
 static void
-SerializeChunkData(ColumnarWriteState *writeState, uint32 chunkIndex, uint32 rowCount)
+SerializeChunkData(ColumnarWriteState *writeState, uint32 chunkIndex, uint32 rowCount,
+				   bool stagingChunk)
 {
 	uint32 columnIndex = 0;
 	StripeBuffers *stripeBuffers = writeState->stripeBuffers;
 	ChunkData *chunkData = writeState->chunkData;
-	CompressionType requestedCompressionType = writeState->options.compressionType;
-	int compressionLevel = writeState->options.compressionLevel;
 	const uint32 columnCount = stripeBuffers->columnCount;
 	StringInfo compressionBuffer = writeState->compressionBuffer;
+	StringInfo encodingBuffer = writeState->encodingBuffer;
 
 	writeState->chunkGroupRowCounts =
 		lappend_int(writeState->chunkGroupRowCounts, rowCount);
@@ -609,6 +878,29 @@ SerializeChunkData(ColumnarWriteState *writeState, uint32 chunkIndex, uint32 row
 			SerializeBoolArray(chunkData->existsArray[columnIndex], rowCount);
 	}
 
+	/* build bloom filters from the hashes collected while writing the rows */
+	for (columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		if (writeState->bloomFilterHashFunctions[columnIndex] == NULL)
+		{
+			continue;
+		}
+
+		if (stagingChunk)
+		{
+			writeState->bloomFilterHashCounts[columnIndex] = 0;
+			continue;
+		}
+
+		ColumnChunkSkipNode *chunkSkipNode =
+			&writeState->stripeSkipList->chunkSkipNodeArray[columnIndex][chunkIndex];
+		chunkSkipNode->bloomFilter =
+			BuildChunkBloomFilter(writeState->bloomFilterHashValues[columnIndex],
+								  writeState->bloomFilterHashCounts[columnIndex]);
+
+		writeState->bloomFilterHashCounts[columnIndex] = 0;
+	}
+
 	/*
 	 * check and compress value buffers, if a value buffer is not compressable
 	 * then keep it as uncompressed, store compression information.
@@ -618,38 +910,500 @@ SerializeChunkData(ColumnarWriteState *writeState, uint32 chunkIndex, uint32 row
 		ColumnBuffers *columnBuffers = stripeBuffers->columnBuffersArray[columnIndex];
 		ColumnChunkBuffers *chunkBuffers = columnBuffers->chunkBuffersArray[chunkIndex];
 		CompressionType actualCompressionType = COMPRESSION_NONE;
+		EncodingType encodingType = ENCODING_NONE;
+		CompressionType requestedCompressionType =
+			writeState->columnCompressionTypes[columnIndex];
+		int compressionLevel = writeState->columnCompressionLevels[columnIndex];
+		bool autoCompression = writeState->columnAutoCompression[columnIndex];
+		uint32 zstdDictionaryId = InvalidZstdDictionaryId;
+
+		if (stagingChunk || writeState->columnCompressionSkipped[columnIndex])
+		{
+			requestedCompressionType = COMPRESSION_NONE;
+		}
 
 		StringInfo serializedValueBuffer = chunkData->valueBufferArray[columnIndex];
 
 		Assert(requestedCompressionType >= 0 &&
 			   requestedCompressionType < COMPRESSION_COUNT);
 
-		chunkBuffers->decompressedValueSize =
-			chunkData->valueBufferArray[columnIndex]->len;
+		if (requestedCompressionType == COMPRESSION_ZSTD)
+		{
+			zstdDictionaryId = writeState->zstdDictionaryId;
+		}
+
+		/*
+		 * Encode the values first if that makes the buffer smaller. Note that
+		 * decompressedValueSize is the size of the encoded buffer in that case,
+		 * since that is what gets compressed.
+		 */
+		if (writeState->encodingEnabled && !stagingChunk)
+		{
+			Form_pg_attribute attributeForm =
+				TupleDescAttr(writeState->tupleDescriptor, columnIndex);
+			uint32 valueCount = 0;
+
+			for (uint32 rowIndex = 0; rowIndex < rowCount; rowIndex++)
+			{
+				valueCount += chunkData->existsArray[columnIndex][rowIndex] ? 1 : 0;
+			}
+
+			encodingType = EncodeValueBuffer(serializedValueBuffer, valueCount,
+											 attributeForm, encodingBuffer);
+			if (encodingType != ENCODING_NONE)
+			{
+				serializedValueBuffer = encodingBuffer;
+			}
+		}
+
+		chunkBuffers->decompressedValueSize = serializedValueBuffer->len;
+		chunkBuffers->valueEncodingType = encodingType;
+
+		/*
+		 * If we have compression workers, store the value buffer uncompressed
+		 * and let a worker compress it. The pool replaces the buffer and the
+		 * compression type once the compressed buffer is received. Columns
+		 * with auto compression are compressed inline, since whether the
+		 * next chunk is compressed depends on the result, and so are chunks
+		 * compressed with a zstd dictionary, since workers can't read it.
+		 */
+		bool compressInWorker = writeState->compressionPool != NULL &&
+								requestedCompressionType != COMPRESSION_NONE &&
+								!autoCompression &&
+								zstdDictionaryId == InvalidZstdDictionaryId;
 
 		/*
 		 * if serializedValueBuffer is be compressed, update serializedValueBuffer
 		 * with compressed data and store compression type.
 		 */
-		bool compressed = CompressBuffer(serializedValueBuffer, compressionBuffer,
-										 requestedCompressionType,
-										 compressionLevel);
-		if (compressed)
+		if (!compressInWorker &&
+			CompressBufferWithDictionary(serializedValueBuffer, compressionBuffer,
+										 requestedCompressionType, compressionLevel,
+										 zstdDictionaryId))
+		{
+			if (autoCompression &&
+				(double) serializedValueBuffer->len <
+				compressionBuffer->len * columnar_auto_compression_min_ratio)
+			{
+				writeState->columnCompressionSkipped[columnIndex] = true;
+			}
+			else
+			{
+				serializedValueBuffer = compressionBuffer;
+				actualCompressionType = requestedCompressionType;
+			}
+		}
+		else if (autoCompression && requestedCompressionType != COMPRESSION_NONE)
 		{
-			serializedValueBuffer = compressionBuffer;
-			actualCompressionType = requestedCompressionType;
+			/* the compression algorithm gave up on the buffer */
+			writeState->columnCompressionSkipped[columnIndex] = true;
 		}
 
 		/* store (compressed) value buffer */
 		chunkBuffers->valueCompressionType = actualCompressionType;
 		chunkBuffers->valueBuffer = CopyStringInfo(serializedValueBuffer);
 
+		if (compressInWorker)
+		{
+			ColumnarCompressionPoolSubmit(writeState->compressionPool, chunkBuffers,
+										  requestedCompressionType,
+										  compressionLevel);
+		}
+
 		/* valueBuffer needs to be reset for next chunk's data */
 		resetStringInfo(chunkData->valueBufferArray[columnIndex]);
 	}
 }
 
 
+/*
+ * StartCompressionPool starts the compression workers of the write state if
+ * columnar.compression_workers is set and the chunks are to be compressed.
+ * The workers are only started once per stripe; if they can't be started,
+ * the chunks of the stripe are compressed inline.
+ */
+static void
+StartCompressionPool(ColumnarWriteState *writeState)
+{
+	writeState->compressionPoolStarted = true;
+
+	if (columnar_compression_workers == 0)
+	{
+		return;
+	}
+
+	/*
+	 * Columns with auto compression and columns compressed with a zstd
+	 * dictionary are not compressed by workers.
+	 */
+	uint32 columnCount = writeState->tupleDescriptor->natts;
+	bool compressInWorkers = false;
+	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		CompressionType compressionType =
+			writeState->columnCompressionTypes[columnIndex];
+
+		if (compressionType != COMPRESSION_NONE &&
+			!writeState->columnAutoCompression[columnIndex] &&
+			!(compressionType == COMPRESSION_ZSTD &&
+			  writeState->zstdDictionaryId != InvalidZstdDictionaryId))
+		{
+			compressInWorkers = true;
+			break;
+		}
+	}
+
+	if (!compressInWorkers)
+	{
+		return;
+	}
+
+	/*
+	 * We are in the stripeWriteContext, so even if the stripe is never flushed
+	 * the workers go away along with the stripe data.
+	 */
+	writeState->compressionPool =
+		ColumnarCompressionPoolCreate(columnar_compression_workers);
+}
+
+
+/*
+ * InitColumnCompressions sets the compression type and level of each column
+ * of the write state, applying the given list of ColumnarColumnCompression
+ * on top of the compression of the table. Entries for columns that don't
+ * exist anymore are ignored.
+ */
+static void
+InitColumnCompressions(ColumnarWriteState *writeState, List *columnCompressionList)
+{
+	TupleDesc tupleDescriptor = writeState->tupleDescriptor;
+	uint32 columnCount = tupleDescriptor->natts;
+
+	writeState->columnCompressionTypes = palloc(columnCount * sizeof(CompressionType));
+	writeState->columnCompressionLevels = palloc(columnCount * sizeof(int));
+	writeState->columnAutoCompression = palloc0(columnCount * sizeof(bool));
+	writeState->columnCompressionSkipped = palloc0(columnCount * sizeof(bool));
+
+	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		writeState->columnCompressionTypes[columnIndex] =
+			writeState->options.compressionType;
+		writeState->columnCompressionLevels[columnIndex] =
+			writeState->options.compressionLevel;
+	}
+
+	ColumnarColumnCompression *columnCompression = NULL;
+	foreach_declared_ptr(columnCompression, columnCompressionList)
+	{
+		for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+		{
+			Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor,
+															columnIndex);
+			if (attributeForm->attisdropped ||
+				strcmp(NameStr(attributeForm->attname),
+					   columnCompression->columnName) != 0)
+			{
+				continue;
+			}
+
+			if (columnCompression->compressionType != COMPRESSION_TYPE_INVALID)
+			{
+				writeState->columnCompressionTypes[columnIndex] =
+					columnCompression->compressionType;
+			}
+
+			if (columnCompression->compressionLevel != 0)
+			{
+				writeState->columnCompressionLevels[columnIndex] =
+					columnCompression->compressionLevel;
+			}
+
+			writeState->columnAutoCompression[columnIndex] =
+				columnCompression->autoCompression;
+			break;
+		}
+	}
+}
+
+
+/*
+ * InitRowSorting prepares the write state to sort the rows of each stripe by
+ * the given sort key columns. Sort key columns that don't exist anymore, or
+ * whose type can't be sorted anymore, are ignored.
+ */
+static void
+InitRowSorting(ColumnarWriteState *writeState, List *sortKeyColumns)
+{
+	TupleDesc tupleDescriptor = writeState->tupleDescriptor;
+	List *columnIndexList = ColumnarSortKeyColumnIndexes(sortKeyColumns,
+														 tupleDescriptor);
+	int sortKeyCount = list_length(columnIndexList);
+
+	writeState->sortKeyCount = sortKeyCount;
+	writeState->bufferedRows = NULL;
+	writeState->bufferedRowCount = 0;
+	writeState->bufferedRowCapacity = 0;
+
+	if (sortKeyCount == 0)
+	{
+		return;
+	}
+
+	writeState->sortKeyColumnIndexes = palloc0(sortKeyCount * sizeof(int));
+	writeState->sortKeys = palloc0(sortKeyCount * sizeof(SortSupportData));
+
+	for (int keyIndex = 0; keyIndex < sortKeyCount; keyIndex++)
+	{
+		int columnIndex = list_nth_int(columnIndexList, keyIndex);
+		Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor, columnIndex);
+		TypeCacheEntry *typeEntry = lookup_type_cache(attributeForm->atttypid,
+													  TYPECACHE_LT_OPR);
+
+		SortSupport sortKey = &writeState->sortKeys[keyIndex];
+		sortKey->ssup_cxt = CurrentMemoryContext;
+		sortKey->ssup_collation = attributeForm->attcollation;
+		sortKey->ssup_nulls_first = false;
+		sortKey->ssup_attno = columnIndex + 1;
+		sortKey->abbreviate = false;
+		PrepareSortSupportFromOrderingOp(typeEntry->lt_opr, sortKey);
+
+		writeState->sortKeyColumnIndexes[keyIndex] = columnIndex;
+	}
+
+	writeState->sortSlot = MakeSingleTupleTableSlot(tupleDescriptor,
+													&TTSOpsMinimalTuple);
+}
+
+
+/*
+ * ColumnarSortKeyColumnIndexes returns the (0-indexed) column indexes of the
+ * given sort key columns in the tuple descriptor, in sort key order. Columns
+ * that don't exist or whose type has no default btree operator class are
+ * skipped.
+ */
+List *
+ColumnarSortKeyColumnIndexes(List *sortKeyColumns, TupleDesc tupleDescriptor)
+{
+	List *columnIndexList = NIL;
+
+	char *columnName = NULL;
+	foreach_declared_ptr(columnName, sortKeyColumns)
+	{
+		for (int columnIndex = 0; columnIndex < tupleDescriptor->natts; columnIndex++)
+		{
+			Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor,
+															columnIndex);
+			if (attributeForm->attisdropped ||
+				strcmp(NameStr(attributeForm->attname), columnName) != 0)
+			{
+				continue;
+			}
+
+			TypeCacheEntry *typeEntry = lookup_type_cache(attributeForm->atttypid,
+														  TYPECACHE_LT_OPR);
+			if (OidIsValid(typeEntry->lt_opr))
+			{
+				columnIndexList = list_append_unique_int(columnIndexList, columnIndex);
+			}
+		}
+	}
+
+	return columnIndexList;
+}
+
+
+/*
+ * ColumnarWriteSetStagingRowLimit makes the write state write the stripes that
+ * it flushes with fewer rows than stagingRowLimit as staging stripes, see
+ * ColumnarWriteState.
+ */
+void
+ColumnarWriteSetStagingRowLimit(ColumnarWriteState *writeState, uint32 stagingRowLimit)
+{
+	writeState->stagingRowLimit = stagingRowLimit;
+}
+
+
+/*
+ * ColumnarWriteStopSorting makes the write state append the rows it is given
+ * to the stripe in arrival order from now on, after appending the rows that
+ * were buffered to be sorted. This is needed when the row numbers returned by
+ * ColumnarWriteRow start being used to refer to the rows, e.g. because an
+ * index is created on the table.
+ */
+void
+ColumnarWriteStopSorting(ColumnarWriteState *writeState)
+{
+	if (writeState->sortKeyCount == 0)
+	{
+		return;
+	}
+
+	if (writeState->bufferedRowCount > 0)
+	{
+		MemoryContext oldContext = MemoryContextSwitchTo(writeState->stripeWriteContext);
+
+		AppendBufferedRowsToStripe(writeState);
+
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	writeState->sortKeyCount = 0;
+}
+
+
+/*
+ * BufferRowForSorting adds a copy of the given row to the rows of the current
+ * stripe that are to be sorted. It should be called in the stripeWriteContext.
+ */
+static void
+BufferRowForSorting(ColumnarWriteState *writeState, Datum *columnValues,
+					bool *columnNulls)
+{
+	int sortKeyCount = writeState->sortKeyCount;
+
+	if (writeState->bufferedRowCount == writeState->bufferedRowCapacity)
+	{
+		writeState->bufferedRowCapacity =
+			Min(writeState->bufferedRowCapacity * 2, writeState->options.stripeRowCount);
+		writeState->bufferedRows =
+			repalloc(writeState->bufferedRows,
+					 writeState->bufferedRowCapacity * sizeof(BufferedRow *));
+	}
+
+	BufferedRow *bufferedRow = palloc(sizeof(BufferedRow));
+	bufferedRow->tuple = heap_form_minimal_tuple(writeState->tupleDescriptor,
+												 columnValues, columnNulls);
+	bufferedRow->keyValues = palloc(sortKeyCount * sizeof(Datum));
+	bufferedRow->keyNulls = palloc(sortKeyCount * sizeof(bool));
+	bufferedRow->rowIndex = writeState->bufferedRowCount;
+
+	/* take the keys from the copy, so that they stay valid */
+	TupleTableSlot *sortSlot = writeState->sortSlot;
+	ExecStoreMinimalTuple(bufferedRow->tuple, sortSlot, false);
+	slot_getallattrs(sortSlot);
+
+	for (int keyIndex = 0; keyIndex < sortKeyCount; keyIndex++)
+	{
+		int columnIndex = writeState->sortKeyColumnIndexes[keyIndex];
+
+		bufferedRow->keyValues[keyIndex] = sortSlot->tts_values[columnIndex];
+		bufferedRow->keyNulls[keyIndex] = sortSlot->tts_isnull[columnIndex];
+	}
+
+	ExecClearTuple(sortSlot);
+
+	writeState->bufferedRows[writeState->bufferedRowCount++] = bufferedRow;
+}
+
+
+/*
+ * AppendBufferedRowsToStripe sorts the buffered rows of the current stripe and
+ * appends them to the stripe in that order. It should be called in the
+ * stripeWriteContext.
+ */
+static void
+AppendBufferedRowsToStripe(ColumnarWriteState *writeState)
+{
+	TupleTableSlot *sortSlot = writeState->sortSlot;
+
+	qsort_arg(writeState->bufferedRows, writeState->bufferedRowCount,
+			  sizeof(BufferedRow *), CompareBufferedRows, writeState);
+
+	for (uint32 rowIndex = 0; rowIndex < writeState->bufferedRowCount; rowIndex++)
+	{
+		BufferedRow *bufferedRow = writeState->bufferedRows[rowIndex];
+
+		ExecStoreMinimalTuple(bufferedRow->tuple, sortSlot, false);
+		slot_getallattrs(sortSlot);
+
+		AppendRowToStripe(writeState, sortSlot->tts_values, sortSlot->tts_isnull);
+
+		ExecClearTuple(sortSlot);
+
+		/* the row is serialized now, so free it to keep the peak memory lower */
+		pfree(bufferedRow->tuple);
+		pfree(bufferedRow->keyValues);
+		pfree(bufferedRow->keyNulls);
+		pfree(bufferedRow);
+	}
+
+	writeState->bufferedRowCount = 0;
+}
+
+
+/*
+ * CompareBufferedRows is a qsort_arg comparator that orders buffered rows by
+ * the sort key of the write state given as arg, and rows with equal keys in
+ * the order they were buffered.
+ */
+static int
+CompareBufferedRows(const void *leftElement, const void *rightElement, void *arg)
+{
+	ColumnarWriteState *writeState = (ColumnarWriteState *) arg;
+	BufferedRow *leftRow = *((BufferedRow **) leftElement);
+	BufferedRow *rightRow = *((BufferedRow **) rightElement);
+
+	for (int keyIndex = 0; keyIndex < writeState->sortKeyCount; keyIndex++)
+	{
+		int compare = ApplySortComparator(leftRow->keyValues[keyIndex],
+										  leftRow->keyNulls[keyIndex],
+										  rightRow->keyValues[keyIndex],
+										  rightRow->keyNulls[keyIndex],
+										  &writeState->sortKeys[keyIndex]);
+		if (compare != 0)
+		{
+			return compare;
+		}
+	}
+
+	if (leftRow->rowIndex < rightRow->rowIndex)
+	{
+		return -1;
+	}
+
+	return (leftRow->rowIndex > rightRow->rowIndex) ? 1 : 0;
+}
+
+
+/*
+ * BloomFilterHashFunctions returns an array with the hash functions to build
+ * the bloom filters of each column with. The entries for the columns that are
+ * not in bloomFilterColumns, or whose types don't have a default hash operator
+ * class, are NULL.
+ */
+static FmgrInfo **
+BloomFilterHashFunctions(List *bloomFilterColumns, TupleDesc tupleDescriptor)
+{
+	uint32 columnCount = tupleDescriptor->natts;
+	FmgrInfo **hashFunctionArray = palloc0(columnCount * sizeof(FmgrInfo *));
+
+	char *columnName = NULL;
+	foreach_declared_ptr(columnName, bloomFilterColumns)
+	{
+		for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+		{
+			Form_pg_attribute attributeForm = TupleDescAttr(tupleDescriptor,
+															columnIndex);
+			if (attributeForm->attisdropped ||
+				strcmp(NameStr(attributeForm->attname), columnName) != 0)
+			{
+				continue;
+			}
+
+			if (hashFunctionArray[columnIndex] == NULL)
+			{
+				hashFunctionArray[columnIndex] =
+					GetFunctionInfoOrNull(attributeForm->atttypid, HASH_AM_OID,
+										  HASHSTANDARD_PROC);
+			}
+		}
+	}
+
+	return hashFunctionArray;
+}
+
+
 /*
  * UpdateChunkSkipNodeMinMax takes the given column value, and checks if this
  * value falls outside the range of minimum/maximum values of the given column
@@ -771,5 +1525,6 @@ CopyStringInfo(StringInfo sourceString)
 bool
 ContainsPendingWrites(ColumnarWriteState *state)
 {
-	return state->stripeBuffers != NULL && state->stripeBuffers->rowCount != 0;
+	return state->stripeBuffers != NULL &&
+		   (state->stripeBuffers->rowCount != 0 || state->bufferedRowCount != 0);
 }
@@ -0,0 +1,116 @@
+-- citus_columnar--12.2-1--13.2-1
+
+-- lightweight encoding (RLE, delta, frame-of-reference or dictionary) that is
+-- applied to the value stream of the chunk before compression
+ALTER TABLE columnar_internal.chunk ADD COLUMN value_encoding_type int NOT NULL DEFAULT 0;
+
+-- bloom filter of the values in the chunk, for the columns listed in the
+-- bloom_filter_columns option of the table
+ALTER TABLE columnar_internal.chunk ADD COLUMN value_bloom_filter bytea;
+
+-- attribute numbers of the columns to build bloom filters for
+ALTER TABLE columnar_internal.options ADD COLUMN bloom_filter_columns smallint[];
+
+-- attribute numbers of the columns to sort the rows of each stripe by, in order
+ALTER TABLE columnar_internal.options ADD COLUMN sort_key smallint[];
+
+-- attribute numbers of the columns whose compression overrides the one of the
+-- table, and their compression settings as compression[:level], in the same
+-- order
+ALTER TABLE columnar_internal.options ADD COLUMN column_compression_columns smallint[];
+ALTER TABLE columnar_internal.options ADD COLUMN column_compression text[];
+
+-- zstd dictionaries trained for columnar tables, see train_zstd_dictionary. The
+-- ids are in the range that zstd reserves for private use, since they are
+-- recorded in the zstd frames of the chunks compressed with the dictionary.
+CREATE SEQUENCE columnar_internal.zstd_dictionary_id_seq
+  MINVALUE 32768 MAXVALUE 2147483647 NO CYCLE;
+
+CREATE TABLE columnar_internal.zstd_dictionary (
+    storage_id bigint NOT NULL,
+    dictionary_id bigint NOT NULL,
+    dictionary bytea NOT NULL,
+    PRIMARY KEY (dictionary_id)
+) WITH (user_catalog_table = true);
+
+CREATE INDEX zstd_dictionary_storage_id_idx
+  ON columnar_internal.zstd_dictionary USING BTREE (storage_id);
+
+COMMENT ON TABLE columnar_internal.zstd_dictionary IS 'Columnar zstd dictionaries';
+
+#include "udfs/columnar_ensure_am_depends_catalog/13.2-1.sql"
+SELECT columnar_internal.columnar_ensure_am_depends_catalog();
+
+CREATE OR REPLACE VIEW columnar.chunk WITH (security_barrier) AS
+  SELECT relation, storage.storage_id, stripe_num, attr_num, chunk_group_num,
+         minimum_value, maximum_value, value_stream_offset, value_stream_length,
+         exists_stream_offset, exists_stream_length, value_compression_type,
+         value_compression_level, value_decompressed_length, value_count,
+         value_encoding_type
+    FROM columnar_internal.chunk chunk, columnar.storage storage
+    WHERE chunk.storage_id = storage.storage_id;
+
+CREATE OR REPLACE VIEW columnar.options WITH (security_barrier) AS
+  SELECT regclass AS relation, chunk_group_row_limit,
+         stripe_row_limit, compression, compression_level,
+         (SELECT array_agg(a.attname ORDER BY a.attnum)
+            FROM pg_attribute a
+            WHERE a.attrelid = o.regclass
+              AND a.attnum = ANY (o.bloom_filter_columns)
+              AND NOT a.attisdropped) AS bloom_filter_columns,
+         (SELECT array_agg(a.attname ORDER BY k.ord)
+            FROM unnest(o.sort_key) WITH ORDINALITY AS k(attnum, ord),
+                 pg_attribute a
+            WHERE a.attrelid = o.regclass
+              AND a.attnum = k.attnum
+              AND NOT a.attisdropped) AS sort_key,
+         (SELECT array_agg(quote_ident(a.attname) || ':' || k.setting ORDER BY k.ord)
+            FROM unnest(o.column_compression_columns, o.column_compression)
+                   WITH ORDINALITY AS k(attnum, setting, ord),
+                 pg_attribute a
+            WHERE a.attrelid = o.regclass
+              AND a.attnum = k.attnum
+              AND NOT a.attisdropped) AS column_compression
+    FROM columnar_internal.options o, pg_class c
+    WHERE o.regclass = c.oid
+      AND pg_has_role(c.relowner, 'USAGE');
+
+CREATE FUNCTION columnar.chunk_cache_stats(
+    OUT hits bigint,
+    OUT misses bigint,
+    OUT evictions bigint,
+    OUT entries bigint,
+    OUT cache_size bigint)
+  RETURNS record
+  LANGUAGE C STRICT
+  AS 'citus_columnar', $$columnar_chunk_cache_stats$$;
+COMMENT ON FUNCTION columnar.chunk_cache_stats()
+  IS 'hit, miss and eviction counters of the columnar chunk cache of the current backend';
+
+CREATE FUNCTION columnar.metadata_cache_stats(
+    OUT hits bigint,
+    OUT misses bigint,
+    OUT evictions bigint,
+    OUT entries bigint,
+    OUT cache_size bigint)
+  RETURNS record
+  LANGUAGE C STRICT
+  AS 'citus_columnar', $$columnar_metadata_cache_stats$$;
+COMMENT ON FUNCTION columnar.metadata_cache_stats()
+  IS 'hit, miss and eviction counters of the columnar stripe metadata cache of the current backend';
+
+CREATE FUNCTION columnar.compact_stripes(table_name regclass, nowait bool DEFAULT false)
+  RETURNS bigint
+  LANGUAGE C STRICT
+  AS 'citus_columnar', $$columnar_compact_stripes$$;
+COMMENT ON FUNCTION columnar.compact_stripes(regclass, bool)
+  IS 'merges adjacent stripes of a columnar table that are not full into full-sized stripes';
+
+CREATE FUNCTION columnar.train_zstd_dictionary(table_name regclass,
+                                               dictionary_size int DEFAULT 65536)
+  RETURNS bigint
+  LANGUAGE C STRICT
+  AS 'citus_columnar', $$columnar_train_zstd_dictionary$$;
+COMMENT ON FUNCTION columnar.train_zstd_dictionary(regclass, int)
+  IS 'trains a zstd dictionary from a sample of the chunks of a columnar table, '
+     'which is used to compress the chunks that are written with zstd afterwards';
@@ -0,0 +1,76 @@
+-- citus_columnar--13.2-1--12.2-1
+
+-- older versions cannot read encoded chunks
+DO $$
+BEGIN
+  IF EXISTS (SELECT 1 FROM columnar_internal.chunk WHERE value_encoding_type <> 0) THEN
+    RAISE EXCEPTION 'cannot downgrade citus_columnar while columnar tables have encoded chunks'
+      USING HINT = 'Set columnar.enable_encoding to off and rewrite the columnar '
+                   'tables using VACUUM FULL before downgrading.';
+  END IF;
+END;
+$$;
+
+-- older versions cannot read chunks compressed with a zstd dictionary
+DO $$
+BEGIN
+  IF EXISTS (SELECT 1 FROM columnar_internal.zstd_dictionary) THEN
+    RAISE EXCEPTION 'cannot downgrade citus_columnar while columnar tables have zstd dictionaries'
+      USING HINT = 'Rewrite the columnar tables that have zstd dictionaries '
+                   'using VACUUM FULL before downgrading.';
+  END IF;
+END;
+$$;
+
+DROP FUNCTION columnar.chunk_cache_stats();
+DROP FUNCTION columnar.metadata_cache_stats();
+DROP FUNCTION columnar.compact_stripes(regclass, bool);
+DROP FUNCTION columnar.train_zstd_dictionary(regclass, int);
+
+-- the access method must not depend on the catalog we drop below
+DELETE FROM pg_depend
+WHERE classid = 'pg_am'::regclass::oid
+    AND objid IN (select oid from pg_am where amname = 'columnar')
+    AND objsubid = 0
+    AND refclassid = 'pg_class'::regclass::oid
+    AND refobjid IN (
+        'columnar_internal.zstd_dictionary'::regclass::oid,
+        'columnar_internal.zstd_dictionary_id_seq'::regclass::oid
+    )
+    AND refobjsubid = 0
+    AND deptype = 'n';
+
+#include "../udfs/columnar_ensure_am_depends_catalog/11.2-1.sql"
+
+DROP TABLE columnar_internal.zstd_dictionary;
+DROP SEQUENCE columnar_internal.zstd_dictionary_id_seq;
+
+DROP VIEW columnar.chunk;
+CREATE VIEW columnar.chunk WITH (security_barrier) AS
+  SELECT relation, storage.storage_id, stripe_num, attr_num, chunk_group_num,
+         minimum_value, maximum_value, value_stream_offset, value_stream_length,
+         exists_stream_offset, exists_stream_length, value_compression_type,
+         value_compression_level, value_decompressed_length, value_count
+    FROM columnar_internal.chunk chunk, columnar.storage storage
+    WHERE chunk.storage_id = storage.storage_id;
+COMMENT ON VIEW columnar.chunk
+  IS 'Columnar chunk information for tables on which the current user has ownership privileges.';
+GRANT SELECT ON columnar.chunk TO PUBLIC;
+
+DROP VIEW columnar.options;
+CREATE VIEW columnar.options WITH (security_barrier) AS
+  SELECT regclass AS relation, chunk_group_row_limit,
+         stripe_row_limit, compression, compression_level
+    FROM columnar_internal.options o, pg_class c
+    WHERE o.regclass = c.oid
+      AND pg_has_role(c.relowner, 'USAGE');
+COMMENT ON VIEW columnar.options
+  IS 'Columnar options for tables on which the current user has ownership privileges.';
+GRANT SELECT ON columnar.options TO PUBLIC;
+
+ALTER TABLE columnar_internal.chunk DROP COLUMN value_encoding_type;
+ALTER TABLE columnar_internal.chunk DROP COLUMN value_bloom_filter;
+ALTER TABLE columnar_internal.options DROP COLUMN bloom_filter_columns;
+ALTER TABLE columnar_internal.options DROP COLUMN sort_key;
+ALTER TABLE columnar_internal.options DROP COLUMN column_compression_columns;
+ALTER TABLE columnar_internal.options DROP COLUMN column_compression;
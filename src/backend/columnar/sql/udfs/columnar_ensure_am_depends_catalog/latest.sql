@@ -16,7 +16,9 @@ BEGIN
                         'chunk_group',
                         'options',
                         'storageid_seq',
-                        'stripe')
+                        'stripe',
+                        'zstd_dictionary',
+                        'zstd_dictionary_id_seq')
   )
   SELECT -- Define a dependency edge from "columnar table access method" ..
          'pg_am'::regclass::oid as classid,
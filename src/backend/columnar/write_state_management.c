@@ -168,6 +168,13 @@ columnar_init_write_state(Relation relation, TupleDesc tupdesc,
 
 		if (stackHead->subXid == currentSubXid)
 		{
+			/* an index or a trigger might have been created since */
+			if (ColumnarRelationKeepsRowNumbers(relation))
+			{
+				ColumnarWriteStopSorting(stackHead->writeState);
+				ColumnarWriteSetStagingRowLimit(stackHead->writeState, 0);
+			}
+
 			return stackHead->writeState;
 		}
 	}
@@ -190,11 +197,25 @@ columnar_init_write_state(Relation relation, TupleDesc tupdesc,
 	 */
 	ReadColumnarOptions(tupSlotRelationId, &columnarOptions);
 
+	bool keepsRowNumbers = ColumnarRelationKeepsRowNumbers(relation);
+	if (keepsRowNumbers)
+	{
+		columnarOptions.sortKeyColumns = NIL;
+	}
+
 	SubXidWriteState *stackEntry = palloc0(sizeof(SubXidWriteState));
 	stackEntry->writeState = ColumnarBeginWrite(RelationPhysicalIdentifier_compat(
 													relation),
 												columnarOptions,
 												tupdesc);
+
+	/* staging stripes can only be merged if rows can get new row numbers */
+	if (!keepsRowNumbers)
+	{
+		ColumnarWriteSetStagingRowLimit(stackEntry->writeState,
+										columnar_staging_row_limit);
+	}
+
 	stackEntry->subXid = currentSubXid;
 	stackEntry->next = hashEntry->writeStateStack;
 	hashEntry->writeStateStack = stackEntry;
@@ -205,6 +226,33 @@ columnar_init_write_state(Relation relation, TupleDesc tupdesc,
 }
 
 
+/*
+ * ColumnarRelationKeepsRowNumbers returns whether something might refer to the
+ * rows of the given relation by their row numbers, namely indexes and AFTER
+ * ROW triggers, which include foreign key checks. If not, rows can be moved
+ * to other row numbers, e.g. to sort the rows of a stripe or to merge small
+ * stripes. This decides both whether stripes are written as staging stripes
+ * and whether columnar.compact_stripes merges them.
+ */
+bool
+ColumnarRelationKeepsRowNumbers(Relation relation)
+{
+	if (relation->rd_rel->relhasindex)
+	{
+		return true;
+	}
+
+	TriggerDesc *triggerDesc = relation->trigdesc;
+	if (triggerDesc != NULL &&
+		(triggerDesc->trig_insert_after_row || triggerDesc->trig_update_after_row))
+	{
+		return true;
+	}
+
+	return false;
+}
+
+
 /*
  * Flushes pending writes for given relfilenode in the given subtransaction.
  */
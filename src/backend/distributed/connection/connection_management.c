@@ -1494,6 +1494,7 @@ ShouldShutdownConnection(MultiConnection *connection, const int cachedConnection
 		   cachedConnectionCount >= MaxCachedConnectionsPerWorker ||
 		   connection->forceCloseAtTransactionEnd ||
 		   PQstatus(connection->pgConn) != CONNECTION_OK ||
+		   PQpipelineStatus(connection->pgConn) != PQ_PIPELINE_OFF ||
 		   !RemoteTransactionIdle(connection) ||
 		   connection->requiresReplication ||
 		   connection->isReplicationOriginSessionSetup ||
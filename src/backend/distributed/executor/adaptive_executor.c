@@ -135,6 +135,7 @@
 #include "catalog/pg_type.h"
 #include "commands/dbcommands.h"
 #include "commands/schemacmds.h"
+#include "executor/executor.h"
 #include "lib/ilist.h"
 #include "portability/instr_time.h"
 #include "storage/fd.h"
@@ -301,6 +302,19 @@ typedef struct DistributedExecution
 	void **columnArray;
 	StringInfoData *stringInfoDataArray;
 
+	/*
+	 * Virtual slot into which rows received in binary format are decoded,
+	 * reused as long as the results have the same tuple descriptor.
+	 */
+	TupleTableSlot *binaryResultSlot;
+
+	/*
+	 * Memory context in which an execution whose results are streamed
+	 * continues when the scan needs more tuples, see
+	 * ReturnTupleFromStreamingExecution.
+	 */
+	MemoryContext streamingContext;
+
 	/*
 	 * jobIdList contains all jobs in the job tree, this is used to
 	 * do cleanup for repartition queries.
@@ -314,6 +328,20 @@ typedef struct DistributedExecution
 	 * fail, such as CREATE INDEX CONCURRENTLY.
 	 */
 	bool localExecutionSupported;
+
+	/*
+	 * Maximum number of task queries that are sent over a session in pipeline
+	 * mode before their results are received, 1 if pipelining is not used.
+	 */
+	int pipelineDepth;
+
+	/*
+	 * Maximum number of task queries that are combined into a single
+	 * multi-statement query, 1 if batching is not used. Batches are sent
+	 * using the simple query protocol, hence their results are always
+	 * received in text format.
+	 */
+	int taskBatchSize;
 } DistributedExecution;
 
 
@@ -472,6 +500,13 @@ typedef struct WorkerSession
 	/* task the worker should work on or NULL */
 	struct TaskPlacementExecution *currentTask;
 
+	/*
+	 * Tasks whose queries were sent in pipeline mode or in the same batch
+	 * after the query of currentTask, in the order in which their results
+	 * arrive.
+	 */
+	List *sentTaskList;
+
 	/*
 	 * The number of commands sent to the worker over the session. Excludes
 	 * distributed transaction related commands such as BEGIN/COMMIT etc.
@@ -497,6 +532,22 @@ bool ForceMaxQueryParallelization = false;
 int MaxAdaptiveExecutorPoolSize = 16;
 bool EnableBinaryProtocol = true;
 
+/* GUC, maximum number of task queries in flight on a single connection */
+int ExecutorPipelineDepth = 1;
+
+/* GUC, maximum number of task queries combined into a single query */
+int ExecutorTaskBatchSize = 1;
+
+/* GUC, whether read-only queries return rows while they are being received */
+bool EnableStreamingResults = false;
+
+/*
+ * Wait event sets of streaming executions, which are kept while the parent
+ * plan consumes tuples. They are released by FreeStreamingWaitEventSets if
+ * the transaction aborts before the scans end.
+ */
+static List *StreamingWaitEventSetList = NIL;
+
 /* GUC, number of ms to wait between opening connections to the same worker */
 int ExecutorSlowStartInterval = 10;
 bool EnableCostBasedConnectionEstablishment = true;
@@ -546,6 +597,9 @@ typedef struct ShardCommandExecution
 	 * encoding/decoding functions */
 	bool binaryResults;
 
+	/* cached BinaryTupleDecoder for task if binaryResults is set */
+	BinaryTupleDecoder **binaryTupleDecoders;
+
 	/* order in which the command should be replicated on replicas */
 	PlacementExecutionOrder executionOrder;
 
@@ -646,9 +700,23 @@ static TransactionProperties DecideTransactionPropertiesForTaskList(RowModifyLev
 																	List *taskList,
 																	bool
 																	exludeFromTransaction);
+static bool CanSendMultipleTasksPerSession(DistributedExecution *execution);
+static bool TaskParametersResolved(DistributedExecution *execution);
 static void StartDistributedExecution(DistributedExecution *execution);
 static void RunLocalExecution(CitusScanState *scanState, DistributedExecution *execution);
+static bool ShouldStreamResults(CitusScanState *scanState,
+								DistributedExecution *execution);
+static void StartStreamingExecution(CitusScanState *scanState,
+									DistributedExecution *execution);
+static void ReceiveStreamingResults(CitusScanState *scanState);
+static void FinishStreamingExecution(CitusScanState *scanState);
+static bool CancelSessionCommand(WorkerSession *session);
+static void StopSessionCommand(WorkerSession *session, bool commandCancelled);
 static void RunDistributedExecution(DistributedExecution *execution);
+static void StartWorkerSessions(DistributedExecution *execution);
+static bool RemoteExecutionInProgress(DistributedExecution *execution);
+static void RunDistributedExecutionIteration(DistributedExecution *execution,
+											 bool *cancellationReceived);
 static void SequentialRunDistributedExecution(DistributedExecution *execution);
 static void FinishDistributedExecution(DistributedExecution *execution);
 static void CleanUpSessions(DistributedExecution *execution);
@@ -686,8 +754,17 @@ static TaskPlacementExecution * PopAssignedPlacementExecution(WorkerSession *ses
 static TaskPlacementExecution * PopUnassignedPlacementExecution(WorkerPool *workerPool);
 static bool StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
 											 WorkerSession *session);
+static bool StartPlacementExecutionBatchOnSession(TaskPlacementExecution *
+												  placementExecution,
+												  WorkerSession *session);
+static void MarkPlacementExecutionRunning(TaskPlacementExecution *placementExecution,
+										  WorkerSession *session);
 static bool SendNextQuery(TaskPlacementExecution *placementExecution,
 						  WorkerSession *session);
+static bool FillTaskPipeline(WorkerSession *session);
+static void ReceivePipelineSync(WorkerSession *session);
+static bool BatchedTaskResultsDone(WorkerSession *session);
+static void ReceiveNextBatchedTask(WorkerSession *session);
 static void ConnectionStateMachine(WorkerSession *session);
 static bool HasUnfinishedTaskForSession(WorkerSession *session);
 static void HandleMultiConnectionSuccess(WorkerSession *session);
@@ -698,6 +775,13 @@ static void TransactionStateMachine(WorkerSession *session);
 static void UpdateConnectionWaitFlags(WorkerSession *session, int waitFlags);
 static bool CheckConnectionReady(WorkerSession *session);
 static bool ReceiveResults(WorkerSession *session, bool storeRows);
+static void StoreBinaryResultRows(DistributedExecution *execution,
+								  TaskPlacementExecution *placementExecution,
+								  TupleDestination *tupleDest, TupleDesc tupleDescriptor,
+								  uint32 queryIndex, PGresult *result,
+								  MemoryContext rowContext);
+static TupleTableSlot * BinaryResultSlot(DistributedExecution *execution,
+										 TupleDesc tupleDescriptor);
 static void WorkerSessionFailed(WorkerSession *session);
 static void WorkerPoolFailed(WorkerPool *workerPool);
 static void PlacementExecutionDone(TaskPlacementExecution *placementExecution,
@@ -872,6 +956,16 @@ AdaptiveExecutor(CitusScanState *scanState)
 	 */
 	StartDistributedExecution(execution);
 
+	if (ShouldStreamResults(scanState, execution))
+	{
+		/* tuples are received when CitusExecScan needs them */
+		StartStreamingExecution(scanState, execution);
+
+		MemoryContextSwitchTo(oldContext);
+
+		return resultSlot;
+	}
+
 	if (ShouldRunTasksSequentially(execution->remoteTaskList))
 	{
 		SequentialRunDistributedExecution(execution);
@@ -928,6 +1022,334 @@ RunLocalExecution(CitusScanState *scanState, DistributedExecution *execution)
 }
 
 
+/*
+ * ShouldStreamResults returns whether the results of the execution can be
+ * returned to the parent plan while the execution is still receiving them,
+ * instead of materializing all of them first.
+ */
+static bool
+ShouldStreamResults(CitusScanState *scanState, DistributedExecution *execution)
+{
+	DistributedPlan *distributedPlan = scanState->distributedPlan;
+	Job *job = distributedPlan->workerJob;
+
+	if (!EnableStreamingResults || !scanState->canStreamResults)
+	{
+		return false;
+	}
+
+	if (distributedPlan->modLevel != ROW_MODIFY_READONLY ||
+		job->jobQuery->commandType != CMD_SELECT ||
+		job->dependentJobList != NIL ||
+		RequestedForExplainAnalyze(scanState))
+	{
+		return false;
+	}
+
+	/*
+	 * The connections of the execution stay claimed while the parent plan
+	 * runs, which might run other distributed queries. Those can only use
+	 * other connections if the placements we access are not part of a
+	 * coordinated transaction, so we only stream the results of single
+	 * statement transactions that do not use remote transaction blocks.
+	 */
+	if (ExecutorLevel > 1 || IsMultiStatementTransaction() ||
+		InCoordinatedTransaction() ||
+		execution->transactionProperties->useRemoteTransactionBlocks ==
+		TRANSACTION_BLOCKS_REQUIRED)
+	{
+		return false;
+	}
+
+	/* local and sequential executions run each task to completion */
+	if (execution->localTaskList != NIL || execution->remoteTaskList == NIL ||
+		ShouldRunTasksSequentially(execution->remoteTaskList))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+/*
+ * StartStreamingExecution starts the remote execution of the tasks, whose
+ * results are then received by ReturnTupleFromStreamingExecution.
+ */
+static void
+StartStreamingExecution(CitusScanState *scanState, DistributedExecution *execution)
+{
+	AssignTasksToConnectionsOrWorkerPool(execution);
+
+	PG_TRY();
+	{
+		StartWorkerSessions(execution);
+	}
+	PG_CATCH();
+	{
+		UnclaimAllSessionConnections(execution->sessionList);
+
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	execution->streamingContext = CurrentMemoryContext;
+	scanState->streamingExecution = execution;
+}
+
+
+/*
+ * ReturnTupleFromStreamingExecution returns the next tuple of an execution
+ * whose results are streamed. The tuple store of the scan only contains the
+ * tuples that were received so far. Once all of them are returned, we empty
+ * the tuple store and go back to the event loop of the execution until new
+ * tuples arrive.
+ *
+ * Since we do not read from the connections while the parent plan consumes
+ * tuples, slow consumers make the workers wait on their sockets rather than
+ * filling up the tuple store.
+ */
+TupleTableSlot *
+ReturnTupleFromStreamingExecution(CitusScanState *scanState)
+{
+	for (;;)
+	{
+		TupleTableSlot *resultSlot = ReturnTupleFromTuplestore(scanState);
+		if (!TupIsNull(resultSlot) || scanState->streamingExecution == NULL)
+		{
+			return resultSlot;
+		}
+
+		/* all tuples received so far were returned, make room for new ones */
+		tuplestore_clear(scanState->tuplestorestate);
+		scanState->streamedResults = true;
+
+		ReceiveStreamingResults(scanState);
+	}
+}
+
+
+/*
+ * EndStreamingExecution is called when the parent plan does not need the
+ * rest of the results of a streaming execution, e.g. because the LIMIT of
+ * the query was reached. Instead of receiving the remaining results, we
+ * cancel the commands that are still running on the workers. Tasks that
+ * were not sent to a worker yet are never started.
+ */
+void
+EndStreamingExecution(CitusScanState *scanState)
+{
+	DistributedExecution *execution = scanState->streamingExecution;
+
+	FreeExecutionWaitEvents(execution);
+
+	/* let all workers stop their commands before we wait for any of them */
+	List *cancelledSessionList = NIL;
+	WorkerSession *session = NULL;
+	foreach_declared_ptr(session, execution->sessionList)
+	{
+		if (CancelSessionCommand(session))
+		{
+			cancelledSessionList = lappend(cancelledSessionList, session);
+		}
+	}
+
+	foreach_declared_ptr(session, execution->sessionList)
+	{
+		bool commandCancelled = list_member_ptr(cancelledSessionList, session);
+
+		StopSessionCommand(session, commandCancelled);
+	}
+
+	FinishDistributedExecution(execution);
+
+	scanState->streamingExecution = NULL;
+}
+
+
+/*
+ * CancelSessionCommand sends a cancelation request for the command that is
+ * running over the connection of a session, unless its results have already
+ * arrived, and returns whether it did. Pipelined connections are left alone,
+ * since a cancelation request only stops one of their queries, see
+ * StopSessionCommand.
+ */
+static bool
+CancelSessionCommand(WorkerSession *session)
+{
+	MultiConnection *connection = session->connection;
+	PGconn *pgConn = connection->pgConn;
+
+	if (connection->connectionState != MULTI_CONNECTION_CONNECTED ||
+		PQpipelineStatus(pgConn) != PQ_PIPELINE_OFF)
+	{
+		return false;
+	}
+
+	if (PQtransactionStatus(pgConn) != PQTRANS_ACTIVE ||
+		ClearResultsIfReady(connection))
+	{
+		return false;
+	}
+
+	SendCancelationRequest(connection);
+
+	return true;
+}
+
+
+/*
+ * StopSessionCommand discards the remaining results of the command that is
+ * running over the connection of a session and unclaims the connection.
+ * Connections that cannot be reused after that are closed, which includes
+ * the ones whose command was cancelled by CancelSessionCommand.
+ */
+static void
+StopSessionCommand(WorkerSession *session, bool commandCancelled)
+{
+	MultiConnection *connection = session->connection;
+	RemoteTransaction *transaction = &(connection->remoteTransaction);
+	PGconn *pgConn = connection->pgConn;
+
+	/* streaming executions do not use remote transaction blocks */
+	Assert(!transaction->beginSent);
+
+	UnclaimConnection(connection);
+
+	if (connection->connectionState != MULTI_CONNECTION_CONNECTED)
+	{
+		/* the connection was not established, see CleanUpSessions */
+		CloseConnection(connection);
+		return;
+	}
+
+	/*
+	 * Each pipelined query is followed by its own sync, hence the workers
+	 * would start the next query after cancelling the current one. Closing
+	 * the connection stops all of them.
+	 */
+	if (PQpipelineStatus(pgConn) != PQ_PIPELINE_OFF &&
+		(PQtransactionStatus(pgConn) != PQTRANS_IDLE ||
+		 PQexitPipelineMode(pgConn) == 0))
+	{
+		CloseConnection(connection);
+		return;
+	}
+
+	/*
+	 * The command either fails or finishes before the cancelation request
+	 * arrives, either way we only wait for the worker to become idle, such
+	 * that closing the connection does not send another cancelation request.
+	 */
+	bool raiseInterrupts = true;
+	while (PQtransactionStatus(pgConn) == PQTRANS_ACTIVE)
+	{
+		PGresult *result = GetRemoteCommandResult(connection, raiseInterrupts);
+		if (result == NULL)
+		{
+			break;
+		}
+
+		PQclear(result);
+	}
+
+	/*
+	 * The command might have finished before the worker processed the
+	 * cancelation request, which would then cancel the next command sent
+	 * over the connection.
+	 */
+	if (commandCancelled || PQtransactionStatus(pgConn) != PQTRANS_IDLE)
+	{
+		CloseConnection(connection);
+		return;
+	}
+
+	/* get ready for the next executions, as in CleanUpSessions */
+	transaction->transactionState = REMOTE_TRANS_NOT_STARTED;
+	connection->waitFlags = WL_SOCKET_READABLE | WL_SOCKET_WRITEABLE;
+}
+
+
+/*
+ * ReceiveStreamingResults runs the event loop of a streaming execution until
+ * new rows were received or the execution finished, in which case the
+ * execution is cleaned up.
+ */
+static void
+ReceiveStreamingResults(CitusScanState *scanState)
+{
+	DistributedExecution *execution = scanState->streamingExecution;
+	uint64 rowsProcessed = execution->rowsProcessed;
+	bool cancellationReceived = false;
+
+	MemoryContext oldContext = MemoryContextSwitchTo(execution->streamingContext);
+
+	PG_TRY();
+	{
+		/*
+		 * Connections that are being established are not read either while
+		 * the parent plan consumes tuples, so we wait for them to be
+		 * established before returning to avoid hitting their timeout.
+		 */
+		while (!cancellationReceived && RemoteExecutionInProgress(execution) &&
+			   (execution->rowsProcessed == rowsProcessed ||
+				HasIncompleteConnectionEstablishment(execution)))
+		{
+			RunDistributedExecutionIteration(execution, &cancellationReceived);
+		}
+
+		/*
+		 * The wait event set is kept for the next call, it only needs to be
+		 * rebuilt when the connections of the execution change.
+		 */
+		if (cancellationReceived || !RemoteExecutionInProgress(execution))
+		{
+			FreeExecutionWaitEvents(execution);
+
+			CleanUpSessions(execution);
+
+			FinishStreamingExecution(scanState);
+		}
+	}
+	PG_CATCH();
+	{
+		/*
+		 * We can still recover from error using ROLLBACK TO SAVEPOINT,
+		 * unclaim all connections to allow that.
+		 */
+		UnclaimAllSessionConnections(execution->sessionList);
+
+		FreeExecutionWaitEvents(execution);
+
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * FinishStreamingExecution finishes a streaming execution after all of its
+ * remote tasks are done.
+ */
+static void
+FinishStreamingExecution(CitusScanState *scanState)
+{
+	DistributedExecution *execution = scanState->streamingExecution;
+
+	/* tasks might have failed over to local execution */
+	if (list_length(execution->localTaskList) > 0)
+	{
+		RunLocalExecution(scanState, execution);
+	}
+
+	FinishDistributedExecution(execution);
+
+	scanState->streamingExecution = NULL;
+}
+
+
 /*
  * ExecuteUtilityTaskList is a wrapper around executing task
  * list for utility commands.
@@ -1246,34 +1668,109 @@ CreateDistributedExecution(RowModifyLevel modLevel, List *taskList,
 	execution->totalTaskCount = list_length(execution->remoteTaskList);
 	execution->unfinishedTaskCount = list_length(execution->remoteTaskList);
 
+	execution->taskBatchSize = 1;
+	execution->pipelineDepth = 1;
+
+	if (CanSendMultipleTasksPerSession(execution))
+	{
+		if (ExecutorTaskBatchSize > 1 && TaskParametersResolved(execution))
+		{
+			execution->taskBatchSize = ExecutorTaskBatchSize;
+		}
+		else
+		{
+			execution->pipelineDepth = ExecutorPipelineDepth;
+		}
+	}
+
 	return execution;
 }
 
 
 /*
- * DecideTransactionPropertiesForTaskList decides whether to use remote transaction
- * blocks, whether to use 2PC for the given task list, and whether to error on any
- * failure.
+ * CanSendMultipleTasksPerSession returns whether the queries of several tasks
+ * of the execution can be sent over a session before their results are
+ * received, either in pipeline mode or as a single batch.
  *
- * Since these decisions have specific dependencies on each other (e.g. 2PC implies
- * errorOnAnyFailure, but not the other way around) we keep them in the same place.
+ * We only do so for read-only executions that do not use remote transaction
+ * blocks, such that the transaction state machine does not need to track
+ * BEGIN/COMMIT in between the tasks. The query of every task also needs to
+ * be a single statement, such that the results can be matched to the tasks.
  */
-static TransactionProperties
-DecideTransactionPropertiesForTaskList(RowModifyLevel modLevel, List *taskList, bool
-									   exludeFromTransaction)
+static bool
+CanSendMultipleTasksPerSession(DistributedExecution *execution)
 {
-	TransactionProperties xactProperties;
-
-	/* ensure uninitialized padding doesn't escape the function */
-	memset_struct_0(xactProperties);
-	xactProperties.errorOnAnyFailure = false;
-	xactProperties.useRemoteTransactionBlocks = TRANSACTION_BLOCKS_ALLOWED;
-	xactProperties.requires2PC = false;
-
-	if (taskList == NIL)
+	if (execution->modLevel != ROW_MODIFY_READONLY ||
+		execution->transactionProperties->useRemoteTransactionBlocks ==
+		TRANSACTION_BLOCKS_REQUIRED ||
+		UseConnectionPerPlacement())
 	{
-		/* nothing to do, return defaults */
-		return xactProperties;
+		return false;
+	}
+
+	Task *task = NULL;
+	foreach_declared_ptr(task, execution->remoteTaskList)
+	{
+		if (task->taskType != READ_TASK || task->queryCount != 1)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * TaskParametersResolved returns whether the queries of all tasks of the
+ * execution can be sent without parameters, which is required to combine
+ * them into a single multi-statement query.
+ */
+static bool
+TaskParametersResolved(DistributedExecution *execution)
+{
+	if (execution->paramListInfo == NULL)
+	{
+		return true;
+	}
+
+	Task *task = NULL;
+	foreach_declared_ptr(task, execution->remoteTaskList)
+	{
+		if (!task->parametersInQueryStringResolved)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * DecideTransactionPropertiesForTaskList decides whether to use remote transaction
+ * blocks, whether to use 2PC for the given task list, and whether to error on any
+ * failure.
+ *
+ * Since these decisions have specific dependencies on each other (e.g. 2PC implies
+ * errorOnAnyFailure, but not the other way around) we keep them in the same place.
+ */
+static TransactionProperties
+DecideTransactionPropertiesForTaskList(RowModifyLevel modLevel, List *taskList, bool
+									   exludeFromTransaction)
+{
+	TransactionProperties xactProperties;
+
+	/* ensure uninitialized padding doesn't escape the function */
+	memset_struct_0(xactProperties);
+	xactProperties.errorOnAnyFailure = false;
+	xactProperties.useRemoteTransactionBlocks = TRANSACTION_BLOCKS_ALLOWED;
+	xactProperties.requires2PC = false;
+
+	if (taskList == NIL)
+	{
+		/* nothing to do, return defaults */
+		return xactProperties;
 	}
 
 	if (exludeFromTransaction)
@@ -1412,6 +1909,13 @@ FinishDistributedExecution(DistributedExecution *execution)
 		/* prevent copying shards in same transaction */
 		XactModificationLevel = XACT_MODIFICATION_DATA;
 	}
+
+	if (execution->binaryResultSlot != NULL)
+	{
+		/* release the pin on the tuple descriptor */
+		ExecDropSingleTupleTableSlot(execution->binaryResultSlot);
+		execution->binaryResultSlot = NULL;
+	}
 }
 
 
@@ -1636,6 +2140,8 @@ SetAttributeInputMetadata(DistributedExecution *execution,
 	uint32 queryCount = shardCommandExecution->task->queryCount;
 	shardCommandExecution->attributeInputMetadata = palloc0(queryCount *
 															sizeof(AttInMetadata *));
+	shardCommandExecution->binaryTupleDecoders = palloc0(queryCount *
+														 sizeof(BinaryTupleDecoder *));
 
 	for (uint32 queryIndex = 0; queryIndex < queryCount; queryIndex++)
 	{
@@ -1646,9 +2152,14 @@ SetAttributeInputMetadata(DistributedExecution *execution,
 		{
 			attInMetadata = NULL;
 		}
-		else if (EnableBinaryProtocol && CanUseBinaryCopyFormat(tupleDescriptor))
+		else if (EnableBinaryProtocol && CanUseBinaryCopyFormat(tupleDescriptor) &&
+				 execution->taskBatchSize == 1)
 		{
-			attInMetadata = TupleDescGetAttBinaryInMetadata(tupleDescriptor);
+			BinaryTupleDecoder *binaryTupleDecoder =
+				CreateBinaryTupleDecoder(tupleDescriptor);
+
+			attInMetadata = binaryTupleDecoder->attinmeta;
+			shardCommandExecution->binaryTupleDecoders[queryIndex] = binaryTupleDecoder;
 			shardCommandExecution->binaryResults = true;
 		}
 		else
@@ -1900,18 +2411,10 @@ RunDistributedExecution(DistributedExecution *execution)
 
 	PG_TRY();
 	{
-		/* Preemptively step state machines in case of immediate errors */
-		WorkerSession *session = NULL;
-		foreach_declared_ptr(session, execution->sessionList)
-		{
-			ConnectionStateMachine(session);
-		}
+		StartWorkerSessions(execution);
 
 		bool cancellationReceived = false;
 
-		/* always (re)build the wait event set the first time */
-		execution->rebuildWaitEventSet = true;
-
 		/*
 		 * Iterate until all the tasks are finished. Once all the tasks
 		 * are finished, ensure that all the connection initializations
@@ -1929,60 +2432,9 @@ RunDistributedExecution(DistributedExecution *execution)
 		 * cancellation to the query. In that case, we terminate the execution
 		 * irrespective of the current status of the tasks or the connections.
 		 */
-		while (!cancellationReceived &&
-			   (execution->unfinishedTaskCount > 0 ||
-				HasIncompleteConnectionEstablishment(execution)))
+		while (!cancellationReceived && RemoteExecutionInProgress(execution))
 		{
-			WorkerPool *workerPool = NULL;
-			foreach_declared_ptr(workerPool, execution->workerList)
-			{
-				ManageWorkerPool(workerPool);
-			}
-
-			bool skipWaitEvents = false;
-			if (execution->remoteTaskList == NIL)
-			{
-				/*
-				 * All the tasks are failed over to the local execution, no need
-				 * to wait for any connection activity.
-				 */
-				continue;
-			}
-			else if (execution->rebuildWaitEventSet)
-			{
-				RebuildWaitEventSet(execution);
-
-				skipWaitEvents =
-					ProcessSessionsWithFailedWaitEventSetOperations(execution);
-			}
-			else if (execution->waitFlagsChanged)
-			{
-				RebuildWaitEventSetFlags(execution->waitEventSet, execution->sessionList);
-				execution->waitFlagsChanged = false;
-
-				skipWaitEvents =
-					ProcessSessionsWithFailedWaitEventSetOperations(execution);
-			}
-
-			if (skipWaitEvents)
-			{
-				/*
-				 * Some operation on the wait event set is failed, retry
-				 * as we already removed the problematic connections.
-				 */
-				execution->rebuildWaitEventSet = true;
-
-				continue;
-			}
-
-			/* wait for I/O events */
-			long timeout = NextEventTimeout(execution);
-			int eventCount =
-				WaitEventSetWait(execution->waitEventSet, timeout, execution->events,
-								 execution->eventSetSize, WAIT_EVENT_CLIENT_READ);
-
-			ProcessWaitEvents(execution, execution->events, eventCount,
-							  &cancellationReceived);
+			RunDistributedExecutionIteration(execution, &cancellationReceived);
 		}
 
 		FreeExecutionWaitEvents(execution);
@@ -2005,6 +2457,100 @@ RunDistributedExecution(DistributedExecution *execution)
 }
 
 
+/*
+ * StartWorkerSessions preemptively steps the state machines of the sessions
+ * of the execution in case of immediate errors, and makes sure that the wait
+ * event set is built in the first iteration of the event loop.
+ */
+static void
+StartWorkerSessions(DistributedExecution *execution)
+{
+	WorkerSession *session = NULL;
+	foreach_declared_ptr(session, execution->sessionList)
+	{
+		ConnectionStateMachine(session);
+	}
+
+	/* always (re)build the wait event set the first time */
+	execution->rebuildWaitEventSet = true;
+}
+
+
+/*
+ * RemoteExecutionInProgress returns whether the execution still has tasks to
+ * finish or connections that are being established.
+ */
+static bool
+RemoteExecutionInProgress(DistributedExecution *execution)
+{
+	return execution->unfinishedTaskCount > 0 ||
+		   HasIncompleteConnectionEstablishment(execution);
+}
+
+
+/*
+ * RunDistributedExecutionIteration runs a single iteration of the event loop
+ * of a distributed execution. It manages the worker pools, waits for I/O
+ * events on the connections and runs the state machines of the sessions that
+ * have events.
+ */
+static void
+RunDistributedExecutionIteration(DistributedExecution *execution,
+								 bool *cancellationReceived)
+{
+	WorkerPool *workerPool = NULL;
+	foreach_declared_ptr(workerPool, execution->workerList)
+	{
+		ManageWorkerPool(workerPool);
+	}
+
+	bool skipWaitEvents = false;
+	if (execution->remoteTaskList == NIL)
+	{
+		/*
+		 * All the tasks are failed over to the local execution, no need
+		 * to wait for any connection activity.
+		 */
+		return;
+	}
+	else if (execution->rebuildWaitEventSet)
+	{
+		RebuildWaitEventSet(execution);
+
+		skipWaitEvents =
+			ProcessSessionsWithFailedWaitEventSetOperations(execution);
+	}
+	else if (execution->waitFlagsChanged)
+	{
+		RebuildWaitEventSetFlags(execution->waitEventSet, execution->sessionList);
+		execution->waitFlagsChanged = false;
+
+		skipWaitEvents =
+			ProcessSessionsWithFailedWaitEventSetOperations(execution);
+	}
+
+	if (skipWaitEvents)
+	{
+		/*
+		 * Some operation on the wait event set is failed, retry
+		 * as we already removed the problematic connections.
+		 */
+		execution->rebuildWaitEventSet = true;
+
+		return;
+	}
+
+	/* wait for I/O events */
+	long timeout = NextEventTimeout(execution);
+	int eventCount =
+		WaitEventSetWait(execution->waitEventSet, timeout, execution->events,
+						 execution->eventSetSize, WAIT_EVENT_CLIENT_READ);
+
+	ProcessWaitEvents(execution, execution->events, eventCount,
+					  cancellationReceived);
+}
+
+
 /*
  * ProcessSessionsWithFailedWaitEventSetOperations goes over the session list
  * and processes sessions with failed wait event set operations.
@@ -2117,11 +2663,31 @@ RebuildWaitEventSetForSessions(DistributedExecution *execution)
 {
 	FreeExecutionWaitEvents(execution);
 
+	/*
+	 * The executor memory of a streaming execution might be gone by the time
+	 * an abort releases its wait event set, so we allocate the set for the
+	 * whole transaction instead.
+	 */
+	bool isStreaming = execution->streamingContext != NULL;
+	MemoryContext oldContext = CurrentMemoryContext;
+	if (isStreaming)
+	{
+		MemoryContextSwitchTo(TopTransactionContext);
+	}
+
 	execution->waitEventSet = BuildWaitEventSet(execution->sessionList);
 
 	execution->eventSetSize = GetEventSetSize(execution->sessionList);
 	execution->events = palloc0(execution->eventSetSize * sizeof(WaitEvent));
 
+	if (isStreaming)
+	{
+		StreamingWaitEventSetList = lappend(StreamingWaitEventSetList,
+											execution->waitEventSet);
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
 	CitusAddWaitEventSetToSet(execution->waitEventSet, WL_POSTMASTER_DEATH,
 							  PGINVALID_SOCKET, NULL, NULL);
 
@@ -3444,6 +4010,13 @@ TransactionStateMachine(WorkerSession *session)
 						break;
 					}
 
+					if (execution->pipelineDepth > 1 &&
+						PQenterPipelineMode(connection->pgConn) == 0)
+					{
+						connection->connectionState = MULTI_CONNECTION_LOST;
+						return;
+					}
+
 					bool placementExecutionStarted =
 						StartPlacementExecutionOnSession(placementExecution, session);
 					if (!placementExecutionStarted)
@@ -3455,6 +4028,16 @@ TransactionStateMachine(WorkerSession *session)
 						return;
 					}
 
+					/* send the queries of more tasks if we are in pipeline mode */
+					if (!FillTaskPipeline(session))
+					{
+						/* no need to continue, connection is lost */
+						Assert(session->connection->connectionState ==
+							   MULTI_CONNECTION_LOST);
+
+						return;
+					}
+
 					transaction->transactionState = REMOTE_TRANS_SENT_COMMAND;
 				}
 
@@ -3466,6 +4049,26 @@ TransactionStateMachine(WorkerSession *session)
 			case REMOTE_TRANS_SENT_BEGIN:
 			case REMOTE_TRANS_CLEARING_RESULTS:
 			{
+				if (PQpipelineStatus(connection->pgConn) != PQ_PIPELINE_OFF)
+				{
+					/*
+					 * In pipeline mode, the results of the next query follow
+					 * the sync of the current one without a NULL result.
+					 */
+					ReceivePipelineSync(session);
+					break;
+				}
+
+				if (session->sentTaskList != NIL)
+				{
+					/*
+					 * The results of the next task in the batch follow the
+					 * ones of the current task without a NULL result.
+					 */
+					ReceiveNextBatchedTask(session);
+					break;
+				}
+
 				PGresult *result = PQgetResult(connection->pgConn);
 				if (result != NULL)
 				{
@@ -3820,6 +4423,129 @@ StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
 {
 	WorkerPool *workerPool = session->workerPool;
 	DistributedExecution *execution = workerPool->distributedExecution;
+
+	if (execution->taskBatchSize > 1)
+	{
+		return StartPlacementExecutionBatchOnSession(placementExecution, session);
+	}
+
+	if (session->commandsSent == 0)
+	{
+		/* first time we send a command, consider the connection used (not unused) */
+		workerPool->unusedConnectionCount--;
+	}
+
+	MarkPlacementExecutionRunning(placementExecution, session);
+
+	bool querySent = SendNextQuery(placementExecution, session);
+	if (querySent)
+	{
+		session->commandsSent++;
+
+		if (workerPool->poolToLocalNode)
+		{
+			/*
+			 * As we started remote execution to the local node,
+			 * we cannot switch back to local execution as that
+			 * would cause self-deadlocks and breaking
+			 * read-your-own-writes consistency.
+			 */
+			SetLocalExecutionStatus(LOCAL_EXECUTION_DISABLED);
+		}
+	}
+
+	return querySent;
+}
+
+
+/*
+ * StartPlacementExecutionBatchOnSession sends the query of the given
+ * TaskPlacementExecution together with the queries of up to taskBatchSize - 1
+ * other ready placement executions of the session as a single multi-statement
+ * query. The results of the statements arrive in order and are received by
+ * the tasks one after the other, as if they had been sent separately.
+ *
+ * The function returns true if the batch is successfully sent over the
+ * connection, otherwise false.
+ */
+static bool
+StartPlacementExecutionBatchOnSession(TaskPlacementExecution *placementExecution,
+									  WorkerSession *session)
+{
+	WorkerPool *workerPool = session->workerPool;
+	DistributedExecution *execution = workerPool->distributedExecution;
+	MultiConnection *connection = session->connection;
+	StringInfo batchQueryString = makeStringInfo();
+	int batchTaskCount = 0;
+
+	if (session->commandsSent == 0)
+	{
+		/* first time we send a command, consider the connection used (not unused) */
+		workerPool->unusedConnectionCount--;
+	}
+
+	while (placementExecution != NULL)
+	{
+		Task *task = placementExecution->shardCommandExecution->task;
+
+		MarkPlacementExecutionRunning(placementExecution, session);
+
+		if (batchTaskCount > 0)
+		{
+			appendStringInfoString(batchQueryString, "; ");
+		}
+
+		appendStringInfoString(batchQueryString, TaskQueryStringAtIndex(task, 0));
+		batchTaskCount++;
+
+		if (batchTaskCount >= execution->taskBatchSize)
+		{
+			break;
+		}
+
+		placementExecution = PopPlacementExecution(session);
+	}
+
+	int querySent = SendRemoteCommand(connection, batchQueryString->data);
+	if (querySent == 0)
+	{
+		connection->connectionState = MULTI_CONNECTION_LOST;
+		return false;
+	}
+
+	/* single row mode applies to all the statements in the batch */
+	int singleRowMode = PQsetSingleRowMode(connection->pgConn);
+	if (singleRowMode == 0)
+	{
+		connection->connectionState = MULTI_CONNECTION_LOST;
+		return false;
+	}
+
+	session->commandsSent += batchTaskCount;
+
+	if (workerPool->poolToLocalNode)
+	{
+		/* see StartPlacementExecutionOnSession */
+		SetLocalExecutionStatus(LOCAL_EXECUTION_DISABLED);
+	}
+
+	return true;
+}
+
+
+/*
+ * MarkPlacementExecutionRunning does the bookkeeping for a placement
+ * execution whose query is about to be sent over the given session. The
+ * first placement execution becomes the current task of the session, the
+ * results of any others sent over the session in pipeline mode or in the
+ * same batch arrive after it.
+ */
+static void
+MarkPlacementExecutionRunning(TaskPlacementExecution *placementExecution,
+							  WorkerSession *session)
+{
+	WorkerPool *workerPool = session->workerPool;
+	DistributedExecution *execution = workerPool->distributedExecution;
 	MultiConnection *connection = session->connection;
 	ShardCommandExecution *shardCommandExecution =
 		placementExecution->shardCommandExecution;
@@ -3837,15 +4563,19 @@ StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
 		AssignPlacementListToConnection(placementAccessList, connection);
 	}
 
-	if (session->commandsSent == 0)
+	if (session->currentTask == NULL)
 	{
-		/* first time we send a command, consider the connection used (not unused) */
-		workerPool->unusedConnectionCount--;
+		/* connection is going to be in use */
+		workerPool->idleConnectionCount--;
+		session->currentTask = placementExecution;
+	}
+	else
+	{
+		/* results arrive after the ones of the earlier tasks */
+		Assert(execution->pipelineDepth > 1 || execution->taskBatchSize > 1);
+		session->sentTaskList = lappend(session->sentTaskList, placementExecution);
 	}
 
-	/* connection is going to be in use */
-	workerPool->idleConnectionCount--;
-	session->currentTask = placementExecution;
 	placementExecution->executionState = PLACEMENT_EXECUTION_RUNNING;
 
 	Assert(INSTR_TIME_IS_ZERO(placementExecution->startTime));
@@ -3858,25 +4588,6 @@ StartPlacementExecutionOnSession(TaskPlacementExecution *placementExecution,
 	 * now.
 	 */
 	INSTR_TIME_SET_CURRENT(placementExecution->startTime);
-
-	bool querySent = SendNextQuery(placementExecution, session);
-	if (querySent)
-	{
-		session->commandsSent++;
-
-		if (workerPool->poolToLocalNode)
-		{
-			/*
-			 * As we started remote execution to the local node,
-			 * we cannot switch back to local execution as that
-			 * would cause self-deadlocks and breaking
-			 * read-your-own-writes consistency.
-			 */
-			SetLocalExecutionStatus(LOCAL_EXECUTION_DISABLED);
-		}
-	}
-
-	return querySent;
 }
 
 
@@ -3898,6 +4609,7 @@ SendNextQuery(TaskPlacementExecution *placementExecution,
 	ParamListInfo paramListInfo = execution->paramListInfo;
 	int querySent = 0;
 	uint32 queryIndex = placementExecution->queryIndex;
+	bool pipelineMode = PQpipelineStatus(connection->pgConn) != PQ_PIPELINE_OFF;
 
 	Assert(queryIndex < task->queryCount);
 	char *queryString = TaskQueryStringAtIndex(task, queryIndex);
@@ -3930,8 +4642,10 @@ SendNextQuery(TaskPlacementExecution *placementExecution,
 		 * strange/incorrectly with select statements. In
 		 * isolation_select_vs_all.spec, when doing an s1-router-select in one
 		 * session blocked an s2-ddl-create-index-concurrently in another.
+		 *
+		 * In pipeline mode, only the extended query protocol can be used.
 		 */
-		if (!binaryResults)
+		if (!binaryResults && !pipelineMode)
 		{
 			querySent = SendRemoteCommand(connection, queryString);
 		}
@@ -3948,6 +4662,29 @@ SendNextQuery(TaskPlacementExecution *placementExecution,
 		return false;
 	}
 
+	if (pipelineMode)
+	{
+		/*
+		 * Follow every query by a sync, such that it runs in its own implicit
+		 * transaction and a failure does not abort the queries of other tasks.
+		 */
+		if (PQpipelineSync(connection->pgConn) == 0)
+		{
+			connection->connectionState = MULTI_CONNECTION_LOST;
+			return false;
+		}
+
+		/*
+		 * In pipeline mode, single row mode can only be set for the query
+		 * whose results are received next. For the other tasks, it is set
+		 * once they become the current task, see ReceivePipelineSync.
+		 */
+		if (session->currentTask != placementExecution)
+		{
+			return true;
+		}
+	}
+
 	int singleRowMode = PQsetSingleRowMode(connection->pgConn);
 	if (singleRowMode == 0)
 	{
@@ -3959,6 +4696,127 @@ SendNextQuery(TaskPlacementExecution *placementExecution,
 }
 
 
+/*
+ * FillTaskPipeline sends the queries of ready tasks over a session that is in
+ * pipeline mode until the pipeline depth of the execution is reached, such
+ * that the worker can start on the next query while we receive the results
+ * of the current one. It does nothing if the session is not in pipeline mode.
+ *
+ * The function returns false if the connection is lost, otherwise true.
+ */
+static bool
+FillTaskPipeline(WorkerSession *session)
+{
+	DistributedExecution *execution = session->workerPool->distributedExecution;
+	MultiConnection *connection = session->connection;
+
+	if (PQpipelineStatus(connection->pgConn) == PQ_PIPELINE_OFF)
+	{
+		return true;
+	}
+
+	/* the query of the current task is also in the pipeline */
+	while (list_length(session->sentTaskList) + 1 < execution->pipelineDepth)
+	{
+		TaskPlacementExecution *placementExecution = PopPlacementExecution(session);
+		if (placementExecution == NULL)
+		{
+			break;
+		}
+
+		bool placementExecutionStarted =
+			StartPlacementExecutionOnSession(placementExecution, session);
+		if (!placementExecutionStarted)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * ReceivePipelineSync receives the sync that follows the query of the current
+ * task of a session in pipeline mode and marks the task as done. The session
+ * then continues with the next pipelined task, or leaves pipeline mode once
+ * the results of all the queries it sent are received.
+ */
+static void
+ReceivePipelineSync(WorkerSession *session)
+{
+	WorkerPool *workerPool = session->workerPool;
+	MultiConnection *connection = session->connection;
+	RemoteTransaction *transaction = &(connection->remoteTransaction);
+	TaskPlacementExecution *placementExecution = session->currentTask;
+	bool succeeded = true;
+
+	if (PQisBusy(connection->pgConn))
+	{
+		/* the sync did not arrive yet, wait for it rather than block */
+		UpdateConnectionWaitFlags(session, WL_SOCKET_READABLE);
+		return;
+	}
+
+	PGresult *result = PQgetResult(connection->pgConn);
+	if (result == NULL || PQresultStatus(result) != PGRES_PIPELINE_SYNC)
+	{
+		ereport(ERROR, (errmsg("unexpected result from %s:%d in pipeline mode",
+							   connection->hostname, connection->port)));
+	}
+
+	PQclear(result);
+
+	/*
+	 * Once we finished a task on a connection, we no longer allow that
+	 * connection to fail.
+	 */
+	MarkRemoteTransactionCritical(connection);
+
+	session->currentTask = NULL;
+
+	PlacementExecutionDone(placementExecution, succeeded);
+
+	if (session->sentTaskList != NIL)
+	{
+		/* results of the next task follow, keep the connection in use */
+		session->currentTask = linitial(session->sentTaskList);
+		session->sentTaskList = list_delete_first(session->sentTaskList);
+
+		/* now that its results come next, the query can use single row mode */
+		if (PQsetSingleRowMode(connection->pgConn) == 0)
+		{
+			connection->connectionState = MULTI_CONNECTION_LOST;
+			return;
+		}
+
+		if (!FillTaskPipeline(session))
+		{
+			/* no need to continue, connection is lost */
+			return;
+		}
+
+		transaction->transactionState = REMOTE_TRANS_SENT_COMMAND;
+	}
+	else
+	{
+		/* connection is ready to use for executing commands */
+		workerPool->idleConnectionCount++;
+
+		if (PQexitPipelineMode(connection->pgConn) == 0)
+		{
+			connection->connectionState = MULTI_CONNECTION_LOST;
+			return;
+		}
+
+		transaction->transactionState = REMOTE_TRANS_NOT_STARTED;
+	}
+
+	/* connection needs to be writeable to send next command */
+	UpdateConnectionWaitFlags(session, WL_SOCKET_READABLE | WL_SOCKET_WRITEABLE);
+}
+
+
 /*
  * ReceiveResults reads the result of a command or query and writes returned
  * rows to the tuple store of the scan state. It returns whether fetching results
@@ -4021,6 +4879,13 @@ ReceiveResults(WorkerSession *session, bool storeRows)
 
 			/* task query might contain multiple queries, so fetch until we reach NULL */
 			placementExecution->queryIndex++;
+
+			if (BatchedTaskResultsDone(session))
+			{
+				fetchDone = true;
+				break;
+			}
+
 			continue;
 		}
 		else if (resultStatus == PGRES_TUPLES_OK)
@@ -4034,6 +4899,13 @@ ReceiveResults(WorkerSession *session, bool storeRows)
 
 			/* task query might contain multiple queries, so fetch until we reach NULL */
 			placementExecution->queryIndex++;
+
+			if (BatchedTaskResultsDone(session))
+			{
+				fetchDone = true;
+				break;
+			}
+
 			continue;
 		}
 		else if (resultStatus != PGRES_SINGLE_TUPLE)
@@ -4101,7 +4973,6 @@ ReceiveResults(WorkerSession *session, bool storeRows)
 		}
 
 		void **columnArray = execution->columnArray;
-		StringInfoData *stringInfoDataArray = execution->stringInfoDataArray;
 		bool binaryResults = shardCommandExecution->binaryResults;
 
 		/*
@@ -4111,6 +4982,15 @@ ReceiveResults(WorkerSession *session, bool storeRows)
 		 */
 		Assert(EnableBinaryProtocol || !binaryResults);
 
+		if (binaryResults)
+		{
+			StoreBinaryResultRows(execution, placementExecution, tupleDest,
+								  tupleDescriptor, queryIndex, result, rowContext);
+
+			PQclear(result);
+			continue;
+		}
+
 		for (uint32 rowIndex = 0; rowIndex < rowsProcessed; rowIndex++)
 		{
 			uint64 tupleLibpqSize = 0;
@@ -4134,25 +5014,12 @@ ReceiveResults(WorkerSession *session, bool storeRows)
 				{
 					int valueLength = PQgetlength(result, rowIndex, columnIndex);
 					char *value = PQgetvalue(result, rowIndex, columnIndex);
-					if (binaryResults)
-					{
-						if (PQfformat(result, columnIndex) == 0)
-						{
-							ereport(ERROR, (errmsg("unexpected text result")));
-						}
-						resetStringInfo(&stringInfoDataArray[columnIndex]);
-						appendBinaryStringInfo(&stringInfoDataArray[columnIndex],
-											   value, valueLength);
-						columnArray[columnIndex] = &stringInfoDataArray[columnIndex];
-					}
-					else
+
+					if (PQfformat(result, columnIndex) == 1)
 					{
-						if (PQfformat(result, columnIndex) == 1)
-						{
-							ereport(ERROR, (errmsg("unexpected binary result")));
-						}
-						columnArray[columnIndex] = value;
+						ereport(ERROR, (errmsg("unexpected binary result")));
 					}
+					columnArray[columnIndex] = value;
 
 					tupleLibpqSize += valueLength;
 				}
@@ -4160,17 +5027,8 @@ ReceiveResults(WorkerSession *session, bool storeRows)
 
 			AttInMetadata *attInMetadata =
 				shardCommandExecution->attributeInputMetadata[queryIndex];
-			HeapTuple heapTuple;
-			if (binaryResults)
-			{
-				heapTuple = BuildTupleFromBytes(attInMetadata,
-												(fmStringInfo *) columnArray);
-			}
-			else
-			{
-				heapTuple = BuildTupleFromCStrings(attInMetadata,
-												   (char **) columnArray);
-			}
+			HeapTuple heapTuple = BuildTupleFromCStrings(attInMetadata,
+														 (char **) columnArray);
 
 			MemoryContextSwitchTo(oldContext);
 
@@ -4193,6 +5051,179 @@ ReceiveResults(WorkerSession *session, bool storeRows)
 }
 
 
+/*
+ * StoreBinaryResultRows decodes the rows of a result in binary format into a
+ * virtual slot and passes them to the tuple destination of the task. Values
+ * of common fixed-width types are decoded without calling their receive
+ * functions, and no HeapTuple is formed if the destination accepts slots.
+ */
+static void
+StoreBinaryResultRows(DistributedExecution *execution,
+					  TaskPlacementExecution *placementExecution,
+					  TupleDestination *tupleDest, TupleDesc tupleDescriptor,
+					  uint32 queryIndex, PGresult *result, MemoryContext rowContext)
+{
+	ShardCommandExecution *shardCommandExecution =
+		placementExecution->shardCommandExecution;
+	Task *task = shardCommandExecution->task;
+	BinaryTupleDecoder *binaryTupleDecoder =
+		shardCommandExecution->binaryTupleDecoders[queryIndex];
+	StringInfoData *stringInfoDataArray = execution->stringInfoDataArray;
+	uint32 rowCount = PQntuples(result);
+	uint32 columnCount = PQnfields(result);
+
+	for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+	{
+		if (PQfformat(result, columnIndex) == 0)
+		{
+			ereport(ERROR, (errmsg("unexpected text result")));
+		}
+	}
+
+	TupleTableSlot *slot = BinaryResultSlot(execution, tupleDescriptor);
+	Datum *values = slot->tts_values;
+	bool *nulls = slot->tts_isnull;
+
+	for (uint32 rowIndex = 0; rowIndex < rowCount; rowIndex++)
+	{
+		uint64 tupleLibpqSize = 0;
+		HeapTuple heapTuple = NULL;
+
+		/*
+		 * Decode into a temporary memory context that we reset after each
+		 * tuple. Fixed-width values do not allocate any memory, in which case
+		 * resetting the context is free.
+		 */
+		MemoryContext oldContext = MemoryContextSwitchTo(rowContext);
+
+		for (uint32 columnIndex = 0; columnIndex < columnCount; columnIndex++)
+		{
+			bool isNull = PQgetisnull(result, rowIndex, columnIndex);
+			char *value = NULL;
+			int valueLength = 0;
+
+			if (!isNull)
+			{
+				value = PQgetvalue(result, rowIndex, columnIndex);
+				valueLength = PQgetlength(result, rowIndex, columnIndex);
+				tupleLibpqSize += valueLength;
+			}
+
+			values[columnIndex] =
+				DecodeBinaryAttribute(binaryTupleDecoder, columnIndex, value,
+									  valueLength, &stringInfoDataArray[columnIndex],
+									  &isNull);
+			nulls[columnIndex] = isNull;
+		}
+
+		ExecStoreVirtualTuple(slot);
+
+		if (tupleDest->putSlot == NULL)
+		{
+			heapTuple = heap_form_tuple(tupleDescriptor, values, nulls);
+		}
+
+		MemoryContextSwitchTo(oldContext);
+
+		if (heapTuple == NULL)
+		{
+			tupleDest->putSlot(tupleDest, task,
+							   placementExecution->placementExecutionIndex, queryIndex,
+							   slot, tupleLibpqSize);
+		}
+		else
+		{
+			tupleDest->putTuple(tupleDest, task,
+								placementExecution->placementExecutionIndex, queryIndex,
+								heapTuple, tupleLibpqSize);
+		}
+
+		/* the slot points into rowContext, empty it before the reset */
+		ExecClearTuple(slot);
+		MemoryContextReset(rowContext);
+
+		execution->rowsProcessed++;
+	}
+}
+
+
+/*
+ * BinaryResultSlot returns the virtual slot into which rows with the given
+ * tuple descriptor are decoded.
+ */
+static TupleTableSlot *
+BinaryResultSlot(DistributedExecution *execution, TupleDesc tupleDescriptor)
+{
+	TupleTableSlot *slot = execution->binaryResultSlot;
+	if (slot != NULL && slot->tts_tupleDescriptor == tupleDescriptor)
+	{
+		return slot;
+	}
+
+	if (slot != NULL)
+	{
+		ExecDropSingleTupleTableSlot(slot);
+	}
+
+	/* the slot lives as long as the execution */
+	MemoryContext oldContext =
+		MemoryContextSwitchTo(GetMemoryChunkContext(execution));
+
+	slot = MakeSingleTupleTableSlot(tupleDescriptor, &TTSOpsVirtual);
+	execution->binaryResultSlot = slot;
+
+	MemoryContextSwitchTo(oldContext);
+
+	return slot;
+}
+
+
+/*
+ * BatchedTaskResultsDone returns whether all results of the current task of
+ * a session were received while the results of other tasks of the same batch
+ * follow. Since a batch is a single multi-statement query, libpq does not
+ * return a NULL result in between the results of the tasks.
+ */
+static bool
+BatchedTaskResultsDone(WorkerSession *session)
+{
+	DistributedExecution *execution = session->workerPool->distributedExecution;
+	TaskPlacementExecution *placementExecution = session->currentTask;
+	Task *task = placementExecution->shardCommandExecution->task;
+
+	return execution->taskBatchSize > 1 && session->sentTaskList != NIL &&
+		   placementExecution->queryIndex >= task->queryCount;
+}
+
+
+/*
+ * ReceiveNextBatchedTask marks the current task of a session as done after
+ * all of its results were received and continues with receiving the results
+ * of the next task of the same batch.
+ */
+static void
+ReceiveNextBatchedTask(WorkerSession *session)
+{
+	MultiConnection *connection = session->connection;
+	RemoteTransaction *transaction = &(connection->remoteTransaction);
+	TaskPlacementExecution *placementExecution = session->currentTask;
+	bool succeeded = true;
+
+	/*
+	 * Once we finished a task on a connection, we no longer allow that
+	 * connection to fail.
+	 */
+	MarkRemoteTransactionCritical(connection);
+
+	session->currentTask = linitial(session->sentTaskList);
+	session->sentTaskList = list_delete_first(session->sentTaskList);
+
+	PlacementExecutionDone(placementExecution, succeeded);
+
+	transaction->transactionState = REMOTE_TRANS_SENT_COMMAND;
+}
+
+
 /*
  * WorkerPoolFailed marks a worker pool and all the placement executions scheduled
  * on it as failed.
@@ -4292,6 +5323,12 @@ WorkerSessionFailed(WorkerSession *session)
 		PlacementExecutionDone(placementExecution, succeeded);
 	}
 
+	/* the queries of pipelined tasks were sent, but their results are lost */
+	foreach_declared_ptr(placementExecution, session->sentTaskList)
+	{
+		PlacementExecutionDone(placementExecution, succeeded);
+	}
+
 	dlist_foreach(iter, &session->pendingTaskQueue)
 	{
 		placementExecution =
@@ -4757,12 +5794,34 @@ FreeExecutionWaitEvents(DistributedExecution *execution)
 
 	if (execution->waitEventSet != NULL)
 	{
+		StreamingWaitEventSetList = list_delete_ptr(StreamingWaitEventSetList,
+													execution->waitEventSet);
+
 		FreeWaitEventSet(execution->waitEventSet);
 		execution->waitEventSet = NULL;
 	}
 }
 
 
+/*
+ * FreeStreamingWaitEventSets frees the wait event sets of streaming executions
+ * whose scans did not end, which happens when the transaction aborts while the
+ * parent plan consumes tuples.
+ */
+void
+FreeStreamingWaitEventSets(void)
+{
+	WaitEventSet *waitEventSet = NULL;
+	foreach_declared_ptr(waitEventSet, StreamingWaitEventSetList)
+	{
+		FreeWaitEventSet(waitEventSet);
+	}
+
+	/* the list itself is freed along with the transaction memory */
+	StreamingWaitEventSetList = NIL;
+}
+
+
 /*
  * AddSessionToWaitEventSet is a helper function which adds the session to
  * the waitEventSet. The function does certain checks before adding the session
@@ -202,6 +202,9 @@ CitusBeginScan(CustomScanState *node, EState *estate, int eflags)
 
 	node->ss.ps.qual = ExecInitQual(node->ss.ps.plan->qual, (PlanState *) node);
 
+	scanState->canStreamResults =
+		(eflags & (EXEC_FLAG_REWIND | EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) == 0;
+
 	DistributedPlan *distributedPlan = scanState->distributedPlan;
 	if (distributedPlan->modifyQueryViaCoordinatorOrRepartition != NULL)
 	{
@@ -253,7 +256,9 @@ CitusPreExecScan(CitusScanState *scanState)
  * CitusExecScan is called when a tuple is pulled from a custom scan.
  * On the first call, it executes the distributed query and writes the
  * results to a tuple store. The postgres executor calls this function
- * repeatedly to read tuples from the tuple store.
+ * repeatedly to read tuples from the tuple store. If the adaptive executor
+ * decided to stream the results, the tuple store only contains the results
+ * received so far and is refilled when it runs empty.
  */
 TupleTableSlot *
 CitusExecScan(CustomScanState *node)
@@ -267,6 +272,11 @@ CitusExecScan(CustomScanState *node)
 		scanState->finishedRemoteScan = true;
 	}
 
+	if (scanState->streamingExecution != NULL)
+	{
+		return ReturnTupleFromStreamingExecution(scanState);
+	}
+
 	return ReturnTupleFromTuplestore(scanState);
 }
 
@@ -777,6 +787,12 @@ CitusEndScan(CustomScanState *node)
 	Const *partitionKeyConst = NULL;
 	char *partitionKeyString = NULL;
 
+	if (scanState->streamingExecution != NULL)
+	{
+		/* the parent plan did not need all results, e.g. because of a LIMIT */
+		EndStreamingExecution(scanState);
+	}
+
 	/* stop propagating notices */
 	DisableWorkerMessagePropagation();
 
@@ -829,6 +845,13 @@ CitusReScan(CustomScanState *node)
 	ExecScanReScan(&node->ss);
 
 	CitusScanState *scanState = (CitusScanState *) node;
+	if (scanState->streamedResults)
+	{
+		/* should not happen, we only stream results if rewinding is not needed */
+		ereport(ERROR, (errmsg("cannot rescan a distributed query whose results "
+							   "were streamed")));
+	}
+
 	if (scanState->tuplestorestate)
 	{
 		tuplestore_rescan(scanState->tuplestorestate);
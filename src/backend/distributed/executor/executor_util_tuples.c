@@ -12,11 +12,18 @@
 #include "funcapi.h"
 #include "miscadmin.h"
 
+#include "catalog/pg_type.h"
 #include "utils/lsyscache.h"
 
 #include "distributed/executor_util.h"
 
 
+static BinaryAttributeDecoder BinaryAttributeDecoderForType(Oid typeId);
+static void EnsureBinaryAttributeLength(int valueLength, int expectedLength);
+static inline uint32 ReadNetworkUInt32(const char *value);
+static inline uint64 ReadNetworkUInt64(const char *value);
+
+
 /*
  * TupleDescGetAttBinaryInMetadata - Build an AttInMetadata structure based on
  * the supplied TupleDesc. AttInMetadata can be used in conjunction with
@@ -129,3 +136,244 @@ BuildTupleFromBytes(AttInMetadata *attinmeta, fmStringInfo *values)
 
 	return tuple;
 }
+
+
+/*
+ * CreateBinaryTupleDecoder creates a BinaryTupleDecoder for tuples of the
+ * given TupleDesc, which picks a specialized decoder for attributes of common
+ * fixed-width types and falls back to the receive functions of all others.
+ */
+BinaryTupleDecoder *
+CreateBinaryTupleDecoder(TupleDesc tupdesc)
+{
+	BinaryTupleDecoder *decoder = palloc0(sizeof(BinaryTupleDecoder));
+	decoder->attinmeta = TupleDescGetAttBinaryInMetadata(tupdesc);
+	decoder->attributeDecoders = palloc0(tupdesc->natts *
+										 sizeof(BinaryAttributeDecoder));
+
+	for (int attributeIndex = 0; attributeIndex < tupdesc->natts; attributeIndex++)
+	{
+		Form_pg_attribute attribute = TupleDescAttr(tupdesc, attributeIndex);
+
+		if (attribute->attisdropped)
+		{
+			decoder->attributeDecoders[attributeIndex] = BINARY_DECODER_DROPPED;
+		}
+		else
+		{
+			decoder->attributeDecoders[attributeIndex] =
+				BinaryAttributeDecoderForType(attribute->atttypid);
+		}
+	}
+
+	return decoder;
+}
+
+
+/*
+ * BinaryAttributeDecoderForType returns the decoder for values of the given
+ * type. We only decode types directly whose receive function does nothing
+ * but converting the value from network byte order, such that the result is
+ * the same as calling the receive function. In particular, domains over these
+ * types need their receive function to check the constraints.
+ */
+static BinaryAttributeDecoder
+BinaryAttributeDecoderForType(Oid typeId)
+{
+	switch (typeId)
+	{
+		case BOOLOID:
+		{
+			return BINARY_DECODER_BOOL;
+		}
+
+		case INT2OID:
+		{
+			return BINARY_DECODER_INT2;
+		}
+
+		case INT4OID:
+		{
+			return BINARY_DECODER_INT4;
+		}
+
+		case OIDOID:
+		{
+			return BINARY_DECODER_OID;
+		}
+
+		case INT8OID:
+		{
+			return BINARY_DECODER_INT8;
+		}
+
+		case FLOAT4OID:
+		{
+			return BINARY_DECODER_FLOAT4;
+		}
+
+		case FLOAT8OID:
+		{
+			return BINARY_DECODER_FLOAT8;
+		}
+
+		default:
+		{
+			return BINARY_DECODER_RECEIVE_FUNCTION;
+		}
+	}
+}
+
+
+/*
+ * DecodeBinaryAttribute returns the Datum for the value of the attribute at
+ * attributeIndex in binary format. value is NULL and *isNull is true for NULL
+ * values, *isNull is also set to true for dropped attributes.
+ *
+ * buffer is used to pass the value to receive functions, which copy the data
+ * they return into CurrentMemoryContext, such that callers can reuse the same
+ * buffer for every tuple.
+ */
+Datum
+DecodeBinaryAttribute(BinaryTupleDecoder *decoder, int attributeIndex, char *value,
+					  int valueLength, StringInfo buffer, bool *isNull)
+{
+	BinaryAttributeDecoder attributeDecoder =
+		decoder->attributeDecoders[attributeIndex];
+
+	if (attributeDecoder == BINARY_DECODER_DROPPED)
+	{
+		*isNull = true;
+		return (Datum) 0;
+	}
+
+	if (*isNull && attributeDecoder != BINARY_DECODER_RECEIVE_FUNCTION)
+	{
+		/* receive functions of the fixed-width types are strict */
+		return (Datum) 0;
+	}
+
+	switch (attributeDecoder)
+	{
+		case BINARY_DECODER_BOOL:
+		{
+			EnsureBinaryAttributeLength(valueLength, 1);
+			return BoolGetDatum(*value != 0);
+		}
+
+		case BINARY_DECODER_INT2:
+		{
+			EnsureBinaryAttributeLength(valueLength, sizeof(int16));
+			return Int16GetDatum((int16) (((uint8) value[0] << 8) | (uint8) value[1]));
+		}
+
+		case BINARY_DECODER_INT4:
+		{
+			EnsureBinaryAttributeLength(valueLength, sizeof(int32));
+			return Int32GetDatum((int32) ReadNetworkUInt32(value));
+		}
+
+		case BINARY_DECODER_OID:
+		{
+			EnsureBinaryAttributeLength(valueLength, sizeof(Oid));
+			return ObjectIdGetDatum((Oid) ReadNetworkUInt32(value));
+		}
+
+		case BINARY_DECODER_INT8:
+		{
+			EnsureBinaryAttributeLength(valueLength, sizeof(int64));
+			return Int64GetDatum((int64) ReadNetworkUInt64(value));
+		}
+
+		case BINARY_DECODER_FLOAT4:
+		{
+			union
+			{
+				float4 f;
+				uint32 i;
+			} swap;
+
+			EnsureBinaryAttributeLength(valueLength, sizeof(swap.i));
+			swap.i = ReadNetworkUInt32(value);
+			return Float4GetDatum(swap.f);
+		}
+
+		case BINARY_DECODER_FLOAT8:
+		{
+			union
+			{
+				float8 f;
+				uint64 i;
+			} swap;
+
+			EnsureBinaryAttributeLength(valueLength, sizeof(swap.i));
+			swap.i = ReadNetworkUInt64(value);
+			return Float8GetDatum(swap.f);
+		}
+
+		default:
+		{
+			break;
+		}
+	}
+
+	/*
+	 * Call the receive function even for NULLs to support domains, like
+	 * BuildTupleFromBytes does.
+	 */
+	StringInfo receiveBuffer = NULL;
+	if (!*isNull)
+	{
+		resetStringInfo(buffer);
+		appendBinaryStringInfo(buffer, value, valueLength);
+		receiveBuffer = buffer;
+	}
+
+	AttInMetadata *attinmeta = decoder->attinmeta;
+	return ReceiveFunctionCall(&attinmeta->attinfuncs[attributeIndex],
+							   receiveBuffer,
+							   attinmeta->attioparams[attributeIndex],
+							   attinmeta->atttypmods[attributeIndex]);
+}
+
+
+/*
+ * EnsureBinaryAttributeLength errors out if a value of a fixed-width type
+ * received in binary format does not have the expected length.
+ */
+static void
+EnsureBinaryAttributeLength(int valueLength, int expectedLength)
+{
+	if (valueLength != expectedLength)
+	{
+		ereport(ERROR, (errcode(ERRCODE_INVALID_BINARY_REPRESENTATION),
+						errmsg("incorrect binary data format"),
+						errdetail("Expected %d bytes, but received %d bytes.",
+								  expectedLength, valueLength)));
+	}
+}
+
+
+/*
+ * ReadNetworkUInt32 reads a 4 byte unsigned integer in network byte order
+ * from a possibly unaligned address.
+ */
+static inline uint32
+ReadNetworkUInt32(const char *value)
+{
+	const uint8 *bytes = (const uint8 *) value;
+
+	return ((uint32) bytes[0] << 24) | ((uint32) bytes[1] << 16) |
+		   ((uint32) bytes[2] << 8) | (uint32) bytes[3];
+}
+
+
+/*
+ * ReadNetworkUInt64 reads an 8 byte unsigned integer in network byte order
+ * from a possibly unaligned address.
+ */
+static inline uint64
+ReadNetworkUInt64(const char *value)
+{
+	return ((uint64) ReadNetworkUInt32(value) << 32) | ReadNetworkUInt32(value + 4);
+}
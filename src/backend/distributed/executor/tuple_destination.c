@@ -49,6 +49,9 @@ typedef struct TupleDestDestReceiver
 static void TupleStoreTupleDestPutTuple(TupleDestination *self, Task *task,
 										int placementIndex, int queryNumber,
 										HeapTuple heapTuple, uint64 tupleLibpqSize);
+static void TupleStoreTupleDestPutSlot(TupleDestination *self, Task *task,
+									   int placementIndex, int queryNumber,
+									   TupleTableSlot *slot, uint64 tupleLibpqSize);
 static void EnsureIntermediateSizeLimitNotExceeded(TupleDestinationStats *
 												   tupleDestinationStats);
 static TupleDesc TupleStoreTupleDestTupleDescForQuery(TupleDestination *self, int
@@ -78,6 +81,7 @@ CreateTupleStoreTupleDest(Tuplestorestate *tupleStore, TupleDesc tupleDescriptor
 	tupleStoreTupleDest->tupleStore = tupleStore;
 	tupleStoreTupleDest->tupleDesc = tupleDescriptor;
 	tupleStoreTupleDest->pub.putTuple = TupleStoreTupleDestPutTuple;
+	tupleStoreTupleDest->pub.putSlot = TupleStoreTupleDestPutSlot;
 	tupleStoreTupleDest->pub.tupleDescForQuery =
 		TupleStoreTupleDestTupleDescForQuery;
 
@@ -131,6 +135,37 @@ TupleStoreTupleDestPutTuple(TupleDestination *self, Task *task,
 }
 
 
+/*
+ * TupleStoreTupleDestPutSlot implements TupleDestination->putSlot for
+ * TupleStoreTupleDestination.
+ */
+static void
+TupleStoreTupleDestPutSlot(TupleDestination *self, Task *task,
+						   int placementIndex, int queryNumber,
+						   TupleTableSlot *slot, uint64 tupleLibpqSize)
+{
+	TupleStoreTupleDestination *tupleDest = (TupleStoreTupleDestination *) self;
+
+	/*
+	 * Only remote execution passes slots, so tupleLibpqSize reflects the size
+	 * of the tuple. Enforce citus.max_intermediate_result_size for subPlans if
+	 * the caller requested.
+	 */
+	TupleDestinationStats *tupleDestinationStats = self->tupleDestinationStats;
+	if (SubPlanLevel > 0 && tupleDestinationStats != NULL)
+	{
+		tupleDestinationStats->totalIntermediateResultSize += tupleLibpqSize;
+		EnsureIntermediateSizeLimitNotExceeded(tupleDestinationStats);
+	}
+
+	/* do the actual work */
+	tuplestore_puttupleslot(tupleDest->tupleStore, slot);
+
+	/* we record tuples received over network */
+	task->totalReceivedTupleData += tupleLibpqSize;
+}
+
+
 /*
  * EnsureIntermediateSizeLimitNotExceeded is a helper function for checking the current
  * state of the tupleDestinationStats and throws error if necessary.
@@ -81,6 +81,8 @@ static Datum WorkerNodeGetDatum(WorkerNode *workerNode, TupleDesc tupleDescripto
 
 static char * CitusCreateAlterColumnarTableSet(char *qualifiedRelationName,
 											   const ColumnarOptions *options);
+static char * ColumnarColumnListString(List *columnNameList);
+static char * ColumnarColumnCompressionString(List *columnCompressionList);
 static char * GetTableDDLCommandColumnar(void *context);
 static TableDDLCommand * ColumnarGetTableOptionsDDL(Oid relationId);
 
@@ -1098,7 +1100,7 @@ CitusCreateAlterColumnarTableSet(char *qualifiedRelationName,
 					 "columnar.chunk_group_row_limit = %d, "
 					 "columnar.stripe_row_limit = %lu, "
 					 "columnar.compression_level = %d, "
-					 "columnar.compression = %s);",
+					 "columnar.compression = %s",
 					 qualifiedRelationName,
 					 options->chunkRowCount,
 					 options->stripeRowCount,
@@ -1106,10 +1108,99 @@ CitusCreateAlterColumnarTableSet(char *qualifiedRelationName,
 					 quote_literal_cstr(extern_CompressionTypeStr(
 											options->compressionType)));
 
+	/*
+	 * Only set bloom filter columns, sort key and column compression if any,
+	 * older versions don't know these options.
+	 */
+	if (options->bloomFilterColumns != NIL)
+	{
+		appendStringInfo(&buf, ", columnar.bloom_filter_columns = %s",
+						 quote_literal_cstr(ColumnarColumnListString(
+												options->bloomFilterColumns)));
+	}
+
+	if (options->sortKeyColumns != NIL)
+	{
+		appendStringInfo(&buf, ", columnar.sort_key = %s",
+						 quote_literal_cstr(ColumnarColumnListString(
+												options->sortKeyColumns)));
+	}
+
+	if (options->columnCompressions != NIL)
+	{
+		appendStringInfo(&buf, ", columnar.column_compression = %s",
+						 quote_literal_cstr(ColumnarColumnCompressionString(
+												options->columnCompressions)));
+	}
+
+	appendStringInfoString(&buf, ");");
+
 	return buf.data;
 }
 
 
+/*
+ * ColumnarColumnListString returns the given column names as a comma-separated
+ * list of quoted identifiers, as accepted by the columnar options that take a
+ * list of columns.
+ */
+static char *
+ColumnarColumnListString(List *columnNameList)
+{
+	StringInfoData columnListString = { 0 };
+	initStringInfo(&columnListString);
+
+	char *columnName = NULL;
+	foreach_declared_ptr(columnName, columnNameList)
+	{
+		if (columnListString.len > 0)
+		{
+			appendStringInfoString(&columnListString, ", ");
+		}
+
+		appendStringInfoString(&columnListString, quote_identifier(columnName));
+	}
+
+	return columnListString.data;
+}
+
+
+/*
+ * ColumnarColumnCompressionString returns the given list of
+ * ColumnarColumnCompression in the format accepted by the
+ * columnar.column_compression option.
+ */
+static char *
+ColumnarColumnCompressionString(List *columnCompressionList)
+{
+	StringInfoData columnCompressionString = { 0 };
+	initStringInfo(&columnCompressionString);
+
+	ColumnarColumnCompression *columnCompression = NULL;
+	foreach_declared_ptr(columnCompression, columnCompressionList)
+	{
+		if (columnCompressionString.len > 0)
+		{
+			appendStringInfoString(&columnCompressionString, ", ");
+		}
+
+		appendStringInfo(&columnCompressionString, "%s:%s",
+						 quote_identifier(columnCompression->columnName),
+						 columnCompression->autoCompression ?
+						 "auto" :
+						 extern_CompressionTypeStr(columnCompression->compressionType));
+
+		if (columnCompression->compressionLevel != 0)
+		{
+			appendStringInfo(&columnCompressionString, ":%d",
+							 columnCompression->compressionLevel);
+		}
+	}
+
+	return columnCompressionString.data;
+}
+
+
 /*
  * GetTableDDLCommandColumnar is an internal function used to turn a
  * ColumnarTableDDLContext stored on the context of a TableDDLCommandFunction into a sql
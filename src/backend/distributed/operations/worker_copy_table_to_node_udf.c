@@ -13,15 +13,27 @@
 
 #include "postgres.h"
 
+#include "miscadmin.h"
+
+#include "access/table.h"
+#include "utils/acl.h"
 #include "utils/builtins.h"
 #include "utils/lsyscache.h"
+#include "utils/rls.h"
+#include "utils/snapmgr.h"
 
 #include "distributed/citus_ruleutils.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/multi_executor.h"
 #include "distributed/priority.h"
+#include "distributed/shared_library_init.h"
 #include "distributed/worker_shard_copy.h"
 
+static bool CanCopyColumnarTableDirectly(Oid relationId);
+static void CopyColumnarTableToDestReceiver(Oid relationId, DestReceiver *destReceiver);
+static void SendColumnarRowToDestReceiver(Datum *columnValues, bool *columnNulls,
+										  void *callbackArg);
+
 PG_FUNCTION_INFO_V1(worker_copy_table_to_node);
 
 /*
@@ -62,21 +74,88 @@ worker_copy_table_to_node(PG_FUNCTION_ARGS)
 		list_make2(relationSchemaName, relationName),
 		targetNodeId);
 
-	StringInfo selectShardQueryForCopy = makeStringInfo();
+	if (CanCopyColumnarTableDirectly(relationId))
+	{
+		CopyColumnarTableToDestReceiver(relationId, destReceiver);
+	}
+	else
+	{
+		StringInfo selectShardQueryForCopy = makeStringInfo();
 
-	/*
-	 * Even though we do COPY(SELECT ...) all the columns, we can't just do SELECT * because we need to not COPY generated colums.
-	 */
-	const char *columnList = CopyableColumnNamesFromRelationName(relationSchemaName,
-																 relationName);
-	appendStringInfo(selectShardQueryForCopy,
-					 "SELECT %s FROM %s;", columnList, relationQualifiedName);
+		/*
+		 * Even though we do COPY(SELECT ...) all the columns, we can't just do SELECT * because we need to not COPY generated colums.
+		 */
+		const char *columnList = CopyableColumnNamesFromRelationName(relationSchemaName,
+																	 relationName);
+		appendStringInfo(selectShardQueryForCopy,
+						 "SELECT %s FROM %s;", columnList, relationQualifiedName);
 
-	ParamListInfo params = NULL;
-	ExecuteQueryStringIntoDestReceiver(selectShardQueryForCopy->data, params,
-									   destReceiver);
+		ParamListInfo params = NULL;
+		ExecuteQueryStringIntoDestReceiver(selectShardQueryForCopy->data, params,
+										   destReceiver);
+	}
 
 	FreeExecutorState(executor);
 
 	PG_RETURN_VOID();
 }
+
+
+/*
+ * CanCopyColumnarTableDirectly returns true if the given table is a columnar
+ * table whose rows can be read directly from the columnar storage, rather than
+ * through a SELECT query. That is not the case if the current user cannot
+ * read the table or row level security applies, in which case the query
+ * takes care of erroring out or of filtering out the rows.
+ */
+static bool
+CanCopyColumnarTableDirectly(Oid relationId)
+{
+	if (!extern_IsColumnarTableAmTable(relationId))
+	{
+		return false;
+	}
+
+	if (pg_class_aclcheck(relationId, GetUserId(), ACL_SELECT) != ACLCHECK_OK)
+	{
+		return false;
+	}
+
+	return check_enable_rls(relationId, InvalidOid, true) != RLS_ENABLED;
+}
+
+
+/*
+ * CopyColumnarTableToDestReceiver sends all rows of the given columnar table
+ * to the given shard copy DestReceiver. The rows are read a chunk group at a
+ * time and passed on as column value arrays, which avoids planning a query and
+ * materializing a tuple slot for each row.
+ */
+static void
+CopyColumnarTableToDestReceiver(Oid relationId, DestReceiver *destReceiver)
+{
+	Relation relation = table_open(relationId, AccessShareLock);
+
+	destReceiver->rStartup(destReceiver, CMD_SELECT, RelationGetDescr(relation));
+
+	extern_ColumnarReadAllRows(relation, GetActiveSnapshot(),
+							   SendColumnarRowToDestReceiver, destReceiver);
+
+	destReceiver->rShutdown(destReceiver);
+
+	table_close(relation, NoLock);
+}
+
+
+/*
+ * SendColumnarRowToDestReceiver is the ColumnarRowCallback that passes the
+ * rows read by CopyColumnarTableToDestReceiver to the shard copy DestReceiver.
+ */
+static void
+SendColumnarRowToDestReceiver(Datum *columnValues, bool *columnNulls,
+							  void *callbackArg)
+{
+	DestReceiver *destReceiver = (DestReceiver *) callbackArg;
+
+	ShardCopyDestReceiverReceiveValues(destReceiver, columnValues, columnNulls);
+}
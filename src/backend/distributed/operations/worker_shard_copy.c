@@ -36,6 +36,9 @@
  */
 static StringInfo LocalCopyBuffer;
 
+/* size of the buffered COPY data after which it is sent to a remote shard */
+#define REMOTE_COPY_BUFFER_SIZE (512 * 1024)
+
 typedef struct ShardCopyDestReceiver
 {
 	/* public DestReceiver interface */
@@ -78,10 +81,12 @@ static bool CanUseLocalCopy(uint32_t destinationNodeId);
 static StringInfo ConstructShardCopyStatement(List *destinationShardFullyQualifiedName,
 											  bool
 											  useBinaryFormat, TupleDesc tupleDesc);
-static void WriteLocalTuple(TupleTableSlot *slot, ShardCopyDestReceiver *copyDest);
+static void WriteLocalTuple(Datum *columnValues, bool *columnNulls,
+							ShardCopyDestReceiver *copyDest);
 static int ReadFromLocalBufferCallback(void *outBuf, int minRead, int maxRead);
 static void LocalCopyToShard(ShardCopyDestReceiver *copyDest, CopyOutState
 							 localCopyOutState);
+static void RemoteCopyToShard(ShardCopyDestReceiver *copyDest);
 static void ConnectToRemoteAndStartCopy(ShardCopyDestReceiver *copyDest);
 
 
@@ -172,6 +177,24 @@ CreateShardCopyDestReceiver(EState *executorState,
  */
 static bool
 ShardCopyDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
+{
+	slot_getallattrs(slot);
+
+	ShardCopyDestReceiverReceiveValues(dest, slot->tts_values, slot->tts_isnull);
+
+	return true;
+}
+
+
+/*
+ * ShardCopyDestReceiverReceiveValues sends a row given as arrays of column
+ * values and nulls, laid out according to the tuple descriptor passed to
+ * rStartup, to the destination shard. This allows callers that don't have
+ * the row in a TupleTableSlot to skip materializing one.
+ */
+void
+ShardCopyDestReceiverReceiveValues(DestReceiver *dest, Datum *columnValues,
+								   bool *columnNulls)
 {
 	ShardCopyDestReceiver *copyDest = (ShardCopyDestReceiver *) dest;
 
@@ -189,16 +212,12 @@ ShardCopyDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
 		ConnectToRemoteAndStartCopy(copyDest);
 	}
 
-	slot_getallattrs(slot);
-	Datum *columnValues = slot->tts_values;
-	bool *columnNulls = slot->tts_isnull;
-
 	CopyOutState copyOutState = copyDest->copyOutState;
 	if (copyDest->useLocalCopy)
 	{
 		/* Setup replication origin session for local copy*/
 
-		WriteLocalTuple(slot, copyDest);
+		WriteLocalTuple(columnValues, columnNulls, copyDest);
 		if (copyOutState->fe_msgbuf->len > LocalCopyFlushThresholdByte)
 		{
 			LocalCopyToShard(copyDest, copyOutState);
@@ -206,7 +225,6 @@ ShardCopyDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
 	}
 	else
 	{
-		resetStringInfo(copyOutState->fe_msgbuf);
 		if (copyDest->copyOutState->binary && copyDest->tuplesSent == 0)
 		{
 			AppendCopyBinaryHeaders(copyDest->copyOutState);
@@ -218,24 +236,14 @@ ShardCopyDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
 						  copyOutState,
 						  copyDest->columnOutputFunctions,
 						  NULL /* columnCoercionPaths */);
-		if (!PutRemoteCopyData(copyDest->connection, copyOutState->fe_msgbuf->data,
-							   copyOutState->fe_msgbuf->len))
-		{
-			char *destinationShardSchemaName = linitial(
-				copyDest->destinationShardFullyQualifiedName);
-			char *destinationShardRelationName = lsecond(
-				copyDest->destinationShardFullyQualifiedName);
 
-			char *errorMessage = PQerrorMessage(copyDest->connection->pgConn);
-			ereport(ERROR, (errcode(ERRCODE_IO_ERROR),
-							errmsg("Failed to COPY to shard %s.%s : %s,",
-								   destinationShardSchemaName,
-								   destinationShardRelationName,
-								   errorMessage),
-							errdetail("failed to send %d bytes %s on node %u",
-									  copyOutState->fe_msgbuf->len,
-									  copyOutState->fe_msgbuf->data,
-									  copyDest->destinationNodeId)));
+		/*
+		 * Rows are accumulated and sent in large CopyData messages, sending
+		 * a message per row costs more than serializing most rows.
+		 */
+		if (copyOutState->fe_msgbuf->len > REMOTE_COPY_BUFFER_SIZE)
+		{
+			RemoteCopyToShard(copyDest);
 		}
 	}
 
@@ -243,7 +251,6 @@ ShardCopyDestReceiverReceive(TupleTableSlot *slot, DestReceiver *dest)
 	ResetPerTupleExprContext(executorState);
 
 	copyDest->tuplesSent++;
-	return true;
 }
 
 
@@ -302,12 +309,14 @@ ShardCopyDestReceiverShutdown(DestReceiver *dest)
 	}
 	else if (copyDest->connection != NULL)
 	{
-		resetStringInfo(copyDest->copyOutState->fe_msgbuf);
 		if (copyDest->copyOutState->binary)
 		{
 			AppendCopyBinaryFooters(copyDest->copyOutState);
 		}
 
+		/* send the buffered rows */
+		RemoteCopyToShard(copyDest);
+
 		/* end the COPY input */
 		if (!PutRemoteCopyEnd(copyDest->connection, NULL /* errormsg */))
 		{
@@ -320,9 +329,7 @@ ShardCopyDestReceiverShutdown(DestReceiver *dest)
 							errmsg("Failed to COPY to destination shard %s.%s",
 								   destinationShardSchemaName,
 								   destinationShardRelationName),
-							errdetail("failed to send %d bytes %s on node %u",
-									  copyDest->copyOutState->fe_msgbuf->len,
-									  copyDest->copyOutState->fe_msgbuf->data,
+							errdetail("failed to end COPY on node %u",
 									  copyDest->destinationNodeId)));
 		}
 
@@ -460,7 +467,7 @@ ConstructShardCopyStatement(List *destinationShardFullyQualifiedName, bool
 
 /* Write Tuple to Local Shard. */
 static void
-WriteLocalTuple(TupleTableSlot *slot, ShardCopyDestReceiver *copyDest)
+WriteLocalTuple(Datum *columnValues, bool *columnNulls, ShardCopyDestReceiver *copyDest)
 {
 	CopyOutState localCopyOutState = copyDest->copyOutState;
 
@@ -478,8 +485,6 @@ WriteLocalTuple(TupleTableSlot *slot, ShardCopyDestReceiver *copyDest)
 		AppendCopyBinaryHeaders(localCopyOutState);
 	}
 
-	Datum *columnValues = slot->tts_values;
-	bool *columnNulls = slot->tts_isnull;
 	FmgrInfo *columnOutputFunctions = copyDest->columnOutputFunctions;
 
 	AppendCopyRowData(columnValues, columnNulls, copyDest->tupleDescriptor,
@@ -488,6 +493,42 @@ WriteLocalTuple(TupleTableSlot *slot, ShardCopyDestReceiver *copyDest)
 }
 
 
+/*
+ * RemoteCopyToShard sends the COPY data buffered in the copy out state to the
+ * destination shard over the open COPY connection and resets the buffer.
+ */
+static void
+RemoteCopyToShard(ShardCopyDestReceiver *copyDest)
+{
+	CopyOutState copyOutState = copyDest->copyOutState;
+	if (copyOutState->fe_msgbuf->len == 0)
+	{
+		return;
+	}
+
+	if (!PutRemoteCopyData(copyDest->connection, copyOutState->fe_msgbuf->data,
+						   copyOutState->fe_msgbuf->len))
+	{
+		char *destinationShardSchemaName = linitial(
+			copyDest->destinationShardFullyQualifiedName);
+		char *destinationShardRelationName = lsecond(
+			copyDest->destinationShardFullyQualifiedName);
+
+		char *errorMessage = PQerrorMessage(copyDest->connection->pgConn);
+		ereport(ERROR, (errcode(ERRCODE_IO_ERROR),
+						errmsg("Failed to COPY to shard %s.%s : %s,",
+							   destinationShardSchemaName,
+							   destinationShardRelationName,
+							   errorMessage),
+						errdetail("failed to send %d bytes on node %u",
+								  copyOutState->fe_msgbuf->len,
+								  copyDest->destinationNodeId)));
+	}
+
+	resetStringInfo(copyOutState->fe_msgbuf);
+}
+
+
 /*
  * LocalCopyToShard performs local copy for the given destination shard.
  */
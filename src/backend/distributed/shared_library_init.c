@@ -124,6 +124,7 @@ ColumnarSupportsIndexAM_type extern_ColumnarSupportsIndexAM = NULL;
 CompressionTypeStr_type extern_CompressionTypeStr = NULL;
 IsColumnarTableAmTable_type extern_IsColumnarTableAmTable = NULL;
 ReadColumnarOptions_type extern_ReadColumnarOptions = NULL;
+ColumnarReadAllRows_type extern_ColumnarReadAllRows = NULL;
 
 /*
  * Define "pass-through" functions so that a SQL function defined as one of
@@ -558,6 +559,7 @@ _PG_init(void)
 	INIT_COLUMNAR_SYMBOL(CompressionTypeStr_type, CompressionTypeStr);
 	INIT_COLUMNAR_SYMBOL(IsColumnarTableAmTable_type, IsColumnarTableAmTable);
 	INIT_COLUMNAR_SYMBOL(ReadColumnarOptions_type, ReadColumnarOptions);
+	INIT_COLUMNAR_SYMBOL(ColumnarReadAllRows_type, ColumnarReadAllRows);
 
 	/* initialize symbols for "pass-through" functions */
 	INIT_COLUMNAR_SYMBOL(PGFunction, columnar_handler);
@@ -1014,6 +1016,24 @@ RegisterCitusConfigVariables(void)
 		GUC_STANDARD,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.columnar_stripe_compaction_interval",
+		gettext_noop("Sets the time to wait between merging small columnar stripes "
+					 "in the background."),
+		gettext_noop("Many small transactions leave columnar tables with many small "
+					 "stripes, which slow down scans. When this setting is enabled, "
+					 "the maintenance daemon regularly runs columnar.compact_stripes "
+					 "on the columnar tables that have no indexes or row triggers, "
+					 "skipping tables it cannot lock right away. This is also what "
+					 "compresses the staging stripes written when "
+					 "columnar.staging_row_limit is set. When set to -1 this "
+					 "background process is skipped."),
+		&ColumnarStripeCompactionInterval,
+		-1, -1, 7 * MS_PER_DAY,
+		PGC_SIGHUP,
+		GUC_UNIT_MS | GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomEnumVariable(
 		"citus.coordinator_aggregation_strategy",
 		gettext_noop("Sets the strategy for when an aggregate cannot be pushed down. "
@@ -1469,6 +1489,22 @@ RegisterCitusConfigVariables(void)
 		&StatisticsCollectionGucCheckHook,
 		NULL, NULL);
 
+	DefineCustomBoolVariable(
+		"citus.enable_streaming_results",
+		gettext_noop("Enables returning the results of read-only multi-shard queries "
+					 "while they are still being received from the workers."),
+		gettext_noop("By default, the results of all shards are collected in a tuple "
+					 "store before the first row is returned. When enabled, rows are "
+					 "returned as soon as any worker sends them and the coordinator "
+					 "only reads from the workers when it needs more rows. This only "
+					 "applies to single statement SELECT queries outside of "
+					 "transaction blocks."),
+		&EnableStreamingResults,
+		false,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.enable_unique_job_ids",
 		gettext_noop("Enables unique job IDs by prepending the local process ID and "
@@ -1537,6 +1573,24 @@ RegisterCitusConfigVariables(void)
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.executor_pipeline_depth",
+		gettext_noop("Sets the maximum number of task queries the adaptive executor "
+					 "sends over a single connection without waiting for results"),
+		gettext_noop("When set to a value higher than 1, read-only multi-shard queries "
+					 "that do not need a remote transaction block use libpq pipeline "
+					 "mode to send the queries of up to this many tasks at once over "
+					 "each connection. Results are received in the order in which the "
+					 "queries were sent. This avoids a network round trip per task "
+					 "when a small number of connections execute many tasks. Rows of "
+					 "pipelined queries are buffered per task before they are "
+					 "processed."),
+		&ExecutorPipelineDepth,
+		1, 1, 64,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		"citus.executor_slow_start_interval",
 		gettext_noop("Time to wait between opening connections to the same worker node"),
@@ -1553,6 +1607,24 @@ RegisterCitusConfigVariables(void)
 		GUC_UNIT_MS | GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		"citus.executor_task_batch_size",
+		gettext_noop("Sets the maximum number of task queries the adaptive executor "
+					 "combines into a single query to a worker node"),
+		gettext_noop("When set to a value higher than 1, read-only multi-shard queries "
+					 "that do not need a remote transaction block send the queries of "
+					 "up to this many tasks as a single multi-statement query over a "
+					 "connection, such that the tasks on a worker node take one network "
+					 "round trip. The results of the individual statements are passed "
+					 "back to the tasks in order. Batched queries always receive their "
+					 "results in text format. When set, this takes precedence over "
+					 "citus.executor_pipeline_depth."),
+		&ExecutorTaskBatchSize,
+		1, 1, 1024,
+		PGC_USERSET,
+		GUC_STANDARD,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		"citus.explain_all_tasks",
 		gettext_noop("Enables showing output for all tasks in Explain."),
@@ -392,6 +392,9 @@ CoordinatedTransactionCallback(XactEvent event, void *arg)
 			/* stop propagating notices from workers, we know the query is failed */
 			DisableWorkerMessagePropagation();
 
+			/* release the wait event sets of scans that were not ended */
+			FreeStreamingWaitEventSets();
+
 			RemoveIntermediateResultsDirectories();
 
 			CleanCitusMainDBConnection();
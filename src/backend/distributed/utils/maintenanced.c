@@ -29,6 +29,7 @@
 #include "catalog/pg_namespace.h"
 #include "commands/async.h"
 #include "commands/extension.h"
+#include "executor/spi.h"
 #include "common/hashfn.h"
 #include "libpq/pqsignal.h"
 #include "nodes/makefuncs.h"
@@ -51,6 +52,8 @@
 #include "distributed/citus_safe_lib.h"
 #include "distributed/coordinator_protocol.h"
 #include "distributed/distributed_deadlock_detection.h"
+#include "distributed/function_utils.h"
+#include "distributed/listutils.h"
 #include "distributed/maintenanced.h"
 #include "distributed/metadata_cache.h"
 #include "distributed/metadata_sync.h"
@@ -98,6 +101,7 @@ double DistributedDeadlockDetectionTimeoutFactor = 2.0;
 int Recover2PCInterval = 60000;
 int DeferShardDeleteInterval = 15000;
 int BackgroundTaskQueueCheckInterval = 5000;
+int ColumnarStripeCompactionInterval = -1;
 int MaxBackgroundTaskExecutors = 4;
 char *MainDb = "";
 
@@ -126,6 +130,10 @@ static void MaintenanceDaemonShmemExit(int code, Datum arg);
 static void MaintenanceDaemonErrorContext(void *arg);
 static bool MetadataSyncTriggeredCheckAndReset(MaintenanceDaemonDBData *dbData);
 static void WarnMaintenanceDaemonNotStarted(void);
+static BackgroundWorkerHandle * SpawnColumnarCompactionWorker(Oid database,
+																Oid extensionOwner);
+static List * ColumnarTablesToCompact(void);
+static int64 TryCompactColumnarTable(Oid compactFunctionId, Oid relationId);
 static MaintenanceDaemonDBData * GetMaintenanceDaemonDBHashEntry(Oid databaseId,
 																 bool *found);
 
@@ -489,6 +497,7 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 	TimestampTz lastRecoveryTime = 0;
 	TimestampTz lastShardCleanTime = 0;
 	TimestampTz lastStatStatementsPurgeTime = 0;
+	TimestampTz lastColumnarCompactionTime = 0;
 	TimestampTz nextMetadataSyncTime = 0;
 
 	/* state kept for the background tasks queue monitor */
@@ -503,6 +512,12 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 	 */
 	BackgroundWorkerHandle *metadataSyncBgwHandle = NULL;
 
+	/*
+	 * Columnar stripe compaction also runs in a separate background worker,
+	 * so that it does not hold back deadlock detection and 2PC recovery.
+	 */
+	BackgroundWorkerHandle *columnarCompactionBgwHandle = NULL;
+
 	MaintenanceDaemonDBData *myDbData = ConnectToDatabase(databaseOid);
 
 	/* make worker recognizable in pg_stat_activity */
@@ -790,6 +805,42 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 			timeout = Min(timeout, DeferShardDeleteInterval);
 		}
 
+		pid_t columnarCompactionBgwPid = 0;
+		BgwHandleStatus columnarCompactionStatus =
+			columnarCompactionBgwHandle != NULL ?
+			GetBackgroundWorkerPid(columnarCompactionBgwHandle,
+								   &columnarCompactionBgwPid) :
+			BGWH_STOPPED;
+
+		/*
+		 * If enabled, merge small columnar stripes on primary nodes. Rewriting
+		 * the tables can take a while, so it is done in a separate background
+		 * worker and we only start a new one once the previous one is done.
+		 */
+		if (!RecoveryInProgress() && ColumnarStripeCompactionInterval > 0 &&
+			columnarCompactionStatus == BGWH_STOPPED &&
+			TimestampDifferenceExceeds(lastColumnarCompactionTime, GetCurrentTimestamp(),
+									   ColumnarStripeCompactionInterval))
+		{
+			if (columnarCompactionBgwHandle)
+			{
+				pfree(columnarCompactionBgwHandle);
+				columnarCompactionBgwHandle = NULL;
+			}
+
+			/*
+			 * Record last compaction time at start to ensure we run once per
+			 * ColumnarStripeCompactionInterval.
+			 */
+			lastColumnarCompactionTime = GetCurrentTimestamp();
+
+			columnarCompactionBgwHandle =
+				SpawnColumnarCompactionWorker(MyDatabaseId, myDbData->userOid);
+
+			/* make sure we don't wait too long */
+			timeout = Min(timeout, ColumnarStripeCompactionInterval);
+		}
+
 		if (StatStatementsPurgeInterval > 0 &&
 			StatStatementsTrack != STAT_STATEMENTS_TRACK_NONE &&
 			TimestampDifferenceExceeds(lastStatStatementsPurgeTime, GetCurrentTimestamp(),
@@ -966,6 +1017,225 @@ CitusMaintenanceDaemonMain(Datum main_arg)
 	{
 		TerminateBackgroundWorker(metadataSyncBgwHandle);
 	}
+
+	if (columnarCompactionBgwHandle)
+	{
+		TerminateBackgroundWorker(columnarCompactionBgwHandle);
+	}
+}
+
+
+/*
+ * SpawnColumnarCompactionWorker starts a background worker which merges the
+ * small stripes of the columnar tables in the given database. On success it
+ * returns the worker's handle. Otherwise it returns NULL.
+ */
+static BackgroundWorkerHandle *
+SpawnColumnarCompactionWorker(Oid database, Oid extensionOwner)
+{
+	BackgroundWorker worker;
+	BackgroundWorkerHandle *handle = NULL;
+
+	memset(&worker, 0, sizeof(worker));
+	SafeSnprintf(worker.bgw_name, BGW_MAXLEN,
+				 "Citus Columnar Compaction: %u/%u",
+				 database, extensionOwner);
+	worker.bgw_flags =
+		BGWORKER_SHMEM_ACCESS | BGWORKER_BACKEND_DATABASE_CONNECTION;
+	worker.bgw_start_time = BgWorkerStart_ConsistentState;
+
+	/* don't restart, the maintenance daemon starts a new one every interval */
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	strcpy_s(worker.bgw_library_name, sizeof(worker.bgw_library_name), "citus");
+	strcpy_s(worker.bgw_function_name, sizeof(worker.bgw_function_name),
+			 "ColumnarCompactionWorkerMain");
+	worker.bgw_main_arg = ObjectIdGetDatum(database);
+	memcpy_s(worker.bgw_extra, sizeof(worker.bgw_extra), &extensionOwner,
+			 sizeof(Oid));
+	worker.bgw_notify_pid = MyProcPid;
+
+	if (!RegisterDynamicBackgroundWorker(&worker, &handle))
+	{
+		ereport(WARNING, (errmsg("could not start columnar compaction worker"),
+						  errhint("Increasing max_worker_processes might help.")));
+		return NULL;
+	}
+
+	return handle;
+}
+
+
+/*
+ * ColumnarCompactionWorkerMain is the main function of the background worker
+ * that merges the small stripes of the columnar tables in the database.
+ * columnar.compact_stripes skips the tables that cannot be locked right away
+ * and the ones whose stripes cannot be merged because they have indexes or
+ * row triggers.
+ *
+ * Each table is compacted in its own transaction, so that its lock is released
+ * and its xmin does not hold back vacuum while the other tables are compacted.
+ */
+void
+ColumnarCompactionWorkerMain(Datum main_arg)
+{
+	Oid databaseOid = DatumGetObjectId(main_arg);
+
+	/* extension owner is passed via bgw_extra */
+	Oid extensionOwner = InvalidOid;
+	memcpy_s(&extensionOwner, sizeof(extensionOwner),
+			 MyBgworkerEntry->bgw_extra, sizeof(Oid));
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/* connect to database, after that we can actually access catalogs */
+	BackgroundWorkerInitializeConnectionByOid(databaseOid, extensionOwner, 0);
+
+	/* make worker recognizable in pg_stat_activity */
+	pgstat_report_appname("Citus Columnar Compaction");
+
+	Oid compactFunctionId = InvalidOid;
+	List *relationIdList = NIL;
+
+	StartTransactionCommand();
+	PushActiveSnapshot(GetTransactionSnapshot());
+
+	if (!LockCitusExtension())
+	{
+		ereport(DEBUG1, (errmsg("could not lock the citus extension, "
+								"skipping columnar stripe compaction")));
+	}
+	else if (CheckCitusVersion(DEBUG1) && CitusHasBeenLoaded())
+	{
+		/* citus_columnar might not be installed, or might be an older version */
+		compactFunctionId = FunctionOidExtended("columnar", "compact_stripes", 2,
+												true);
+		if (OidIsValid(compactFunctionId))
+		{
+			/* the list has to outlive the transaction */
+			MemoryContext oldContext = MemoryContextSwitchTo(TopMemoryContext);
+			relationIdList = ColumnarTablesToCompact();
+			MemoryContextSwitchTo(oldContext);
+		}
+	}
+
+	PopActiveSnapshot();
+	CommitTransactionCommand();
+
+	int64 mergedStripeCount = 0;
+
+	Oid relationId = InvalidOid;
+	foreach_declared_oid(relationId, relationIdList)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		StartTransactionCommand();
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		mergedStripeCount += TryCompactColumnarTable(compactFunctionId, relationId);
+
+		PopActiveSnapshot();
+		CommitTransactionCommand();
+	}
+
+	if (mergedStripeCount > 0)
+	{
+		ereport(LOG, (errmsg("columnar compaction worker merged " INT64_FORMAT
+							 " small columnar stripes", mergedStripeCount)));
+	}
+}
+
+
+/*
+ * ColumnarTablesToCompact returns the oids of the columnar tables whose stripes
+ * the columnar compaction worker tries to merge. Temporary tables are skipped since
+ * they can only be accessed by the backend that created them.
+ */
+static List *
+ColumnarTablesToCompact(void)
+{
+	const char *tableQuery =
+		"SELECT c.oid FROM pg_class c JOIN pg_am a ON (c.relam = a.oid) "
+		"WHERE a.amname = 'columnar' AND c.relkind = 'r' "
+		"AND c.relpersistence <> 't'";
+
+	MemoryContext outerContext = CurrentMemoryContext;
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+	{
+		ereport(ERROR, (errmsg("could not connect to SPI manager")));
+	}
+
+	if (SPI_execute(tableQuery, true, 0) != SPI_OK_SELECT)
+	{
+		ereport(ERROR, (errmsg("could not run SPI query")));
+	}
+
+	List *relationIdList = NIL;
+
+	for (uint64 rowIndex = 0; rowIndex < SPI_processed; rowIndex++)
+	{
+		bool isNull = false;
+		Oid relationId = DatumGetObjectId(SPI_getbinval(SPI_tuptable->vals[rowIndex],
+														SPI_tuptable->tupdesc, 1,
+														&isNull));
+
+		/* the list has to outlive the SPI connection */
+		MemoryContext spiContext = MemoryContextSwitchTo(outerContext);
+		relationIdList = lappend_oid(relationIdList, relationId);
+		MemoryContextSwitchTo(spiContext);
+	}
+
+	if (SPI_finish() != SPI_OK_FINISH)
+	{
+		ereport(ERROR, (errmsg("could not finish SPI connection")));
+	}
+
+	return relationIdList;
+}
+
+
+/*
+ * TryCompactColumnarTable merges the small stripes of the given columnar table
+ * in a subtransaction, so that a failure to compact one table does not stop
+ * the columnar compaction worker from compacting the other tables. Errors are
+ * rethrown as warnings. Returns the number of stripes that were merged
+ * away.
+ */
+static int64
+TryCompactColumnarTable(Oid compactFunctionId, Oid relationId)
+{
+	int64 mergedStripeCount = 0;
+	MemoryContext savedContext = CurrentMemoryContext;
+
+	BeginInternalSubTransaction(NULL);
+
+	PG_TRY();
+	{
+		bool nowait = true;
+		Datum mergedStripeCountDatum = OidFunctionCall2(compactFunctionId,
+														ObjectIdGetDatum(relationId),
+														BoolGetDatum(nowait));
+		mergedStripeCount = DatumGetInt64(mergedStripeCountDatum);
+
+		ReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(savedContext);
+	}
+	PG_CATCH();
+	{
+		MemoryContextSwitchTo(savedContext);
+		ErrorData *edata = CopyErrorData();
+		FlushErrorState();
+
+		RollbackAndReleaseCurrentSubTransaction();
+
+		/* rethrow as WARNING */
+		edata->elevel = WARNING;
+		ThrowErrorData(edata);
+	}
+	PG_END_TRY();
+
+	return mergedStripeCount;
 }
 
 
@@ -24,7 +24,9 @@
 
 #include "pg_version_compat.h"
 
+#include "columnar/columnar_cache.h"
 #include "columnar/columnar_compression.h"
+#include "columnar/columnar_encoding.h"
 #include "columnar/columnar_metadata.h"
 
 #if PG_VERSION_NUM >= PG_VERSION_16
@@ -64,6 +66,26 @@
 /*global variables for citus_columnar fake version Y */
 #define CITUS_COLUMNAR_INTERNAL_VERSION "11.1-0"
 
+/*
+ * ColumnarColumnCompression holds the compression setting of a column that
+ * overrides the compression of the table, as given in the
+ * columnar.column_compression option.
+ */
+typedef struct ColumnarColumnCompression
+{
+	char *columnName;
+
+	/* COMPRESSION_TYPE_INVALID to use the compression type of the table */
+	CompressionType compressionType;
+
+	/* 0 to use the compression level of the table */
+	int compressionLevel;
+
+	/* whether to store chunks that don't compress well uncompressed */
+	bool autoCompression;
+} ColumnarColumnCompression;
+
+
 /*
  * ColumnarOptions holds the option values to be used when reading or writing
  * a columnar table. To resolve these values, we first check foreign table's options,
@@ -75,6 +97,15 @@ typedef struct ColumnarOptions
 	uint32 chunkRowCount;
 	CompressionType compressionType;
 	int compressionLevel;
+
+	/* names of the columns to build per-chunk bloom filters for */
+	List *bloomFilterColumns;
+
+	/* names of the columns to sort the rows of each stripe by, in order */
+	List *sortKeyColumns;
+
+	/* ColumnarColumnCompression of the columns that override the compression */
+	List *columnCompressions;
 } ColumnarOptions;
 
 
@@ -105,6 +136,15 @@ typedef struct ColumnChunkSkipNode
 
 	CompressionType valueCompressionType;
 	int valueCompressionLevel;
+
+	/* encoding applied to the value stream before compression */
+	EncodingType valueEncodingType;
+
+	/*
+	 * Bloom filter of the values in the chunk, or NULL if the column is not
+	 * in columnar.bloom_filter_columns. See columnar_bloom.c.
+	 */
+	bytea *bloomFilter;
 } ColumnChunkSkipNode;
 
 
@@ -158,7 +198,14 @@ typedef struct ColumnChunkBuffers
 	StringInfo existsBuffer;
 	StringInfo valueBuffer;
 	CompressionType valueCompressionType;
+	EncodingType valueEncodingType;
 	uint64 decompressedValueSize;
+
+	/*
+	 * Key to store the decoded value buffer in the chunk cache with, or NULL
+	 * if it should not be cached. See columnar_cache.c.
+	 */
+	ColumnarChunkCacheKey *cacheKey;
 } ColumnChunkBuffers;
 
 
@@ -183,6 +230,47 @@ typedef struct StripeBuffers
 } StripeBuffers;
 
 
+/*
+ * ColumnarBatch represents a deserialized chunk group that is handed out as a
+ * whole by the reader, so callers can evaluate quals over the column vectors
+ * instead of one row at a time. Rows of chunkData in [startRow, rowCount) are
+ * part of the batch, and the row at startRow has row number firstRowNumber.
+ *
+ * Unless materialized is true, only the columns referenced by the scan quals
+ * are deserialized, and ColumnarReadMaterializeBatch needs to be called before
+ * reading rows from the batch.
+ */
+typedef struct ColumnarBatch
+{
+	ChunkData *chunkData;           /* owned by the reader */
+	List *projectedColumnList;      /* borrowed reference */
+	uint32 startRow;
+	uint32 rowCount;
+	uint64 firstRowNumber;
+	bool materialized;
+} ColumnarBatch;
+
+
+/*
+ * ColumnarChunkGroupCallback is called by the reader for each chunk group of a
+ * stripe that is not filtered out by the scan quals, before the chunk group is
+ * read. If it returns true, then the caller consumed the chunk group using its
+ * skip list entries, and the reader skips it.
+ */
+typedef bool (*ColumnarChunkGroupCallback)(StripeMetadata *stripeMetadata,
+										   StripeSkipList *stripeSkipList,
+										   uint32 chunkGroupIndex,
+										   void *callbackArg);
+
+/*
+ * ColumnarRowCallback is called by ColumnarReadAllRows for each row of the
+ * table. columnValues and columnNulls are indexed by attribute number - 1 and
+ * are only valid for the duration of the call.
+ */
+typedef void (*ColumnarRowCallback)(Datum *columnValues, bool *columnNulls,
+									void *callbackArg);
+
+
 /* return value of StripeWriteState to decide stripe write state */
 typedef enum StripeWriteStateEnum
 {
@@ -207,11 +295,16 @@ typedef bool (*ColumnarSupportsIndexAM_type)(char *);
 typedef const char *(*CompressionTypeStr_type)(CompressionType);
 typedef bool (*IsColumnarTableAmTable_type)(Oid);
 typedef bool (*ReadColumnarOptions_type)(Oid, ColumnarOptions *);
+typedef uint64 (*ColumnarReadAllRows_type)(Relation, Snapshot, ColumnarRowCallback,
+										   void *);
 
 /* ColumnarReadState represents state of a columnar scan. */
 struct ColumnarReadState;
 typedef struct ColumnarReadState ColumnarReadState;
 
+/* defined in columnar_tableam.h */
+struct ParallelColumnarScanDescData;
+
 
 /* ColumnarWriteState represents state of a columnar write operation. */
 struct ColumnarWriteState;
@@ -222,6 +315,13 @@ extern int columnar_compression;
 extern int columnar_stripe_row_limit;
 extern int columnar_chunk_group_row_limit;
 extern int columnar_compression_level;
+extern bool columnar_enable_encoding;
+extern int columnar_prefetch_depth;
+extern int columnar_chunk_cache_size;
+extern int columnar_metadata_cache_size;
+extern int columnar_compression_workers;
+extern int columnar_staging_row_limit;
+extern double columnar_auto_compression_min_ratio;
 
 /* called when the user changes options on the given relation */
 typedef void (*ColumnarTableSetOptions_hook_type)(Oid relid, ColumnarOptions options);
@@ -238,6 +338,11 @@ extern ColumnarWriteState * ColumnarBeginWrite(RelFileLocator relfilelocator,
 extern uint64 ColumnarWriteRow(ColumnarWriteState *state, Datum *columnValues,
 							   bool *columnNulls);
 extern void ColumnarFlushPendingWrites(ColumnarWriteState *state);
+extern void ColumnarWriteSetStagingRowLimit(ColumnarWriteState *state,
+											uint32 stagingRowLimit);
+extern void ColumnarWriteStopSorting(ColumnarWriteState *state);
+extern List * ColumnarSortKeyColumnIndexes(List *sortKeyColumns,
+										   TupleDesc tupleDescriptor);
 extern void ColumnarEndWrite(ColumnarWriteState *state);
 extern bool ContainsPendingWrites(ColumnarWriteState *state);
 extern MemoryContext ColumnarWritePerTupleContext(ColumnarWriteState *state);
@@ -251,7 +356,9 @@ extern ColumnarReadState * ColumnarBeginRead(Relation relation,
 											 List *qualConditions,
 											 MemoryContext scanContext,
 											 Snapshot snaphot,
-											 bool randomAccess);
+											 bool randomAccess,
+											 struct ParallelColumnarScanDescData *
+											 parallelScan);
 extern void ColumnarReadFlushPendingWrites(ColumnarReadState *readState);
 extern void ColumnarEndRead(ColumnarReadState *state);
 extern void ColumnarResetRead(ColumnarReadState *readState);
@@ -259,7 +366,19 @@ extern void ColumnarResetRead(ColumnarReadState *readState);
 /* functions only applicable for sequential access */
 extern bool ColumnarReadNextRow(ColumnarReadState *state, Datum *columnValues,
 								bool *columnNulls, uint64 *rowNumber);
+extern bool ColumnarReadNextBatch(ColumnarReadState *state, ColumnarBatch *batch);
+extern void ColumnarReadMaterializeBatch(ColumnarReadState *state,
+										 ColumnarBatch *batch);
+extern void ColumnarBatchGetRow(ColumnarBatch *batch, uint32 rowIndex,
+								Datum *columnValues, bool *columnNulls);
+extern void ColumnarReadSetChunkGroupCallback(ColumnarReadState *state,
+											  ColumnarChunkGroupCallback callback,
+											  void *callbackArg);
+extern void ColumnarReadSetStripeList(ColumnarReadState *state, List *stripeList);
 extern int64 ColumnarReadChunkGroupsFiltered(ColumnarReadState *state);
+extern PGDLLEXPORT uint64 ColumnarReadAllRows(Relation relation, Snapshot snapshot,
+											  ColumnarRowCallback callback,
+											  void *callbackArg);
 extern void ColumnarRescan(ColumnarReadState *readState, List *scanQual);
 
 /* functions only applicable for random access */
@@ -269,6 +388,8 @@ extern void ColumnarReadRowByRowNumberOrError(ColumnarReadState *readState,
 extern bool ColumnarReadRowByRowNumber(ColumnarReadState *readState,
 									   uint64 rowNumber, Datum *columnValues,
 									   bool *columnNulls);
+extern bool ColumnarReadBitmapRow(ColumnarReadState *readState, uint64 rowNumber,
+								  Datum *columnValues, bool *columnNulls);
 
 /* Function declarations for common functions */
 extern FmgrInfo * GetFunctionInfoOrNull(Oid typeId, Oid accessMethodId,
@@ -288,6 +409,7 @@ extern PGDLLEXPORT bool IsColumnarTableAmTable(Oid relationId);
 
 /* columnar_metadata_tables.c */
 extern void DeleteMetadataRows(RelFileLocator relfilelocator);
+extern void DeleteStripeMetadataRows(RelFileLocator relfilelocator, uint64 stripeId);
 extern uint64 ColumnarMetadataNewStorageId(void);
 extern uint64 GetHighestUsedAddress(RelFileLocator relfilelocator);
 extern EmptyStripeReservation * ReserveEmptyStripe(Relation rel, uint64 columnCount,
@@ -305,6 +427,12 @@ extern StripeSkipList * ReadStripeSkipList(RelFileLocator relfilelocator, uint64
 										   TupleDesc tupleDescriptor,
 										   uint32 chunkCount,
 										   Snapshot snapshot);
+extern bool ColumnarChunkEncodingSupported(void);
+extern uint32 ColumnarMetadataNewZstdDictionaryId(void);
+extern void SaveColumnarZstdDictionary(RelFileLocator relfilelocator,
+									   uint32 dictionaryId, StringInfo dictionary);
+extern uint32 LatestColumnarZstdDictionaryId(RelFileLocator relfilelocator);
+extern bytea * ReadColumnarZstdDictionary(uint32 dictionaryId);
 extern StripeMetadata * FindNextStripeByRowNumber(Relation relation, uint64 rowNumber,
 												  Snapshot snapshot);
 extern StripeMetadata * FindStripeByRowNumber(Relation relation, uint64 rowNumber,
@@ -336,5 +464,6 @@ extern void NonTransactionDropWriteState(RelFileNumber relfilenumber);
 extern bool PendingWritesInUpperTransactions(RelFileNumber relfilenumber,
 											 SubTransactionId currentSubXid);
 extern MemoryContext GetWriteContextForDebug(void);
+extern bool ColumnarRelationKeepsRowNumbers(Relation relation);
 
 #endif /* COLUMNAR_H */
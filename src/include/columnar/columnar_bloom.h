@@ -0,0 +1,54 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_bloom.h
+ *
+ * Type and function declarations for the bloom filters that are kept for
+ * the column chunks of the columns listed in columnar.bloom_filter_columns.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef COLUMNAR_BLOOM_H
+#define COLUMNAR_BLOOM_H
+
+#include "postgres.h"
+
+#include "fmgr.h"
+
+#include "access/tupdesc.h"
+#include "nodes/pg_list.h"
+
+/* number of filter bits we reserve for each value in a chunk */
+#define BLOOM_FILTER_BITS_PER_VALUE 10
+
+/* number of bits that are set for each value, optimal for 10 bits per value */
+#define BLOOM_FILTER_HASH_COUNT 7
+
+/* size of the bloom filter of an empty chunk */
+#define BLOOM_FILTER_MIN_BITS 64
+
+/*
+ * ColumnarBloomFilterQual represents a qual in the form of "Var = Const" or
+ * "Var = ANY(Const array)" that can be checked against the bloom filters of
+ * a column. hashValues holds the hashes of the (non-NULL) constants the Var
+ * is compared against, computed by the hash function the filters are built
+ * with.
+ */
+typedef struct ColumnarBloomFilterQual
+{
+	/* 0-indexed attribute number of the Var */
+	int columnIndex;
+
+	uint32 *hashValues;
+	uint32 hashValueCount;
+} ColumnarBloomFilterQual;
+
+
+extern bytea * BuildChunkBloomFilter(uint32 *hashValues, uint32 hashValueCount);
+extern List * BuildColumnarBloomFilterQuals(List *qualList, TupleDesc tupleDescriptor);
+extern bool ColumnarBloomFilterQualRefutesChunk(ColumnarBloomFilterQual *bloomQual,
+												bytea *bloomFilter);
+
+#endif /* COLUMNAR_BLOOM_H */
@@ -0,0 +1,42 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_cache.h
+ *
+ * Type and function declarations for the backend-local cache of decoded
+ * column chunk value buffers.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef COLUMNAR_CACHE_H
+#define COLUMNAR_CACHE_H
+
+#include "postgres.h"
+
+#include "lib/stringinfo.h"
+
+/*
+ * ColumnarChunkCacheKey identifies the value buffer of a column chunk. Stripes
+ * are never modified once they are flushed, so a key always refers to the
+ * same data.
+ */
+typedef struct ColumnarChunkCacheKey
+{
+	uint64 storageId;
+	uint64 stripeId;
+	uint32 chunkGroupIndex;
+
+	/* 0-indexed attribute number */
+	uint32 columnIndex;
+} ColumnarChunkCacheKey;
+
+
+extern bool ColumnarChunkCacheEnabled(void);
+extern StringInfo ColumnarChunkCacheLookup(ColumnarChunkCacheKey *key);
+extern void ColumnarChunkCacheInsert(ColumnarChunkCacheKey *key, StringInfo valueBuffer);
+extern void ColumnarChunkCacheInvalidateStorage(uint64 storageId);
+extern void ColumnarChunkCacheSizeAssignHook(int newval, void *extra);
+
+#endif /* COLUMNAR_CACHE_H */
@@ -24,11 +24,22 @@ typedef enum
 	COMPRESSION_COUNT
 } CompressionType;
 
+/* zstd frames compressed without a dictionary have dictionary id 0 */
+#define InvalidZstdDictionaryId 0
+
 extern bool CompressBuffer(StringInfo inputBuffer,
 						   StringInfo outputBuffer,
 						   CompressionType compressionType,
 						   int compressionLevel);
+extern bool CompressBufferWithDictionary(StringInfo inputBuffer,
+										 StringInfo outputBuffer,
+										 CompressionType compressionType,
+										 int compressionLevel,
+										 uint32 zstdDictionaryId);
 extern StringInfo DecompressBuffer(StringInfo buffer, CompressionType compressionType,
 								   uint64 decompressedSize);
+extern StringInfo TrainZstdDictionary(StringInfo sampleBuffer, size_t *sampleSizes,
+									  uint32 sampleCount, int dictionarySize,
+									  uint32 dictionaryId);
 
 #endif /* COLUMNAR_COMPRESSION_H */
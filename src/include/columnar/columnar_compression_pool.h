@@ -0,0 +1,36 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_compression_pool.h
+ *
+ * Type and function declarations for the pool of background workers that
+ * compress column chunks on behalf of a columnar writer.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef COLUMNAR_COMPRESSION_POOL_H
+#define COLUMNAR_COMPRESSION_POOL_H
+
+#include "postgres.h"
+
+#include "columnar/columnar.h"
+
+/* maximum value of columnar.compression_workers */
+#define COMPRESSION_WORKERS_MAXIMUM 64
+
+/* ColumnarCompressionPool represents the compression workers of a writer */
+struct ColumnarCompressionPool;
+typedef struct ColumnarCompressionPool ColumnarCompressionPool;
+
+
+extern ColumnarCompressionPool * ColumnarCompressionPoolCreate(int workerCount);
+extern void ColumnarCompressionPoolSubmit(ColumnarCompressionPool *pool,
+										  ColumnChunkBuffers *chunkBuffers,
+										  CompressionType compressionType,
+										  int compressionLevel);
+extern void ColumnarCompressionPoolWait(ColumnarCompressionPool *pool);
+extern void ColumnarCompressionPoolDestroy(ColumnarCompressionPool *pool);
+
+#endif /* COLUMNAR_COMPRESSION_POOL_H */
@@ -0,0 +1,42 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_encoding.h
+ *
+ * Type and function declarations for lightweight encodings of chunk value
+ * buffers.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef COLUMNAR_ENCODING_H
+#define COLUMNAR_ENCODING_H
+
+#include "catalog/pg_attribute.h"
+#include "lib/stringinfo.h"
+
+/*
+ * Enumaration for the encodings of a chunk's value buffer. Encodings are
+ * applied to the serialized values before compression, and the chosen
+ * encoding is recorded in columnar.chunk.
+ */
+typedef enum
+{
+	ENCODING_TYPE_INVALID = -1,
+	ENCODING_NONE = 0,
+	ENCODING_RLE = 1,
+	ENCODING_DELTA = 2,
+	ENCODING_FRAME_OF_REFERENCE = 3,
+	ENCODING_DICTIONARY = 4,
+
+	ENCODING_COUNT
+} EncodingType;
+
+extern EncodingType EncodeValueBuffer(StringInfo inputBuffer, uint32 valueCount,
+									  Form_pg_attribute attributeForm,
+									  StringInfo outputBuffer);
+extern StringInfo DecodeValueBuffer(StringInfo buffer, EncodingType encodingType,
+									Form_pg_attribute attributeForm);
+
+#endif /* COLUMNAR_ENCODING_H */
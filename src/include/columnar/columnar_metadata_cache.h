@@ -0,0 +1,74 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_metadata_cache.h
+ *
+ * Type and function declarations for the backend-local cache of columnar
+ * stripe lists and stripe skip lists.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef COLUMNAR_METADATA_CACHE_H
+#define COLUMNAR_METADATA_CACHE_H
+
+#include "postgres.h"
+
+#include "access/tupdesc.h"
+#include "utils/snapshot.h"
+
+#include "columnar/columnar.h"
+#include "columnar/columnar_metadata.h"
+
+/*
+ * ColumnarCachedStripeList is the cached stripe list of a storage. It holds
+ * the stripes that are visible to every snapshot that sees all transactions
+ * in xids as committed, sorted by their first row numbers.
+ */
+typedef struct ColumnarCachedStripeList
+{
+	/* reserved stripe id of the storage when the list was read */
+	uint64 reservedStripeId;
+
+	/*
+	 * Set if the stripe list couldn't be read, either because blockingXid was
+	 * still running, or because other transactions were writing to the table
+	 * when snapshots had blockedSnapshotXmax as xmax. stripeCount is 0 then.
+	 */
+	bool blocked;
+	TransactionId blockingXid;
+	TransactionId blockedSnapshotXmax;
+
+	int stripeCount;
+	StripeMetadata *stripes;
+
+	/* transactions that inserted or deleted stripes, newest first */
+	int xidCount;
+	TransactionId *xids;
+} ColumnarCachedStripeList;
+
+
+extern void ColumnarMetadataCacheInit(void);
+extern bool ColumnarMetadataCacheEnabled(void);
+extern StripeSkipList * ColumnarMetadataCacheLookupSkipList(uint64 storageId,
+															uint64 stripeId,
+															TupleDesc tupleDescriptor,
+															uint32 chunkCount);
+extern void ColumnarMetadataCacheInsertSkipList(uint64 storageId, uint64 stripeId,
+												TupleDesc tupleDescriptor,
+												StripeSkipList *skipList);
+extern ColumnarCachedStripeList * ColumnarMetadataCacheLookupStripeList(uint64 storageId,
+																		 uint64
+																		 reservedStripeId);
+extern ColumnarCachedStripeList * ColumnarMetadataCacheInsertStripeList(uint64 storageId,
+																		 Oid relationId,
+																		 ColumnarCachedStripeList
+																		 *stripeList);
+extern bool ColumnarCachedStripeListIsVisible(ColumnarCachedStripeList *stripeList,
+											  Snapshot snapshot);
+extern void ColumnarMetadataCacheInvalidateStripeList(uint64 storageId);
+extern void ColumnarMetadataCacheInvalidateStorage(uint64 storageId);
+extern void ColumnarMetadataCacheSizeAssignHook(int newval, void *extra);
+
+#endif /* COLUMNAR_METADATA_CACHE_H */
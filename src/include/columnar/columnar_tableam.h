@@ -5,6 +5,7 @@
 #include "fmgr.h"
 
 #include "access/heapam.h"
+#include "access/relscan.h"
 #include "access/skey.h"
 #include "access/tableam.h"
 #include "catalog/indexing.h"
@@ -13,6 +14,8 @@
 
 #include "citus_version.h"
 
+#include "columnar/columnar.h"
+
 /*
  * Number of valid ItemPointer Offset's for "row number" <> "ItemPointer"
  * mapping.
@@ -49,6 +52,26 @@
 struct ColumnarScanDescData;
 typedef struct ColumnarScanDescData *ColumnarScanDesc;
 
+/*
+ * ParallelColumnarScanDescData is the state shared between the participants
+ * of a parallel scan on a columnar table. Participants claim the stripes to
+ * read one at a time, in the order of their first row numbers.
+ */
+typedef struct ParallelColumnarScanDescData
+{
+	/*
+	 * We only embed the block based parallel scan descriptor of postgres to
+	 * initialize the fields that are common to all table access methods in a
+	 * version independent way, see columnar_parallelscan_initialize.
+	 */
+	ParallelBlockTableScanDescData base;
+
+	/* first row number of the last claimed stripe */
+	pg_atomic_uint64 lastClaimedRowNumber;
+} ParallelColumnarScanDescData;
+
+typedef struct ParallelColumnarScanDescData *ParallelColumnarScanDesc;
+
 
 const TableAmRoutine * GetColumnarTableAmRoutine(void);
 extern void columnar_tableam_init(void);
@@ -58,6 +81,15 @@ extern TableScanDesc columnar_beginscan_extended(Relation relation, Snapshot sna
 												 uint32 flags, Bitmapset *attr_needed,
 												 List *scanQual);
 extern int64 ColumnarScanChunkGroupsFiltered(ColumnarScanDesc columnarScanDesc);
+extern bool ColumnarScanNextBatch(TableScanDesc sscan, TupleTableSlot *slot,
+								  struct ColumnarBatch *batch);
+extern void ColumnarScanMaterializeBatch(TableScanDesc sscan,
+										 struct ColumnarBatch *batch);
+extern void ColumnarScanSetChunkGroupCallback(TableScanDesc sscan,
+											  ColumnarChunkGroupCallback callback,
+											  void *callbackArg);
+extern void ColumnarScanStoreBatchRow(struct ColumnarBatch *batch, uint32 rowIndex,
+									  TupleTableSlot *slot);
 extern PGDLLEXPORT bool ColumnarSupportsIndexAM(char *indexAMName);
 extern bool IsColumnarTableAmTable(Oid relationId);
 extern void CheckCitusColumnarCreateExtensionStmt(Node *parseTree);
@@ -0,0 +1,142 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_vector.h
+ *
+ * Type and function declarations for evaluating quals and aggregates over
+ * the column vectors of a chunk group.
+ *
+ * Copyright (c) Citus Data, Inc.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef COLUMNAR_VECTOR_H
+#define COLUMNAR_VECTOR_H
+
+#include "postgres.h"
+
+#include "fmgr.h"
+
+#include "access/stratnum.h"
+#include "nodes/pg_list.h"
+#include "nodes/primnodes.h"
+
+#include "columnar/columnar.h"
+
+/*
+ * ColumnarVectorFastPath describes how values of a column with a built-in
+ * fixed-width type are compared by the fast path, i.e., without calling the
+ * operator function.
+ */
+typedef enum ColumnarVectorFastPath
+{
+	VECTOR_FAST_PATH_NONE,
+
+	/* int2 */
+	VECTOR_FAST_PATH_INT16,
+
+	/* int4 and date */
+	VECTOR_FAST_PATH_INT32,
+
+	/* int8, timestamp and timestamptz */
+	VECTOR_FAST_PATH_INT64,
+
+	/* float8 */
+	VECTOR_FAST_PATH_FLOAT8
+} ColumnarVectorFastPath;
+
+/*
+ * ColumnarVectorQual represents a qual in the form of "Var op Const" that can
+ * be evaluated over the values of a single column of a chunk group.
+ */
+typedef struct ColumnarVectorQual
+{
+	/* 0-indexed attribute number of the Var */
+	int columnIndex;
+
+	/* operator implementation and the collation to call it with */
+	FmgrInfo operatorFunction;
+	Oid inputCollation;
+
+	Datum constValue;
+
+	/* true if the qual is "Const op Var" */
+	bool varOnRight;
+
+	/*
+	 * If fastPath is not VECTOR_FAST_PATH_NONE, then the qual is equivalent
+	 * to "Var strategy Const" for the btree strategy below (regardless of
+	 * varOnRight), and the constant is converted into intConstValue or
+	 * floatConstValue depending on fastPath.
+	 */
+	ColumnarVectorFastPath fastPath;
+	StrategyNumber strategy;
+	int64 intConstValue;
+	float8 floatConstValue;
+} ColumnarVectorQual;
+
+/*
+ * ColumnarVectorAggregateKind lists the aggregates that can be computed over
+ * column vectors and chunk skip nodes, see BuildColumnarVectorAggregate.
+ */
+typedef enum ColumnarVectorAggregateKind
+{
+	VECTOR_AGGREGATE_COUNT_STAR,
+	VECTOR_AGGREGATE_COUNT,
+	VECTOR_AGGREGATE_MIN,
+	VECTOR_AGGREGATE_MAX,
+	VECTOR_AGGREGATE_SUM
+} ColumnarVectorAggregateKind;
+
+/*
+ * ColumnarVectorAggregate holds the transition state of an aggregate whose
+ * argument is a single column, or of count(*).
+ */
+typedef struct ColumnarVectorAggregate
+{
+	ColumnarVectorAggregateKind kind;
+
+	/* 0-indexed attribute number of the argument, -1 for count(*) */
+	int columnIndex;
+
+	/* type of the argument and how its values are compared and summed */
+	Oid argumentTypeId;
+	ColumnarVectorFastPath fastPath;
+
+	/* number of rows (for count(*)) or non-NULL values aggregated so far */
+	int64 count;
+
+	/*
+	 * Current min/max or sum, depending on fastPath. Sums of int8 values are
+	 * accumulated in intValue until it would overflow, at which point it is
+	 * added to numericSum.
+	 */
+	int64 intValue;
+	float8 floatValue;
+	Datum numericSum;
+	bool hasNumericSum;
+} ColumnarVectorAggregate;
+
+
+extern List * BuildColumnarVectorQuals(List *qualList, bool *allQualsConverted);
+extern List * BuildColumnarFastPathQuals(List *qualList, bool *allQualsConverted);
+extern uint32 ColumnarVectorFilter(List *vectorQualList, ColumnarBatch *batch,
+								   uint32 *selectionVector);
+extern bool ColumnarVectorQualRefutesRange(ColumnarVectorQual *vectorQual,
+										   Datum minimumValue, Datum maximumValue);
+extern bool ColumnarVectorQualImpliedByRange(ColumnarVectorQual *vectorQual,
+											 Datum minimumValue, Datum maximumValue);
+extern ColumnarVectorAggregate * BuildColumnarVectorAggregate(Aggref *aggref);
+extern bool ColumnarVectorAggregateSkipNodeUsable(ColumnarVectorAggregate *aggregate,
+												  bool columnNotNull);
+extern void ColumnarVectorAggregateSkipNode(ColumnarVectorAggregate *aggregate,
+											ColumnChunkSkipNode *chunkSkipNode,
+											uint32 chunkGroupRowCount);
+extern void ColumnarVectorAggregateBatch(ColumnarVectorAggregate *aggregate,
+										 ChunkData *chunkData, uint32 *selectionVector,
+										 uint32 selectedRowCount);
+extern Datum ColumnarVectorAggregateResult(ColumnarVectorAggregate *aggregate,
+										   bool *isNull);
+extern void ColumnarVectorAggregateReset(ColumnarVectorAggregate *aggregate);
+
+#endif /* COLUMNAR_VECTOR_H */
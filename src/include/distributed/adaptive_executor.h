@@ -7,6 +7,9 @@
 extern bool ForceMaxQueryParallelization;
 extern int MaxAdaptiveExecutorPoolSize;
 extern bool EnableBinaryProtocol;
+extern int ExecutorPipelineDepth;
+extern int ExecutorTaskBatchSize;
+extern bool EnableStreamingResults;
 
 
 /* GUC, number of ms to wait between opening connections to the same worker */
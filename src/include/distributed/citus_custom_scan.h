@@ -28,6 +28,18 @@ typedef struct CitusScanState
 	MultiExecutorType executorType;   /* distributed executor type */
 	bool finishedRemoteScan;          /* flag to check if remote scan is finished */
 	Tuplestorestate *tuplestorestate; /* tuple store to store distributed results */
+
+	/*
+	 * Whether the scan never needs to return tuples it already returned, which
+	 * allows the adaptive executor to stream the results of the remote scan.
+	 */
+	bool canStreamResults;
+
+	/* remote execution that is still streaming results into tuplestorestate */
+	struct DistributedExecution *streamingExecution;
+
+	/* flag to check if tuplestorestate was cleared while streaming results */
+	bool streamedResults;
 } CitusScanState;
 
 
@@ -12,6 +12,7 @@
 #include "funcapi.h"
 
 #include "access/tupdesc.h"
+#include "lib/stringinfo.h"
 #include "nodes/params.h"
 #include "nodes/pg_list.h"
 
@@ -37,9 +38,44 @@ extern void ExtractParametersFromParamList(ParamListInfo paramListInfo,
 										   const char ***parameterValues, bool
 										   useOriginalCustomTypeOids);
 
+/*
+ * BinaryAttributeDecoder denotes how an attribute received in binary format
+ * is decoded. Common fixed-width types are decoded directly from the bytes
+ * received over the network, other types use their receive function.
+ */
+typedef enum BinaryAttributeDecoder
+{
+	BINARY_DECODER_RECEIVE_FUNCTION,
+	BINARY_DECODER_DROPPED,
+	BINARY_DECODER_BOOL,
+	BINARY_DECODER_INT2,
+	BINARY_DECODER_INT4,
+	BINARY_DECODER_OID,
+	BINARY_DECODER_INT8,
+	BINARY_DECODER_FLOAT4,
+	BINARY_DECODER_FLOAT8
+} BinaryAttributeDecoder;
+
+/*
+ * BinaryTupleDecoder contains what is needed to decode the attributes of
+ * tuples received in binary format into Datums.
+ */
+typedef struct BinaryTupleDecoder
+{
+	/* receive functions of the attributes */
+	AttInMetadata *attinmeta;
+
+	/* decoder of each attribute */
+	BinaryAttributeDecoder *attributeDecoders;
+} BinaryTupleDecoder;
+
 /* utility functions for processing tuples in the executor */
 extern AttInMetadata * TupleDescGetAttBinaryInMetadata(TupleDesc tupdesc);
 extern HeapTuple BuildTupleFromBytes(AttInMetadata *attinmeta, fmStringInfo *values);
+extern BinaryTupleDecoder * CreateBinaryTupleDecoder(TupleDesc tupdesc);
+extern Datum DecodeBinaryAttribute(BinaryTupleDecoder *decoder, int attributeIndex,
+								   char *value, int valueLength, StringInfo buffer,
+								   bool *isNull);
 
 
 #endif /* EXECUTOR_UTIL_H */
@@ -20,6 +20,7 @@
 
 /* config variable for */
 extern double DistributedDeadlockDetectionTimeoutFactor;
+extern int ColumnarStripeCompactionInterval;
 extern char *MainDb;
 
 extern void StopMaintenanceDaemon(Oid databaseId);
@@ -32,5 +33,6 @@ extern void InitializeMaintenanceDaemonForMainDb(void);
 extern bool LockCitusExtension(void);
 
 extern PGDLLEXPORT void CitusMaintenanceDaemonMain(Datum main_arg);
+extern PGDLLEXPORT void ColumnarCompactionWorkerMain(Datum main_arg);
 
 #endif /* MAINTENANCED_H */
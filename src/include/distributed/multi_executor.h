@@ -78,6 +78,9 @@ extern void CitusExecutorRun(QueryDesc *queryDesc, ScanDirection direction, uint
 							 bool execute_once);
 extern void AdaptiveExecutorPreExecutorRun(CitusScanState *scanState);
 extern TupleTableSlot * AdaptiveExecutor(CitusScanState *scanState);
+extern TupleTableSlot * ReturnTupleFromStreamingExecution(CitusScanState *scanState);
+extern void EndStreamingExecution(CitusScanState *scanState);
+extern void FreeStreamingWaitEventSets(void);
 
 
 /*
@@ -21,6 +21,7 @@ extern PGDLLEXPORT ColumnarSupportsIndexAM_type extern_ColumnarSupportsIndexAM;
 extern PGDLLEXPORT CompressionTypeStr_type extern_CompressionTypeStr;
 extern PGDLLEXPORT IsColumnarTableAmTable_type extern_IsColumnarTableAmTable;
 extern PGDLLEXPORT ReadColumnarOptions_type extern_ReadColumnarOptions;
+extern PGDLLEXPORT ColumnarReadAllRows_type extern_ColumnarReadAllRows;
 
 extern void StartupCitusBackend(void);
 extern const char * GetClientMinMessageLevelNameForValue(int minMessageLevel);
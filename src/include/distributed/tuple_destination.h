@@ -11,6 +11,7 @@
 #define TUPLE_DESTINATION_H
 
 #include "access/tupdesc.h"
+#include "executor/tuptable.h"
 #include "tcop/dest.h"
 #include "utils/tuplestore.h"
 
@@ -50,6 +51,15 @@ struct TupleDestination
 					 int placementIndex, int queryNumber,
 					 HeapTuple tuple, uint64 tupleLibpqSize);
 
+	/*
+	 * putSlot implements custom processing of a tuple in a virtual slot with the
+	 * tuple descriptor of the query, which saves forming a HeapTuple. Could be
+	 * NULL if the destination only implements putTuple.
+	 */
+	void (*putSlot)(TupleDestination *self, Task *task,
+					int placementIndex, int queryNumber,
+					TupleTableSlot *slot, uint64 tupleLibpqSize);
+
 	/* tupleDescForQuery returns tuple descriptor for a query number. Can return NULL. */
 	TupleDesc (*tupleDescForQuery)(TupleDestination *self, int queryNumber);
 
@@ -18,6 +18,8 @@ extern bool EnableBinaryProtocol;
 extern DestReceiver * CreateShardCopyDestReceiver(EState *executorState,
 												  List *destinationShardFullyQualifiedName,
 												  uint32_t destinationNodeId);
+extern void ShardCopyDestReceiverReceiveValues(DestReceiver *dest, Datum *columnValues,
+											   bool *columnNulls);
 
 extern const char * CopyableColumnNamesFromRelationName(const char *schemaName, const
 														char *relationName);
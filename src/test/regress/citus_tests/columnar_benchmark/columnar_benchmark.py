@@ -0,0 +1,358 @@
+#!/usr/bin/env python3
+
+"""Benchmarks for the hot paths of the columnar access method
+
+For every combination of the requested dataset shapes and compression types
+this loads a columnar table from a heap table with the same contents and then
+runs a fixed set of queries against it. Each measurement is printed as a CSV
+(or JSON) row with its rows/sec and bytes/sec throughput, so that runs of
+different builds can be compared by a script.
+
+The phases map to the following parts of the columnar engine:
+
+    load        ColumnarWriteRow, FlushStripe and chunk compression
+    scan_all    DeserializeChunkData for every column of the table
+    scan_one    DeserializeChunkData for a single column
+    filter      SelectedChunkMask chunk group filtering on the key column
+    aggregate   an analytical GROUP BY query over the whole table
+
+bytes/sec is computed from the size of the heap table that the columnar table
+was loaded from, i.e. the uncompressed size of the data the phase processed.
+"""
+
+import argparse
+import csv
+import itertools
+import json
+import os
+import statistics
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+import psycopg
+
+# https://stackoverflow.com/questions/14132789/relative-imports-for-the-billionth-time/14132912#14132912
+sys.path.append(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+# ignore E402 because these imports require addition to path
+import common  # noqa: E402
+
+WIDTHS = {"narrow": 4, "wide": 32}
+CARDINALITIES = {"low": 16, "high": None}
+ORDERS = ["sorted", "random"]
+NULL_FRACTIONS = [0.0, 0.1, 0.5]
+COMPRESSION_TYPES = ["none", "pglz", "lz4", "zstd"]
+PHASES = ["load", "scan_all", "scan_one", "filter", "aggregate"]
+
+# the column types are cycled through for the value columns of a dataset
+COLUMN_TYPES = ["int4", "int8", "float8", "text"]
+
+# fraction of the key range that the filter phase selects
+FILTER_SELECTIVITY = 0.01
+
+# settings that make the measurements reproducible across runs
+SESSION_SETTINGS = {
+    "columnar.chunk_cache_size": "0",
+    "columnar.enable_aggregate_pushdown": "off",
+    "columnar.enable_parallel_scan": "off",
+    "max_parallel_workers_per_gather": "0",
+    "jit": "off",
+}
+
+RESULT_FIELDS = [
+    "dataset",
+    "width",
+    "null_fraction",
+    "cardinality",
+    "order",
+    "compression",
+    "phase",
+    "rows",
+    "seconds",
+    "rows_per_sec",
+    "bytes",
+    "bytes_per_sec",
+    "stored_bytes",
+]
+
+
+def parse_arguments():
+    parser = argparse.ArgumentParser(
+        description="Run throughput benchmarks for the columnar access method"
+    )
+    parser.add_argument(
+        "--conninfo",
+        help="connection string of the server to benchmark, a temporary "
+        "single node server is started if not given",
+    )
+    parser.add_argument("--rows", type=int, default=1_000_000)
+    parser.add_argument(
+        "--repeat",
+        type=int,
+        default=3,
+        help="number of times each phase is run, the median is reported",
+    )
+    parser.add_argument("--widths", default=",".join(WIDTHS))
+    parser.add_argument(
+        "--null-fractions", default=",".join(str(f) for f in NULL_FRACTIONS)
+    )
+    parser.add_argument("--cardinalities", default=",".join(CARDINALITIES))
+    parser.add_argument("--orders", default=",".join(ORDERS))
+    parser.add_argument("--compressions", default=",".join(COMPRESSION_TYPES))
+    parser.add_argument("--phases", default=",".join(PHASES))
+    parser.add_argument(
+        "--compression-workers",
+        type=int,
+        default=0,
+        help="value of columnar.compression_workers during the load phase",
+    )
+    parser.add_argument("--seed", type=float, default=0.5)
+    parser.add_argument("--format", choices=["csv", "json"], default="csv")
+    parser.add_argument(
+        "--output", help="file to write the results to, defaults to stdout"
+    )
+    args = parser.parse_args()
+
+    args.widths = split_choices(parser, args.widths, WIDTHS)
+    args.cardinalities = split_choices(parser, args.cardinalities, CARDINALITIES)
+    args.orders = split_choices(parser, args.orders, ORDERS)
+    args.compressions = split_choices(parser, args.compressions, COMPRESSION_TYPES)
+    # the phases always run in the order of PHASES, the load phase first
+    selected_phases = split_choices(parser, args.phases, PHASES)
+    args.phases = [phase for phase in PHASES if phase in selected_phases]
+    args.null_fractions = [float(f) for f in args.null_fractions.split(",")]
+
+    if "load" not in args.phases:
+        parser.error("the load phase is required to create the tables")
+
+    return args
+
+
+def split_choices(parser, value, choices):
+    selected = value.split(",")
+    for choice in selected:
+        if choice not in choices:
+            parser.error(
+                f"unknown value {choice}, expected one of {', '.join(choices)}"
+            )
+    return selected
+
+
+def value_expression(column_index, column_type, cardinality, rows):
+    """Returns the SQL expression that generates column_index from i"""
+    distinct_values = CARDINALITIES[cardinality] or rows
+
+    # spread the values of different columns using different multipliers
+    value = f"((i * {2 * column_index + 7919}) % {distinct_values})"
+
+    if column_type == "int4":
+        return f"{value}::int4"
+    elif column_type == "int8":
+        return f"{value} * 1000003"
+    elif column_type == "float8":
+        return f"{value} / 7.0::float8"
+    else:
+        return f"'value-' || {value}"
+
+
+def create_source_table(conn, dataset, args):
+    """Creates the heap table that the columnar tables are loaded from"""
+    width, null_fraction, cardinality, order = dataset
+    column_count = WIDTHS[width]
+
+    columns = ["k int8"]
+    expressions = ["i"]
+    for column_index in range(column_count):
+        column_type = COLUMN_TYPES[column_index % len(COLUMN_TYPES)]
+        columns.append(f"c{column_index} {column_type}")
+
+        expression = value_expression(column_index, column_type, cardinality, args.rows)
+        if null_fraction > 0:
+            expression = (
+                f"CASE WHEN random() < {null_fraction} THEN NULL ELSE {expression} END"
+            )
+        expressions.append(expression)
+
+    order_by = "i" if order == "sorted" else "random()"
+
+    conn.execute("DROP TABLE IF EXISTS bench_source")
+    conn.execute(f"CREATE TABLE bench_source ({', '.join(columns)})")
+    conn.execute("SELECT setseed(%s)", (args.seed,))
+    conn.execute(
+        f"INSERT INTO bench_source SELECT {', '.join(expressions)} "
+        f"FROM generate_series(1, {args.rows}) i ORDER BY {order_by}"
+    )
+    conn.execute("VACUUM ANALYZE bench_source")
+
+    return conn.execute("SELECT pg_relation_size('bench_source')").fetchone()[0]
+
+
+def compression_supported(conn, compression):
+    try:
+        conn.execute(f"SET columnar.compression TO '{compression}'")
+        conn.execute("RESET columnar.compression")
+        return True
+    except psycopg.errors.InvalidParameterValue:
+        return False
+
+
+def phase_queries(conn, args):
+    """Returns the query of each phase that runs against bench"""
+    column_list = [
+        row[0]
+        for row in conn.execute(
+            "SELECT attname FROM pg_attribute "
+            "WHERE attrelid = 'bench_source'::regclass AND attnum > 0 "
+            "ORDER BY attnum"
+        )
+    ]
+    filter_width = max(1, int(args.rows * FILTER_SELECTIVITY))
+    filter_start = args.rows // 2
+
+    return {
+        "load": "INSERT INTO bench SELECT * FROM bench_source",
+        "scan_all": "SELECT "
+        + ", ".join(f"count({column})" for column in column_list)
+        + " FROM bench",
+        "scan_one": "SELECT count(c0) FROM bench",
+        "filter": f"SELECT count(c0) FROM bench WHERE k BETWEEN {filter_start} "
+        f"AND {filter_start + filter_width - 1}",
+        "aggregate": "SELECT c0 % 16, count(*), count(c1) FROM bench GROUP BY 1",
+    }
+
+
+def phase_rows(phase, args):
+    """Returns the number of rows the phase reads or writes"""
+    if phase == "filter":
+        return max(1, int(args.rows * FILTER_SELECTIVITY))
+    return args.rows
+
+
+def timed(conn, query):
+    start = time.perf_counter()
+    conn.execute(query)
+    return time.perf_counter() - start
+
+
+def run_dataset(conn, dataset, args, writer):
+    width, null_fraction, cardinality, order = dataset
+    dataset_name = f"{width}-{null_fraction}-{cardinality}-{order}"
+    source_bytes = create_source_table(conn, dataset, args)
+    queries = phase_queries(conn, args)
+
+    for compression in args.compressions:
+        if not compression_supported(conn, compression):
+            common.eprint(f"skipping compression type {compression}, not supported")
+            continue
+
+        conn.execute("DROP TABLE IF EXISTS bench")
+        conn.execute("CREATE TABLE bench (LIKE bench_source) USING columnar")
+        conn.execute(f"ALTER TABLE bench SET (columnar.compression = '{compression}')")
+
+        results = {}
+        for phase in args.phases:
+            timings = []
+            for _ in range(args.repeat):
+                if phase == "load":
+                    conn.execute("TRUNCATE bench")
+                    conn.execute(
+                        f"SET columnar.compression_workers TO {args.compression_workers}"
+                    )
+                timings.append(timed(conn, queries[phase]))
+                if phase == "load":
+                    conn.execute("RESET columnar.compression_workers")
+            results[phase] = statistics.median(timings)
+
+        stored_bytes = conn.execute(
+            "SELECT pg_total_relation_size('bench')"
+        ).fetchone()[0]
+
+        for phase, seconds in results.items():
+            rows = phase_rows(phase, args)
+            processed_bytes = source_bytes * rows // args.rows
+            writer(
+                {
+                    "dataset": dataset_name,
+                    "width": WIDTHS[width],
+                    "null_fraction": null_fraction,
+                    "cardinality": cardinality,
+                    "order": order,
+                    "compression": compression,
+                    "phase": phase,
+                    "rows": rows,
+                    "seconds": round(seconds, 6),
+                    "rows_per_sec": round(rows / seconds),
+                    "bytes": processed_bytes,
+                    "bytes_per_sec": round(processed_bytes / seconds),
+                    "stored_bytes": stored_bytes,
+                }
+            )
+
+    conn.execute("DROP TABLE IF EXISTS bench")
+    conn.execute("DROP TABLE IF EXISTS bench_source")
+
+
+def make_writer(output, output_format):
+    if output_format == "json":
+
+        def write_json(result):
+            output.write(json.dumps(result) + "\n")
+            output.flush()
+
+        return write_json
+
+    csv_writer = csv.DictWriter(output, fieldnames=RESULT_FIELDS)
+    csv_writer.writeheader()
+
+    def write_csv(result):
+        csv_writer.writerow(result)
+        output.flush()
+
+    return write_csv
+
+
+def run_benchmarks(conn, args, output):
+    for setting, value in SESSION_SETTINGS.items():
+        conn.execute(f"SET {setting} TO '{value}'")
+
+    writer = make_writer(output, args.format)
+    datasets = itertools.product(
+        args.widths, args.null_fractions, args.cardinalities, args.orders
+    )
+    for dataset in datasets:
+        run_dataset(conn, dataset, args, writer)
+
+
+def main():
+    args = parse_arguments()
+
+    output = open(args.output, "w", newline="") if args.output else sys.stdout
+
+    try:
+        if args.conninfo:
+            with psycopg.connect(args.conninfo, autocommit=True) as conn:
+                run_benchmarks(conn, args, output)
+            return
+
+        with tempfile.TemporaryDirectory(prefix="columnar_benchmark") as tmpdir:
+            node = common.Postgres(Path(tmpdir) / "coordinator")
+            try:
+                node.init_with_citus()
+
+                # the default test settings are tuned for many small servers
+                node.configure("shared_buffers = '512MB'", "max_wal_size = '4GB'")
+                node.restart()
+
+                with node.conn() as conn:
+                    run_benchmarks(conn, args, output)
+            finally:
+                node.cleanup()
+    finally:
+        if output is not sys.stdout:
+            output.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -58,4 +58,73 @@ SELECT select_for_update();
 
 SET citus.log_remote_commands TO off;
 
+-- pipeline the queries of multiple tasks over a single connection per worker
+SET citus.max_adaptive_executor_pool_size TO 1;
+SET citus.executor_pipeline_depth TO 3;
+SELECT count(*), sum(x) FROM test;
+SELECT x, y FROM test ORDER BY x;
+SET citus.enable_binary_protocol TO off;
+SELECT x, y FROM test ORDER BY x;
+RESET citus.enable_binary_protocol;
+-- the queries of both shards on the worker are sent before any results are
+-- received, hence the notices of the worker follow both queries
+CREATE FUNCTION pipeline_probe(v int) RETURNS bool LANGUAGE plpgsql AS $$
+BEGIN
+  RAISE NOTICE 'probing %', v;
+  RETURN true;
+END;
+$$;
+SET citus.log_remote_commands TO on;
+SELECT x FROM test WHERE x IN (1, 8) AND pipeline_probe(x) ORDER BY x;
+-- without pipelining, the second query is only sent once the first one is done
+SET citus.executor_pipeline_depth TO 1;
+SELECT x FROM test WHERE x IN (1, 8) AND pipeline_probe(x) ORDER BY x;
+SET citus.executor_pipeline_depth TO 3;
+SET citus.log_remote_commands TO off;
+-- a failing query ends the pipeline, later queries use new connections
+SELECT x / (x - 8) FROM test ORDER BY 1;
+SELECT count(*) FROM test;
+RESET citus.executor_pipeline_depth;
+RESET citus.max_adaptive_executor_pool_size;
+
+-- combine the queries of multiple tasks into a single query per worker
+SET citus.max_adaptive_executor_pool_size TO 1;
+SET citus.executor_task_batch_size TO 4;
+SELECT count(*), sum(x) FROM test;
+SELECT x, y FROM test ORDER BY x;
+SELECT x, y FROM test WHERE y = 3;
+SELECT x / (x - 8) FROM test ORDER BY 1;
+SELECT count(*) FROM test;
+RESET citus.executor_task_batch_size;
+RESET citus.max_adaptive_executor_pool_size;
+
+-- return rows while they are still being received from the workers
+SET citus.enable_streaming_results TO on;
+SELECT count(*), sum(x) FROM test;
+SELECT x, y FROM test ORDER BY x;
+-- commands that are still running once the LIMIT is reached are cancelled
+SELECT x > 0 FROM test LIMIT 2;
+SELECT count(*) FROM test;
+-- the window function is computed on the coordinator, hence the LIMIT is not
+-- pushed down and the workers would run out of time producing all rows
+SET statement_timeout TO '10s';
+SELECT row_number() OVER () FROM test, generate_series(1, 1000000000) g LIMIT 3;
+RESET statement_timeout;
+SET citus.max_adaptive_executor_pool_size TO 1;
+SET citus.executor_pipeline_depth TO 3;
+SELECT x > 0 FROM test LIMIT 1;
+SELECT count(*) FROM test;
+-- the pipelined queries that were not started yet are not run either
+SET statement_timeout TO '10s';
+SELECT row_number() OVER () FROM test, generate_series(1, 1000000000) g LIMIT 3;
+RESET statement_timeout;
+RESET citus.executor_pipeline_depth;
+RESET citus.max_adaptive_executor_pool_size;
+SELECT x / (x - 8) FROM test ORDER BY 1;
+-- results are not streamed within transaction blocks
+BEGIN;
+SELECT x, y FROM test ORDER BY x;
+END;
+RESET citus.enable_streaming_results;
+
 DROP SCHEMA adaptive_executor CASCADE;
@@ -103,5 +103,17 @@ SELECT id, val1
 FROM test_table_1 LEFT JOIN test_table_2 USING(id, val1)
 ORDER BY 1, 2;
 
+-- fixed-width types are decoded without calling their receive functions
+CREATE TABLE fixed_width_types(id int, b bool, s int2, i int4, l int8, o oid, f4 float4, f8 float8);
+SELECT create_distributed_table('fixed_width_types', 'id');
+INSERT INTO fixed_width_types VALUES
+  (1, true, -32768, -2147483648, -9223372036854775808, 4294967295, -1.5, 'NaN'),
+  (2, false, 32767, 2147483647, 9223372036854775807, 0, 'Infinity', -0.125),
+  (3, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+SELECT * FROM fixed_width_types ORDER BY id;
+-- domains over fixed-width types still go through the receive function
+CREATE DOMAIN nonnegative_int8 AS int8 CHECK (VALUE >= 0);
+SELECT id, l::nonnegative_int8 FROM fixed_width_types WHERE id > 1 ORDER BY id;
+
 SET client_min_messages TO WARNING;
 DROP SCHEMA binary_protocol CASCADE;
@@ -0,0 +1,87 @@
+--
+-- Test computing aggregates in the columnar custom scan.
+--
+CREATE SCHEMA columnar_aggregate_pushdown;
+SET search_path TO columnar_aggregate_pushdown;
+SET columnar.enable_aggregate_pushdown TO on;
+
+CREATE TABLE agg_test (a int NOT NULL, b bigint, c float8, d text) USING columnar;
+ALTER TABLE agg_test SET (columnar.chunk_group_row_limit = 1000);
+INSERT INTO agg_test
+SELECT i, CASE WHEN i % 10 = 0 THEN NULL ELSE i * 1000 END, i / 4.0, 'x' || i
+FROM generate_series(1, 10000) i;
+
+-- without quals, count(*), min() and max() only need the chunk group metadata
+EXPLAIN (analyze on, costs off, timing off, summary off)
+  SELECT count(*), min(a), max(a) FROM agg_test;
+SELECT count(*), min(a), max(a) FROM agg_test;
+
+-- chunk groups whose rows all pass the quals are aggregated from metadata,
+-- the remaining ones are read
+EXPLAIN (analyze on, costs off, timing off, summary off)
+  SELECT count(*), min(a), max(a) FROM agg_test WHERE a > 2500;
+SELECT count(*), min(a), max(a) FROM agg_test WHERE a > 2500;
+
+-- min() and max() ignore NULLs, but count() of a nullable column needs the data
+EXPLAIN (analyze on, costs off, timing off, summary off)
+  SELECT min(b), max(b) FROM agg_test;
+SELECT min(b), max(b) FROM agg_test;
+EXPLAIN (analyze on, costs off, timing off, summary off)
+  SELECT count(b) FROM agg_test;
+SELECT count(b) FROM agg_test;
+
+-- sum() is always computed over the values
+EXPLAIN (analyze on, costs off, timing off, summary off)
+  SELECT sum(a), sum(b), sum(c), count(b), count(d) FROM agg_test WHERE a <= 5000;
+SELECT sum(a), sum(b), sum(c), count(b), count(d) FROM agg_test WHERE a <= 5000;
+
+-- quals that cannot be vectorized are evaluated row by row
+SELECT count(*), sum(a) FROM agg_test WHERE d LIKE 'x1%';
+
+-- aggregates that are not supported fall back to a regular aggregate
+EXPLAIN (costs off) SELECT avg(a) FROM agg_test;
+SELECT a % 2, count(*) FROM agg_test GROUP BY 1 ORDER BY 1;
+
+-- stripes written before a column was added don't have its metadata
+ALTER TABLE agg_test ADD COLUMN e int NOT NULL DEFAULT 7;
+INSERT INTO agg_test (a, e) SELECT i, 8 FROM generate_series(10001, 11000) i;
+EXPLAIN (analyze on, costs off, timing off, summary off)
+  SELECT count(*), min(e), max(e), count(e) FROM agg_test;
+SELECT count(*), min(e), max(e), count(e) FROM agg_test;
+
+-- chunk groups with only NULLs have no min/max
+CREATE TABLE nulls_test (a int) USING columnar;
+ALTER TABLE nulls_test SET (columnar.chunk_group_row_limit = 1000);
+INSERT INTO nulls_test SELECT CASE WHEN i > 1000 THEN i END FROM generate_series(1, 2000) i;
+SELECT count(*), count(a), min(a), max(a) FROM nulls_test;
+SELECT min(a), max(a) FROM nulls_test WHERE a < 1000;
+
+-- sums of bigint values that don't fit into a bigint
+CREATE TABLE big_sum (v bigint) USING columnar;
+INSERT INTO big_sum SELECT 9223372036854775807 - i FROM generate_series(0, 9) i;
+INSERT INTO big_sum SELECT -9223372036854775807 + i FROM generate_series(0, 4) i;
+EXPLAIN (costs off) SELECT sum(v) FROM big_sum;
+SELECT sum(v) FROM big_sum;
+SELECT sum(v) FROM big_sum WHERE v > 0;
+
+-- params are evaluated when the scan starts
+SET plan_cache_mode TO force_generic_plan;
+PREPARE count_above(int) AS SELECT count(*), max(a) FROM agg_test WHERE a > $1;
+EXECUTE count_above(9000);
+EXECUTE count_above(10500);
+RESET plan_cache_mode;
+
+-- aggregates of subqueries with a different range table index
+SELECT * FROM (SELECT count(*) FROM agg_test WHERE a > 10500) s,
+              (SELECT max(a) FROM agg_test WHERE a < 100) t;
+SELECT count(*) FROM agg_test WHERE a < (SELECT max(a) FROM nulls_test);
+
+-- results are the same without the pushdown
+SELECT count(*), count(b), min(b), max(b), sum(a), sum(b), sum(c), min(c), max(c), min(e)
+FROM agg_test WHERE a % 3 = 0;
+SET columnar.enable_aggregate_pushdown TO off;
+SELECT count(*), count(b), min(b), max(b), sum(a), sum(b), sum(c), min(c), max(c), min(e)
+FROM agg_test WHERE a % 3 = 0;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_aggregate_pushdown CASCADE;
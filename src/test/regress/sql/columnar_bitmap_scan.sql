@@ -0,0 +1,56 @@
+--
+-- Test bitmap heap scans on columnar tables.
+--
+CREATE SCHEMA columnar_bitmap_scan;
+SET search_path TO columnar_bitmap_scan;
+
+CREATE TABLE bitmap_test (a int, b int, c text) USING columnar;
+INSERT INTO bitmap_test SELECT i, i % 100, 'text ' || i FROM generate_series(1, 300000) i;
+
+-- leave a gap in row numbers
+BEGIN;
+  INSERT INTO bitmap_test SELECT i, i % 100, 'text ' || i FROM generate_series(300001, 300010) i;
+ROLLBACK;
+INSERT INTO bitmap_test SELECT i, i % 100, 'text ' || i FROM generate_series(300001, 300010) i;
+
+CREATE INDEX bitmap_test_a_idx ON bitmap_test (a);
+CREATE INDEX bitmap_test_b_idx ON bitmap_test (b);
+ANALYZE bitmap_test;
+
+SET columnar.enable_custom_scan TO off;
+SET enable_seqscan TO off;
+SET enable_indexscan TO off;
+
+-- bitmap heap scans are disabled by default
+EXPLAIN (COSTS OFF) SELECT count(*), sum(a) FROM bitmap_test WHERE a = 1 OR a = 300010;
+
+SET columnar.enable_bitmap_scan TO on;
+
+EXPLAIN (COSTS OFF) SELECT count(*), sum(a) FROM bitmap_test WHERE a = 1 OR a = 300010;
+SELECT count(*), sum(a) FROM bitmap_test WHERE a = 1 OR a = 300010;
+
+-- rows spanning two stripes
+EXPLAIN (COSTS OFF) SELECT count(*), sum(a) FROM bitmap_test WHERE a BETWEEN 149000 AND 151000;
+SELECT count(*), sum(a) FROM bitmap_test WHERE a BETWEEN 149000 AND 151000;
+SELECT a, b, c FROM bitmap_test WHERE a IN (1, 149999, 150000, 150001, 300010) ORDER BY a;
+
+-- rows spread over all chunk groups, with a lossy bitmap
+SET work_mem TO '64kB';
+SELECT count(*), sum(a), min(c), max(c) FROM bitmap_test WHERE b = 7;
+RESET work_mem;
+SELECT count(*), sum(a), min(c), max(c) FROM bitmap_test WHERE b = 7;
+
+-- rows that are not flushed yet
+BEGIN;
+  INSERT INTO bitmap_test VALUES (400007, 7, 'pending');
+  SELECT count(*), sum(a), max(c) FROM bitmap_test WHERE b = 7;
+ROLLBACK;
+
+-- rescans
+SET enable_hashjoin TO off;
+SET enable_mergejoin TO off;
+SELECT v.x, t.c FROM (VALUES (10), (200000), (300005), (400000)) v(x)
+LEFT JOIN bitmap_test t ON t.a = v.x ORDER BY v.x;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_bitmap_scan CASCADE;
@@ -0,0 +1,53 @@
+--
+-- Test bloom filters of columnar chunks.
+--
+CREATE SCHEMA columnar_bloom_filter;
+SET search_path TO columnar_bloom_filter;
+
+CREATE TABLE bloom_test (id int, user_id bigint, country text) USING columnar;
+ALTER TABLE bloom_test SET (columnar.chunk_group_row_limit = 1000,
+                            columnar.bloom_filter_columns = 'user_id');
+SELECT relation, bloom_filter_columns FROM columnar.options
+WHERE relation = 'bloom_test'::regclass;
+
+-- user ids are not sorted, so the min/max values of the chunk groups don't
+-- help with skipping them
+INSERT INTO bloom_test
+  SELECT i, (i * 7919) % 10007, 'country_' || (i % 10) FROM generate_series(1, 10000) i;
+
+EXPLAIN (analyze on, costs off, timing off, summary off)
+SELECT id FROM bloom_test WHERE user_id = 8906;
+SELECT id FROM bloom_test WHERE user_id = 8906;
+
+EXPLAIN (analyze on, costs off, timing off, summary off)
+SELECT id FROM bloom_test WHERE user_id IN (8906, 1483, 123456);
+SELECT id FROM bloom_test WHERE user_id IN (8906, 1483, 123456) ORDER BY id;
+
+-- bloom filter columns are kept when the column is renamed
+ALTER TABLE bloom_test RENAME COLUMN user_id TO uid;
+SELECT relation, bloom_filter_columns FROM columnar.options
+WHERE relation = 'bloom_test'::regclass;
+
+VACUUM FULL bloom_test;
+EXPLAIN (analyze on, costs off, timing off, summary off)
+SELECT id FROM bloom_test WHERE uid = 8906;
+
+-- errors
+ALTER TABLE bloom_test SET (columnar.bloom_filter_columns = 'uid, no_such_column');
+ALTER TABLE bloom_test SET (columnar.bloom_filter_columns = 'uid,');
+
+ALTER TABLE bloom_test SET (columnar.bloom_filter_columns = 'country, id');
+SELECT relation, bloom_filter_columns FROM columnar.options
+WHERE relation = 'bloom_test'::regclass;
+
+-- dropped columns are removed from the list
+ALTER TABLE bloom_test DROP COLUMN country;
+SELECT relation, bloom_filter_columns FROM columnar.options
+WHERE relation = 'bloom_test'::regclass;
+
+ALTER TABLE bloom_test RESET (columnar.bloom_filter_columns);
+SELECT relation, bloom_filter_columns FROM columnar.options
+WHERE relation = 'bloom_test'::regclass;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_bloom_filter CASCADE;
@@ -0,0 +1,66 @@
+--
+-- Test the cache of decompressed columnar chunks.
+--
+CREATE SCHEMA columnar_chunk_cache;
+SET search_path TO columnar_chunk_cache;
+
+CREATE TABLE cache_test (a int, b text) USING columnar;
+ALTER TABLE cache_test SET (columnar.chunk_group_row_limit = 1000,
+                            columnar.compression = pglz);
+INSERT INTO cache_test SELECT i, repeat('x', 100) || (i % 10) FROM generate_series(1, 3000) i;
+
+-- the cache is disabled by default
+SHOW columnar.chunk_cache_size;
+SELECT sum(length(b)) FROM cache_test;
+SELECT hits, misses, evictions, entries, cache_size > 0 AS has_data
+FROM columnar.chunk_cache_stats();
+
+SET columnar.chunk_cache_size TO '1MB';
+
+-- the first scan decompresses the chunks of b and caches them
+SELECT sum(length(b)) FROM cache_test;
+SELECT hits, misses, evictions, entries, cache_size > 0 AS has_data
+FROM columnar.chunk_cache_stats();
+
+-- later scans copy them from the cache
+SELECT sum(length(b)) FROM cache_test;
+SELECT count(*) FROM cache_test WHERE b LIKE '%7';
+SELECT hits, misses, evictions, entries, cache_size > 0 AS has_data
+FROM columnar.chunk_cache_stats();
+
+-- vacuum drops the cached chunks of the relation
+VACUUM cache_test;
+SELECT hits, misses, evictions, entries, cache_size > 0 AS has_data
+FROM columnar.chunk_cache_stats();
+SELECT sum(length(b)) FROM cache_test;
+SELECT hits, misses, evictions, entries, cache_size > 0 AS has_data
+FROM columnar.chunk_cache_stats();
+
+-- lowering the cache size evicts the least recently used chunks
+SET columnar.chunk_cache_size TO '256kB';
+SELECT hits, misses, evictions, entries, cache_size > 0 AS has_data
+FROM columnar.chunk_cache_stats();
+
+-- so does truncate
+TRUNCATE cache_test;
+SELECT hits, misses, evictions, entries, cache_size > 0 AS has_data
+FROM columnar.chunk_cache_stats();
+
+-- truncating a table created in the same transaction reuses its relfilenode,
+-- scans after that must not see the chunks cached before it
+BEGIN;
+CREATE TABLE cache_test_2 (b text) USING columnar;
+ALTER TABLE cache_test_2 SET (columnar.compression = pglz);
+INSERT INTO cache_test_2 SELECT repeat('a', 100) FROM generate_series(1, 1000);
+SELECT DISTINCT b FROM cache_test_2;
+TRUNCATE cache_test_2;
+INSERT INTO cache_test_2 SELECT repeat('b', 100) FROM generate_series(1, 1000);
+SELECT DISTINCT b FROM cache_test_2;
+COMMIT;
+
+-- disabling the cache releases it
+SET columnar.chunk_cache_size TO 0;
+SELECT evictions, entries, cache_size FROM columnar.chunk_cache_stats();
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_chunk_cache CASCADE;
@@ -0,0 +1,53 @@
+--
+-- Test per-column compression settings of columnar tables.
+--
+CREATE SCHEMA columnar_column_compression;
+SET search_path TO columnar_column_compression;
+
+SET columnar.compression TO 'pglz';
+SET columnar.chunk_group_row_limit TO 1000;
+SET columnar.stripe_row_limit TO 3000;
+SET columnar.enable_encoding TO off;
+
+CREATE TABLE metrics (a int, payload text, notes text, "Reading" float8) USING columnar;
+ALTER TABLE metrics SET (columnar.column_compression =
+  'payload:pglz:5, notes:auto, "Reading":none');
+SELECT relation, compression, compression_level, column_compression
+FROM columnar.options WHERE relation = 'metrics'::regclass;
+
+INSERT INTO metrics
+SELECT i, repeat('payload ', 20) || i, repeat('note ', 20) || (i % 10), i * 0.5
+FROM generate_series(1, 3000) i;
+
+-- chunks of auto columns that don't compress well are stored uncompressed
+SET columnar.auto_compression_min_ratio TO 100;
+INSERT INTO metrics
+SELECT i, repeat('payload ', 20) || i, repeat('note ', 20) || (i % 10), i * 0.5
+FROM generate_series(3001, 6000) i;
+RESET columnar.auto_compression_min_ratio;
+
+-- compression type 0 is none, 1 is pglz
+SELECT stripe_num, attr_num, value_compression_type, value_compression_level, count(*)
+FROM columnar.chunk WHERE relation = 'metrics'::regclass AND attr_num > 1
+GROUP BY 1, 2, 3, 4 ORDER BY 1, 2, 3, 4;
+
+SELECT count(*), sum(length(payload)), count(DISTINCT notes), sum("Reading")
+FROM metrics;
+
+-- settings follow renamed columns and skip dropped ones
+ALTER TABLE metrics RENAME COLUMN notes TO remarks;
+ALTER TABLE metrics DROP COLUMN payload;
+SELECT column_compression FROM columnar.options WHERE relation = 'metrics'::regclass;
+
+-- errors
+ALTER TABLE metrics SET (columnar.column_compression = 'no_such_column:none');
+ALTER TABLE metrics SET (columnar.column_compression = 'remarks:snappy');
+ALTER TABLE metrics SET (columnar.column_compression = 'remarks:pglz:99');
+ALTER TABLE metrics SET (columnar.column_compression = 'remarks');
+ALTER TABLE metrics SET (columnar.column_compression = 'ctid:none');
+
+ALTER TABLE metrics RESET (columnar.column_compression);
+SELECT column_compression FROM columnar.options WHERE relation = 'metrics'::regclass;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_column_compression CASCADE;
@@ -0,0 +1,56 @@
+--
+-- Test merging small columnar stripes.
+--
+CREATE SCHEMA columnar_compact_stripes;
+SET search_path TO columnar_compact_stripes;
+
+SET columnar.stripe_row_limit TO 1000;
+SET columnar.chunk_group_row_limit TO 1000;
+
+CREATE TABLE small_stripes (a int, b text) USING columnar;
+
+-- each insert writes a stripe of its own
+INSERT INTO small_stripes SELECT i, 'row ' || i FROM generate_series(1, 300) i;
+INSERT INTO small_stripes SELECT i, 'row ' || i FROM generate_series(301, 600) i;
+INSERT INTO small_stripes SELECT i, 'row ' || i FROM generate_series(601, 900) i;
+INSERT INTO small_stripes SELECT i, 'row ' || i FROM generate_series(901, 1900) i;
+INSERT INTO small_stripes SELECT i, 'row ' || i FROM generate_series(1901, 2300) i;
+INSERT INTO small_stripes SELECT i, 'row ' || i FROM generate_series(2301, 2700) i;
+INSERT INTO small_stripes SELECT i, 'row ' || i FROM generate_series(2701, 2800) i;
+
+SELECT stripe_num, row_count FROM columnar.stripe
+WHERE relation = 'small_stripes'::regclass ORDER BY stripe_num;
+
+-- merging is undone on rollback
+BEGIN;
+SELECT columnar.compact_stripes('small_stripes');
+SELECT stripe_num, row_count FROM columnar.stripe
+WHERE relation = 'small_stripes'::regclass ORDER BY stripe_num;
+ROLLBACK;
+SELECT stripe_num, row_count FROM columnar.stripe
+WHERE relation = 'small_stripes'::regclass ORDER BY stripe_num;
+SELECT count(*), sum(a), count(DISTINCT b) FROM small_stripes;
+
+-- the full stripe in the middle is kept, the stripes around it are merged
+SELECT columnar.compact_stripes('small_stripes');
+SELECT stripe_num, row_count FROM columnar.stripe
+WHERE relation = 'small_stripes'::regclass ORDER BY stripe_num;
+SELECT count(*), sum(a), count(DISTINCT b) FROM small_stripes;
+SELECT count(*) FROM small_stripes WHERE b <> 'row ' || a;
+
+-- merging the last two stripes wouldn't reduce the number of stripes
+SELECT columnar.compact_stripes('small_stripes');
+
+-- the rows of the merged stripes get new row numbers, which indexes refer to
+CREATE TABLE indexed (a int PRIMARY KEY) USING columnar;
+INSERT INTO indexed VALUES (1);
+INSERT INTO indexed VALUES (2);
+SELECT columnar.compact_stripes('indexed');
+-- the maintenance daemon skips such tables via nowait
+SELECT columnar.compact_stripes('indexed', nowait => true);
+
+CREATE TABLE heap_table (a int);
+SELECT columnar.compact_stripes('heap_table');
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_compact_stripes CASCADE;
@@ -0,0 +1,86 @@
+--
+-- Test compressing columnar chunks in background workers.
+--
+CREATE SCHEMA columnar_compression_workers;
+SET search_path TO columnar_compression_workers;
+
+SET columnar.compression TO 'pglz';
+SET columnar.chunk_group_row_limit TO 1000;
+SET columnar.stripe_row_limit TO 5000;
+
+CREATE TABLE serial_load (a int, b text) USING columnar;
+CREATE TABLE parallel_load (a int, b text) USING columnar;
+
+-- chunks are compressed inline by default
+SHOW columnar.compression_workers;
+INSERT INTO serial_load SELECT i, repeat('abc', i % 40) FROM generate_series(1, 12345) i;
+
+SET columnar.compression_workers TO 3;
+INSERT INTO parallel_load SELECT i, repeat('abc', i % 40) FROM generate_series(1, 12345) i;
+
+-- chunks are compressed the same way regardless of where they are compressed
+CREATE FUNCTION chunk_layout(rel regclass)
+RETURNS TABLE (stripe_num bigint, attr_num int, chunk_group_num int,
+               value_stream_length bigint, value_compression_type int,
+               value_decompressed_length bigint)
+LANGUAGE sql AS $$
+  SELECT stripe_num, attr_num, chunk_group_num, value_stream_length,
+         value_compression_type, value_decompressed_length
+  FROM columnar.chunk WHERE relation = rel
+$$;
+
+SELECT count(*) FROM chunk_layout('parallel_load');
+-- compression type 1 is pglz
+SELECT count(*) > 0 AS has_compressed_chunks
+FROM chunk_layout('parallel_load') WHERE value_compression_type = 1;
+SELECT count(*) FROM (
+  SELECT * FROM chunk_layout('serial_load')
+  EXCEPT
+  SELECT * FROM chunk_layout('parallel_load')
+) differences;
+
+SELECT count(*), sum(a), sum(length(b)) FROM serial_load;
+SELECT count(*), sum(a), sum(length(b)) FROM parallel_load;
+SELECT count(*) FROM (
+  SELECT * FROM serial_load
+  EXCEPT
+  SELECT * FROM parallel_load
+) differences;
+
+-- rows buffered across statements of a transaction
+BEGIN;
+INSERT INTO parallel_load SELECT i, repeat('abc', i % 40) FROM generate_series(1, 3000) i;
+INSERT INTO parallel_load SELECT i, repeat('abc', i % 40) FROM generate_series(1, 3000) i;
+SELECT count(*), sum(length(b)) FROM parallel_load;
+COMMIT;
+SELECT count(*), sum(length(b)) FROM parallel_load;
+
+-- writes discarded by rolled back subtransactions and transactions
+BEGIN;
+INSERT INTO parallel_load SELECT i, repeat('abc', i % 40) FROM generate_series(1, 3000) i;
+SAVEPOINT s1;
+INSERT INTO parallel_load SELECT i, repeat('xyz', i % 40) FROM generate_series(1, 3000) i;
+ROLLBACK TO SAVEPOINT s1;
+INSERT INTO parallel_load SELECT i, repeat('abc', i % 40) FROM generate_series(1, 1500) i;
+COMMIT;
+SELECT count(*), sum(length(b)) FROM parallel_load;
+SELECT count(*) FROM parallel_load WHERE b LIKE 'xyz%';
+
+BEGIN;
+INSERT INTO parallel_load SELECT i, repeat('xyz', i % 40) FROM generate_series(1, 3000) i;
+ROLLBACK;
+SELECT count(*), sum(length(b)) FROM parallel_load;
+
+-- workers are not used when chunks are not compressed
+SET columnar.compression TO 'none';
+CREATE TABLE uncompressed_load (a int, b text) USING columnar;
+INSERT INTO uncompressed_load SELECT i, repeat('abc', i % 40) FROM generate_series(1, 3000) i;
+SELECT DISTINCT value_compression_type FROM chunk_layout('uncompressed_load');
+
+RESET columnar.compression_workers;
+RESET columnar.compression;
+RESET columnar.chunk_group_row_limit;
+RESET columnar.stripe_row_limit;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_compression_workers CASCADE;
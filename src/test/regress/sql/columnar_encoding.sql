@@ -0,0 +1,56 @@
+--
+-- Test lightweight encodings of chunk values in columnar.
+--
+CREATE SCHEMA columnar_encoding;
+SET search_path TO columnar_encoding;
+
+SET columnar.enable_encoding TO on;
+SET columnar.compression TO 'none';
+SET columnar.chunk_group_row_limit TO 1000;
+
+-- each column is expected to pick a different encoding:
+-- a: delta, b: frame-of-reference, c: dictionary, d: run-length,
+-- e: delta, f: run-length, g: run-length, h and i: none
+CREATE TABLE encoded (a int, b int8, c text, d text, e timestamp, f float8,
+                      g int, h int, i text) USING columnar;
+CREATE TABLE plain (LIKE encoded);
+
+INSERT INTO encoded
+  SELECT i, i % 7, 'category_' || (i % 3), 'group_' || (i / 500),
+         '2024-01-01'::timestamp + i * interval '1 second', floor(i / 100),
+         CASE WHEN i % 2 = 0 THEN NULL ELSE 42 END, NULL, md5(i::text)
+  FROM generate_series(1, 3000) i;
+INSERT INTO plain SELECT * FROM encoded;
+
+SELECT attr_num, value_encoding_type, count(*)
+FROM columnar.chunk WHERE relation = 'encoded'::regclass
+GROUP BY 1, 2 ORDER BY 1, 2;
+
+-- verify that encoded values are decoded correctly
+SELECT count(*) FROM (SELECT * FROM encoded EXCEPT ALL SELECT * FROM plain) diff;
+SELECT count(*) FROM (SELECT * FROM plain EXCEPT ALL SELECT * FROM encoded) diff;
+
+SELECT count(*), sum(a), sum(b) FROM encoded WHERE c = 'category_1' AND d = 'group_3';
+SELECT a, b, c, d, e, f, g, h FROM encoded WHERE a IN (1, 1000, 1999, 3000) ORDER BY a;
+
+-- differences that overflow int8 should be handled
+CREATE TABLE extremes (v int8) USING columnar;
+INSERT INTO extremes
+  SELECT CASE WHEN i % 2 = 0 THEN -9223372036854775808 ELSE 9223372036854775807 END
+  FROM generate_series(1, 1000) i;
+SELECT DISTINCT value_encoding_type FROM columnar.chunk WHERE relation = 'extremes'::regclass;
+SELECT min(v), max(v), count(*) FILTER (WHERE v > 0) FROM extremes;
+
+-- chunks are not encoded when encodings are disabled
+SET columnar.enable_encoding TO off;
+CREATE TABLE not_encoded (a int) USING columnar;
+INSERT INTO not_encoded SELECT i FROM generate_series(1, 3000) i;
+SELECT DISTINCT value_encoding_type FROM columnar.chunk WHERE relation = 'not_encoded'::regclass;
+
+-- rewriting the table removes the encodings
+VACUUM FULL encoded;
+SELECT DISTINCT value_encoding_type FROM columnar.chunk WHERE relation = 'encoded'::regclass;
+SELECT count(*) FROM (SELECT * FROM encoded EXCEPT ALL SELECT * FROM plain) diff;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_encoding CASCADE;
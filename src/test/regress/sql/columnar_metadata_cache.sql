@@ -0,0 +1,59 @@
+--
+-- Test the cache of columnar stripe lists and skip lists.
+--
+CREATE SCHEMA columnar_metadata_cache;
+SET search_path TO columnar_metadata_cache;
+
+CREATE TABLE cache_test (a int) USING columnar;
+INSERT INTO cache_test SELECT generate_series(1, 1000);
+INSERT INTO cache_test SELECT generate_series(1001, 2000);
+INSERT INTO cache_test SELECT generate_series(2001, 3000);
+
+SHOW columnar.metadata_cache_size;
+
+-- the first scan caches the stripe list and the skip lists of the 3 stripes
+SELECT sum(a) FROM cache_test WHERE a > 0;
+SELECT entries, cache_size > 0 AS has_data FROM columnar.metadata_cache_stats();
+
+-- later scans don't read them from the catalog tables again
+CREATE TEMP TABLE stats_before AS SELECT * FROM columnar.metadata_cache_stats();
+SELECT sum(a) FROM cache_test WHERE a > 0;
+SELECT s.hits > b.hits AS has_hits, s.misses = b.misses AS no_misses, s.entries
+FROM columnar.metadata_cache_stats() s, stats_before b;
+
+-- writing to the table makes the cached stripe list stale
+INSERT INTO cache_test SELECT generate_series(3001, 4000);
+SELECT sum(a) FROM cache_test WHERE a > 0;
+SELECT entries FROM columnar.metadata_cache_stats();
+
+-- stripes written by a running transaction are not cached
+BEGIN;
+INSERT INTO cache_test SELECT generate_series(4001, 5000);
+SELECT sum(a) FROM cache_test WHERE a > 0;
+SELECT entries FROM columnar.metadata_cache_stats();
+ROLLBACK;
+SELECT sum(a) FROM cache_test WHERE a > 0;
+SELECT entries FROM columnar.metadata_cache_stats();
+
+-- truncate drops the cached metadata of the old storage
+TRUNCATE cache_test;
+SELECT entries FROM columnar.metadata_cache_stats();
+SELECT sum(a) FROM cache_test WHERE a > 0;
+
+-- so does deleting stripes when compacting them
+INSERT INTO cache_test SELECT generate_series(1, 1000);
+INSERT INTO cache_test SELECT generate_series(1001, 2000);
+INSERT INTO cache_test SELECT generate_series(2001, 3000);
+SELECT sum(a) FROM cache_test WHERE a > 0;
+SELECT columnar.compact_stripes('cache_test');
+SELECT sum(a) FROM cache_test WHERE a > 0;
+SELECT entries FROM columnar.metadata_cache_stats();
+
+-- disabling the cache releases it
+SET columnar.metadata_cache_size TO 0;
+SELECT entries, cache_size FROM columnar.metadata_cache_stats();
+SELECT sum(a) FROM cache_test WHERE a > 0;
+SELECT entries, cache_size FROM columnar.metadata_cache_stats();
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_metadata_cache CASCADE;
@@ -0,0 +1,49 @@
+--
+-- Test parallel scans on columnar tables.
+--
+CREATE SCHEMA columnar_parallel_scan;
+SET search_path TO columnar_parallel_scan;
+
+SET columnar.stripe_row_limit TO 10000;
+
+CREATE TABLE parallel_scan (a int, b int, c text) USING columnar;
+INSERT INTO parallel_scan SELECT i, i % 100, 'text_' || i FROM generate_series(1, 150000) i;
+
+-- stripes of aborted transactions should be skipped
+BEGIN;
+INSERT INTO parallel_scan SELECT i, i, 'aborted' FROM generate_series(1, 20000) i;
+ROLLBACK;
+
+SET columnar.enable_parallel_scan TO on;
+SET max_parallel_workers_per_gather TO 2;
+SET parallel_setup_cost TO 0;
+SET parallel_tuple_cost TO 0;
+SET min_parallel_table_scan_size TO 0;
+
+EXPLAIN (costs off) SELECT count(*), sum(a) FROM parallel_scan;
+SELECT count(*), sum(a) FROM parallel_scan;
+SELECT count(*), sum(a) FROM parallel_scan WHERE b < 10;
+SELECT count(DISTINCT c) FROM parallel_scan;
+
+-- without the custom scan, we should do a parallel seq scan
+SET columnar.enable_custom_scan TO off;
+EXPLAIN (costs off) SELECT count(*), sum(a) FROM parallel_scan;
+SELECT count(*), sum(a) FROM parallel_scan;
+SELECT count(*), sum(a) FROM parallel_scan WHERE b < 10;
+RESET columnar.enable_custom_scan;
+
+-- pending writes can't be flushed in parallel mode, so don't scan in parallel
+BEGIN;
+INSERT INTO parallel_scan VALUES (150001, 1, 'pending');
+EXPLAIN (costs off) SELECT count(*), sum(a) FROM parallel_scan;
+SELECT count(*), sum(a) FROM parallel_scan;
+ROLLBACK;
+
+-- results should be the same without parallel scans
+SET columnar.enable_parallel_scan TO off;
+EXPLAIN (costs off) SELECT count(*), sum(a) FROM parallel_scan;
+SELECT count(*), sum(a) FROM parallel_scan;
+SELECT count(*), sum(a) FROM parallel_scan WHERE b < 10;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_parallel_scan CASCADE;
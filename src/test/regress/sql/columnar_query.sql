@@ -128,3 +128,27 @@ INSERT INTO tbl1(c0) VALUES('[0,1]'::int4range);
 SELECT tbl1.c0 FROM tbl1 JOIN tbl2 ON tbl1.c0=tbl2.c0 WHERE tbl2.c0<=tbl2.c0 ISNULL;
 DROP TABLE tbl1;
 DROP TABLE tbl2;
+
+-- results shouldn't depend on how far ahead we prefetch
+SET columnar.stripe_row_limit TO 1000;
+SET columnar.chunk_group_row_limit TO 1000;
+CREATE TABLE prefetch_test (a int, b text, c int) USING columnar;
+INSERT INTO prefetch_test SELECT i, repeat('x', i % 50), i % 7 FROM generate_series(1, 5000) i;
+CREATE TEMP TABLE prefetch_temp USING columnar AS SELECT * FROM prefetch_test;
+RESET columnar.stripe_row_limit;
+RESET columnar.chunk_group_row_limit;
+
+SET columnar.prefetch_depth TO 1;
+SELECT count(*), sum(a), sum(length(b)) FROM prefetch_test;
+SELECT count(*), sum(a), sum(length(b)) FROM prefetch_test WHERE c = 3;
+SELECT count(*), sum(a), sum(length(b)) FROM prefetch_temp WHERE c = 3;
+SET columnar.prefetch_depth TO 0;
+SELECT count(*), sum(a), sum(length(b)) FROM prefetch_test;
+SELECT count(*), sum(a), sum(length(b)) FROM prefetch_test WHERE c = 3;
+SELECT count(*), sum(a), sum(length(b)) FROM prefetch_temp WHERE c = 3;
+RESET columnar.prefetch_depth;
+SELECT count(*), sum(a), sum(length(b)) FROM prefetch_test;
+SELECT count(*), sum(a), sum(length(b)) FROM prefetch_test WHERE c = 3;
+SELECT count(*), sum(a), sum(length(b)) FROM prefetch_temp WHERE c = 3;
+
+DROP TABLE prefetch_test, prefetch_temp;
@@ -0,0 +1,68 @@
+--
+-- Test writing the rows of columnar stripes in sort key order.
+--
+CREATE SCHEMA columnar_sort_key;
+SET search_path TO columnar_sort_key;
+
+SET columnar.chunk_group_row_limit TO 1000;
+SET columnar.stripe_row_limit TO 3000;
+
+CREATE TABLE sorted (id int, k int, p point) USING columnar;
+ALTER TABLE sorted SET (columnar.sort_key = 'k, id');
+SELECT relation, sort_key FROM columnar.options
+WHERE relation = 'sorted'::regclass;
+
+-- k decreases as rows are inserted, but each stripe is written in k order
+INSERT INTO sorted SELECT i, (6001 - i) / 2 FROM generate_series(1, 6000) i;
+SELECT stripe_num, chunk_group_num, minimum_value, maximum_value
+FROM columnar.chunk
+WHERE relation = 'sorted'::regclass AND attr_num = 2
+ORDER BY stripe_num, chunk_group_num;
+SELECT id, k FROM sorted LIMIT 4;
+SELECT count(*), sum(id), sum(k) FROM sorted;
+
+-- so the min/max values of the chunk groups can be used to skip them
+EXPLAIN (analyze on, costs off, timing off, summary off)
+SELECT id FROM sorted WHERE k = 1200;
+SELECT id FROM sorted WHERE k = 1200 ORDER BY id;
+
+-- errors
+ALTER TABLE sorted SET (columnar.sort_key = 'k, no_such_column');
+ALTER TABLE sorted SET (columnar.sort_key = 'k,');
+ALTER TABLE sorted SET (columnar.sort_key = 'ctid');
+ALTER TABLE sorted SET (columnar.sort_key = 'p');
+
+-- the sort key is kept when a column is renamed
+ALTER TABLE sorted RENAME COLUMN k TO key;
+SELECT relation, sort_key FROM columnar.options
+WHERE relation = 'sorted'::regclass;
+
+ALTER TABLE sorted RESET (columnar.sort_key);
+SELECT relation, sort_key FROM columnar.options
+WHERE relation = 'sorted'::regclass;
+
+-- rows are written in insertion order when an index refers to them
+CREATE TABLE indexed (id int, k int) USING columnar;
+ALTER TABLE indexed SET (columnar.sort_key = 'k');
+CREATE INDEX indexed_id_idx ON indexed (id);
+INSERT INTO indexed SELECT i, (6001 - i) / 2 FROM generate_series(1, 6000) i;
+SELECT stripe_num, chunk_group_num, minimum_value, maximum_value
+FROM columnar.chunk
+WHERE relation = 'indexed'::regclass AND attr_num = 2
+ORDER BY stripe_num, chunk_group_num;
+
+-- VACUUM FULL writes the whole table in sort key order and rebuilds the index
+VACUUM FULL indexed;
+SELECT stripe_num, chunk_group_num, minimum_value, maximum_value
+FROM columnar.chunk
+WHERE relation = 'indexed'::regclass AND attr_num = 2
+ORDER BY stripe_num, chunk_group_num;
+
+BEGIN;
+  SET LOCAL enable_seqscan TO off;
+  SET LOCAL columnar.enable_custom_scan TO off;
+  SELECT id, k FROM indexed WHERE id IN (1, 3000, 6000) ORDER BY id;
+ROLLBACK;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_sort_key CASCADE;
@@ -0,0 +1,63 @@
+--
+-- Test writing small columnar stripes as staging stripes.
+--
+CREATE SCHEMA columnar_staging;
+SET search_path TO columnar_staging;
+
+SET columnar.compression TO 'pglz';
+SET columnar.chunk_group_row_limit TO 1000;
+SET columnar.stripe_row_limit TO 1000;
+
+CREATE TABLE events (a int, b text) USING columnar;
+
+-- staging is disabled by default
+SHOW columnar.staging_row_limit;
+INSERT INTO events VALUES (1, repeat('x', 100) || 1);
+
+-- warns since the maintenance daemon does not merge stripes in tests
+SET columnar.staging_row_limit TO 100;
+
+-- small transactions write staging stripes
+INSERT INTO events SELECT i, repeat('x', 100) || i FROM generate_series(2, 50) i;
+BEGIN;
+  INSERT INTO events VALUES (51, repeat('x', 100) || 51);
+  INSERT INTO events VALUES (52, repeat('x', 100) || 52);
+COMMIT;
+
+-- larger stripes are written as usual
+INSERT INTO events SELECT i, repeat('x', 100) || i FROM generate_series(53, 252) i;
+
+-- compression type 0 is none, 1 is pglz
+SELECT stripe_num, row_count, value_compression_type
+FROM columnar.stripe JOIN columnar.chunk USING (relation, stripe_num)
+WHERE relation = 'events'::regclass AND attr_num = 2 ORDER BY stripe_num;
+SELECT count(*), sum(a), count(DISTINCT b) FROM events;
+SELECT a FROM events WHERE a IN (1, 50, 51, 52, 53) ORDER BY a;
+
+-- merging writes the rows of staging stripes compressed
+SELECT columnar.compact_stripes('events');
+SELECT stripe_num, row_count, value_compression_type
+FROM columnar.stripe JOIN columnar.chunk USING (relation, stripe_num)
+WHERE relation = 'events'::regclass AND attr_num = 2 ORDER BY stripe_num;
+SELECT count(*), sum(a), count(DISTINCT b) FROM events;
+
+-- stripes of tables with indexes cannot be merged, so they are not staged
+CREATE TABLE indexed (a int PRIMARY KEY, b text) USING columnar;
+INSERT INTO indexed VALUES (1, repeat('x', 100) || 1);
+SELECT stripe_num, row_count, value_compression_type
+FROM columnar.stripe JOIN columnar.chunk USING (relation, stripe_num)
+WHERE relation = 'indexed'::regclass AND attr_num = 2 ORDER BY stripe_num;
+
+-- stripes written after an index is created in the same transaction are not staged
+CREATE TABLE late_index (a int, b text) USING columnar;
+BEGIN;
+  INSERT INTO late_index VALUES (1, repeat('x', 100) || 1);
+  CREATE INDEX late_index_a ON late_index (a);
+  INSERT INTO late_index VALUES (2, repeat('x', 100) || 2);
+COMMIT;
+SELECT stripe_num, row_count, value_compression_type
+FROM columnar.stripe JOIN columnar.chunk USING (relation, stripe_num)
+WHERE relation = 'late_index'::regclass AND attr_num = 2 ORDER BY stripe_num;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_staging CASCADE;
@@ -0,0 +1,67 @@
+--
+-- Test vectorized evaluation of pushed-down quals in columnar custom scan.
+--
+CREATE SCHEMA columnar_vectorization;
+SET search_path TO columnar_vectorization;
+
+SET columnar.qual_pushdown_correlation_threshold TO 0.0;
+SET columnar.chunk_group_row_limit TO 1000;
+
+CREATE TABLE vectorized (a int, b text, c float8) USING columnar;
+INSERT INTO vectorized SELECT i, 'text_' || (i % 10), i / 2.0 FROM generate_series(1, 5000) i;
+INSERT INTO vectorized VALUES (NULL, NULL, NULL);
+
+SET columnar.enable_vectorization TO on;
+SELECT count(*), sum(a) FROM vectorized WHERE a > 4500;
+SELECT count(*) FROM vectorized WHERE b = 'text_3';
+SELECT count(*) FROM vectorized WHERE 100 >= a AND c < 10;
+SELECT count(*) FROM vectorized WHERE a > 1000 AND b = 'text_7' AND c <= 1500;
+
+-- rescans with parameterized quals
+SELECT count(*) FROM generate_series(4995, 4999) s,
+  LATERAL (SELECT * FROM vectorized WHERE a > s) v;
+
+-- results should be the same without vectorization
+SET columnar.enable_vectorization TO off;
+SELECT count(*), sum(a) FROM vectorized WHERE a > 4500;
+SELECT count(*) FROM vectorized WHERE b = 'text_3';
+SELECT count(*) FROM vectorized WHERE 100 >= a AND c < 10;
+SELECT count(*) FROM vectorized WHERE a > 1000 AND b = 'text_7' AND c <= 1500;
+SELECT count(*) FROM generate_series(4995, 4999) s,
+  LATERAL (SELECT * FROM vectorized WHERE a > s) v;
+RESET columnar.enable_vectorization;
+
+-- comparisons on fixed-width columns take the fast path both for chunk group
+-- filtering and for vectorized evaluation
+CREATE TABLE fast_path (s int2, l int8, d date, t timestamp, f float8) USING columnar;
+INSERT INTO fast_path
+  SELECT i, i * 10, '2020-01-01'::date + i, '2020-01-01'::timestamp + i * interval '1 hour', i / 4.0
+  FROM generate_series(1, 5000) i;
+INSERT INTO fast_path VALUES (NULL, NULL, NULL, NULL, NULL);
+INSERT INTO fast_path VALUES (NULL, NULL, NULL, NULL, 'NaN');
+
+SELECT count(*) FROM fast_path WHERE s BETWEEN 1200 AND 1300;
+SELECT count(*) FROM fast_path WHERE 10 > s;
+SELECT count(*) FROM fast_path WHERE l = 25000;
+SELECT count(*) FROM fast_path WHERE d < '2020-01-11';
+SELECT count(*) FROM fast_path WHERE t >= '2020-07-01';
+SELECT count(*) FROM fast_path WHERE f > 1249.5;
+SELECT count(*) FROM fast_path WHERE f = 'NaN';
+
+EXPLAIN (analyze on, costs off, timing off, summary off)
+  SELECT l FROM fast_path WHERE l = 25000;
+
+-- columns that are not referenced by the quals are deserialized only for the
+-- chunk groups that have rows passing the quals
+CREATE TABLE late_mat (a int, b text, c int, d text) USING columnar;
+INSERT INTO late_mat SELECT i, 'b_' || i, i * 2, repeat('d', i % 7) FROM generate_series(1, 5000) i;
+ALTER TABLE late_mat ADD COLUMN e int DEFAULT 42;
+INSERT INTO late_mat VALUES (5001, NULL, NULL, NULL, NULL);
+
+SELECT * FROM late_mat WHERE b = 'b_1500';
+SELECT count(*), sum(c), max(d), sum(e) FROM late_mat WHERE a > 4990;
+SELECT s, v.a, v.d, v.e FROM generate_series(2000, 6000, 2000) s,
+  LATERAL (SELECT * FROM late_mat WHERE c = s) v ORDER BY s;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_vectorization CASCADE;
@@ -0,0 +1,73 @@
+SELECT columnar_test_helpers.compression_type_supported('zstd') AS zstd_supported \gset
+\if :zstd_supported
+\else
+\q
+\endif
+
+CREATE SCHEMA columnar_zstd_dictionary;
+SET search_path TO columnar_zstd_dictionary;
+
+SET columnar.compression TO 'zstd';
+SET columnar.chunk_group_row_limit TO 1000;
+SET columnar.enable_encoding TO off;
+
+CREATE TABLE events (id int, payload text) USING columnar;
+INSERT INTO events
+SELECT i, 'user ' || (i % 97) || ' clicked ' ||
+          (ARRAY['home', 'search', 'cart', 'checkout', 'profile'])[i % 5 + 1] ||
+          ' at step ' || i
+FROM generate_series(1, 20000) i;
+
+-- a small stripe compressed without a dictionary
+INSERT INTO events
+SELECT i, 'user ' || (i % 97) || ' clicked ' ||
+          (ARRAY['home', 'search', 'cart', 'checkout', 'profile'])[i % 5 + 1] ||
+          ' at step ' || i
+FROM generate_series(20001, 20100) i;
+
+-- errors
+SELECT columnar.train_zstd_dictionary('events', 100);
+CREATE TABLE empty_table (a int) USING columnar;
+SELECT columnar.train_zstd_dictionary('empty_table');
+CREATE TABLE heap_table (a int);
+SELECT columnar.train_zstd_dictionary('heap_table');
+
+SELECT columnar.train_zstd_dictionary('events', 4096) >= 32768 AS trained;
+
+-- a small stripe compressed with the dictionary
+INSERT INTO events
+SELECT i, 'user ' || (i % 97) || ' clicked ' ||
+          (ARRAY['home', 'search', 'cart', 'checkout', 'profile'])[i % 5 + 1] ||
+          ' at step ' || i
+FROM generate_series(20101, 20200) i;
+
+-- compression type 3 is zstd
+SELECT stripe_num, value_compression_type FROM columnar.chunk
+WHERE relation = 'events'::regclass AND attr_num = 2 AND stripe_num > 1
+ORDER BY stripe_num;
+
+SELECT with_dictionary.value_stream_length < without_dictionary.value_stream_length
+       AS dictionary_compresses_better
+FROM columnar.chunk with_dictionary, columnar.chunk without_dictionary
+WHERE with_dictionary.relation = 'events'::regclass AND with_dictionary.attr_num = 2 AND
+      with_dictionary.stripe_num = 3 AND
+      without_dictionary.relation = 'events'::regclass AND
+      without_dictionary.attr_num = 2 AND without_dictionary.stripe_num = 2;
+
+-- the dictionary is read back in a new backend to decompress the chunks
+\c - - - :master_port
+SET search_path TO columnar_zstd_dictionary;
+
+SELECT count(*), sum(length(payload)) FROM events;
+SELECT * FROM events WHERE id IN (20050, 20150) ORDER BY id;
+
+-- rewriting the table discards the dictionary
+SELECT count(*) FROM columnar_internal.zstd_dictionary d, columnar.storage s
+WHERE d.storage_id = s.storage_id AND s.relation = 'events'::regclass;
+VACUUM FULL events;
+SELECT count(*) FROM columnar_internal.zstd_dictionary d, columnar.storage s
+WHERE d.storage_id = s.storage_id AND s.relation = 'events'::regclass;
+SELECT count(*), sum(length(payload)) FROM events;
+
+SET client_min_messages TO WARNING;
+DROP SCHEMA columnar_zstd_dictionary CASCADE;
@@ -144,7 +144,9 @@ WHERE pg_namespace.oid=pg_class.relnamespace AND
                                'chunk_pkey',
                                'options_pkey',
                                'stripe_first_row_number_idx',
-                               'stripe_pkey');
+                               'stripe_pkey',
+                               'zstd_dictionary_pkey',
+                               'zstd_dictionary_storage_id_idx');
 SELECT refobjid INTO columnar_schema_members_pg_depend
 FROM pg_depend
 WHERE classid = 'pg_am'::regclass::oid AND
@@ -160,8 +162,8 @@ UNION
 (TABLE columnar_schema_members_pg_depend EXCEPT TABLE columnar_schema_members);
 
 -- ... , and both columnar_schema_members_pg_depend & columnar_schema_members
--- should have 5 entries.
-SELECT COUNT(*)=5 FROM columnar_schema_members_pg_depend;
+-- should have 7 entries.
+SELECT COUNT(*)=7 FROM columnar_schema_members_pg_depend;
 
 DROP TABLE columnar_schema_members, columnar_schema_members_pg_depend;
 
@@ -177,7 +179,9 @@ WHERE pg_namespace.oid=pg_class.relnamespace AND
                                'chunk_pkey',
                                'options_pkey',
                                'stripe_first_row_number_idx',
-                               'stripe_pkey');
+                               'stripe_pkey',
+                               'zstd_dictionary_pkey',
+                               'zstd_dictionary_storage_id_idx');
 SELECT refobjid INTO columnar_schema_members_pg_depend
 FROM pg_depend
 WHERE classid = 'pg_am'::regclass::oid AND
@@ -199,7 +203,7 @@ $$
 
 SELECT success, result FROM run_command_on_workers(
 $$
-SELECT COUNT(*)=5 FROM columnar_schema_members_pg_depend;
+SELECT COUNT(*)=7 FROM columnar_schema_members_pg_depend;
 $$
 );
 
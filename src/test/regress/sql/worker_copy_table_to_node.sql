@@ -42,6 +42,36 @@ SET search_path TO worker_copy_table_to_node;
 
 SELECT count(*) FROM t_62629600;
 
+\c - - - :master_port
+SET search_path TO worker_copy_table_to_node;
+SET citus.shard_count TO 1;
+SET citus.shard_replication_factor TO 1;
+SET citus.next_shard_id TO 62629610;
+
+-- Columnar shards are read directly from the columnar storage, make sure
+-- that dropped and generated columns and NULLs are handled
+CREATE TABLE tc(a int, b text, c int, d int GENERATED ALWAYS AS (a * 2) STORED) USING columnar;
+ALTER TABLE tc DROP COLUMN c;
+INSERT INTO tc (a, b) SELECT i, CASE WHEN i % 10 = 0 THEN NULL ELSE 'v' || i END
+FROM generate_series(1, 1000) i;
+SELECT create_distributed_table('tc', 'a');
+
+\c - - - :worker_2_port
+SET search_path TO worker_copy_table_to_node;
+
+CREATE TABLE tc_62629610(a int, b text, d int GENERATED ALWAYS AS (a * 2) STORED) USING columnar;
+
+\c - - - :worker_1_port
+SET search_path TO worker_copy_table_to_node;
+
+SELECT worker_copy_table_to_node('tc_62629610', :worker_2_node);
+
+\c - - - :worker_2_port
+SET search_path TO worker_copy_table_to_node;
+
+SELECT count(*), count(b), sum(a), sum(d), max(b) FROM tc_62629610;
+SELECT * FROM tc_62629610 WHERE a IN (9, 10) ORDER BY a;
+
 \c - - - :master_port
 SET search_path TO worker_copy_table_to_node;
 